@@ -113,6 +113,16 @@ MojomValidationResult MojomArray_Validate(
     uint32_t in_num_handles,
     struct MojomValidationContext* inout_context);
 
+// Validates and decodes the mojom array described by the |inout_array| buffer
+// in a single pass. See MojomStruct_ValidateAndDecode().
+MojomValidationResult MojomArray_ValidateAndDecode(
+    const struct MojomTypeDescriptorArray* in_type_desc,
+    struct MojomArrayHeader* inout_array,
+    uint32_t in_array_size,
+    MojoHandle* inout_handles,
+    uint32_t in_num_handles,
+    struct MojomValidationContext* inout_context);
+
 // Creates a new copy of |in_array| using |buffer| to allocate space.
 // Recursively creates new copies of any references from |in_array|, and updates
 // the references to point to the new copies. This operation is useful if you
@@ -7,10 +7,22 @@
 
 #include <mojo/macros.h>
 #include <mojo/system/handle.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 MOJO_BEGIN_EXTERN_C
 
+struct MojomBuffer;
+
+// A caller-supplied function that makes room in |buffer| once it runs out:
+// it must set |buffer->buf| to a buffer of at least |min_buf_size| bytes (and
+// |buffer->buf_size| to its size) that starts with the first
+// |buffer->num_bytes_used| bytes of the old one, which may mean moving them
+// (e.g., using realloc()). Returns false if it can't, in which case |buffer|
+// must be left as it was.
+typedef bool (*MojomBufferGrowFunction)(struct MojomBuffer* buffer,
+                                        uint32_t min_buf_size);
+
 // |MojomBuffer| is used to track a buffer state for mojom serialization. The
 // user must initialize this struct themselves. See the fields for details.
 struct MojomBuffer {
@@ -20,10 +32,18 @@ struct MojomBuffer {
   // Must be initialized to 0. MojomBuffer_Allocate() will update it as it
   // consumes |buf|.
   uint32_t num_bytes_used;
+  // Optional (may be NULL): called by MojomBuffer_Allocate() to grow |buf|
+  // when there isn't enough space left, instead of failing. Note that if it
+  // moves |buf|, any pointers into the old |buf| become invalid; see
+  // MojomStruct_DeepCopyAndEncode() for a way to serialize into such a buffer.
+  MojomBufferGrowFunction grow;
+  // For use by |grow|.
+  void* grow_context;
 };
 
-// Allocates |num_bytes| (rounded up to 8 bytes) from |buf|. Returns NULL if
-// there isn't enough space left to allocate.
+// Allocates |num_bytes| (rounded up to 8 bytes) from |buf|, growing it (using
+// |buf->grow|, if set) if needed. The space gained by growing is zeroed. Returns
+// NULL if there isn't enough space left to allocate.
 void* MojomBuffer_Allocate(struct MojomBuffer* buf, uint32_t num_bytes);
 
 // |MojomHandleBuffer| is used to track handle offsets during serialization.
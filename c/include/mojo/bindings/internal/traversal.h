@@ -0,0 +1,160 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file contains the traversal engine that implements the operations on
+// mojom structs, arrays and unions (computing the serialized size, encoding,
+// decoding, validation, optionally decoding as it goes, and deep copying,
+// optionally encoding the copy as it is made) for the C bindings.
+//
+// Rather than recursing (through the |MojomType_Dispatch*()| functions) for
+// every nested struct and array, the engine walks the object graph using an
+// explicit stack of (at most |MOJOM_TRAVERSAL_MAX_DEPTH|) frames. Unions, which
+// have at most one field that needs visiting, don't take up a frame. Objects
+// nested more deeply than the stack allows are rejected by validation; for the
+// other (trusted) operations the engine continues with a new stack instead.
+// Since the stack is explicit, validation can also stop when it reaches data
+// that hasn't arrived yet, and pick up from there once it has.
+//
+// The user is not expected to call these directly -- use the
+// |MojomStruct_*()|, |MojomArray_*()| and |MojomUnion_*()| functions instead.
+
+#ifndef MOJO_PUBLIC_C_INCLUDE_MOJO_BINDINGS_INTERNAL_TRAVERSAL_H_
+#define MOJO_PUBLIC_C_INCLUDE_MOJO_BINDINGS_INTERNAL_TRAVERSAL_H_
+
+#include <mojo/bindings/buffer.h>
+#include <mojo/bindings/internal/type_descriptor.h>
+#include <mojo/bindings/internal/util.h>
+#include <mojo/bindings/validation.h>
+#include <mojo/macros.h>
+#include <mojo/system/handle.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+MOJO_BEGIN_EXTERN_C
+
+// The maximum number of nested structs, maps and arrays (including the
+// outermost one) that validation accepts.
+#define MOJOM_TRAVERSAL_MAX_DEPTH 100u
+
+// The number of frames on a stack: one for each of the nested structs and
+// arrays, plus one for a field at the root and one for the frame being set up
+// above the top one.
+#define MOJOM_TRAVERSAL_STACK_SIZE (MOJOM_TRAVERSAL_MAX_DEPTH + 2u)
+
+// A struct (or map) or array whose fields (or elements) are being visited, or
+// a single field.
+struct MojomTraversalFrame {
+  // One of MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR, _MAP_PTR or _ARRAY_PTR, or
+  // (if |is_field|) the type of the field.
+  enum MojomTypeDescriptorType type;
+  // (Only when deep copying and encoding) the offset of the copy of |data| in
+  // the buffer, which may move.
+  uint32_t out_offset;
+  const void* type_desc;
+  // The struct or array, and (only when deep copying) its copy.
+  char* data;
+  char* out_data;
+  // Size of the buffer backing |data| (starting at |data|), in bytes.
+  uint32_t buf_size;
+  // Index of the next struct entry or array element to visit, and the number
+  // of them (0 if none of them need visiting).
+  uint32_t next_index;
+  uint32_t num_fields;
+  bool is_field;
+  // Only used if |is_field|.
+  bool nullable;
+};
+
+// The state of a validation that is carried out as the data to be validated
+// arrives (see |MojomStruct_BeginIncrementalValidation()|). It is only known
+// to the traversal engine.
+struct MojomIncrementalValidation {
+  enum MojomTypeDescriptorType type;
+  const void* type_desc;
+  char* data;
+  uint32_t buf_size;
+  uint32_t num_handles;
+  struct MojomValidationContext context;
+  // The result so far; MOJOM_VALIDATION_INCOMPLETE until it is known.
+  MojomValidationResult result;
+  // Whether the header of |data| has been validated, so that the fields on
+  // |stack| (up to and including the frame at |top|) are being visited.
+  bool entered;
+  uint32_t top;
+  struct MojomTraversalFrame stack[MOJOM_TRAVERSAL_STACK_SIZE];
+};
+
+// In the following, |in_type| must be MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR,
+// MOJOM_TYPE_DESCRIPTOR_TYPE_MAP_PTR or MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR,
+// |in_type_desc| the corresponding type descriptor, and the data the struct (or
+// map) or array itself (not a pointer to it). See |MojomStruct_*()| for the
+// meanings of the other arguments.
+
+size_t MojomTraversal_ComputeSerializedSize(
+    enum MojomTypeDescriptorType in_type,
+    const void* in_type_desc,
+    const void* in_data);
+
+void MojomTraversal_EncodePointersAndHandles(
+    enum MojomTypeDescriptorType in_type,
+    const void* in_type_desc,
+    void* inout_data,
+    uint32_t in_buf_size,
+    struct MojomHandleBuffer* inout_handles_buffer);
+
+void MojomTraversal_DecodePointersAndHandles(
+    enum MojomTypeDescriptorType in_type,
+    const void* in_type_desc,
+    void* inout_data,
+    uint32_t in_buf_size,
+    MojoHandle* inout_handles,
+    uint32_t in_num_handles);
+
+MojomValidationResult MojomTraversal_Validate(
+    enum MojomTypeDescriptorType in_type,
+    const void* in_type_desc,
+    const void* in_data,
+    uint32_t in_buf_size,
+    uint32_t in_num_handles,
+    struct MojomValidationContext* inout_context);
+
+void MojomTraversal_BeginIncrementalValidation(
+    enum MojomTypeDescriptorType in_type,
+    const void* in_type_desc,
+    const void* in_data,
+    uint32_t in_buf_size,
+    uint32_t in_num_handles,
+    struct MojomIncrementalValidation* out_validation);
+
+MojomValidationResult MojomTraversal_ContinueIncrementalValidation(
+    struct MojomIncrementalValidation* inout_validation,
+    uint32_t in_num_bytes_received);
+
+MojomValidationResult MojomTraversal_ValidateAndDecode(
+    enum MojomTypeDescriptorType in_type,
+    const void* in_type_desc,
+    void* inout_data,
+    uint32_t in_buf_size,
+    MojoHandle* inout_handles,
+    uint32_t in_num_handles,
+    struct MojomValidationContext* inout_context);
+
+bool MojomTraversal_DeepCopy(struct MojomBuffer* buffer,
+                             enum MojomTypeDescriptorType in_type,
+                             const void* in_type_desc,
+                             const void* in_data,
+                             void** out_data);
+
+bool MojomTraversal_DeepCopyAndEncode(
+    struct MojomBuffer* buffer,
+    enum MojomTypeDescriptorType in_type,
+    const void* in_type_desc,
+    const void* in_data,
+    struct MojomHandleBuffer* inout_handles_buffer,
+    uint32_t* out_offset);
+
+MOJO_END_EXTERN_C
+
+#endif  // MOJO_PUBLIC_C_INCLUDE_MOJO_BINDINGS_INTERNAL_TRAVERSAL_H_
@@ -75,6 +75,10 @@ struct MojomTypeDescriptorStructVersion {
   uint32_t num_bytes;
 };
 
+// Flags summarizing the contents of an object described by a type descriptor;
+// see below.
+typedef uint32_t MojomTypeDescriptorFlags;
+
 // Mojom structs are described using this struct.
 struct MojomTypeDescriptorStruct {
   uint32_t num_versions;
@@ -84,6 +88,13 @@ struct MojomTypeDescriptorStruct {
   // reference or handle type.
   uint32_t num_entries;
   const struct MojomTypeDescriptorStructEntry* entries;
+  // Flags (MOJOM_TYPE_DESCRIPTOR_FLAG_POINTER_FREE and
+  // MOJOM_TYPE_DESCRIPTOR_FLAG_HANDLE_FREE) that the bindings generator knows
+  // to hold for every struct of this type and everything it references, which
+  // would otherwise take a walk over |entries| (and theirs) to work out. Since
+  // a union may hold a field of a newer version than its type descriptor knows
+  // about, these are never set for structs with union fields. May be 0.
+  MojomTypeDescriptorFlags flags;
 };
 
 // This struct is used to describe each entry in a mojom struct. Each entry
@@ -148,6 +159,27 @@ struct MojomTypeDescriptorArray {
   bool nullable;
 };
 
+// Flags summarizing the contents of an object described by a type descriptor,
+// as returned by |MojomType_GetFlags()|. These let the encoding, decoding,
+// validation and copying code skip over whole subtrees (or use tighter loops)
+// where possible.
+#define MOJOM_TYPE_DESCRIPTOR_FLAG_NONE ((MojomTypeDescriptorFlags)0)
+// The object contains no pointers or handles (e.g., a struct with only POD
+// fields, or an array of POD elements). Once the pointer to such an object has
+// been dealt with, its contents need no encoding or decoding, validating it
+// only requires validating its header, and copying it is just a |memcpy()|.
+// Implies the two flags below.
+#define MOJOM_TYPE_DESCRIPTOR_FLAG_POINTER_AND_HANDLE_FREE \
+  ((MojomTypeDescriptorFlags)1 << 0)
+// The object contains no pointers, though it may contain handles. Its
+// serialized size is just its own |num_bytes|, and copying it is just a
+// |memcpy()|.
+#define MOJOM_TYPE_DESCRIPTOR_FLAG_POINTER_FREE \
+  ((MojomTypeDescriptorFlags)1 << 1)
+// Neither the object nor anything it references contains any handles.
+#define MOJOM_TYPE_DESCRIPTOR_FLAG_HANDLE_FREE \
+  ((MojomTypeDescriptorFlags)1 << 2)
+
 // This describes a mojom string.
 // A mojom string is a mojom array of chars without a fixed-sized.
 extern const struct MojomTypeDescriptorArray g_mojom_string_type_description;
@@ -158,6 +190,16 @@ extern const struct MojomTypeDescriptorArray g_mojom_string_type_description;
 // them here.
 bool MojomType_IsPointer(enum MojomTypeDescriptorType type);
 
+// Returns the |MojomTypeDescriptorFlags| for the object of type |type|
+// described by |type_desc|. This is cheap to compute (it only looks at
+// |type_desc| itself and, for an array, the descriptor of its elements, since
+// struct and union descriptors only have entries for pointer and handle fields
+// and struct descriptors carry the flags that the generator worked out), but
+// callers processing many elements of the same type (e.g., in an array) should
+// compute it once up front.
+MojomTypeDescriptorFlags MojomType_GetFlags(enum MojomTypeDescriptorType type,
+                                            const void* type_desc);
+
 // This helper function, depending on |type|, calls the appropriate
 // *_ComputeSerializedSize(|type_desc|, |data|).
 size_t MojomType_DispatchComputeSerializedSize(
@@ -166,6 +208,41 @@ size_t MojomType_DispatchComputeSerializedSize(
     bool nullable,
     const void* data);
 
+// Encodes |*inout_pointer| in place, from a pointer to an offset. The pointer
+// must point within |in_max_offset| bytes of |inout_pointer| (or be null).
+void MojomType_EncodePointer(union MojomPointer* inout_pointer,
+                             uint32_t in_max_offset);
+
+// Decodes |*inout_pointer| in place, from an offset to a pointer.
+void MojomType_DecodePointer(union MojomPointer* inout_pointer);
+
+// Encodes the handle |*inout_handle| in place, moving it into
+// |inout_handles_buffer| and replacing it with its index there.
+void MojomType_EncodeHandle(bool in_nullable,
+                            MojoHandle* inout_handle,
+                            struct MojomHandleBuffer* inout_handles_buffer);
+
+// Decodes the handle |*inout_handle| in place, replacing its index into
+// |inout_handles| with the handle (which is removed from |inout_handles|).
+void MojomType_DecodeHandle(MojoHandle* inout_handle,
+                            MojoHandle* inout_handles,
+                            uint32_t in_num_handles);
+
+// Validates the encoded pointer |*in_pointer| (which may be at most
+// |in_max_offset|), updating |inout_context|.
+MojomValidationResult MojomType_ValidatePointer(
+    const union MojomPointer* in_pointer,
+    size_t in_max_offset,
+    bool in_nullable,
+    struct MojomValidationContext* inout_context);
+
+// Validates the encoded handle |in_encoded_handle|, updating |inout_context|.
+MojomValidationResult MojomType_ValidateHandle(
+    MojoHandle in_encoded_handle,
+    uint32_t in_num_handles,
+    bool in_nullable,
+    struct MojomValidationContext* inout_context);
+
 // This helper function, depending on |in_elem_type|, calls the appropriate
 // *_EncodePointersAndHandles(...). If |in_elem_type| describes a pointer, it
 // first encodes the pointer before calling the associated
@@ -202,6 +279,18 @@ MojomValidationResult MojomType_DispatchValidate(
     uint32_t in_num_handles,
     struct MojomValidationContext* inout_context);
 
+// Like MojomType_DispatchValidate(), but also decodes |inout_buf| as it is
+// validated (see MojomStruct_ValidateAndDecode()).
+MojomValidationResult MojomType_DispatchValidateAndDecode(
+    enum MojomTypeDescriptorType in_elem_type,
+    const void* in_type_desc,
+    bool in_nullable,
+    void* inout_buf,
+    uint32_t in_buf_size,
+    MojoHandle* inout_handles,
+    uint32_t in_num_handles,
+    struct MojomValidationContext* inout_context);
+
 // This helper function, depending on |in_elem_type|, calls the appropriate
 // *_DeepCopy(...). The result of that call is then assigned to |out_data|. If
 // |in_type_type| describes a pointer to a union, it allocates space for the
@@ -5,9 +5,15 @@
 #ifndef MOJO_PUBLIC_C_INCLUDE_MOJO_BINDINGS_MESSAGE_H_
 #define MOJO_PUBLIC_C_INCLUDE_MOJO_BINDINGS_MESSAGE_H_
 
+#include <mojo/bindings/buffer.h>
+#include <mojo/bindings/internal/type_descriptor.h>
 #include <mojo/bindings/struct.h>
 #include <mojo/bindings/validation.h>
 #include <mojo/macros.h>
+#include <mojo/system/handle.h>
+#include <mojo/system/result.h>
+#include <mojo/system/time.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 MOJO_BEGIN_EXTERN_C
@@ -71,6 +77,196 @@ MojomValidationResult MojomMessage_ValidateRequestWithoutResponse(
 // already validated by MojomMessage_ValidateHeader().
 MojomValidationResult MojomMessage_ValidateResponse(const void* in_buf);
 
+// Building and sending messages -----------------------------------------------
+
+// Serializes a message into |buffer| (which must be empty, i.e., have
+// |num_bytes_used| == 0): a message header with the given |ordinal| and
+// |flags| (a MojomMessageWithRequestId with |request_id| if |flags| has
+// MOJOM_MESSAGE_FLAGS_EXPECTS_RESPONSE or MOJOM_MESSAGE_FLAGS_IS_RESPONSE set,
+// otherwise a MojomMessage), followed by its parameters |in_params| (described
+// by |in_params_type_desc|), in a single pass (see
+// MojomStruct_DeepCopyAndEncode()). On success, the message is
+// |buffer->buf[0, buffer->num_bytes_used)| and its handles are in
+// |inout_handles_buffer|. Returns false if |buffer| or |inout_handles_buffer|
+// runs out of space.
+bool MojomMessage_Build(
+    struct MojomBuffer* buffer,
+    uint32_t ordinal,
+    uint32_t flags,
+    uint64_t request_id,
+    const struct MojomTypeDescriptorStruct* in_params_type_desc,
+    const struct MojomStructHeader* in_params,
+    struct MojomHandleBuffer* inout_handles_buffer);
+
+// Writes the message built in |buffer| and |handles_buffer| (see
+// MojomMessage_Build()) to |message_pipe|. On success, the handles are
+// transferred (so the ones in the parameters the message was built from must
+// no longer be used); otherwise they are left alone. Returns the result of
+// MojoWriteMessage().
+MojoResult MojomMessage_Write(MojoHandle message_pipe,
+                              const struct MojomBuffer* buffer,
+                              const struct MojomHandleBuffer* handles_buffer);
+
+// Dispatching messages --------------------------------------------------------
+
+struct MojomMessageDispatcher;
+
+// Handles a request (for which the message header and parameters have been
+// validated, and the parameters decoded). |message| is the message header (a
+// MojomMessageWithRequestId if the request expects a response, in which case
+// the handler should reply using MojomMessageDispatcher_SendResponse()), and
+// |params| its parameters, which own any handles in them. Both are only valid
+// during the call.
+typedef void (*MojomMessageRequestHandler)(
+    struct MojomMessageDispatcher* dispatcher,
+    const struct MojomMessage* message,
+    struct MojomStructHeader* params);
+
+// Handles the (validated and decoded) parameters |params| of a response to a
+// request sent using MojomMessageDispatcher_SendRequest(). |params| is only
+// valid during the call.
+typedef void (*MojomMessageResponseCallback)(void* context,
+                                             struct MojomStructHeader* params);
+
+// Called when a dispatcher stops dispatching because reading from its message
+// pipe failed with |result| (e.g., MOJO_SYSTEM_RESULT_FAILED_PRECONDITION if
+// the peer was closed), or because a message failed validation with
+// |validation_result| (in which case |result| is MOJO_RESULT_OK); either way,
+// the message pipe should be closed. See
+// MojomMessageDispatcher_WaitAndDispatch().
+typedef void (*MojomMessageErrorHandler)(
+    struct MojomMessageDispatcher* dispatcher,
+    MojoResult result,
+    MojomValidationResult validation_result);
+
+// Describes how requests with a given ordinal are handled.
+struct MojomMessageHandler {
+  uint32_t ordinal;
+  // Whether requests must have MOJOM_MESSAGE_FLAGS_EXPECTS_RESPONSE set (or
+  // must not).
+  bool expects_response;
+  // Describes the request's parameters struct.
+  const struct MojomTypeDescriptorStruct* params_type_desc;
+  MojomMessageRequestHandler handler;
+};
+
+// An entry in the table of requests awaiting responses. A slot is free if its
+// |callback| is NULL.
+struct MojomMessageResponseSlot {
+  uint64_t request_id;
+  // The ordinal of the request (which the response must have).
+  uint32_t ordinal;
+  // Describes the response's parameters struct.
+  const struct MojomTypeDescriptorStruct* params_type_desc;
+  MojomMessageResponseCallback callback;
+  void* context;
+};
+
+// |MojomMessageDispatcher| reads messages from a message pipe, validates them
+// and dispatches requests to the handler for their ordinal and responses to
+// the callback for their request ID, and sends requests and responses over the
+// same message pipe. It doesn't allocate memory: the user must initialize this
+// struct themselves. See the fields for details.
+struct MojomMessageDispatcher {
+  MojoHandle message_pipe;
+  // The handlers for incoming requests, sorted by ordinal.
+  const struct MojomMessageHandler* handlers;
+  uint32_t num_handlers;
+  // The table of requests awaiting responses, indexed by request ID (modulo
+  // |num_response_slots|, which must be a power of two). All slots must be
+  // initialized to be free. It limits the number of requests that can await
+  // responses at once; it may be NULL (with |num_response_slots| 0) if no
+  // requests expecting responses are sent.
+  struct MojomMessageResponseSlot* response_slots;
+  uint32_t num_response_slots;
+  // Must be initialized to 0. The request ID of the next request expecting a
+  // response (unless its slot is still in use, in which case the next ID with
+  // a free slot is used).
+  uint64_t next_request_id;
+  // Optional (may be NULL): see MojomMessageDispatcher_WaitAndDispatch().
+  MojomMessageErrorHandler on_error;
+  // For use by the handlers, response callbacks and |on_error|.
+  void* context;
+  // Messages are read into |read_buffer|, which must be 8-byte aligned; it is
+  // grown (using |read_buffer.grow|, if set) to fit larger messages. Their
+  // handles are read into |read_handles_buffer.handles|.
+  struct MojomBuffer read_buffer;
+  struct MojomHandleBuffer read_handles_buffer;
+  // Messages are built in |write_buffer| and |write_handles_buffer|, which are
+  // reset by each send.
+  struct MojomBuffer write_buffer;
+  struct MojomHandleBuffer write_handles_buffer;
+};
+
+// Sends a request with the given |ordinal| and parameters |in_params|
+// (described by |in_params_type_desc|; see MojomMessage_Build()). If
+// |response_callback| is non-NULL, the request expects a response, and
+// |response_callback| will be called with |response_context| and the
+// response's parameters (described by |response_params_type_desc|) when it is
+// dispatched.
+//
+// Returns:
+//   |MOJO_RESULT_OK| if the request was sent.
+//   |MOJO_SYSTEM_RESULT_RESOURCE_EXHAUSTED| if there is no free response slot
+//       for the request, or the request doesn't fit in |write_buffer| or
+//       |write_handles_buffer|.
+//   Otherwise, the (failure) result of MojoWriteMessage().
+MojoResult MojomMessageDispatcher_SendRequest(
+    struct MojomMessageDispatcher* dispatcher,
+    uint32_t ordinal,
+    const struct MojomTypeDescriptorStruct* in_params_type_desc,
+    const struct MojomStructHeader* in_params,
+    const struct MojomTypeDescriptorStruct* response_params_type_desc,
+    MojomMessageResponseCallback response_callback,
+    void* response_context);
+
+// Sends the response, with parameters |in_params| (described by
+// |in_params_type_desc|), to |request| (which must expect a response). Returns
+// as MojomMessageDispatcher_SendRequest() does.
+MojoResult MojomMessageDispatcher_SendResponse(
+    struct MojomMessageDispatcher* dispatcher,
+    const struct MojomMessage* request,
+    const struct MojomTypeDescriptorStruct* in_params_type_desc,
+    const struct MojomStructHeader* in_params);
+
+// Reads a message from the dispatcher's message pipe and, if it is valid,
+// dispatches it. Any handles in the message that aren't in its parameters are
+// closed, as are all its handles if it is invalid.
+//
+// Returns:
+//   |MOJO_RESULT_OK| if a message was read. |*out_validation_result| is set to
+//       MOJOM_VALIDATION_ERROR_NONE if it was dispatched; otherwise, it was
+//       invalid (an unexpected ordinal, or a response whose request ID doesn't
+//       match a request awaiting one, is reported as
+//       MOJOM_VALIDATION_MESSAGE_HEADER_UNKNOWN_METHOD or
+//       MOJOM_VALIDATION_MESSAGE_HEADER_INVALID_FLAGS, respectively) and was
+//       dropped.
+//   |MOJO_SYSTEM_RESULT_RESOURCE_EXHAUSTED| if the next message doesn't fit in
+//       |read_buffer| (and it can't grow) or |read_handles_buffer|. It is left
+//       in the message pipe.
+//   Otherwise, the (failure) result of MojoReadMessage(), e.g.,
+//       |MOJO_SYSTEM_RESULT_SHOULD_WAIT| if there are no messages to read.
+MojoResult MojomMessageDispatcher_ReadAndDispatch(
+    struct MojomMessageDispatcher* dispatcher,
+    MojomValidationResult* out_validation_result);
+
+// Adds the dispatcher's message pipe to |wait_set| (with the dispatcher as its
+// cookie), for MojomMessageDispatcher_WaitAndDispatch(). Returns the result of
+// MojoWaitSetAdd().
+MojoResult MojomMessageDispatcher_AddToWaitSet(
+    struct MojomMessageDispatcher* dispatcher,
+    MojoHandle wait_set);
+
+// Waits (until |deadline|) on |wait_set|, all of whose entries must have been
+// added using MojomMessageDispatcher_AddToWaitSet(), and reads and dispatches
+// the messages of the dispatchers that become readable. If a dispatcher fails
+// to read a message (other than for lack of messages) or reads an invalid one,
+// it is removed from |wait_set| and its |on_error| is called; this is the only
+// place a dispatcher may be destroyed while this runs. Returns the result of
+// MojoWaitSetWait().
+MojoResult MojomMessageDispatcher_WaitAndDispatch(MojoHandle wait_set,
+                                                  MojoDeadline deadline);
+
 MOJO_END_EXTERN_C
 
 #endif  // MOJO_PUBLIC_C_INCLUDE_MOJO_BINDINGS_MESSAGE_H_
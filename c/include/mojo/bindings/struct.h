@@ -6,6 +6,7 @@
 #define MOJO_PUBLIC_C_INCLUDE_MOJO_BINDINGS_STRUCT_H_
 
 #include <mojo/bindings/buffer.h>
+#include <mojo/bindings/internal/traversal.h>
 #include <mojo/bindings/internal/type_descriptor.h>
 #include <mojo/bindings/internal/util.h>
 #include <mojo/macros.h>
@@ -87,6 +88,66 @@ MojomValidationResult MojomStruct_Validate(
     uint32_t in_num_handles,
     struct MojomValidationContext* inout_context);
 
+// Starts validating the mojom struct described by the |in_struct| buffer (as
+// MojomStruct_Validate() does, with the same results) while the buffer is still
+// being filled in, front to back -- e.g., as a large message is being read.
+// Nothing is validated until MojomStruct_ContinueIncrementalValidation() is
+// called. |out_validation| keeps the state of the validation (whose context
+// starts out at the beginning of |in_struct|, with no handles claimed), and
+// refers to |in_struct| for as long as it is used.
+// |in_type_desc|: Describes the pointer and handle fields of the mojom struct.
+// |in_struct|: Buffer that will contain the struct, and any other references
+//              outside of the struct.
+// |in_struct_size|: Size of the buffer backed by |in_struct| in bytes, once
+//                   all of it has arrived.
+// |in_num_handles|: Number of valid handles expected to be referenced from
+//                   |in_struct|.
+// |out_validation|: Will be set up to validate |in_struct|.
+void MojomStruct_BeginIncrementalValidation(
+    const struct MojomTypeDescriptorStruct* in_type_desc,
+    const struct MojomStructHeader* in_struct,
+    uint32_t in_struct_size,
+    uint32_t in_num_handles,
+    struct MojomIncrementalValidation* out_validation);
+
+// Validates as much of the struct being validated by |inout_validation| as
+// can be, now that its first |in_num_bytes_received| bytes have arrived
+// (validation picks up where it left off, so this should be called with more
+// bytes each time). Returns MOJOM_VALIDATION_INCOMPLETE if what has arrived so
+// far is valid but the rest is still needed, and otherwise the result
+// MojomStruct_Validate() would have returned. Errors are returned as soon as
+// they are found, so a bad message can be rejected before the rest of it has
+// been read; once a result other than MOJOM_VALIDATION_INCOMPLETE is returned,
+// the same result is returned from then on.
+MojomValidationResult MojomStruct_ContinueIncrementalValidation(
+    struct MojomIncrementalValidation* inout_validation,
+    uint32_t in_num_bytes_received);
+
+// Validates the mojom struct described by the |inout_struct| buffer (as
+// MojomStruct_Validate() does, with the same results) and decodes it (as
+// MojomStruct_DecodePointersAndHandles() does) in a single pass: each pointer
+// is decoded and each handle claimed from |inout_handles| as soon as it has
+// been validated. Claimed handles are only removed from |inout_handles| (i.e.,
+// set to MOJO_HANDLE_INVALID) once the whole struct is known to be valid;
+// handles that are skipped over (which nothing can refer to) are closed as soon
+// as they are skipped. If validation fails, the contents of |inout_struct| are
+// unspecified and must not be used, and the caller still owns the handles left
+// in |inout_handles|.
+// |in_type_desc|: Describes the pointer and handle fields of the mojom struct.
+// |inout_struct|: Buffer containing the encoded struct, and any other
+//                 references outside of the struct.
+// |in_struct_size|: Size of the buffer backed by |inout_struct| in bytes.
+// |inout_handles|: Mojo handles referenced by index from |inout_struct|.
+// |in_num_handles|: Size in # of number elements available in |inout_handles|.
+// |inout_context|: See MojomStruct_Validate().
+MojomValidationResult MojomStruct_ValidateAndDecode(
+    const struct MojomTypeDescriptorStruct* in_type_desc,
+    struct MojomStructHeader* inout_struct,
+    uint32_t in_struct_size,
+    MojoHandle* inout_handles,
+    uint32_t in_num_handles,
+    struct MojomValidationContext* inout_context);
+
 // Creates a new copy of |in_struct| using |buffer| to allocate space.
 // Recursively creates new copies of any references from |in_struct|, and
 // updates the references to point to the new copies. This operation is useful
@@ -103,6 +164,23 @@ bool MojomStruct_DeepCopy(struct MojomBuffer* buffer,
                           const struct MojomStructHeader* in_struct,
                           struct MojomStructHeader** out_struct);
 
+// Like MojomStruct_DeepCopy(), but encodes the new copy (as
+// MojomStruct_EncodePointersAndHandles() would) as it is made, so that a
+// struct can be serialized in a single pass: there is no need to compute its
+// serialized size first, as long as |buffer| can grow (see
+// |MojomBuffer::grow|). Since |buffer| may move while growing, the new copy is
+// returned as its offset from the start of |buffer->buf| in |out_offset|. It
+// ends at |buffer->num_bytes_used|. Handles are moved out of the new copy (but
+// not out of |in_struct|) into |inout_handles_buffer|. Returns false under the
+// same conditions as MojomStruct_DeepCopy(), or if |inout_handles_buffer| runs
+// out of space.
+bool MojomStruct_DeepCopyAndEncode(
+    struct MojomBuffer* buffer,
+    const struct MojomTypeDescriptorStruct* in_type_desc,
+    const struct MojomStructHeader* in_struct,
+    struct MojomHandleBuffer* inout_handles_buffer,
+    uint32_t* out_offset);
+
 MOJO_END_EXTERN_C
 
 #endif  // MOJO_PUBLIC_C_INCLUDE_MOJO_BINDINGS_STRUCT_H_
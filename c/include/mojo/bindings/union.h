@@ -96,6 +96,17 @@ MojomValidationResult MojomUnion_Validate(
     uint32_t in_num_handles,
     struct MojomValidationContext* inout_context);
 
+// Validates and decodes the mojom union described by the |inout_union| buffer
+// in a single pass. See MojomStruct_ValidateAndDecode().
+MojomValidationResult MojomUnion_ValidateAndDecode(
+    const struct MojomTypeDescriptorUnion* in_type_desc,
+    bool in_nullable,
+    struct MojomUnionLayout* inout_union,
+    uint32_t in_union_size,
+    MojoHandle* inout_handles,
+    uint32_t in_num_handles,
+    struct MojomValidationContext* inout_context);
+
 // Copies over |in_union_data| into |out_union_data|, recursively copying any
 // references from |in_union_data| using |buffer| to allocate space, and
 // updating the references to point to the new copies. Note that a space is
@@ -57,6 +57,12 @@ typedef uint32_t MojomValidationResult;
   ((MojomValidationResult)12)
 // A non-nullable union is set to null. (Has size 0)
 #define MOJOM_VALIDATION_UNEXPECTED_NULL_UNION ((MojomValidationResult)13)
+// Structs, maps and arrays are nested more deeply than
+// |MOJOM_TRAVERSAL_MAX_DEPTH| (see <mojo/bindings/internal/traversal.h>).
+#define MOJOM_VALIDATION_MAX_RECURSION_DEPTH ((MojomValidationResult)14)
+// (Only from incremental validation; not an error.) What has arrived so far is
+// valid, but more is needed before validation can go on.
+#define MOJOM_VALIDATION_INCOMPLETE ((MojomValidationResult)15)
 
 MOJO_END_EXTERN_C
 
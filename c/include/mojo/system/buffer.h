@@ -88,10 +88,26 @@ MOJO_STATIC_ASSERT(sizeof(struct MojoBufferInformation) == 16,
 
 // |MojoMapBufferFlags|: Used to specify different modes to |MojoMapBuffer()|.
 //   |MOJO_MAP_BUFFER_FLAG_NONE| - No flags; default mode.
+//   |MOJO_MAP_BUFFER_FLAG_READ_ONLY| - The caller will only read from the
+//       mapped memory, so the implementation may map it read-only (writing to
+//       it is then undefined behavior).
+//   |MOJO_MAP_BUFFER_FLAG_PREFAULT| - The implementation should populate the
+//       mapping's pages up front (if possible), instead of on first access.
+//   |MOJO_MAP_BUFFER_FLAG_HUGE_PAGES| - The implementation should back the
+//       mapping with huge (a.k.a. large) pages (if possible).
+// All the above flags other than |MOJO_MAP_BUFFER_FLAG_NONE| are hints: an
+// implementation that supports a flag may still ignore it (e.g., if the buffer
+// or range is not suitably sized or aligned for huge pages), and mapping
+// without the flag is always a valid fallback. Older implementations may reject
+// them with |MOJO_SYSTEM_RESULT_UNIMPLEMENTED|, in which case the caller should
+// retry without them.
 
 typedef uint32_t MojoMapBufferFlags;
 
 #define MOJO_MAP_BUFFER_FLAG_NONE ((MojoMapBufferFlags)0)
+#define MOJO_MAP_BUFFER_FLAG_READ_ONLY ((MojoMapBufferFlags)1 << 0)
+#define MOJO_MAP_BUFFER_FLAG_PREFAULT ((MojoMapBufferFlags)1 << 1)
+#define MOJO_MAP_BUFFER_FLAG_HUGE_PAGES ((MojoMapBufferFlags)1 << 2)
 
 MOJO_BEGIN_EXTERN_C
 
@@ -211,6 +227,8 @@ MojoResult MojoGetBufferInformation(MojoHandle buffer_handle,            // In.
 //       both the |MOJO_HANDLE_RIGHT_READ| and |MOJO_HANDLE_RIGHT_WRITE| rights.
 //   |MOJO_SYSTEM_RESULT_RESOURCE_EXHAUSTED| if the mapping operation itself
 //       failed (e.g., due to not having appropriate address space available).
+//   |MOJO_SYSTEM_RESULT_UNIMPLEMENTED| if an unsupported flag was set in
+//       |flags|.
 //   |MOJO_SYSTEM_RESULT_BUSY| if |buffer_handle| is currently in use in some
 //       transaction (that, e.g., may result in it being invalidated, such as
 //       being sent in a message).
@@ -38,12 +38,36 @@ MOJO_STATIC_ASSERT(sizeof(struct MojoCreateWaitSetOptions) == 8,
 // wait set with |MojoWaitSetAdd()|.
 //   |uint32_t struct_size|: Set to the size of the |MojoWaitSetAddOptions|
 //       struct. (Used to allow for future extensions.)
-//   |MojoWaitSetAddOptionsFlags flags|: Reserved for future use.
-//       |MOJO_WAIT_SET_ADD_OPTIONS_FLAGS_NONE|: No flags, default mode.
+//   |MojoWaitSetAddOptionsFlags flags|: Used to specify different modes of
+//       operation.
+//       |MOJO_WAIT_SET_ADD_OPTIONS_FLAGS_NONE|: No flags, default mode. The
+//           entry is "level-triggered": it is reported by every
+//           |MojoWaitSetWait()| for as long as its handle satisfies (or can
+//           never satisfy) any of its signals.
+//       |MOJO_WAIT_SET_ADD_OPTIONS_FLAG_EDGE_TRIGGERED|: The entry is
+//           "edge-triggered": it is reported once when it becomes satisfied
+//           (or unsatisfiable), and then not again until its handle first stops
+//           satisfying all of its signals and then satisfies one again. (An
+//           entry whose handle already satisfies one of its signals when it is
+//           added is reported once.) E.g., a message pipe handle that stays
+//           readable because not all its messages have been read is not
+//           reported again, even if more messages arrive.
+//       |MOJO_WAIT_SET_ADD_OPTIONS_FLAG_ONE_SHOT|: The entry is automatically
+//           removed from the wait set once it has been reported by
+//           |MojoWaitSetWait()| (after which its cookie may be reused, and
+//           |MojoWaitSetRemove()| with its cookie will yield
+//           |MOJO_SYSTEM_RESULT_NOT_FOUND|). Entries that are not reported
+//           (e.g., because |*num_results| was too small) are not removed.
+//       Implementations that do not support these flags will reject them with
+//       |MOJO_SYSTEM_RESULT_UNIMPLEMENTED| (see |MojoWaitSetAdd()|).
 
 typedef uint32_t MojoWaitSetAddOptionsFlags;
 
 #define MOJO_WAIT_SET_ADD_OPTIONS_FLAG_NONE ((MojoWaitSetAddOptionsFlags)0)
+#define MOJO_WAIT_SET_ADD_OPTIONS_FLAG_EDGE_TRIGGERED \
+  ((MojoWaitSetAddOptionsFlags)1 << 0)
+#define MOJO_WAIT_SET_ADD_OPTIONS_FLAG_ONE_SHOT \
+  ((MojoWaitSetAddOptionsFlags)1 << 1)
 
 struct MOJO_ALIGNAS(8) MojoWaitSetAddOptions {
   uint32_t struct_size;
@@ -52,6 +76,20 @@ struct MOJO_ALIGNAS(8) MojoWaitSetAddOptions {
 MOJO_STATIC_ASSERT(sizeof(struct MojoWaitSetAddOptions) == 8,
                    "MojoWaitSetAddOptions has wrong size");
 
+// |MojoWaitSetEntry|: Used to specify an entry to add to a wait set with
+// |MojoWaitSetAddMany()|.
+//   |uint64_t cookie|: The cookie value for the entry (see |MojoWaitSetAdd()|).
+//   |MojoHandle handle|: The handle to watch.
+//   |MojoHandleSignals signals|: The signals to watch for.
+
+struct MOJO_ALIGNAS(8) MojoWaitSetEntry {
+  uint64_t cookie;
+  MojoHandle handle;
+  MojoHandleSignals signals;
+};
+MOJO_STATIC_ASSERT(sizeof(struct MojoWaitSetEntry) == 16,
+                   "MojoWaitSetEntry has wrong size");
+
 // |MojoWaitSetResult|: Returned by |MojoWaitSetWait()| to indicate the state of
 // entries. See |MojoWaitSetWait()| for the values of these fields.
 
@@ -130,6 +168,66 @@ MojoResult MojoWaitSetAdd(MojoHandle wait_set_handle,  // In.
 MojoResult MojoWaitSetRemove(MojoHandle wait_set_handle,  // In.
                              uint64_t cookie);            // In.
 
+// |MojoWaitSetAddMany()|: Adds the |num_entries| entries given by
+// |entries[0]|, ..., |entries[num_entries-1]| to the wait set specified by
+// |wait_set_handle| (which must have the |MOJO_HANDLE_RIGHT_WRITE| right), all
+// with the same |options| (if |options| is null, the default options will be
+// used).
+//
+// This is equivalent to calling |MojoWaitSetAdd()| for each entry in turn, but
+// is typically much cheaper when adding many entries at once (e.g., the wait
+// set only has to be locked and updated once). Each entry is added (or fails to
+// be added) independently of the others. If |results| is non-null, |results[i]|
+// is set to the result that |MojoWaitSetAdd()| would have given for
+// |entries[i]|.
+//
+// Returns:
+//   |MOJO_RESULT_OK| if all the entries were added to the wait set.
+//   |MOJO_SYSTEM_RESULT_INVALID_ARGUMENT| if |wait_set_handle| does not refer
+//       to a valid wait set or |options| is not null and |*options| is not a
+//       valid options structure. (In this case, no entries are added and
+//       |results| is not modified.)
+//   |MOJO_SYSTEM_RESULT_ABORTED| if one or more (but not necessarily all) of
+//       the entries could not be added (see |results| for which).
+//   |MOJO_SYSTEM_RESULT_UNIMPLEMENTED| if some unknown/unsupported option has
+//       been specified in |*options|, or if the implementation does not support
+//       adding entries in bulk (in which case |MojoWaitSetAdd()| should be used
+//       instead). (In this case, no entries are added and |results| is not
+//       modified.)
+MojoResult MojoWaitSetAddMany(
+    MojoHandle wait_set_handle,                            // In.
+    const struct MojoWaitSetEntry* MOJO_RESTRICT entries,  // In.
+    uint32_t num_entries,                                  // In.
+    const struct MojoWaitSetAddOptions* MOJO_RESTRICT
+        options,                         // Optional in.
+    MojoResult* MOJO_RESTRICT results);  // Optional out.
+
+// |MojoWaitSetRemoveMany()|: Removes the entries with cookies |cookies[0]|,
+// ..., |cookies[num_cookies-1]| from the wait set specified by
+// |wait_set_handle| (which must have the |MOJO_HANDLE_RIGHT_WRITE| right).
+//
+// This is equivalent to calling |MojoWaitSetRemove()| for each cookie in turn
+// (but, like |MojoWaitSetAddMany()|, typically much cheaper). If |results| is
+// non-null, |results[i]| is set to the result that |MojoWaitSetRemove()| would
+// have given for |cookies[i]|.
+//
+// Returns:
+//   |MOJO_RESULT_OK| if all the entries were removed.
+//   |MOJO_SYSTEM_RESULT_INVALID_ARGUMENT| if |wait_set_handle| does not refer
+//       to a valid wait set. (In this case, no entries are removed and
+//       |results| is not modified.)
+//   |MOJO_SYSTEM_RESULT_ABORTED| if one or more of the cookies did not identify
+//       an entry within the wait set (see |results| for which).
+//   |MOJO_SYSTEM_RESULT_UNIMPLEMENTED| if the implementation does not support
+//       removing entries in bulk (in which case |MojoWaitSetRemove()| should be
+//       used instead). (In this case, no entries are removed and |results| is
+//       not modified.)
+MojoResult MojoWaitSetRemoveMany(
+    MojoHandle wait_set_handle,             // In.
+    const uint64_t* MOJO_RESTRICT cookies,  // In.
+    uint32_t num_cookies,                   // In.
+    MojoResult* MOJO_RESTRICT results);     // Optional out.
+
 // |MojoWaitSetWait()|: Waits on all entries in the wait set specified by
 // |wait_set_handle| (which must have the |MOJO_HANDLE_RIGHT_READ| right) for at
 // least one of the following:
@@ -7,14 +7,23 @@
 #include <assert.h>
 #include <mojo/bindings/internal/util.h>
 #include <stddef.h>
+#include <string.h>
 
 void* MojomBuffer_Allocate(struct MojomBuffer* buf, uint32_t num_bytes) {
   assert(buf);
 
   const uint32_t bytes_used = buf->num_bytes_used;
   const uint64_t size = MOJOM_INTERNAL_ROUND_TO_8((uint64_t)num_bytes);
-  if (bytes_used + size > buf->buf_size)
-    return NULL;
+  if (bytes_used + size > buf->buf_size) {
+    if (buf->grow == NULL || bytes_used + size > UINT32_MAX ||
+        !buf->grow(buf, (uint32_t)(bytes_used + size))) {
+      return NULL;
+    }
+    assert(bytes_used + size <= buf->buf_size);
+    // The space gained (e.g., from realloc()) may be uninitialized, and padding
+    // isn't written by callers.
+    memset(buf->buf + bytes_used, 0, buf->buf_size - bytes_used);
+  }
 
   buf->num_bytes_used += size;
   return buf->buf + bytes_used;
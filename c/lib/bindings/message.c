@@ -4,8 +4,22 @@
 
 #include <mojo/bindings/message.h>
 
+#include <assert.h>
 #include <mojo/bindings/struct.h>
+#include <mojo/system/message_pipe.h>
+#include <mojo/system/wait_set.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+
+// The most messages MojomMessageDispatcher_WaitAndDispatch() reads from a
+// message pipe each time it becomes readable, so that one busy message pipe
+// can't starve the others.
+#define MAX_MESSAGES_PER_WAKE 32u
+
+// The most wait set results MojomMessageDispatcher_WaitAndDispatch() handles
+// per call.
+#define MAX_WAIT_SET_RESULTS 16u
 
 MojomValidationResult MojomMessage_ValidateHeader(const void* in_buf,
                                                   uint32_t in_buf_size) {
@@ -71,3 +85,363 @@ MojomValidationResult MojomMessage_ValidateResponse(
              ? MOJOM_VALIDATION_ERROR_NONE
              : MOJOM_VALIDATION_MESSAGE_HEADER_INVALID_FLAGS;
 }
+
+bool MojomMessage_Build(
+    struct MojomBuffer* buffer,
+    uint32_t ordinal,
+    uint32_t flags,
+    uint64_t request_id,
+    const struct MojomTypeDescriptorStruct* in_params_type_desc,
+    const struct MojomStructHeader* in_params,
+    struct MojomHandleBuffer* inout_handles_buffer) {
+  assert(buffer);
+  assert(buffer->num_bytes_used == 0u);
+
+  const bool has_request_id =
+      (flags & (MOJOM_MESSAGE_FLAGS_EXPECTS_RESPONSE |
+                MOJOM_MESSAGE_FLAGS_IS_RESPONSE)) != 0u;
+  const uint32_t header_size =
+      has_request_id ? (uint32_t)sizeof(struct MojomMessageWithRequestId)
+                     : (uint32_t)sizeof(struct MojomMessage);
+
+  // Parameters without pointers serialize to exactly their own bytes, so (as
+  // long as there is room for all their handles) the message can be allocated
+  // all at once, and the parameters encoded in place.
+  if ((MojomType_GetFlags(MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR,
+                          in_params_type_desc) &
+       MOJOM_TYPE_DESCRIPTOR_FLAG_POINTER_FREE) &&
+      inout_handles_buffer->num_handles -
+              inout_handles_buffer->num_handles_used >=
+          in_params_type_desc->num_entries) {
+    char* buf =
+        MojomBuffer_Allocate(buffer, header_size + in_params->num_bytes);
+    if (buf == NULL)
+      return false;
+    struct MojomStructHeader* params =
+        (struct MojomStructHeader*)(buf + header_size);
+    memcpy(params, in_params, in_params->num_bytes);
+    MojomStruct_EncodePointersAndHandles(in_params_type_desc, params,
+                                         in_params->num_bytes,
+                                         inout_handles_buffer);
+  } else {
+    if (MojomBuffer_Allocate(buffer, header_size) == NULL)
+      return false;
+
+    uint32_t params_offset = 0u;
+    if (!MojomStruct_DeepCopyAndEncode(buffer, in_params_type_desc, in_params,
+                                       inout_handles_buffer, &params_offset)) {
+      return false;
+    }
+    assert(params_offset == header_size);
+  }
+
+  // The header is only filled in now, since |buffer->buf| may have moved while
+  // the parameters were being serialized.
+  struct MojomMessageWithRequestId* header =
+      (struct MojomMessageWithRequestId*)buffer->buf;
+  header->header.num_bytes = header_size;
+  header->header.version = has_request_id ? 1u : 0u;
+  header->ordinal = ordinal;
+  header->flags = flags;
+  if (has_request_id)
+    header->request_id = request_id;
+  return true;
+}
+
+MojoResult MojomMessage_Write(MojoHandle message_pipe,
+                              const struct MojomBuffer* buffer,
+                              const struct MojomHandleBuffer* handles_buffer) {
+  assert(buffer);
+  assert(handles_buffer);
+
+  return MojoWriteMessage(message_pipe, buffer->buf, buffer->num_bytes_used,
+                          handles_buffer->handles,
+                          handles_buffer->num_handles_used,
+                          MOJO_WRITE_MESSAGE_FLAG_NONE);
+}
+
+// Builds a message in |dispatcher|'s write buffers and sends it.
+static MojoResult build_and_write(
+    struct MojomMessageDispatcher* dispatcher,
+    uint32_t ordinal,
+    uint32_t flags,
+    uint64_t request_id,
+    const struct MojomTypeDescriptorStruct* in_params_type_desc,
+    const struct MojomStructHeader* in_params) {
+  dispatcher->write_buffer.num_bytes_used = 0u;
+  dispatcher->write_handles_buffer.num_handles_used = 0u;
+  if (!MojomMessage_Build(&dispatcher->write_buffer, ordinal, flags,
+                          request_id, in_params_type_desc, in_params,
+                          &dispatcher->write_handles_buffer)) {
+    return MOJO_SYSTEM_RESULT_RESOURCE_EXHAUSTED;
+  }
+  return MojomMessage_Write(dispatcher->message_pipe, &dispatcher->write_buffer,
+                            &dispatcher->write_handles_buffer);
+}
+
+MojoResult MojomMessageDispatcher_SendRequest(
+    struct MojomMessageDispatcher* dispatcher,
+    uint32_t ordinal,
+    const struct MojomTypeDescriptorStruct* in_params_type_desc,
+    const struct MojomStructHeader* in_params,
+    const struct MojomTypeDescriptorStruct* response_params_type_desc,
+    MojomMessageResponseCallback response_callback,
+    void* response_context) {
+  assert(dispatcher);
+
+  if (response_callback == NULL) {
+    return build_and_write(dispatcher, ordinal, 0u, 0u, in_params_type_desc,
+                           in_params);
+  }
+
+  assert((dispatcher->num_response_slots &
+          (dispatcher->num_response_slots - 1u)) == 0u);
+  if (dispatcher->num_response_slots == 0u)
+    return MOJO_SYSTEM_RESULT_RESOURCE_EXHAUSTED;
+  // Skip the IDs whose slots are still in use (e.g., by a slow request that
+  // the IDs have come back around to).
+  uint64_t request_id = dispatcher->next_request_id;
+  struct MojomMessageResponseSlot* slot = NULL;
+  for (uint32_t i = 0u; i < dispatcher->num_response_slots;
+       i++, request_id++) {
+    slot = &dispatcher->response_slots[request_id &
+                                       (dispatcher->num_response_slots - 1u)];
+    if (slot->callback == NULL)
+      break;
+  }
+  if (slot->callback != NULL)
+    return MOJO_SYSTEM_RESULT_RESOURCE_EXHAUSTED;
+
+  MojoResult result =
+      build_and_write(dispatcher, ordinal, MOJOM_MESSAGE_FLAGS_EXPECTS_RESPONSE,
+                      request_id, in_params_type_desc, in_params);
+  if (result != MOJO_RESULT_OK)
+    return result;
+
+  dispatcher->next_request_id = request_id + 1u;
+  slot->request_id = request_id;
+  slot->ordinal = ordinal;
+  slot->params_type_desc = response_params_type_desc;
+  slot->callback = response_callback;
+  slot->context = response_context;
+  return MOJO_RESULT_OK;
+}
+
+MojoResult MojomMessageDispatcher_SendResponse(
+    struct MojomMessageDispatcher* dispatcher,
+    const struct MojomMessage* request,
+    const struct MojomTypeDescriptorStruct* in_params_type_desc,
+    const struct MojomStructHeader* in_params) {
+  assert(dispatcher);
+  assert(request);
+  assert(request->flags & MOJOM_MESSAGE_FLAGS_EXPECTS_RESPONSE);
+
+  return build_and_write(
+      dispatcher, request->ordinal, MOJOM_MESSAGE_FLAGS_IS_RESPONSE,
+      ((const struct MojomMessageWithRequestId*)request)->request_id,
+      in_params_type_desc, in_params);
+}
+
+// Finds the handler for |ordinal| in |dispatcher->handlers|, or returns NULL if
+// there is none.
+static const struct MojomMessageHandler* find_handler(
+    const struct MojomMessageDispatcher* dispatcher,
+    uint32_t ordinal) {
+  const struct MojomMessageHandler* handlers = dispatcher->handlers;
+  // Ordinals are usually numbered from 0, in which case each handler is at its
+  // ordinal's index.
+  if (ordinal < dispatcher->num_handlers &&
+      handlers[ordinal].ordinal == ordinal) {
+    return &handlers[ordinal];
+  }
+
+  uint32_t begin = 0u;
+  uint32_t end = dispatcher->num_handlers;
+  while (begin < end) {
+    uint32_t mid = begin + (end - begin) / 2u;
+    if (handlers[mid].ordinal == ordinal)
+      return &handlers[mid];
+    if (handlers[mid].ordinal < ordinal)
+      begin = mid + 1u;
+    else
+      end = mid;
+  }
+  return NULL;
+}
+
+// Closes the handles in |handles| that are still valid (i.e., weren't decoded
+// into a message's parameters).
+static void close_handles(MojoHandle* handles, uint32_t num_handles) {
+  for (uint32_t i = 0u; i < num_handles; i++) {
+    if (handles[i] != MOJO_HANDLE_INVALID) {
+      MojoClose(handles[i]);
+      handles[i] = MOJO_HANDLE_INVALID;
+    }
+  }
+}
+
+// Validates and decodes the parameters |params| of a message, given its
+// |num_handles| |handles|.
+static MojomValidationResult validate_and_decode_params(
+    const struct MojomTypeDescriptorStruct* params_type_desc,
+    struct MojomStructHeader* params,
+    uint32_t params_size,
+    MojoHandle* handles,
+    uint32_t num_handles) {
+  struct MojomValidationContext context = {0u, (char*)params};
+  return MojomStruct_ValidateAndDecode(params_type_desc, params, params_size,
+                                       handles, num_handles, &context);
+}
+
+// Validates the message |message| of |num_bytes| bytes (with |num_handles|
+// |handles|) and dispatches it.
+static MojomValidationResult dispatch_message(
+    struct MojomMessageDispatcher* dispatcher,
+    struct MojomMessage* message,
+    uint32_t num_bytes,
+    MojoHandle* handles,
+    uint32_t num_handles) {
+  MojomValidationResult result =
+      MojomMessage_ValidateHeader(message, num_bytes);
+  if (result != MOJOM_VALIDATION_ERROR_NONE)
+    return result;
+
+  const uint32_t header_size = message->header.num_bytes;
+  if (header_size % 8u != 0u)
+    return MOJOM_VALIDATION_MISALIGNED_OBJECT;
+  struct MojomStructHeader* params =
+      (struct MojomStructHeader*)((char*)message + header_size);
+  const uint32_t params_size = num_bytes - header_size;
+
+  if (message->flags & MOJOM_MESSAGE_FLAGS_IS_RESPONSE) {
+    const uint64_t request_id =
+        ((const struct MojomMessageWithRequestId*)message)->request_id;
+    struct MojomMessageResponseSlot* slot =
+        dispatcher->num_response_slots == 0u
+            ? NULL
+            : &dispatcher->response_slots[request_id &
+                                          (dispatcher->num_response_slots -
+                                           1u)];
+    if (slot == NULL || slot->callback == NULL ||
+        slot->request_id != request_id || slot->ordinal != message->ordinal) {
+      return MOJOM_VALIDATION_MESSAGE_HEADER_INVALID_FLAGS;
+    }
+
+    result = validate_and_decode_params(slot->params_type_desc, params,
+                                        params_size, handles, num_handles);
+    if (result != MOJOM_VALIDATION_ERROR_NONE)
+      return result;
+
+    // Free the slot first, so that the callback can reuse it.
+    MojomMessageResponseCallback callback = slot->callback;
+    void* context = slot->context;
+    slot->callback = NULL;
+    slot->context = NULL;
+    close_handles(handles, num_handles);
+    callback(context, params);
+    return MOJOM_VALIDATION_ERROR_NONE;
+  }
+
+  const struct MojomMessageHandler* handler =
+      find_handler(dispatcher, message->ordinal);
+  if (handler == NULL)
+    return MOJOM_VALIDATION_MESSAGE_HEADER_UNKNOWN_METHOD;
+  result = handler->expects_response
+               ? MojomMessage_ValidateRequestExpectingResponse(message)
+               : MojomMessage_ValidateRequestWithoutResponse(message);
+  if (result != MOJOM_VALIDATION_ERROR_NONE)
+    return result;
+
+  result = validate_and_decode_params(handler->params_type_desc, params,
+                                      params_size, handles, num_handles);
+  if (result != MOJOM_VALIDATION_ERROR_NONE)
+    return result;
+
+  close_handles(handles, num_handles);
+  handler->handler(dispatcher, message, params);
+  return MOJOM_VALIDATION_ERROR_NONE;
+}
+
+MojoResult MojomMessageDispatcher_ReadAndDispatch(
+    struct MojomMessageDispatcher* dispatcher,
+    MojomValidationResult* out_validation_result) {
+  assert(dispatcher);
+  assert(out_validation_result);
+
+  struct MojomBuffer* buffer = &dispatcher->read_buffer;
+  struct MojomHandleBuffer* handles_buffer = &dispatcher->read_handles_buffer;
+  uint32_t num_bytes = buffer->buf_size;
+  uint32_t num_handles = handles_buffer->num_handles;
+  MojoResult result =
+      MojoReadMessage(dispatcher->message_pipe, buffer->buf, &num_bytes,
+                      handles_buffer->handles, &num_handles,
+                      MOJO_READ_MESSAGE_FLAG_NONE);
+  if (result == MOJO_SYSTEM_RESULT_RESOURCE_EXHAUSTED) {
+    // |num_bytes| and |num_handles| are now what the message needs. There is
+    // nothing in |buffer| worth keeping while growing it.
+    if (num_handles > handles_buffer->num_handles || buffer->grow == NULL)
+      return MOJO_SYSTEM_RESULT_RESOURCE_EXHAUSTED;
+    buffer->num_bytes_used = 0u;
+    if (!buffer->grow(buffer, num_bytes))
+      return MOJO_SYSTEM_RESULT_RESOURCE_EXHAUSTED;
+    num_bytes = buffer->buf_size;
+    num_handles = handles_buffer->num_handles;
+    result = MojoReadMessage(dispatcher->message_pipe, buffer->buf, &num_bytes,
+                             handles_buffer->handles, &num_handles,
+                             MOJO_READ_MESSAGE_FLAG_NONE);
+  }
+  if (result != MOJO_RESULT_OK)
+    return result;
+
+  *out_validation_result =
+      dispatch_message(dispatcher, (struct MojomMessage*)buffer->buf,
+                       num_bytes, handles_buffer->handles, num_handles);
+  if (*out_validation_result != MOJOM_VALIDATION_ERROR_NONE)
+    close_handles(handles_buffer->handles, num_handles);
+  return MOJO_RESULT_OK;
+}
+
+MojoResult MojomMessageDispatcher_AddToWaitSet(
+    struct MojomMessageDispatcher* dispatcher,
+    MojoHandle wait_set) {
+  assert(dispatcher);
+
+  return MojoWaitSetAdd(
+      wait_set, dispatcher->message_pipe,
+      MOJO_HANDLE_SIGNAL_READABLE | MOJO_HANDLE_SIGNAL_PEER_CLOSED,
+      (uint64_t)(uintptr_t)dispatcher, NULL);
+}
+
+MojoResult MojomMessageDispatcher_WaitAndDispatch(MojoHandle wait_set,
+                                                  MojoDeadline deadline) {
+  struct MojoWaitSetResult results[MAX_WAIT_SET_RESULTS];
+  uint32_t num_results = MAX_WAIT_SET_RESULTS;
+  MojoResult result =
+      MojoWaitSetWait(wait_set, deadline, &num_results, results, NULL);
+  if (result != MOJO_RESULT_OK)
+    return result;
+
+  for (uint32_t i = 0u; i < num_results; i++) {
+    struct MojomMessageDispatcher* dispatcher =
+        (struct MojomMessageDispatcher*)(uintptr_t)results[i].cookie;
+    MojoResult read_result = results[i].wait_result;
+    MojomValidationResult validation_result = MOJOM_VALIDATION_ERROR_NONE;
+    for (uint32_t j = 0u;
+         read_result == MOJO_RESULT_OK && j < MAX_MESSAGES_PER_WAKE; j++) {
+      read_result = MojomMessageDispatcher_ReadAndDispatch(dispatcher,
+                                                           &validation_result);
+      if (validation_result != MOJOM_VALIDATION_ERROR_NONE)
+        break;
+    }
+    if (read_result == MOJO_SYSTEM_RESULT_SHOULD_WAIT ||
+        (read_result == MOJO_RESULT_OK &&
+         validation_result == MOJOM_VALIDATION_ERROR_NONE)) {
+      continue;
+    }
+
+    MojoWaitSetRemove(wait_set, results[i].cookie);
+    if (dispatcher->on_error)
+      dispatcher->on_error(dispatcher, read_result, validation_result);
+  }
+  return MOJO_RESULT_OK;
+}
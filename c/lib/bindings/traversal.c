@@ -0,0 +1,1980 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <mojo/bindings/internal/traversal.h>
+
+#include <assert.h>
+#include <mojo/bindings/array.h>
+#include <mojo/bindings/interface.h>
+#include <mojo/bindings/internal/util.h>
+#include <mojo/bindings/map.h>
+#include <mojo/bindings/struct.h>
+#include <mojo/bindings/union.h>
+#include <mojo/system/handle.h>
+#include <string.h>
+
+#define UNION_TAG_UNKNOWN ((uint32_t)0xFFFFFFFF)
+
+// The encoding of a MojoHandle is an index into an array of Handles. A
+// null/invalid handle is encoded as index (which is unsigned) "-1", which
+// equates to the highest possible index.
+static const MojoHandle kEncodedHandleInvalid = (MojoHandle)-1;
+
+void MojomType_EncodePointer(union MojomPointer* pointer, uint32_t max_offset) {
+  if (pointer->ptr == NULL) {
+    pointer->offset = 0;
+  } else {
+    assert((char*)pointer->ptr > (char*)pointer);
+    assert((size_t)((char*)pointer->ptr - (char*)pointer) < max_offset);
+    pointer->offset = (char*)(pointer->ptr) - (char*)pointer;
+  }
+}
+
+void MojomType_DecodePointer(union MojomPointer* pointer) {
+  if (pointer->offset == 0) {
+    pointer->ptr = NULL;
+  } else {
+    pointer->ptr = (char*)pointer + pointer->offset;
+  }
+}
+
+void MojomType_EncodeHandle(bool nullable,
+                            MojoHandle* handle,
+                            struct MojomHandleBuffer* handles_buffer) {
+  assert(handle);
+  assert(handles_buffer);
+  assert(handles_buffer->handles);
+
+  if (*handle == MOJO_HANDLE_INVALID) {
+    assert(nullable);
+    *handle = kEncodedHandleInvalid;
+  } else {
+    assert(handles_buffer->num_handles_used < handles_buffer->num_handles);
+
+    handles_buffer->handles[handles_buffer->num_handles_used] = *handle;
+    *handle = handles_buffer->num_handles_used;
+    handles_buffer->num_handles_used++;
+  }
+}
+
+// *handle is an index into inout_handles, or is encoded NULL.
+void MojomType_DecodeHandle(MojoHandle* handle,
+                            MojoHandle inout_handles[],
+                            uint32_t in_num_handles) {
+  assert(handle);
+  assert(inout_handles);
+
+  if (*handle == kEncodedHandleInvalid) {
+    *handle = MOJO_HANDLE_INVALID;
+  } else {
+    assert(*handle < in_num_handles);
+    MojoHandle index = *handle;
+    *handle = inout_handles[index];
+    inout_handles[index] = MOJO_HANDLE_INVALID;
+  }
+}
+
+// Validates that the offset (|pointer->offset|) points to a new memory region,
+// i.e. one that hasn't been referenced yet. If so, moves the expected offset
+// (for the next pointer) forward.
+MojomValidationResult MojomType_ValidatePointer(
+    const union MojomPointer* pointer,
+    size_t max_offset,
+    bool is_nullable,
+    struct MojomValidationContext* inout_context) {
+  // Offset must be <= UINT32_MAX and within range.
+  if (pointer->offset > max_offset || pointer->offset > UINT32_MAX)
+    return MOJOM_VALIDATION_ILLEGAL_POINTER;
+
+  if (pointer->offset != 0) {
+    if ((char*)pointer + pointer->offset < inout_context->next_pointer)
+      return MOJOM_VALIDATION_ILLEGAL_MEMORY_RANGE;
+
+    inout_context->next_pointer = (char*)pointer + pointer->offset;
+  }
+
+  // Offset must be 8-byte aligned: this check is sufficient, given that all
+  // objects are rounded to 8-bytes.
+  if ((pointer->offset & 7) != 0)
+    return MOJOM_VALIDATION_MISALIGNED_OBJECT;
+
+  if (!is_nullable && pointer->offset == 0)
+    return MOJOM_VALIDATION_UNEXPECTED_NULL_POINTER;
+
+  return MOJOM_VALIDATION_ERROR_NONE;
+}
+
+MojomValidationResult MojomType_ValidateHandle(
+    MojoHandle encoded_handle, uint32_t num_handles, bool is_nullable,
+    struct MojomValidationContext* inout_context) {
+  if (!is_nullable && encoded_handle == kEncodedHandleInvalid)
+    return MOJOM_VALIDATION_UNEXPECTED_INVALID_HANDLE;
+
+  if (encoded_handle != kEncodedHandleInvalid) {
+    if (encoded_handle >= num_handles ||
+        encoded_handle < inout_context->next_handle_index)
+      return MOJOM_VALIDATION_ILLEGAL_HANDLE;
+
+    inout_context->next_handle_index = encoded_handle + 1;
+  }
+
+  return MOJOM_VALIDATION_ERROR_NONE;
+}
+
+// A field of a struct (or an element of an array) that needs visiting.
+struct MojomTraversalField {
+  enum MojomTypeDescriptorType type;
+  const void* type_desc;
+  bool nullable;
+  // Offset of the field from the start of the struct or array, in bytes.
+  uint32_t offset;
+};
+
+// Sets up |frame| to visit the fields of the struct or array |data|.
+static inline void init_frame(struct MojomTraversalFrame* frame,
+                              enum MojomTypeDescriptorType type,
+                              const void* type_desc,
+                              const void* data,
+                              void* out_data,
+                              uint32_t buf_size) {
+  frame->type = type;
+  frame->type_desc = type_desc;
+  frame->data = (char*)data;
+  frame->out_data = out_data;
+  frame->buf_size = buf_size;
+  frame->next_index = 0;
+  frame->num_fields =
+      type == MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR
+          ? ((const struct MojomArrayHeader*)data)->num_elements
+          : ((const struct MojomTypeDescriptorStruct*)type_desc)->num_entries;
+  frame->is_field = false;
+}
+
+// Sets up |frame| to visit just the field (of type |type|) at |data|. This is
+// how the |MojomType_Dispatch*()| functions start, so that (like everything
+// else) the field gets visited by *_run().
+static inline void init_field_frame(struct MojomTraversalFrame* frame,
+                                    enum MojomTypeDescriptorType type,
+                                    const void* type_desc,
+                                    bool nullable,
+                                    const void* data,
+                                    void* out_data,
+                                    uint32_t buf_size) {
+  frame->type = type;
+  frame->type_desc = type_desc;
+  frame->data = (char*)data;
+  frame->out_data = out_data;
+  frame->buf_size = buf_size;
+  frame->next_index = 0;
+  frame->num_fields = 1;
+  frame->is_field = true;
+  frame->nullable = nullable;
+}
+
+// Returns the size of an array element of type |type|. Only supports non-POD
+// types.
+static inline uint32_t array_elem_num_bytes(enum MojomTypeDescriptorType type) {
+  switch (type) {
+    case MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR:
+    case MOJOM_TYPE_DESCRIPTOR_TYPE_MAP_PTR:
+    case MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR:
+      return sizeof(union MojomPointer);
+    case MOJOM_TYPE_DESCRIPTOR_TYPE_UNION:
+      return sizeof(struct MojomUnionLayout);
+    case MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE:
+      return sizeof(MojoHandle);
+    case MOJOM_TYPE_DESCRIPTOR_TYPE_INTERFACE:
+      return sizeof(struct MojomInterfaceData);
+    case MOJOM_TYPE_DESCRIPTOR_TYPE_UNION_PTR:
+    case MOJOM_TYPE_DESCRIPTOR_TYPE_POD:
+      // This is a type that isn't supported in an array.
+      assert(0);
+      break;
+  }
+  return 0;
+}
+
+// Gets the next field of the struct (or element of the array) of |frame| that
+// may contain pointers or handles, skipping struct fields that are newer than
+// the struct. Returns false if there are none left.
+static inline bool next_field(struct MojomTraversalFrame* frame,
+                              struct MojomTraversalField* field) {
+  while (frame->next_index < frame->num_fields) {
+    uint32_t index = frame->next_index++;
+    if (frame->is_field) {
+      field->type = frame->type;
+      field->type_desc = frame->type_desc;
+      field->nullable = frame->nullable;
+      field->offset = 0;
+      return true;
+    }
+
+    if (frame->type == MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR) {
+      const struct MojomTypeDescriptorArray* type_desc = frame->type_desc;
+      field->type = type_desc->elem_type;
+      field->type_desc = type_desc->elem_descriptor;
+      field->nullable = type_desc->nullable;
+      field->offset = sizeof(struct MojomArrayHeader) +
+                      index * array_elem_num_bytes(field->type);
+      return true;
+    }
+
+    const struct MojomTypeDescriptorStructEntry* entry =
+        &((const struct MojomTypeDescriptorStruct*)frame->type_desc)
+             ->entries[index];
+    if (((const struct MojomStructHeader*)frame->data)->version <
+        entry->min_version)
+      continue;
+
+    field->type = entry->elem_type;
+    field->type_desc = entry->elem_descriptor;
+    field->nullable = entry->nullable;
+    field->offset = sizeof(struct MojomStructHeader) + entry->offset;
+    return true;
+  }
+  return false;
+}
+
+// Returns the entry of |type_desc| for the active field of |in_union|, or NULL
+// if there isn't one (i.e., the field is of a type not described by the entries
+// or the tag is unknown).
+static inline const struct MojomTypeDescriptorUnionEntry* union_entry(
+    const struct MojomTypeDescriptorUnion* type_desc,
+    const struct MojomUnionLayout* in_union) {
+  for (size_t i = 0; i < type_desc->num_entries; i++) {
+    if (type_desc->entries[i].tag == in_union->tag)
+      return &type_desc->entries[i];
+  }
+  return NULL;
+}
+
+// Whether the elements of an array described by |type_desc| are pointers to
+// structs or arrays that all have the given |flags|.
+static inline bool has_elements_pointing_to(
+    const struct MojomTypeDescriptorArray* type_desc,
+    MojomTypeDescriptorFlags flags) {
+  return (type_desc->elem_type == MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR ||
+          type_desc->elem_type == MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR) &&
+         (MojomType_GetFlags(type_desc->elem_type,
+                             type_desc->elem_descriptor) &
+          flags) == flags;
+}
+
+// Whether |type_desc| describes a struct (or map) whose flags include |flags|,
+// so that there may be no need to visit its fields.
+static inline bool is_struct_with(enum MojomTypeDescriptorType type,
+                                  const void* type_desc,
+                                  MojomTypeDescriptorFlags flags) {
+  return type != MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR &&
+         (MojomType_GetFlags(type, type_desc) & flags) == flags;
+}
+
+// Each operation consists of three parts:
+//   - *_enter(), which handles a struct or array, setting up a frame to visit
+//     its fields (or elements) if any of them need visiting;
+//   - *_field(), which handles a field (or element) of a given type, following
+//     pointers and unions until it gets to a struct or array (which it hands to
+//     *_enter()) or a handle; and
+//   - *_run(), which visits the fields of the frame at the bottom of a stack
+//     (using *_field()), and those of the frames that they lead to, depth
+//     first.
+// Frames are set up in place, in the stack slot above the current frame. If
+// the stack runs out, *_run() continues with a new one (except when validating,
+// which fails instead). A frame with no fields to visit is never pushed.
+
+// ComputeSerializedSize -------------------------------------------------------
+
+static inline size_t compute_size_enter(enum MojomTypeDescriptorType type,
+                                        const void* type_desc,
+                                        const void* data,
+                                        struct MojomTraversalFrame* frame) {
+  // Struct and array headers both start with |num_bytes|.
+  size_t size = *(const uint32_t*)data;
+  if (type == MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR) {
+    const struct MojomTypeDescriptorArray* array_desc = type_desc;
+    switch (array_desc->elem_type) {
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_INTERFACE:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_POD:
+        return size;
+      default:
+        break;
+    }
+
+    // The elements of arrays of pointers to objects without any pointers of
+    // their own only contribute their own sizes.
+    if (has_elements_pointing_to(array_desc,
+                                 MOJOM_TYPE_DESCRIPTOR_FLAG_POINTER_FREE)) {
+      const struct MojomArrayHeader* array = data;
+      const union MojomPointer* pointers =
+          MOJOM_ARRAY_INDEX(array, union MojomPointer, 0);
+      for (uint32_t i = 0; i < array->num_elements; i++) {
+        const uint32_t* num_bytes = pointers[i].ptr;
+        assert(array_desc->nullable || num_bytes);
+        if (num_bytes)
+          size += *num_bytes;
+      }
+      return size;
+    }
+  } else if (is_struct_with(type, type_desc,
+                            MOJOM_TYPE_DESCRIPTOR_FLAG_POINTER_FREE)) {
+    // A struct without any pointers is just its own size, too.
+    return size;
+  }
+
+  init_frame(frame, type, type_desc, data, NULL, 0);
+  return size;
+}
+
+static inline size_t compute_size_field(enum MojomTypeDescriptorType type,
+                                        const void* type_desc,
+                                        bool nullable,
+                                        const void* data,
+                                        struct MojomTraversalFrame* frame) {
+  size_t size = 0;
+  frame->num_fields = 0;
+  for (;;) {
+    switch (type) {
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_MAP_PTR:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR: {
+        const void* ptr = ((const union MojomPointer*)data)->ptr;
+        assert(nullable || ptr);
+        if (ptr == NULL)
+          return size;
+        return size + compute_size_enter(type, type_desc, ptr, frame);
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_UNION_PTR:
+        data = ((const union MojomPointer*)data)->ptr;
+        if (data == NULL)
+          return size;
+        size += sizeof(struct MojomUnionLayout);
+        // Fall through.
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_UNION: {
+        const struct MojomUnionLayout* in_union = data;
+        // Unions inside unions may be set to null by setting their pointer to
+        // NULL, OR by setting the union's |size| to 0.
+        if (nullable && in_union->size == 0)
+          return size;
+        const struct MojomTypeDescriptorUnionEntry* entry =
+            union_entry(type_desc, in_union);
+        // We should skip non-pointer types.
+        if (entry == NULL || !MojomType_IsPointer(entry->elem_type))
+          return size;
+        type = entry->elem_type;
+        type_desc = entry->elem_descriptor;
+        nullable = entry->nullable;
+        data = &in_union->data;
+        break;
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_INTERFACE:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_POD:
+        return size;
+    }
+  }
+}
+
+static size_t compute_size_run(struct MojomTraversalFrame* stack);
+
+// Visits |frame| using a new stack.
+static size_t compute_size_resume(const struct MojomTraversalFrame* frame) {
+  struct MojomTraversalFrame stack[MOJOM_TRAVERSAL_STACK_SIZE];
+  stack[0] = *frame;
+  return compute_size_run(stack);
+}
+
+static size_t compute_size_run(struct MojomTraversalFrame* stack) {
+  struct MojomTraversalFrame* frame = stack;
+  struct MojomTraversalField field;
+  size_t size = 0;
+  for (;;) {
+    if (!next_field(frame, &field)) {
+      if (frame == stack)
+        return size;
+      frame--;
+      continue;
+    }
+    struct MojomTraversalFrame* child = frame + 1;
+    size += compute_size_field(field.type, field.type_desc, field.nullable,
+                               frame->data + field.offset, child);
+    if (child->num_fields == 0)
+      continue;
+    if (child == &stack[MOJOM_TRAVERSAL_STACK_SIZE - 1])
+      size += compute_size_resume(child);
+    else
+      frame = child;
+  }
+}
+
+size_t MojomTraversal_ComputeSerializedSize(
+    enum MojomTypeDescriptorType in_type,
+    const void* in_type_desc,
+    const void* in_data) {
+  assert(in_type_desc);
+  assert(in_data);
+
+  struct MojomTraversalFrame stack[MOJOM_TRAVERSAL_STACK_SIZE];
+  stack[0].num_fields = 0;
+  size_t size = compute_size_enter(in_type, in_type_desc, in_data, stack);
+  return size + compute_size_run(stack);
+}
+
+size_t MojomType_DispatchComputeSerializedSize(
+    enum MojomTypeDescriptorType type,
+    const void* type_desc,
+    bool nullable,
+    const void* data) {
+  struct MojomTraversalFrame stack[MOJOM_TRAVERSAL_STACK_SIZE];
+  init_field_frame(stack, type, type_desc, nullable, data, NULL, 0);
+  return compute_size_run(stack);
+}
+
+// EncodePointersAndHandles ----------------------------------------------------
+
+static inline void encode_enter(
+    enum MojomTypeDescriptorType type,
+    const void* type_desc,
+    void* data,
+    uint32_t buf_size,
+    struct MojomHandleBuffer* inout_handles_buffer,
+    struct MojomTraversalFrame* frame) {
+  if (type == MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR) {
+    const struct MojomTypeDescriptorArray* array_desc = type_desc;
+    struct MojomArrayHeader* array = data;
+    assert(buf_size >= sizeof(struct MojomArrayHeader));
+    assert(buf_size >= array->num_bytes);
+
+    switch (array_desc->elem_type) {
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_POD:
+        // Nothing to encode for POD types.
+        return;
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE: {
+        MojoHandle* handles = MOJOM_ARRAY_INDEX(array, MojoHandle, 0);
+        for (uint32_t i = 0; i < array->num_elements; i++) {
+          MojomType_EncodeHandle(array_desc->nullable, &handles[i],
+                                 inout_handles_buffer);
+        }
+        return;
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_INTERFACE: {
+        struct MojomInterfaceData* interfaces =
+            MOJOM_ARRAY_INDEX(array, struct MojomInterfaceData, 0);
+        for (uint32_t i = 0; i < array->num_elements; i++) {
+          MojomType_EncodeHandle(array_desc->nullable, &interfaces[i].handle,
+                                 inout_handles_buffer);
+        }
+        return;
+      }
+      default:
+        break;
+    }
+
+    // Only the pointers themselves need encoding if the objects they point to
+    // have no pointers or handles.
+    if (has_elements_pointing_to(
+            array_desc, MOJOM_TYPE_DESCRIPTOR_FLAG_POINTER_AND_HANDLE_FREE)) {
+      union MojomPointer* pointers =
+          MOJOM_ARRAY_INDEX(array, union MojomPointer, 0);
+      for (uint32_t i = 0; i < array->num_elements; i++) {
+        MojomType_EncodePointer(
+            &pointers[i],
+            buf_size - (uint32_t)((char*)&pointers[i] - (char*)array));
+      }
+      return;
+    }
+  } else {
+    assert(buf_size >= sizeof(struct MojomStructHeader));
+  }
+
+  init_frame(frame, type, type_desc, data, NULL, buf_size);
+}
+
+static inline void encode_field(
+    enum MojomTypeDescriptorType type,
+    const void* type_desc,
+    bool nullable,
+    char* data,
+    uint32_t buf_size,
+    struct MojomHandleBuffer* inout_handles_buffer,
+    struct MojomTraversalFrame* frame) {
+  frame->num_fields = 0;
+  for (;;) {
+    switch (type) {
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_MAP_PTR:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR: {
+        char* ptr = ((union MojomPointer*)data)->ptr;
+        MojomType_EncodePointer((union MojomPointer*)data, buf_size);
+        assert(nullable || ptr);
+        if (ptr != NULL) {
+          encode_enter(type, type_desc, ptr, buf_size - (uint32_t)(ptr - data),
+                       inout_handles_buffer, frame);
+        }
+        return;
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_UNION_PTR: {
+        char* ptr = ((union MojomPointer*)data)->ptr;
+        MojomType_EncodePointer((union MojomPointer*)data, buf_size);
+        if (ptr == NULL)
+          return;
+        buf_size -= (uint32_t)(ptr - data);
+        data = ptr;
+        // Fall through.
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_UNION: {
+        struct MojomUnionLayout* inout_union = (struct MojomUnionLayout*)data;
+        assert(buf_size >= sizeof(struct MojomUnionLayout));
+        if (nullable && inout_union->size == 0)
+          return;
+        const struct MojomTypeDescriptorUnionEntry* entry =
+            union_entry(type_desc, inout_union);
+        if (entry == NULL || entry->elem_type == MOJOM_TYPE_DESCRIPTOR_TYPE_POD)
+          return;
+        type = entry->elem_type;
+        type_desc = entry->elem_descriptor;
+        nullable = entry->nullable;
+        data = (char*)&inout_union->data;
+        buf_size -= (uint32_t)offsetof(struct MojomUnionLayout, data);
+        break;
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE:
+        MojomType_EncodeHandle(nullable, (MojoHandle*)data,
+                               inout_handles_buffer);
+        return;
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_INTERFACE:
+        MojomType_EncodeHandle(nullable,
+                               &((struct MojomInterfaceData*)data)->handle,
+                               inout_handles_buffer);
+        return;
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_POD:
+        // We shouldn't ever end up here.
+        assert(false);
+        return;
+    }
+  }
+}
+
+static void encode_run(struct MojomTraversalFrame* stack,
+                       struct MojomHandleBuffer* inout_handles_buffer);
+
+// Visits |frame| using a new stack.
+static void encode_resume(const struct MojomTraversalFrame* frame,
+                          struct MojomHandleBuffer* inout_handles_buffer) {
+  struct MojomTraversalFrame stack[MOJOM_TRAVERSAL_STACK_SIZE];
+  stack[0] = *frame;
+  encode_run(stack, inout_handles_buffer);
+}
+
+static void encode_run(struct MojomTraversalFrame* stack,
+                       struct MojomHandleBuffer* inout_handles_buffer) {
+  struct MojomTraversalFrame* frame = stack;
+  struct MojomTraversalField field;
+  for (;;) {
+    if (!next_field(frame, &field)) {
+      if (frame == stack)
+        return;
+      frame--;
+      continue;
+    }
+    assert(field.offset < frame->buf_size);
+    struct MojomTraversalFrame* child = frame + 1;
+    encode_field(field.type, field.type_desc, field.nullable,
+                 frame->data + field.offset, frame->buf_size - field.offset,
+                 inout_handles_buffer, child);
+    if (child->num_fields == 0)
+      continue;
+    if (child == &stack[MOJOM_TRAVERSAL_STACK_SIZE - 1])
+      encode_resume(child, inout_handles_buffer);
+    else
+      frame = child;
+  }
+}
+
+void MojomTraversal_EncodePointersAndHandles(
+    enum MojomTypeDescriptorType in_type,
+    const void* in_type_desc,
+    void* inout_data,
+    uint32_t in_buf_size,
+    struct MojomHandleBuffer* inout_handles_buffer) {
+  assert(in_type_desc);
+  assert(inout_data);
+
+  struct MojomTraversalFrame stack[MOJOM_TRAVERSAL_STACK_SIZE];
+  stack[0].num_fields = 0;
+  encode_enter(in_type, in_type_desc, inout_data, in_buf_size,
+               inout_handles_buffer, stack);
+  encode_run(stack, inout_handles_buffer);
+}
+
+void MojomType_DispatchEncodePointersAndHandles(
+    enum MojomTypeDescriptorType in_elem_type,
+    const void* in_type_desc,
+    bool in_nullable,
+    void* inout_buf,
+    uint32_t in_buf_size,
+    struct MojomHandleBuffer* inout_handles_buffer) {
+  assert(inout_buf);
+
+  struct MojomTraversalFrame stack[MOJOM_TRAVERSAL_STACK_SIZE];
+  init_field_frame(stack, in_elem_type, in_type_desc, in_nullable, inout_buf,
+                   NULL, in_buf_size);
+  encode_run(stack, inout_handles_buffer);
+}
+
+// DecodePointersAndHandles ----------------------------------------------------
+
+static inline void decode_enter(enum MojomTypeDescriptorType type,
+                                const void* type_desc,
+                                void* data,
+                                uint32_t buf_size,
+                                MojoHandle* inout_handles,
+                                uint32_t in_num_handles,
+                                struct MojomTraversalFrame* frame) {
+  if (type == MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR) {
+    const struct MojomTypeDescriptorArray* array_desc = type_desc;
+    struct MojomArrayHeader* array = data;
+
+    switch (array_desc->elem_type) {
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_POD:
+        // Nothing to decode for POD types.
+        return;
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE: {
+        MojoHandle* handles = MOJOM_ARRAY_INDEX(array, MojoHandle, 0);
+        for (uint32_t i = 0; i < array->num_elements; i++)
+          MojomType_DecodeHandle(&handles[i], inout_handles, in_num_handles);
+        return;
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_INTERFACE: {
+        struct MojomInterfaceData* interfaces =
+            MOJOM_ARRAY_INDEX(array, struct MojomInterfaceData, 0);
+        for (uint32_t i = 0; i < array->num_elements; i++) {
+          MojomType_DecodeHandle(&interfaces[i].handle, inout_handles,
+                                 in_num_handles);
+        }
+        return;
+      }
+      default:
+        break;
+    }
+
+    // Only the pointers themselves need decoding if the objects they point to
+    // have no pointers or handles.
+    if (has_elements_pointing_to(
+            array_desc, MOJOM_TYPE_DESCRIPTOR_FLAG_POINTER_AND_HANDLE_FREE)) {
+      union MojomPointer* pointers =
+          MOJOM_ARRAY_INDEX(array, union MojomPointer, 0);
+      for (uint32_t i = 0; i < array->num_elements; i++) {
+        MojomType_DecodePointer(&pointers[i]);
+        assert(pointers[i].ptr == NULL ||
+               (char*)pointers[i].ptr < (char*)array + buf_size);
+      }
+      return;
+    }
+  }
+
+  init_frame(frame, type, type_desc, data, NULL, buf_size);
+}
+
+static inline void decode_field(enum MojomTypeDescriptorType type,
+                                const void* type_desc,
+                                bool nullable,
+                                char* data,
+                                uint32_t buf_size,
+                                MojoHandle* inout_handles,
+                                uint32_t in_num_handles,
+                                struct MojomTraversalFrame* frame) {
+  frame->num_fields = 0;
+  for (;;) {
+    switch (type) {
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_MAP_PTR:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR: {
+        MojomType_DecodePointer((union MojomPointer*)data);
+        char* ptr = ((union MojomPointer*)data)->ptr;
+        assert(ptr == NULL || ptr < data + buf_size);
+        assert(nullable || ptr);
+        if (ptr != NULL) {
+          decode_enter(type, type_desc, ptr, buf_size - (uint32_t)(ptr - data),
+                       inout_handles, in_num_handles, frame);
+        }
+        return;
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_UNION_PTR: {
+        MojomType_DecodePointer((union MojomPointer*)data);
+        char* ptr = ((union MojomPointer*)data)->ptr;
+        assert(ptr == NULL || ptr < data + buf_size);
+        if (ptr == NULL)
+          return;
+        buf_size -= (uint32_t)(ptr - data);
+        data = ptr;
+        // Fall through.
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_UNION: {
+        struct MojomUnionLayout* inout_union = (struct MojomUnionLayout*)data;
+        assert(buf_size >= sizeof(struct MojomUnionLayout));
+        if (nullable && inout_union->size == 0)
+          return;
+        const struct MojomTypeDescriptorUnionEntry* entry =
+            union_entry(type_desc, inout_union);
+        if (entry == NULL || entry->elem_type == MOJOM_TYPE_DESCRIPTOR_TYPE_POD)
+          return;
+        type = entry->elem_type;
+        type_desc = entry->elem_descriptor;
+        nullable = entry->nullable;
+        data = (char*)&inout_union->data;
+        buf_size -= (uint32_t)offsetof(struct MojomUnionLayout, data);
+        break;
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE:
+        MojomType_DecodeHandle((MojoHandle*)data, inout_handles,
+                               in_num_handles);
+        return;
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_INTERFACE:
+        MojomType_DecodeHandle(&((struct MojomInterfaceData*)data)->handle,
+                               inout_handles, in_num_handles);
+        return;
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_POD:
+        // We shouldn't ever end up here.
+        assert(false);
+        return;
+    }
+  }
+}
+
+static void decode_run(struct MojomTraversalFrame* stack,
+                       MojoHandle* inout_handles,
+                       uint32_t in_num_handles);
+
+// Visits |frame| using a new stack.
+static void decode_resume(const struct MojomTraversalFrame* frame,
+                          MojoHandle* inout_handles,
+                          uint32_t in_num_handles) {
+  struct MojomTraversalFrame stack[MOJOM_TRAVERSAL_STACK_SIZE];
+  stack[0] = *frame;
+  decode_run(stack, inout_handles, in_num_handles);
+}
+
+static void decode_run(struct MojomTraversalFrame* stack,
+                       MojoHandle* inout_handles,
+                       uint32_t in_num_handles) {
+  struct MojomTraversalFrame* frame = stack;
+  struct MojomTraversalField field;
+  for (;;) {
+    if (!next_field(frame, &field)) {
+      if (frame == stack)
+        return;
+      frame--;
+      continue;
+    }
+    assert(field.offset < frame->buf_size);
+    struct MojomTraversalFrame* child = frame + 1;
+    decode_field(field.type, field.type_desc, field.nullable,
+                 frame->data + field.offset, frame->buf_size - field.offset,
+                 inout_handles, in_num_handles, child);
+    if (child->num_fields == 0)
+      continue;
+    if (child == &stack[MOJOM_TRAVERSAL_STACK_SIZE - 1])
+      decode_resume(child, inout_handles, in_num_handles);
+    else
+      frame = child;
+  }
+}
+
+void MojomTraversal_DecodePointersAndHandles(
+    enum MojomTypeDescriptorType in_type,
+    const void* in_type_desc,
+    void* inout_data,
+    uint32_t in_buf_size,
+    MojoHandle* inout_handles,
+    uint32_t in_num_handles) {
+  assert(in_type_desc);
+  assert(inout_data);
+  assert(inout_handles != NULL || in_num_handles == 0);
+
+  struct MojomTraversalFrame stack[MOJOM_TRAVERSAL_STACK_SIZE];
+  stack[0].num_fields = 0;
+  decode_enter(in_type, in_type_desc, inout_data, in_buf_size, inout_handles,
+               in_num_handles, stack);
+  decode_run(stack, inout_handles, in_num_handles);
+}
+
+void MojomType_DispatchDecodePointersAndHandles(
+    enum MojomTypeDescriptorType in_elem_type,
+    const void* in_type_desc,
+    bool in_nullable,
+    void* inout_buf,
+    uint32_t in_buf_size,
+    MojoHandle* inout_handles,
+    uint32_t in_num_handles) {
+  assert(inout_buf);
+
+  struct MojomTraversalFrame stack[MOJOM_TRAVERSAL_STACK_SIZE];
+  init_field_frame(stack, in_elem_type, in_type_desc, in_nullable, inout_buf,
+                   NULL, in_buf_size);
+  decode_run(stack, inout_handles, in_num_handles);
+}
+
+// Validate --------------------------------------------------------------------
+
+static bool is_valid_size_for_version(
+    const struct MojomStructHeader* in_struct,
+    const struct MojomTypeDescriptorStructVersion versions[],
+    uint32_t num_versions) {
+  // Structs are most often of the latest version we know of (or a newer one).
+  const struct MojomTypeDescriptorStructVersion* latest =
+      &versions[num_versions - 1];
+  if (in_struct->version >= latest->version) {
+    return in_struct->version == latest->version
+               ? in_struct->num_bytes == latest->num_bytes
+               : in_struct->num_bytes >= latest->num_bytes;
+  }
+
+  // Versions start at 0 and increase, so the most recent one that |in_struct|
+  // is compatible with is at an index no greater than its version -- and is at
+  // exactly that index if (as usual) there are no gaps in the versions.
+  uint32_t version = in_struct->version;
+  uint32_t lo = 0;
+  uint32_t hi = version < num_versions - 1 ? version : num_versions - 1;
+  if (versions[hi].version != version) {
+    // Binary search for the last version no greater than |version|.
+    while (lo < hi) {
+      uint32_t mid = hi - (hi - lo) / 2;
+      if (versions[mid].version <= version)
+        lo = mid;
+      else
+        hi = mid - 1;
+    }
+  }
+
+  if (versions[hi].version == version)
+    return in_struct->num_bytes == versions[hi].num_bytes;
+  return in_struct->num_bytes >= versions[hi].num_bytes;
+}
+
+static MojomValidationResult validate_struct_header(
+    const struct MojomTypeDescriptorStruct* in_type_desc,
+    const struct MojomStructHeader* in_struct,
+    uint32_t in_buf_size) {
+  if (in_buf_size < sizeof(struct MojomStructHeader))
+    return MOJOM_VALIDATION_ILLEGAL_MEMORY_RANGE;
+
+  if (in_struct->num_bytes > in_buf_size)
+    return MOJOM_VALIDATION_ILLEGAL_MEMORY_RANGE;
+
+  if (!is_valid_size_for_version(in_struct, in_type_desc->versions,
+                                 in_type_desc->num_versions)) {
+    return MOJOM_VALIDATION_UNEXPECTED_STRUCT_HEADER;
+  }
+
+  if ((in_struct->num_bytes & 7) != 0)
+    return MOJOM_VALIDATION_MISALIGNED_OBJECT;
+
+  return MOJOM_VALIDATION_ERROR_NONE;
+}
+
+// Rounds up to nearest byte.
+static uint64_t bits_to_bytes(uint64_t bits) {
+  return (bits + 7) / 8;
+}
+
+static MojomValidationResult validate_array_header(
+    const struct MojomTypeDescriptorArray* in_type_desc,
+    const struct MojomArrayHeader* in_array,
+    uint32_t in_buf_size) {
+  if (in_buf_size < sizeof(struct MojomArrayHeader))
+    return MOJOM_VALIDATION_ILLEGAL_MEMORY_RANGE;
+
+  if (in_array->num_bytes < sizeof(struct MojomArrayHeader))
+    return MOJOM_VALIDATION_UNEXPECTED_ARRAY_HEADER;
+
+  if (in_array->num_bytes > in_buf_size)
+    return MOJOM_VALIDATION_ILLEGAL_MEMORY_RANGE;
+
+  if (in_type_desc->num_elements != 0 &&
+      in_array->num_elements != in_type_desc->num_elements)
+    return MOJOM_VALIDATION_UNEXPECTED_ARRAY_HEADER;
+
+  // Array size is less than what we need to fit the elements.
+  if (in_array->num_bytes <
+      sizeof(struct MojomArrayHeader) +
+          bits_to_bytes((uint64_t)in_type_desc->elem_num_bits *
+                        (uint64_t)in_array->num_elements)) {
+    return MOJOM_VALIDATION_UNEXPECTED_ARRAY_HEADER;
+  }
+
+  return MOJOM_VALIDATION_ERROR_NONE;
+}
+
+// When validating and decoding in one pass (|decode| is true), each pointer is
+// decoded right after it is validated, and each handle is claimed from
+// |inout_handles| right after it is validated. Claimed handles are left in
+// |inout_handles| until the whole object is known to be valid, so that a
+// failure leaves the caller owning all of them; the handles that are skipped
+// over (which nothing may refer to once a later one is claimed) are closed as
+// soon as they are skipped.
+
+// Validates the encoded handle |*inout_handle| and, if |decode|, replaces it
+// with the handle it refers to in |inout_handles|.
+static inline MojomValidationResult validate_handle(
+    MojoHandle* inout_handle,
+    bool nullable,
+    uint32_t in_num_handles,
+    bool decode,
+    MojoHandle* inout_handles,
+    struct MojomValidationContext* inout_context) {
+  const uint32_t first_unclaimed = inout_context->next_handle_index;
+  MojomValidationResult result = MojomType_ValidateHandle(
+      *inout_handle, in_num_handles, nullable, inout_context);
+  if (result != MOJOM_VALIDATION_ERROR_NONE || !decode)
+    return result;
+
+  if (*inout_handle == kEncodedHandleInvalid) {
+    *inout_handle = MOJO_HANDLE_INVALID;
+    return MOJOM_VALIDATION_ERROR_NONE;
+  }
+  for (uint32_t i = first_unclaimed; i < *inout_handle; i++) {
+    if (inout_handles[i] != MOJO_HANDLE_INVALID) {
+      MojoClose(inout_handles[i]);
+      inout_handles[i] = MOJO_HANDLE_INVALID;
+    }
+  }
+  *inout_handle = inout_handles[*inout_handle];
+  return MOJOM_VALIDATION_ERROR_NONE;
+}
+
+// When validating incrementally, |received_end| is the end of the data that has
+// arrived so far (and NULL otherwise). Nothing past it is looked at: whatever
+// needs it returns MOJOM_VALIDATION_INCOMPLETE instead, so that it can be
+// retried once more has arrived.
+
+// Whether the |num_bytes| at |data| have arrived, as far as they are within the
+// |buf_size| bytes there (going past those is for validation to reject).
+static inline bool is_received(const char* data,
+                               uint32_t num_bytes,
+                               uint32_t buf_size,
+                               const char* received_end) {
+  if (num_bytes > buf_size)
+    num_bytes = buf_size;
+  return received_end == NULL || data + num_bytes <= received_end;
+}
+
+// Returns the size of a field of type |type|.
+static inline uint32_t field_num_bytes(enum MojomTypeDescriptorType type) {
+  switch (type) {
+    case MOJOM_TYPE_DESCRIPTOR_TYPE_UNION_PTR:
+      return sizeof(union MojomPointer);
+    case MOJOM_TYPE_DESCRIPTOR_TYPE_POD:
+      return 0;
+    default:
+      return array_elem_num_bytes(type);
+  }
+}
+
+// |depth| is the number of structs and arrays enclosing |data|.
+static inline MojomValidationResult validate_enter(
+    enum MojomTypeDescriptorType type,
+    const void* type_desc,
+    char* data,
+    uint32_t buf_size,
+    uint32_t depth,
+    uint32_t in_num_handles,
+    bool decode,
+    MojoHandle* inout_handles,
+    const char* received_end,
+    struct MojomValidationContext* inout_context,
+    struct MojomTraversalFrame* frame) {
+  if (depth == MOJOM_TRAVERSAL_MAX_DEPTH)
+    return MOJOM_VALIDATION_MAX_RECURSION_DEPTH;
+
+  // Struct and array headers are the same size.
+  if (!is_received(data, sizeof(struct MojomStructHeader), buf_size,
+                   received_end)) {
+    return MOJOM_VALIDATION_INCOMPLETE;
+  }
+
+  MojomValidationResult result;
+  if (type == MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR) {
+    const struct MojomTypeDescriptorArray* array_desc = type_desc;
+    struct MojomArrayHeader* array = (struct MojomArrayHeader*)data;
+    result = validate_array_header(array_desc, array, buf_size);
+    if (result != MOJOM_VALIDATION_ERROR_NONE)
+      return result;
+
+    // Handles are validated right away, so they all need to have arrived.
+    if ((array_desc->elem_type == MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE ||
+         array_desc->elem_type == MOJOM_TYPE_DESCRIPTOR_TYPE_INTERFACE) &&
+        !is_received(data, array->num_bytes, buf_size, received_end)) {
+      return MOJOM_VALIDATION_INCOMPLETE;
+    }
+
+    // From here on out, all pointers need to point past the end of this array.
+    inout_context->next_pointer = data + array->num_bytes;
+
+    switch (array_desc->elem_type) {
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_POD:
+        // Nothing to validate for POD types.
+        return MOJOM_VALIDATION_ERROR_NONE;
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE: {
+        MojoHandle* handles = MOJOM_ARRAY_INDEX(array, MojoHandle, 0);
+        for (uint32_t i = 0; i < array->num_elements; i++) {
+          result = validate_handle(&handles[i], array_desc->nullable,
+                                   in_num_handles, decode, inout_handles,
+                                   inout_context);
+          if (result != MOJOM_VALIDATION_ERROR_NONE)
+            return result;
+        }
+        return MOJOM_VALIDATION_ERROR_NONE;
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_INTERFACE: {
+        struct MojomInterfaceData* interfaces =
+            MOJOM_ARRAY_INDEX(array, struct MojomInterfaceData, 0);
+        for (uint32_t i = 0; i < array->num_elements; i++) {
+          result = validate_handle(&interfaces[i].handle, array_desc->nullable,
+                                   in_num_handles, decode, inout_handles,
+                                   inout_context);
+          if (result != MOJOM_VALIDATION_ERROR_NONE)
+            return result;
+        }
+        return MOJOM_VALIDATION_ERROR_NONE;
+      }
+      default:
+        break;
+    }
+  } else {
+    const struct MojomTypeDescriptorStruct* struct_desc = type_desc;
+    const struct MojomStructHeader* in_struct =
+        (const struct MojomStructHeader*)data;
+    result = validate_struct_header(struct_desc, in_struct, buf_size);
+    if (result != MOJOM_VALIDATION_ERROR_NONE)
+      return result;
+
+    // From here on out, all pointers need to point past the end of this
+    // struct.
+    inout_context->next_pointer = data + in_struct->num_bytes;
+  }
+
+  // (Maps always have entries, so they always get a frame, which lets us check
+  // their arrays once they've been validated.)
+  init_frame(frame, type, type_desc, data, NULL, buf_size);
+  return MOJOM_VALIDATION_ERROR_NONE;
+}
+
+static inline MojomValidationResult validate_field(
+    enum MojomTypeDescriptorType type,
+    const void* type_desc,
+    bool nullable,
+    char* data,
+    uint32_t buf_size,
+    uint32_t depth,
+    uint32_t in_num_handles,
+    bool decode,
+    MojoHandle* inout_handles,
+    const char* received_end,
+    struct MojomValidationContext* inout_context,
+    struct MojomTraversalFrame* frame) {
+  frame->num_fields = 0;
+  for (;;) {
+    switch (type) {
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_MAP_PTR:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR: {
+        union MojomPointer* pointer = (union MojomPointer*)data;
+        MojomValidationResult result = MojomType_ValidatePointer(
+            pointer, buf_size, nullable, inout_context);
+        if (result != MOJOM_VALIDATION_ERROR_NONE)
+          return result;
+
+        const uint32_t offset = (uint32_t)pointer->offset;
+        if (decode)
+          MojomType_DecodePointer(pointer);
+        if (offset == 0)
+          return MOJOM_VALIDATION_ERROR_NONE;
+        return validate_enter(type, type_desc, data + offset, buf_size - offset,
+                              depth, in_num_handles, decode, inout_handles,
+                              received_end, inout_context, frame);
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_UNION_PTR: {
+        union MojomPointer* pointer = (union MojomPointer*)data;
+        MojomValidationResult result = MojomType_ValidatePointer(
+            pointer, buf_size, nullable, inout_context);
+        if (result != MOJOM_VALIDATION_ERROR_NONE)
+          return result;
+
+        const uint32_t offset = (uint32_t)pointer->offset;
+        if (decode)
+          MojomType_DecodePointer(pointer);
+        if (offset == 0)
+          return MOJOM_VALIDATION_ERROR_NONE;
+
+        // Since this union is a pointer, we update |next_pointer| to be past
+        // the union data.
+        inout_context->next_pointer += sizeof(struct MojomUnionLayout);
+
+        data += offset;
+        buf_size -= offset;
+        if (!is_received(data, sizeof(struct MojomUnionLayout), buf_size,
+                         received_end)) {
+          return MOJOM_VALIDATION_INCOMPLETE;
+        }
+        // Fall through.
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_UNION: {
+        const struct MojomUnionLayout* in_union =
+            (const struct MojomUnionLayout*)data;
+        if (in_union->size == 0) {
+          return nullable ? MOJOM_VALIDATION_ERROR_NONE
+                          : MOJOM_VALIDATION_UNEXPECTED_NULL_UNION;
+        }
+
+        const struct MojomTypeDescriptorUnionEntry* entry =
+            union_entry(type_desc, in_union);
+        if (entry == NULL || entry->elem_type == MOJOM_TYPE_DESCRIPTOR_TYPE_POD)
+          return MOJOM_VALIDATION_ERROR_NONE;
+
+        if (!nullable && in_union->size != sizeof(struct MojomUnionLayout))
+          return MOJOM_VALIDATION_UNEXPECTED_NULL_UNION;
+
+        type = entry->elem_type;
+        type_desc = entry->elem_descriptor;
+        nullable = entry->nullable;
+        data = (char*)&in_union->data;
+        buf_size -= (uint32_t)offsetof(struct MojomUnionLayout, data);
+        break;
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE:
+        return validate_handle((MojoHandle*)data, nullable, in_num_handles,
+                               decode, inout_handles, inout_context);
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_INTERFACE:
+        return validate_handle(&((struct MojomInterfaceData*)data)->handle,
+                               nullable, in_num_handles, decode, inout_handles,
+                               inout_context);
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_POD:
+        return MOJOM_VALIDATION_ERROR_NONE;
+    }
+  }
+}
+
+// Checks that the keys and values arrays of the (already validated, and if
+// |decode|, decoded) map |map| have the same number of elements.
+static inline MojomValidationResult validate_map_arrays(
+    const struct MojomTraversalFrame* frame,
+    uint32_t in_num_handles,
+    bool decode,
+    struct MojomValidationContext* inout_context) {
+  if (!decode) {
+    return MojomMap_Validate(frame->type_desc,
+                             (const struct MojomStructHeader*)frame->data,
+                             frame->buf_size, in_num_handles, inout_context);
+  }
+
+  const struct MojomMapHeader* map = (const struct MojomMapHeader*)frame->data;
+  if (map->keys.ptr->num_elements != map->values.ptr->num_elements)
+    return MOJOM_VALIDATION_DIFFERENT_SIZED_ARRAYS_IN_MAP;
+  return MOJOM_VALIDATION_ERROR_NONE;
+}
+
+// When validating incrementally, visiting starts at the frame at |*inout_top|
+// in |stack| (rather than at the bottom), and if more data is needed, the
+// field that needed it is left to be visited again and the frame visiting it
+// is stored in |*inout_top|.
+static inline MojomValidationResult validate_run_impl(
+    struct MojomTraversalFrame* stack,
+    uint32_t* inout_top,
+    uint32_t in_num_handles,
+    bool decode,
+    MojoHandle* inout_handles,
+    const char* received_end,
+    struct MojomValidationContext* inout_context) {
+  struct MojomTraversalFrame* frame = stack;
+  if (received_end != NULL)
+    frame += *inout_top;
+  struct MojomTraversalField field;
+  struct MojomValidationContext saved_context;
+  MojomValidationResult result;
+  for (;;) {
+    if (!next_field(frame, &field)) {
+      if (frame->type == MOJOM_TYPE_DESCRIPTOR_TYPE_MAP_PTR &&
+          !frame->is_field) {
+        result =
+            validate_map_arrays(frame, in_num_handles, decode, inout_context);
+        if (result != MOJOM_VALIDATION_ERROR_NONE)
+          return result;
+      }
+      if (frame == stack)
+        return MOJOM_VALIDATION_ERROR_NONE;
+      frame--;
+      continue;
+    }
+    // The field is enclosed by the structs and arrays of the frames up to and
+    // including this one. (|validate_enter()| fails rather than letting the
+    // stack overflow.)
+    uint32_t depth = (uint32_t)(frame - stack) + (stack->is_field ? 0u : 1u);
+    if (received_end != NULL) {
+      saved_context = *inout_context;
+      if (is_received(frame->data + field.offset, field_num_bytes(field.type),
+                      frame->buf_size - field.offset, received_end)) {
+        result = validate_field(field.type, field.type_desc, field.nullable,
+                                frame->data + field.offset,
+                                frame->buf_size - field.offset, depth,
+                                in_num_handles, decode, inout_handles,
+                                received_end, inout_context, frame + 1);
+      } else {
+        result = MOJOM_VALIDATION_INCOMPLETE;
+      }
+      if (result == MOJOM_VALIDATION_INCOMPLETE) {
+        // Nothing but the validation context has changed yet.
+        *inout_context = saved_context;
+        frame->next_index--;
+        *inout_top = (uint32_t)(frame - stack);
+        return result;
+      }
+    } else {
+      result = validate_field(field.type, field.type_desc, field.nullable,
+                              frame->data + field.offset,
+                              frame->buf_size - field.offset, depth,
+                              in_num_handles, decode, inout_handles, NULL,
+                              inout_context, frame + 1);
+    }
+    if (result != MOJOM_VALIDATION_ERROR_NONE)
+      return result;
+    if (frame[1].num_fields != 0)
+      frame++;
+  }
+}
+
+// (Separate instances of |validate_run_impl()| for validating, for validating
+// and decoding, and for validating incrementally.)
+static MojomValidationResult validate_run(
+    struct MojomTraversalFrame* stack,
+    uint32_t in_num_handles,
+    struct MojomValidationContext* inout_context) {
+  return validate_run_impl(stack, NULL, in_num_handles, false, NULL, NULL,
+                           inout_context);
+}
+
+static MojomValidationResult validate_decode_run(
+    struct MojomTraversalFrame* stack,
+    MojoHandle* inout_handles,
+    uint32_t in_num_handles,
+    struct MojomValidationContext* inout_context) {
+  return validate_run_impl(stack, NULL, in_num_handles, true, inout_handles,
+                           NULL, inout_context);
+}
+
+static MojomValidationResult validate_incremental_run(
+    struct MojomTraversalFrame* stack,
+    uint32_t* inout_top,
+    uint32_t in_num_handles,
+    const char* received_end,
+    struct MojomValidationContext* inout_context) {
+  return validate_run_impl(stack, inout_top, in_num_handles, false, NULL,
+                           received_end, inout_context);
+}
+
+// Once everything has been validated (and decoded), removes the handles that
+// were claimed, starting at index |first_unclaimed|, from |inout_handles| (the
+// skipped ones already have been).
+static void remove_claimed_handles(
+    MojoHandle* inout_handles,
+    uint32_t first_unclaimed,
+    const struct MojomValidationContext* context) {
+  for (uint32_t i = first_unclaimed; i < context->next_handle_index; i++)
+    inout_handles[i] = MOJO_HANDLE_INVALID;
+}
+
+MojomValidationResult MojomTraversal_Validate(
+    enum MojomTypeDescriptorType in_type,
+    const void* in_type_desc,
+    const void* in_data,
+    uint32_t in_buf_size,
+    uint32_t in_num_handles,
+    struct MojomValidationContext* inout_context) {
+  assert(in_type_desc);
+  assert(in_data);
+
+  struct MojomTraversalFrame stack[MOJOM_TRAVERSAL_STACK_SIZE];
+  stack[0].num_fields = 0;
+  MojomValidationResult result =
+      validate_enter(in_type, in_type_desc, (char*)in_data, in_buf_size, 0,
+                     in_num_handles, false, NULL, NULL, inout_context, stack);
+  if (result != MOJOM_VALIDATION_ERROR_NONE || stack[0].num_fields == 0)
+    return result;
+  return validate_run(stack, in_num_handles, inout_context);
+}
+
+MojomValidationResult MojomType_DispatchValidate(
+    enum MojomTypeDescriptorType in_elem_type,
+    const void* in_type_desc,
+    bool in_nullable,
+    const void* in_buf,
+    uint32_t in_buf_size,
+    uint32_t in_num_handles,
+    struct MojomValidationContext* inout_context) {
+  assert(in_buf);
+
+  struct MojomTraversalFrame stack[MOJOM_TRAVERSAL_STACK_SIZE];
+  init_field_frame(stack, in_elem_type, in_type_desc, in_nullable, in_buf,
+                   NULL, in_buf_size);
+  return validate_run(stack, in_num_handles, inout_context);
+}
+
+// Incremental validation ------------------------------------------------------
+
+void MojomTraversal_BeginIncrementalValidation(
+    enum MojomTypeDescriptorType in_type,
+    const void* in_type_desc,
+    const void* in_data,
+    uint32_t in_buf_size,
+    uint32_t in_num_handles,
+    struct MojomIncrementalValidation* out_validation) {
+  assert(in_type_desc);
+  assert(in_data);
+  assert(out_validation);
+
+  out_validation->type = in_type;
+  out_validation->type_desc = in_type_desc;
+  out_validation->data = (char*)in_data;
+  out_validation->buf_size = in_buf_size;
+  out_validation->num_handles = in_num_handles;
+  out_validation->context.next_handle_index = 0;
+  out_validation->context.next_pointer = (char*)in_data;
+  out_validation->result = MOJOM_VALIDATION_INCOMPLETE;
+  out_validation->entered = false;
+  out_validation->top = 0;
+}
+
+MojomValidationResult MojomTraversal_ContinueIncrementalValidation(
+    struct MojomIncrementalValidation* inout_validation,
+    uint32_t in_num_bytes_received) {
+  assert(inout_validation);
+
+  struct MojomIncrementalValidation* v = inout_validation;
+  const uint32_t num_bytes_received =
+      in_num_bytes_received < v->buf_size ? in_num_bytes_received
+                                          : v->buf_size;
+  if (v->result == MOJOM_VALIDATION_INCOMPLETE) {
+    const char* received_end = v->data + num_bytes_received;
+    MojomValidationResult result = MOJOM_VALIDATION_ERROR_NONE;
+    if (!v->entered) {
+      v->stack[0].num_fields = 0;
+      result = validate_enter(v->type, v->type_desc, v->data, v->buf_size, 0,
+                              v->num_handles, false, NULL, received_end,
+                              &v->context, v->stack);
+      if (result == MOJOM_VALIDATION_INCOMPLETE)
+        return result;
+      v->entered = true;
+    }
+    if (result == MOJOM_VALIDATION_ERROR_NONE && v->stack[0].num_fields != 0) {
+      result = validate_incremental_run(v->stack, &v->top, v->num_handles,
+                                        received_end, &v->context);
+      if (result == MOJOM_VALIDATION_INCOMPLETE)
+        return result;
+    }
+    v->result = result;
+  }
+
+  // Errors are reported as soon as they're found, but success has to wait for
+  // the rest of the buffer (which only holds POD data by now).
+  if (v->result == MOJOM_VALIDATION_ERROR_NONE &&
+      num_bytes_received < v->buf_size) {
+    return MOJOM_VALIDATION_INCOMPLETE;
+  }
+  return v->result;
+}
+
+// ValidateAndDecode -----------------------------------------------------------
+
+MojomValidationResult MojomTraversal_ValidateAndDecode(
+    enum MojomTypeDescriptorType in_type,
+    const void* in_type_desc,
+    void* inout_data,
+    uint32_t in_buf_size,
+    MojoHandle* inout_handles,
+    uint32_t in_num_handles,
+    struct MojomValidationContext* inout_context) {
+  assert(in_type_desc);
+  assert(inout_data);
+  assert(inout_handles != NULL || in_num_handles == 0);
+
+  const uint32_t first_unclaimed = inout_context->next_handle_index;
+  struct MojomTraversalFrame stack[MOJOM_TRAVERSAL_STACK_SIZE];
+  stack[0].num_fields = 0;
+  MojomValidationResult result =
+      validate_enter(in_type, in_type_desc, inout_data, in_buf_size, 0,
+                     in_num_handles, true, inout_handles, NULL, inout_context,
+                     stack);
+  if (result == MOJOM_VALIDATION_ERROR_NONE && stack[0].num_fields != 0) {
+    result = validate_decode_run(stack, inout_handles, in_num_handles,
+                                 inout_context);
+  }
+  if (result == MOJOM_VALIDATION_ERROR_NONE)
+    remove_claimed_handles(inout_handles, first_unclaimed, inout_context);
+  return result;
+}
+
+MojomValidationResult MojomType_DispatchValidateAndDecode(
+    enum MojomTypeDescriptorType in_elem_type,
+    const void* in_type_desc,
+    bool in_nullable,
+    void* inout_buf,
+    uint32_t in_buf_size,
+    MojoHandle* inout_handles,
+    uint32_t in_num_handles,
+    struct MojomValidationContext* inout_context) {
+  assert(inout_buf);
+  assert(inout_handles != NULL || in_num_handles == 0);
+
+  const uint32_t first_unclaimed = inout_context->next_handle_index;
+  struct MojomTraversalFrame stack[MOJOM_TRAVERSAL_STACK_SIZE];
+  init_field_frame(stack, in_elem_type, in_type_desc, in_nullable, inout_buf,
+                   NULL, in_buf_size);
+  MojomValidationResult result = validate_decode_run(
+      stack, inout_handles, in_num_handles, inout_context);
+  if (result == MOJOM_VALIDATION_ERROR_NONE)
+    remove_claimed_handles(inout_handles, first_unclaimed, inout_context);
+  return result;
+}
+
+// DeepCopy --------------------------------------------------------------------
+
+// Whether the elements of an array described by |type_desc| are unions whose
+// fields (as far as |type_desc| knows) are all POD, so that copying them only
+// takes checking their tags.
+static inline bool has_pod_union_elements(
+    const struct MojomTypeDescriptorArray* type_desc) {
+  if (type_desc->elem_type != MOJOM_TYPE_DESCRIPTOR_TYPE_UNION)
+    return false;
+  const struct MojomTypeDescriptorUnion* union_desc =
+      type_desc->elem_descriptor;
+  for (size_t i = 0; i < union_desc->num_entries; i++) {
+    if (union_desc->entries[i].elem_type != MOJOM_TYPE_DESCRIPTOR_TYPE_POD)
+      return false;
+  }
+  return true;
+}
+
+// Whether all the (already copied) unions in |array|, described by
+// |type_desc|, can be copied, i.e., have tags that are known or UNKNOWN (see
+// |copy_field()|).
+static bool has_known_union_tags(
+    const struct MojomTypeDescriptorArray* type_desc,
+    const struct MojomArrayHeader* array) {
+  const struct MojomTypeDescriptorUnion* union_desc =
+      type_desc->elem_descriptor;
+  const struct MojomUnionLayout* unions =
+      MOJOM_ARRAY_INDEX(array, struct MojomUnionLayout, 0);
+  for (uint32_t i = 0; i < array->num_elements; i++) {
+    if (unions[i].size != 0 && unions[i].tag >= union_desc->num_fields &&
+        unions[i].tag != UNION_TAG_UNKNOWN &&
+        union_entry(union_desc, &unions[i]) == NULL) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Copies the structs or arrays (which must have no pointers of their own) that
+// the |num_elements| pointers in |in_pointers| point to, using a single
+// allocation from |buffer|, and points the pointers at |out_pointers_offset| in
+// |buffer| at the copies (as offsets, if |encode| is true). The copies are laid
+// out just as copying them one by one would lay them out, so objects that are
+// adjacent in memory (and need no padding) are copied in runs.
+static bool copy_pointees(struct MojomBuffer* buffer,
+                          const union MojomPointer* in_pointers,
+                          uint32_t num_elements,
+                          uint32_t out_pointers_offset,
+                          bool encode) {
+  // Struct and array headers both start with |num_bytes|.
+  uint64_t total_num_bytes = 0;
+  for (uint32_t i = 0; i < num_elements; i++) {
+    if (in_pointers[i].ptr != NULL) {
+      total_num_bytes +=
+          MOJOM_INTERNAL_ROUND_TO_8(*(const uint32_t*)in_pointers[i].ptr);
+    }
+  }
+  if (total_num_bytes > UINT32_MAX)
+    return false;
+  char* out_data = MojomBuffer_Allocate(buffer, (uint32_t)total_num_bytes);
+  if (out_data == NULL)
+    return false;
+
+  // |buffer| may have moved, so only now find the pointers to fix up.
+  union MojomPointer* out_pointers =
+      (union MojomPointer*)(buffer->buf + out_pointers_offset);
+  uint32_t i = 0;
+  while (i < num_elements) {
+    const char* run = in_pointers[i].ptr;
+    if (run == NULL) {
+      if (encode)
+        out_pointers[i].offset = 0;
+      else
+        out_pointers[i].ptr = NULL;
+      i++;
+      continue;
+    }
+    uint32_t run_num_bytes = 0;
+    for (;;) {
+      char* out = out_data + run_num_bytes;
+      if (encode)
+        out_pointers[i].offset = (uint64_t)(out - (char*)&out_pointers[i]);
+      else
+        out_pointers[i].ptr = out;
+      uint32_t num_bytes = *(const uint32_t*)in_pointers[i].ptr;
+      run_num_bytes += num_bytes;
+      i++;
+      // A copy that needs padding after it ends its run.
+      if (num_bytes % 8 != 0 || i == num_elements ||
+          in_pointers[i].ptr != run + run_num_bytes) {
+        break;
+      }
+    }
+    memcpy(out_data, run, run_num_bytes);
+    out_data += MOJOM_INTERNAL_ROUND_TO_8(run_num_bytes);
+  }
+  return true;
+}
+
+static inline bool copy_enter(struct MojomBuffer* buffer,
+                              enum MojomTypeDescriptorType type,
+                              const void* type_desc,
+                              const void* in_data,
+                              void** out_data,
+                              struct MojomTraversalFrame* frame) {
+  // Struct and array headers both start with |num_bytes|.
+  uint32_t num_bytes = *(const uint32_t*)in_data;
+  *out_data = MojomBuffer_Allocate(buffer, num_bytes);
+  if (*out_data == NULL)
+    return false;
+
+  memcpy(*out_data, in_data, num_bytes);
+
+  if (type == MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR) {
+    const struct MojomTypeDescriptorArray* array_desc = type_desc;
+    switch (array_desc->elem_type) {
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_POD:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_INTERFACE:
+        // Nothing else to copy for POD and handle types.
+        return true;
+      default:
+        break;
+    }
+
+    const struct MojomArrayHeader* array = in_data;
+    if (has_pod_union_elements(array_desc))
+      return has_known_union_tags(array_desc, array);
+
+    // The objects that the elements point to, if they have no pointers of
+    // their own, are copied all at once.
+    if (has_elements_pointing_to(array_desc,
+                                 MOJOM_TYPE_DESCRIPTOR_FLAG_POINTER_FREE)) {
+      uint32_t pointers_offset =
+          (uint32_t)((char*)*out_data - buffer->buf) +
+          (uint32_t)sizeof(struct MojomArrayHeader);
+      return copy_pointees(buffer,
+                           MOJOM_ARRAY_INDEX(array, union MojomPointer, 0),
+                           array->num_elements, pointers_offset, false);
+    }
+  } else if (is_struct_with(type, type_desc,
+                            MOJOM_TYPE_DESCRIPTOR_FLAG_POINTER_FREE)) {
+    // Nor for structs without pointers (whose handles have been copied).
+    return true;
+  }
+
+  init_frame(frame, type, type_desc, in_data, *out_data, 0);
+  return true;
+}
+
+static inline bool copy_field(struct MojomBuffer* buffer,
+                              enum MojomTypeDescriptorType type,
+                              const void* type_desc,
+                              const char* in_data,
+                              char* out_data,
+                              struct MojomTraversalFrame* frame) {
+  frame->num_fields = 0;
+  for (;;) {
+    switch (type) {
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_MAP_PTR:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR: {
+        const void* in_ptr = ((const union MojomPointer*)in_data)->ptr;
+        union MojomPointer* out_pointer = (union MojomPointer*)out_data;
+        if (in_ptr == NULL) {
+          out_pointer->ptr = NULL;
+          return true;
+        }
+        return copy_enter(buffer, type, type_desc, in_ptr, &out_pointer->ptr,
+                          frame);
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_UNION_PTR: {
+        const void* in_ptr = ((const union MojomPointer*)in_data)->ptr;
+        union MojomPointer* out_pointer = (union MojomPointer*)out_data;
+        if (in_ptr == NULL) {
+          out_pointer->ptr = NULL;
+          return true;
+        }
+        out_pointer->ptr =
+            MojomBuffer_Allocate(buffer, sizeof(struct MojomUnionLayout));
+        if (out_pointer->ptr == NULL)
+          return false;
+        in_data = in_ptr;
+        out_data = out_pointer->ptr;
+        // Fall through.
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_UNION: {
+        const struct MojomUnionLayout* in_union =
+            (const struct MojomUnionLayout*)in_data;
+        struct MojomUnionLayout* out_union = (struct MojomUnionLayout*)out_data;
+        memcpy(out_union, in_union, sizeof(struct MojomUnionLayout));
+
+        // Unions with size 0 are null.
+        if (in_union->size == 0)
+          return true;
+
+        const struct MojomTypeDescriptorUnionEntry* entry =
+            union_entry(type_desc, in_union);
+        if (entry == NULL) {
+          // If the tag is the UNKNOWN tag, it's not a failure. If it's an
+          // unrecognized tag (erroneous or because this union is from a
+          // future-version), we don't know how to copy it, so the copy is a
+          // failure.
+          return in_union->tag <
+                     ((const struct MojomTypeDescriptorUnion*)type_desc)
+                         ->num_fields ||
+                 in_union->tag == UNION_TAG_UNKNOWN;
+        }
+
+        // We should skip non-pointer types.
+        if (entry->elem_type == MOJOM_TYPE_DESCRIPTOR_TYPE_POD)
+          return true;
+
+        type = entry->elem_type;
+        type_desc = entry->elem_descriptor;
+        in_data = (const char*)&in_union->data;
+        out_data = (char*)&out_union->data;
+        break;
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_INTERFACE:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_POD:
+        return true;
+    }
+  }
+}
+
+static bool copy_run(struct MojomBuffer* buffer,
+                     struct MojomTraversalFrame* stack);
+
+// Visits |frame| using a new stack.
+static bool copy_resume(struct MojomBuffer* buffer,
+                        const struct MojomTraversalFrame* frame) {
+  struct MojomTraversalFrame stack[MOJOM_TRAVERSAL_STACK_SIZE];
+  stack[0] = *frame;
+  return copy_run(buffer, stack);
+}
+
+static bool copy_run(struct MojomBuffer* buffer,
+                     struct MojomTraversalFrame* stack) {
+  struct MojomTraversalFrame* frame = stack;
+  struct MojomTraversalField field;
+  for (;;) {
+    if (!next_field(frame, &field)) {
+      if (frame == stack)
+        return true;
+      frame--;
+      continue;
+    }
+    struct MojomTraversalFrame* child = frame + 1;
+    if (!copy_field(buffer, field.type, field.type_desc,
+                    frame->data + field.offset, frame->out_data + field.offset,
+                    child)) {
+      return false;
+    }
+    if (child->num_fields == 0)
+      continue;
+    if (child == &stack[MOJOM_TRAVERSAL_STACK_SIZE - 1]) {
+      if (!copy_resume(buffer, child))
+        return false;
+    } else {
+      frame = child;
+    }
+  }
+}
+
+bool MojomTraversal_DeepCopy(struct MojomBuffer* buffer,
+                             enum MojomTypeDescriptorType in_type,
+                             const void* in_type_desc,
+                             const void* in_data,
+                             void** out_data) {
+  assert(in_type_desc);
+  assert(in_data);
+  assert(out_data);
+
+  struct MojomTraversalFrame stack[MOJOM_TRAVERSAL_STACK_SIZE];
+  stack[0].num_fields = 0;
+  return copy_enter(buffer, in_type, in_type_desc, in_data, out_data,
+                    stack) &&
+         copy_run(buffer, stack);
+}
+
+bool MojomType_DispatchDeepCopy(struct MojomBuffer* buffer,
+                                enum MojomTypeDescriptorType in_elem_type,
+                                const void* in_type_desc,
+                                const void* in_data,
+                                void* out_data) {
+  assert(in_data);
+
+  struct MojomTraversalFrame stack[MOJOM_TRAVERSAL_STACK_SIZE];
+  init_field_frame(stack, in_elem_type, in_type_desc, false, in_data, out_data,
+                   0);
+  return copy_run(buffer, stack);
+}
+
+// DeepCopyAndEncode -----------------------------------------------------------
+
+// Since |buffer| may move whenever something is allocated from it, the copy is
+// only referred to by offsets into it.
+
+static inline MojoHandle* encoded_handle_at(struct MojomBuffer* buffer,
+                                            uint32_t offset) {
+  return (MojoHandle*)(buffer->buf + offset);
+}
+
+// Like MojomType_EncodeHandle(), but returns false (rather than writing past
+// the end of |inout_handles_buffer|) if there is no room left for the handle.
+static inline bool copy_encode_handle(
+    bool nullable,
+    MojoHandle* handle,
+    struct MojomHandleBuffer* inout_handles_buffer) {
+  if (*handle != MOJO_HANDLE_INVALID &&
+      inout_handles_buffer->num_handles_used >=
+          inout_handles_buffer->num_handles) {
+    return false;
+  }
+  MojomType_EncodeHandle(nullable, handle, inout_handles_buffer);
+  return true;
+}
+
+static inline bool copy_encode_enter(
+    struct MojomBuffer* buffer,
+    enum MojomTypeDescriptorType type,
+    const void* type_desc,
+    const void* in_data,
+    struct MojomHandleBuffer* inout_handles_buffer,
+    uint32_t* out_offset,
+    struct MojomTraversalFrame* frame) {
+  // Struct and array headers both start with |num_bytes|.
+  uint32_t num_bytes = *(const uint32_t*)in_data;
+  char* out_data = MojomBuffer_Allocate(buffer, num_bytes);
+  if (out_data == NULL)
+    return false;
+
+  memcpy(out_data, in_data, num_bytes);
+  *out_offset = (uint32_t)(out_data - buffer->buf);
+
+  if (type == MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR) {
+    const struct MojomTypeDescriptorArray* array_desc = type_desc;
+    struct MojomArrayHeader* array = (struct MojomArrayHeader*)out_data;
+    switch (array_desc->elem_type) {
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_POD:
+        // Nothing else to copy or encode for POD types.
+        return true;
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE: {
+        MojoHandle* handles = MOJOM_ARRAY_INDEX(array, MojoHandle, 0);
+        for (uint32_t i = 0; i < array->num_elements; i++) {
+          if (!copy_encode_handle(array_desc->nullable, &handles[i],
+                                  inout_handles_buffer)) {
+            return false;
+          }
+        }
+        return true;
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_INTERFACE: {
+        struct MojomInterfaceData* interfaces =
+            MOJOM_ARRAY_INDEX(array, struct MojomInterfaceData, 0);
+        for (uint32_t i = 0; i < array->num_elements; i++) {
+          if (!copy_encode_handle(array_desc->nullable, &interfaces[i].handle,
+                                  inout_handles_buffer)) {
+            return false;
+          }
+        }
+        return true;
+      }
+      default:
+        break;
+    }
+
+    if (has_pod_union_elements(array_desc))
+      return has_known_union_tags(array_desc, array);
+
+    // See |copy_enter()|; here, the objects mustn't have handles either.
+    if (has_elements_pointing_to(
+            array_desc, MOJOM_TYPE_DESCRIPTOR_FLAG_POINTER_AND_HANDLE_FREE)) {
+      return copy_pointees(
+          buffer, MOJOM_ARRAY_INDEX((const struct MojomArrayHeader*)in_data,
+                                    union MojomPointer, 0),
+          array->num_elements,
+          *out_offset + (uint32_t)sizeof(struct MojomArrayHeader), true);
+    }
+  }
+
+  init_frame(frame, type, type_desc, in_data, NULL, 0);
+  frame->out_offset = *out_offset;
+  return true;
+}
+
+static inline bool copy_encode_field(
+    struct MojomBuffer* buffer,
+    enum MojomTypeDescriptorType type,
+    const void* type_desc,
+    bool nullable,
+    const char* in_data,
+    uint32_t out_offset,
+    struct MojomHandleBuffer* inout_handles_buffer,
+    struct MojomTraversalFrame* frame) {
+  frame->num_fields = 0;
+  for (;;) {
+    switch (type) {
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_MAP_PTR:
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR: {
+        const void* in_ptr = ((const union MojomPointer*)in_data)->ptr;
+        assert(nullable || in_ptr);
+        uint32_t ptr_offset = out_offset;
+        if (in_ptr != NULL &&
+            !copy_encode_enter(buffer, type, type_desc, in_ptr,
+                               inout_handles_buffer, &ptr_offset, frame)) {
+          return false;
+        }
+        // (A null pointer is encoded as an offset of 0.)
+        ((union MojomPointer*)(buffer->buf + out_offset))->offset =
+            ptr_offset - out_offset;
+        return true;
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_UNION_PTR: {
+        const void* in_ptr = ((const union MojomPointer*)in_data)->ptr;
+        uint32_t ptr_offset = out_offset;
+        if (in_ptr != NULL) {
+          char* out_union =
+              MojomBuffer_Allocate(buffer, sizeof(struct MojomUnionLayout));
+          if (out_union == NULL)
+            return false;
+          memcpy(out_union, in_ptr, sizeof(struct MojomUnionLayout));
+          ptr_offset = (uint32_t)(out_union - buffer->buf);
+        }
+        ((union MojomPointer*)(buffer->buf + out_offset))->offset =
+            ptr_offset - out_offset;
+        if (in_ptr == NULL)
+          return true;
+        in_data = in_ptr;
+        out_offset = ptr_offset;
+        // Fall through.
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_UNION: {
+        // (The union itself has already been copied, along with the struct or
+        // array containing it.)
+        const struct MojomUnionLayout* in_union =
+            (const struct MojomUnionLayout*)in_data;
+
+        // Unions with size 0 are null.
+        if (in_union->size == 0)
+          return true;
+
+        const struct MojomTypeDescriptorUnionEntry* entry =
+            union_entry(type_desc, in_union);
+        if (entry == NULL) {
+          // See |copy_field()|.
+          return in_union->tag <
+                     ((const struct MojomTypeDescriptorUnion*)type_desc)
+                         ->num_fields ||
+                 in_union->tag == UNION_TAG_UNKNOWN;
+        }
+
+        // We should skip non-pointer types.
+        if (entry->elem_type == MOJOM_TYPE_DESCRIPTOR_TYPE_POD)
+          return true;
+
+        type = entry->elem_type;
+        type_desc = entry->elem_descriptor;
+        nullable = entry->nullable;
+        in_data = (const char*)&in_union->data;
+        out_offset += (uint32_t)offsetof(struct MojomUnionLayout, data);
+        break;
+      }
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE:
+        return copy_encode_handle(nullable,
+                                  encoded_handle_at(buffer, out_offset),
+                                  inout_handles_buffer);
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_INTERFACE:
+        out_offset += (uint32_t)offsetof(struct MojomInterfaceData, handle);
+        return copy_encode_handle(nullable,
+                                  encoded_handle_at(buffer, out_offset),
+                                  inout_handles_buffer);
+      case MOJOM_TYPE_DESCRIPTOR_TYPE_POD:
+        return true;
+    }
+  }
+}
+
+static bool copy_encode_run(struct MojomBuffer* buffer,
+                            struct MojomHandleBuffer* inout_handles_buffer,
+                            struct MojomTraversalFrame* stack);
+
+// Visits |frame| using a new stack.
+static bool copy_encode_resume(struct MojomBuffer* buffer,
+                               struct MojomHandleBuffer* inout_handles_buffer,
+                               const struct MojomTraversalFrame* frame) {
+  struct MojomTraversalFrame stack[MOJOM_TRAVERSAL_STACK_SIZE];
+  stack[0] = *frame;
+  return copy_encode_run(buffer, inout_handles_buffer, stack);
+}
+
+static bool copy_encode_run(struct MojomBuffer* buffer,
+                            struct MojomHandleBuffer* inout_handles_buffer,
+                            struct MojomTraversalFrame* stack) {
+  struct MojomTraversalFrame* frame = stack;
+  struct MojomTraversalField field;
+  for (;;) {
+    if (!next_field(frame, &field)) {
+      if (frame == stack)
+        return true;
+      frame--;
+      continue;
+    }
+    struct MojomTraversalFrame* child = frame + 1;
+    if (!copy_encode_field(buffer, field.type, field.type_desc, field.nullable,
+                           frame->data + field.offset,
+                           frame->out_offset + field.offset,
+                           inout_handles_buffer, child)) {
+      return false;
+    }
+    if (child->num_fields == 0)
+      continue;
+    if (child == &stack[MOJOM_TRAVERSAL_STACK_SIZE - 1]) {
+      if (!copy_encode_resume(buffer, inout_handles_buffer, child))
+        return false;
+    } else {
+      frame = child;
+    }
+  }
+}
+
+bool MojomTraversal_DeepCopyAndEncode(
+    struct MojomBuffer* buffer,
+    enum MojomTypeDescriptorType in_type,
+    const void* in_type_desc,
+    const void* in_data,
+    struct MojomHandleBuffer* inout_handles_buffer,
+    uint32_t* out_offset) {
+  assert(in_type_desc);
+  assert(in_data);
+  assert(out_offset);
+
+  struct MojomTraversalFrame stack[MOJOM_TRAVERSAL_STACK_SIZE];
+  stack[0].num_fields = 0;
+  return copy_encode_enter(buffer, in_type, in_type_desc, in_data,
+                           inout_handles_buffer, out_offset, stack) &&
+         copy_encode_run(buffer, inout_handles_buffer, stack);
+}
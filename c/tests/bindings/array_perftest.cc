@@ -0,0 +1,302 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This tests the performance of the C bindings on (large) arrays of structs and
+// handles.
+
+#include <mojo/bindings/array.h>
+
+#include <assert.h>
+#include <mojo/bindings/buffer.h>
+#include <mojo/bindings/internal/type_descriptor.h>
+#include <mojo/bindings/internal/util.h>
+#include <mojo/bindings/struct.h>
+#include <mojo/macros.h>
+#include <mojo/system/handle.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mojo/public/c/tests/system/perftest_utils.h"
+
+namespace {
+
+// A struct with no pointers or handles:
+//   struct Point { int32 x; int32 y; };
+struct Point {
+  struct MojomStructHeader header;
+  int32_t x;
+  int32_t y;
+};
+
+struct MojomTypeDescriptorStructVersion g_point_versions[] = {
+    {0u, static_cast<uint32_t>(sizeof(Point))},
+};
+const struct MojomTypeDescriptorStruct g_point_type_desc = {
+    1u, g_point_versions, 0u, nullptr,
+};
+
+// A struct with a (non-nullable) string:
+//   struct Label { string text; };
+struct Label {
+  struct MojomStructHeader header;
+  union MojomPointer text;
+};
+
+struct MojomTypeDescriptorStructVersion g_label_versions[] = {
+    {0u, static_cast<uint32_t>(sizeof(Label))},
+};
+const struct MojomTypeDescriptorStructEntry g_label_entries[] = {
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR, &g_mojom_string_type_description,
+     0u, 0u, false},
+};
+const struct MojomTypeDescriptorStruct g_label_type_desc = {
+    1u, g_label_versions, 1u, g_label_entries,
+};
+
+// array<Point>, array<Label> and array<handle>:
+const struct MojomTypeDescriptorArray g_point_array_type_desc = {
+    MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR, &g_point_type_desc, 0u, 64u, false,
+};
+const struct MojomTypeDescriptorArray g_label_array_type_desc = {
+    MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR, &g_label_type_desc, 0u, 64u, false,
+};
+const struct MojomTypeDescriptorArray g_handle_array_type_desc = {
+    MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE, nullptr, 0u, 32u, false,
+};
+
+// The parameters of a message carrying a blob of bytes and some points:
+//   struct Blob { array<uint8> bytes; array<Point> points; };
+struct Blob {
+  struct MojomStructHeader header;
+  union MojomPointer bytes;
+  union MojomPointer points;
+};
+
+const struct MojomTypeDescriptorArray g_byte_array_type_desc = {
+    MOJOM_TYPE_DESCRIPTOR_TYPE_POD, nullptr, 0u, 8u, false,
+};
+
+struct MojomTypeDescriptorStructVersion g_blob_versions[] = {
+    {0u, static_cast<uint32_t>(sizeof(Blob))},
+};
+const struct MojomTypeDescriptorStructEntry g_blob_entries[] = {
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR, &g_byte_array_type_desc, 0u, 0u,
+     false},
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR, &g_point_array_type_desc, 8u, 0u,
+     false},
+};
+const struct MojomTypeDescriptorStruct g_blob_type_desc = {
+    1u, g_blob_versions, 2u, g_blob_entries,
+};
+
+// Builds an (unencoded) array of |num_elements| |Point|s in |buffer|.
+struct MojomArrayHeader* MakePointArray(struct MojomBuffer* buffer,
+                                        uint32_t num_elements) {
+  struct MojomArrayHeader* array =
+      MojomArray_New(buffer, num_elements, sizeof(union MojomPointer));
+  assert(array);
+  for (uint32_t i = 0u; i < num_elements; i++) {
+    Point* point =
+        static_cast<Point*>(MojomBuffer_Allocate(buffer, sizeof(Point)));
+    assert(point);
+    point->header.num_bytes = static_cast<uint32_t>(sizeof(Point));
+    point->header.version = 0u;
+    point->x = static_cast<int32_t>(i);
+    point->y = -static_cast<int32_t>(i);
+    MOJOM_ARRAY_INDEX(array, union MojomPointer, i)->ptr = point;
+  }
+  return array;
+}
+
+// Builds an (unencoded) array of |num_elements| |Label|s in |buffer|.
+struct MojomArrayHeader* MakeLabelArray(struct MojomBuffer* buffer,
+                                        uint32_t num_elements) {
+  struct MojomArrayHeader* array =
+      MojomArray_New(buffer, num_elements, sizeof(union MojomPointer));
+  assert(array);
+  for (uint32_t i = 0u; i < num_elements; i++) {
+    Label* label =
+        static_cast<Label*>(MojomBuffer_Allocate(buffer, sizeof(Label)));
+    assert(label);
+    label->header.num_bytes = static_cast<uint32_t>(sizeof(Label));
+    label->header.version = 0u;
+    label->text.ptr = MojomArray_New(buffer, 8u, 1u);
+    assert(label->text.ptr);
+    MOJOM_ARRAY_INDEX(array, union MojomPointer, i)->ptr = label;
+  }
+  return array;
+}
+
+void DoArrayOfStructsTest(const char* name,
+                          const struct MojomTypeDescriptorArray* type_desc,
+                          struct MojomArrayHeader* (*make_array)(
+                              struct MojomBuffer*, uint32_t),
+                          uint32_t num_elements) {
+  std::vector<uint64_t> storage(num_elements * 8u + 1024u);
+  struct MojomBuffer buffer = {reinterpret_cast<char*>(storage.data()),
+                               static_cast<uint32_t>(storage.size() * 8u), 0u};
+  struct MojomArrayHeader* array = make_array(&buffer, num_elements);
+  const uint32_t num_bytes = buffer.num_bytes_used;
+
+  char sub_test_name[100];
+  sprintf(sub_test_name, "%s_%uelements", name, num_elements);
+
+  mojo::test::IterateAndReportPerf(
+      "CBindings_ArrayComputeSerializedSize", sub_test_name,
+      [type_desc, array, num_bytes]() {
+        size_t size = MojomArray_ComputeSerializedSize(type_desc, array);
+        MOJO_ALLOW_UNUSED_LOCAL(size);
+        assert(size == num_bytes);
+      });
+
+  mojo::test::IterateAndReportPerf(
+      "CBindings_ArrayEncodeDecode", sub_test_name,
+      [type_desc, array, num_bytes]() {
+        MojomArray_EncodePointersAndHandles(type_desc, array, num_bytes,
+                                            nullptr);
+        MojomArray_DecodePointersAndHandles(type_desc, array, num_bytes,
+                                            nullptr, 0u);
+      });
+
+  MojomArray_EncodePointersAndHandles(type_desc, array, num_bytes, nullptr);
+  mojo::test::IterateAndReportPerf(
+      "CBindings_ArrayValidate", sub_test_name,
+      [type_desc, array, num_bytes]() {
+        struct MojomValidationContext context = {
+            0u, reinterpret_cast<char*>(array)};
+        MojomValidationResult result =
+            MojomArray_Validate(type_desc, array, num_bytes, 0u, &context);
+        MOJO_ALLOW_UNUSED_LOCAL(result);
+        assert(result == MOJOM_VALIDATION_ERROR_NONE);
+      });
+  MojomArray_DecodePointersAndHandles(type_desc, array, num_bytes, nullptr,
+                                      0u);
+
+  std::vector<uint64_t> copy_storage(storage.size());
+  mojo::test::IterateAndReportPerf(
+      "CBindings_ArrayDeepCopy", sub_test_name,
+      [type_desc, array, num_bytes, &copy_storage]() {
+        struct MojomBuffer copy_buffer = {
+            reinterpret_cast<char*>(copy_storage.data()),
+            static_cast<uint32_t>(copy_storage.size() * 8u), 0u};
+        struct MojomArrayHeader* copy = nullptr;
+        bool success =
+            MojomArray_DeepCopy(&copy_buffer, type_desc, array, &copy);
+        MOJO_ALLOW_UNUSED_LOCAL(success);
+        assert(success);
+        assert(copy_buffer.num_bytes_used == num_bytes);
+      });
+}
+
+TEST(CBindingsArrayPerftest, ArrayOfPointerFreeStructs) {
+  DoArrayOfStructsTest("Point", &g_point_array_type_desc, MakePointArray,
+                       100u);
+  DoArrayOfStructsTest("Point", &g_point_array_type_desc, MakePointArray,
+                       10000u);
+}
+
+TEST(CBindingsArrayPerftest, ArrayOfStructsWithPointers) {
+  DoArrayOfStructsTest("Label", &g_label_array_type_desc, MakeLabelArray,
+                       100u);
+  DoArrayOfStructsTest("Label", &g_label_array_type_desc, MakeLabelArray,
+                       10000u);
+}
+
+// Clones (as a message fanned out to many subscribers would be) a |Blob| of
+// about |num_kilobytes| KB, half of which is bytes and half points.
+void DoCloneTest(uint32_t num_kilobytes) {
+  const uint32_t num_points =
+      num_kilobytes * 512u /
+      static_cast<uint32_t>(sizeof(Point) + sizeof(union MojomPointer));
+  std::vector<uint64_t> storage(num_kilobytes * 128u + 64u);
+  struct MojomBuffer buffer = {reinterpret_cast<char*>(storage.data()),
+                               static_cast<uint32_t>(storage.size() * 8u), 0u};
+  Blob* blob = static_cast<Blob*>(MojomBuffer_Allocate(&buffer, sizeof(Blob)));
+  assert(blob);
+  blob->header.num_bytes = static_cast<uint32_t>(sizeof(Blob));
+  blob->header.version = 0u;
+  blob->bytes.ptr = MojomArray_New(&buffer, num_kilobytes * 512u, 1u);
+  assert(blob->bytes.ptr);
+  blob->points.ptr = MakePointArray(&buffer, num_points);
+  const uint32_t num_bytes = buffer.num_bytes_used;
+
+  char sub_test_name[100];
+  sprintf(sub_test_name, "%uKB", num_kilobytes);
+  std::vector<uint64_t> copy_storage(storage.size());
+  mojo::test::IterateAndReportPerf(
+      "CBindings_MessageClone", sub_test_name,
+      [blob, num_bytes, &copy_storage]() {
+        struct MojomBuffer copy_buffer = {
+            reinterpret_cast<char*>(copy_storage.data()),
+            static_cast<uint32_t>(copy_storage.size() * 8u), 0u};
+        struct MojomStructHeader* copy = nullptr;
+        bool success = MojomStruct_DeepCopy(&copy_buffer, &g_blob_type_desc,
+                                            &blob->header, &copy);
+        MOJO_ALLOW_UNUSED_LOCAL(success);
+        assert(success);
+        assert(copy_buffer.num_bytes_used == num_bytes);
+      });
+}
+
+TEST(CBindingsArrayPerftest, CloneMessages) {
+  for (uint32_t num_kilobytes = 1u; num_kilobytes <= 16u * 1024u;
+       num_kilobytes *= 4u) {
+    DoCloneTest(num_kilobytes);
+  }
+}
+
+void DoArrayOfHandlesTest(uint32_t num_elements) {
+  std::vector<uint64_t> storage(num_elements / 2u + 8u);
+  struct MojomBuffer buffer = {reinterpret_cast<char*>(storage.data()),
+                               static_cast<uint32_t>(storage.size() * 8u), 0u};
+  struct MojomArrayHeader* array =
+      MojomArray_New(&buffer, num_elements, sizeof(MojoHandle));
+  assert(array);
+  // These needn't be valid handles, since we never use them.
+  for (uint32_t i = 0u; i < num_elements; i++)
+    *MOJOM_ARRAY_INDEX(array, MojoHandle, i) = static_cast<MojoHandle>(i + 1u);
+  const uint32_t num_bytes = buffer.num_bytes_used;
+
+  std::vector<MojoHandle> handles(num_elements);
+
+  char sub_test_name[100];
+  sprintf(sub_test_name, "%uelements", num_elements);
+  mojo::test::IterateAndReportPerf(
+      "CBindings_HandleArrayEncodeDecode", sub_test_name,
+      [array, num_bytes, num_elements, &handles]() {
+        struct MojomHandleBuffer handle_buffer = {handles.data(), num_elements,
+                                                  0u};
+        MojomArray_EncodePointersAndHandles(&g_handle_array_type_desc, array,
+                                            num_bytes, &handle_buffer);
+        assert(handle_buffer.num_handles_used == num_elements);
+        MojomArray_DecodePointersAndHandles(&g_handle_array_type_desc, array,
+                                            num_bytes, handles.data(),
+                                            num_elements);
+      });
+
+  struct MojomHandleBuffer handle_buffer = {handles.data(), num_elements, 0u};
+  MojomArray_EncodePointersAndHandles(&g_handle_array_type_desc, array,
+                                      num_bytes, &handle_buffer);
+  mojo::test::IterateAndReportPerf(
+      "CBindings_HandleArrayValidate", sub_test_name,
+      [array, num_bytes, num_elements]() {
+        struct MojomValidationContext context = {
+            0u, reinterpret_cast<char*>(array)};
+        MojomValidationResult result = MojomArray_Validate(
+            &g_handle_array_type_desc, array, num_bytes, num_elements,
+            &context);
+        MOJO_ALLOW_UNUSED_LOCAL(result);
+        assert(result == MOJOM_VALIDATION_ERROR_NONE);
+      });
+}
+
+TEST(CBindingsArrayPerftest, ArrayOfHandles) {
+  DoArrayOfHandlesTest(100u);
+  DoArrayOfHandlesTest(10000u);
+}
+
+}  // namespace
@@ -5,11 +5,18 @@
 #include <mojo/bindings/buffer.h>
 
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "gtest/gtest.h"
+#include "mojo/public/c/tests/bindings/testing_util.h"
 
 namespace {
 
+bool FailToGrow(struct MojomBuffer* buffer, uint32_t min_buf_size) {
+  return false;
+}
+
 TEST(MojomBufferTest, RoundTo8) {
   char buffer[100];
   struct MojomBuffer mbuf = {
@@ -49,4 +56,50 @@ TEST(MojomBufferTest, Failure) {
   EXPECT_EQ(NULL, MojomBuffer_Allocate(&mbuf, 1));
 }
 
+TEST(MojomBufferTest, Grow) {
+  int num_grows = 0;
+  struct MojomBuffer mbuf = {
+      static_cast<char*>(malloc(16)), 16,
+      0,  // num_bytes_used
+      GrowWithRealloc, &num_grows,
+  };
+
+  char* first = static_cast<char*>(MojomBuffer_Allocate(&mbuf, 16));
+  ASSERT_TRUE(first);
+  memset(first, 'a', 16);
+  EXPECT_EQ(0, num_grows);
+
+  // This doesn't fit, so the buffer has to grow (and may move).
+  char* second = static_cast<char*>(MojomBuffer_Allocate(&mbuf, 24));
+  ASSERT_TRUE(second);
+  EXPECT_EQ(1, num_grows);
+  EXPECT_EQ(mbuf.buf + 16, second);
+  EXPECT_EQ(40ul, mbuf.num_bytes_used);
+  EXPECT_LE(40ul, mbuf.buf_size);
+  // What was allocated before is still there.
+  for (size_t i = 0; i < 16; i++)
+    EXPECT_EQ('a', mbuf.buf[i]);
+  // The space gained is zeroed.
+  for (size_t i = 16; i < mbuf.buf_size; i++)
+    EXPECT_EQ(0, mbuf.buf[i]);
+
+  free(mbuf.buf);
+}
+
+TEST(MojomBufferTest, GrowFailure) {
+  char buffer[16];
+  struct MojomBuffer mbuf = {
+      buffer, sizeof(buffer),
+      0,  // num_bytes_used
+      FailToGrow, NULL,
+  };
+
+  EXPECT_EQ(buffer, MojomBuffer_Allocate(&mbuf, 8));
+  EXPECT_EQ(NULL, MojomBuffer_Allocate(&mbuf, 16));
+  // The buffer is left as it was.
+  EXPECT_EQ(buffer, mbuf.buf);
+  EXPECT_EQ(sizeof(buffer), mbuf.buf_size);
+  EXPECT_EQ(8ul, mbuf.num_bytes_used);
+}
+
 }  // namespace
@@ -0,0 +1,194 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This tests the performance of sending and dispatching messages using the C
+// bindings (cf. mojo/public/cpp/bindings/tests/bindings_perftest.cc).
+
+#include <mojo/bindings/message.h>
+
+#include <assert.h>
+#include <mojo/bindings/buffer.h>
+#include <mojo/bindings/internal/type_descriptor.h>
+#include <mojo/macros.h>
+#include <mojo/system/handle.h>
+#include <mojo/system/message_pipe.h>
+#include <mojo/system/result.h>
+#include <mojo/system/time.h>
+#include <mojo/system/wait_set.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mojo/public/c/tests/system/perftest_utils.h"
+#include "mojo/public/cpp/system/macros.h"
+
+namespace {
+
+// The (empty) parameters of:
+//   interface PingService { Ping() => (); };
+struct PingParams {
+  struct MojomStructHeader header;
+};
+
+struct MojomTypeDescriptorStructVersion g_ping_params_versions[] = {
+    {0u, static_cast<uint32_t>(sizeof(PingParams))},
+};
+const struct MojomTypeDescriptorStruct g_ping_params_type_desc = {
+    1u, g_ping_params_versions, 0u, nullptr,
+};
+
+constexpr uint32_t kPingOrdinal = 0u;
+
+// A |MojomMessageDispatcher| with its buffers, which can serve |PingService|.
+class Endpoint {
+ public:
+  explicit Endpoint(MojoHandle message_pipe) {
+    d_.message_pipe = message_pipe;
+    d_.handlers = kHandlers;
+    d_.num_handlers = static_cast<uint32_t>(MOJO_ARRAYSIZE(kHandlers));
+    d_.response_slots = slots_;
+    d_.num_response_slots = static_cast<uint32_t>(MOJO_ARRAYSIZE(slots_));
+    d_.next_request_id = 0u;
+    d_.on_error = nullptr;
+    d_.context = this;
+    d_.read_buffer = {reinterpret_cast<char*>(read_storage_),
+                      static_cast<uint32_t>(sizeof(read_storage_)), 0u};
+    d_.read_handles_buffer = {nullptr, 0u, 0u};
+    d_.write_buffer = {reinterpret_cast<char*>(write_storage_),
+                       static_cast<uint32_t>(sizeof(write_storage_)), 0u};
+    d_.write_handles_buffer = {nullptr, 0u, 0u};
+  }
+  ~Endpoint() {
+    MojoResult result = MojoClose(d_.message_pipe);
+    MOJO_ALLOW_UNUSED_LOCAL(result);
+    assert(result == MOJO_RESULT_OK);
+  }
+
+  struct MojomMessageDispatcher* dispatcher() { return &d_; }
+
+ private:
+  static void OnPing(struct MojomMessageDispatcher* d,
+                     const struct MojomMessage* message,
+                     struct MojomStructHeader* params) {
+    PingParams response = {{static_cast<uint32_t>(sizeof(PingParams)), 0u}};
+    MojoResult result = MojomMessageDispatcher_SendResponse(
+        d, message, &g_ping_params_type_desc, &response.header);
+    MOJO_ALLOW_UNUSED_LOCAL(result);
+    assert(result == MOJO_RESULT_OK);
+  }
+
+  static const struct MojomMessageHandler kHandlers[1];
+
+  struct MojomMessageDispatcher d_;
+  struct MojomMessageResponseSlot slots_[1] = {};
+  uint64_t read_storage_[4];
+  uint64_t write_storage_[4];
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(Endpoint);
+};
+
+const struct MojomMessageHandler Endpoint::kHandlers[1] = {
+    {kPingOrdinal, true, &g_ping_params_type_desc, &Endpoint::OnPing},
+};
+
+void OnPingDone(void* context, struct MojomStructHeader* params) {
+  *static_cast<bool*>(context) = true;
+}
+
+void SendPing(Endpoint* client, bool* done) {
+  PingParams params = {{static_cast<uint32_t>(sizeof(PingParams)), 0u}};
+  MojoResult result = MojomMessageDispatcher_SendRequest(
+      client->dispatcher(), kPingOrdinal, &g_ping_params_type_desc,
+      &params.header, &g_ping_params_type_desc, &OnPingDone, done);
+  MOJO_ALLOW_UNUSED_LOCAL(result);
+  assert(result == MOJO_RESULT_OK);
+}
+
+// Creates a message pipe with an |Endpoint| on each end.
+void CreateEndpoints(std::unique_ptr<Endpoint>* client,
+                     std::unique_ptr<Endpoint>* service) {
+  MojoHandle h0;
+  MojoHandle h1;
+  MojoResult result = MojoCreateMessagePipe(nullptr, &h0, &h1);
+  MOJO_ALLOW_UNUSED_LOCAL(result);
+  assert(result == MOJO_RESULT_OK);
+  client->reset(new Endpoint(h0));
+  service->reset(new Endpoint(h1));
+}
+
+// Pings directly, reading each message as soon as it's sent.
+TEST(CBindingsMessagePerftest, PingPong) {
+  std::unique_ptr<Endpoint> client;
+  std::unique_ptr<Endpoint> service;
+  CreateEndpoints(&client, &service);
+  mojo::test::IterateAndReportPerf(
+      "CBindings_MessagePingPong", nullptr, [&client, &service]() {
+        bool done = false;
+        SendPing(client.get(), &done);
+        MojomValidationResult validation_result;
+        MojoResult result = MojomMessageDispatcher_ReadAndDispatch(
+            service->dispatcher(), &validation_result);
+        MOJO_ALLOW_UNUSED_LOCAL(result);
+        assert(result == MOJO_RESULT_OK);
+        assert(validation_result == MOJOM_VALIDATION_ERROR_NONE);
+        result = MojomMessageDispatcher_ReadAndDispatch(client->dispatcher(),
+                                                        &validation_result);
+        assert(result == MOJO_RESULT_OK);
+        assert(validation_result == MOJOM_VALIDATION_ERROR_NONE);
+        assert(done);
+      });
+}
+
+// Pings via a wait set, which also has |num_inactive| idle message pipes in
+// it.
+void DoWaitSetPingPongTest(const char* sub_test_name, size_t num_inactive) {
+  MojoHandle wait_set;
+  MojoResult result = MojoCreateWaitSet(nullptr, &wait_set);
+  MOJO_ALLOW_UNUSED_LOCAL(result);
+  assert(result == MOJO_RESULT_OK);
+
+  std::unique_ptr<Endpoint> client;
+  std::unique_ptr<Endpoint> service;
+  CreateEndpoints(&client, &service);
+  result = MojomMessageDispatcher_AddToWaitSet(client->dispatcher(), wait_set);
+  assert(result == MOJO_RESULT_OK);
+  result = MojomMessageDispatcher_AddToWaitSet(service->dispatcher(), wait_set);
+  assert(result == MOJO_RESULT_OK);
+
+  std::vector<std::unique_ptr<Endpoint>> inactive(num_inactive * 2u);
+  for (size_t i = 0u; i < num_inactive; i++) {
+    CreateEndpoints(&inactive[2u * i], &inactive[2u * i + 1u]);
+    result = MojomMessageDispatcher_AddToWaitSet(
+        inactive[2u * i + 1u]->dispatcher(), wait_set);
+    assert(result == MOJO_RESULT_OK);
+  }
+
+  mojo::test::IterateAndReportPerf(
+      "CBindings_MessageWaitSetPingPong", sub_test_name,
+      [&client, wait_set]() {
+        bool done = false;
+        SendPing(client.get(), &done);
+        while (!done) {
+          MojoResult result = MojomMessageDispatcher_WaitAndDispatch(
+              wait_set, MOJO_DEADLINE_INDEFINITE);
+          MOJO_ALLOW_UNUSED_LOCAL(result);
+          assert(result == MOJO_RESULT_OK);
+        }
+      });
+
+  inactive.clear();
+  client.reset();
+  service.reset();
+  result = MojoClose(wait_set);
+  assert(result == MOJO_RESULT_OK);
+}
+
+TEST(CBindingsMessagePerftest, WaitSetPingPong) {
+  DoWaitSetPingPongTest("0_Inactive", 0u);
+  DoWaitSetPingPongTest("1000_Inactive", 1000u);
+}
+
+}  // namespace
@@ -4,6 +4,12 @@
 
 #include <mojo/bindings/message.h>
 
+#include <mojo/bindings/array.h>
+#include <mojo/bindings/buffer.h>
+#include <mojo/bindings/internal/type_descriptor.h>
+#include <mojo/system/handle.h>
+#include <mojo/system/message_pipe.h>
+#include <mojo/system/wait_set.h>
 #include <stdint.h>
 
 #include <string>
@@ -124,4 +130,476 @@ TEST(MessageValidationTest, ValidMessageHeader) {
   }
 }
 
+// The parameters of the messages used below:
+//   struct Params { uint32 value; handle? h; };
+struct Params {
+  struct MojomStructHeader header;
+  uint32_t value;
+  MojoHandle h;
+};
+
+struct MojomTypeDescriptorStructVersion g_params_versions[] = {
+    {0u, static_cast<uint32_t>(sizeof(Params))},
+};
+const struct MojomTypeDescriptorStructEntry g_params_entries[] = {
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE, nullptr, 4u, 0u, true},
+};
+// As the generator would, this says that |Params| has no pointers, so that
+// messages are built without a deep copy.
+const struct MojomTypeDescriptorStruct g_params_type_desc = {
+    1u, g_params_versions, 1u, g_params_entries,
+    MOJOM_TYPE_DESCRIPTOR_FLAG_POINTER_FREE,
+};
+
+Params MakeParams(uint32_t value, MojoHandle h) {
+  return Params{{static_cast<uint32_t>(sizeof(Params)), 0u}, value, h};
+}
+
+// Ordinals of the messages handled by |TestDispatcher|.
+constexpr uint32_t kIncrementOrdinal = 0u;
+constexpr uint32_t kNotifyOrdinal = 5u;
+
+// A |MojomMessageDispatcher| (with its buffers) that handles:
+//   Increment(uint32 value, handle? h) => (uint32 value, handle? h);
+//   [Ordinal=5] Notify(uint32 value, handle? h);
+// by replying with |value| + 1 (and |h|), and recording |value| and |h|,
+// respectively.
+struct TestDispatcher {
+  explicit TestDispatcher(MojoHandle message_pipe) {
+    d.message_pipe = message_pipe;
+    d.handlers = kHandlers;
+    d.num_handlers = static_cast<uint32_t>(MOJO_ARRAYSIZE(kHandlers));
+    d.response_slots = slots;
+    d.num_response_slots = static_cast<uint32_t>(MOJO_ARRAYSIZE(slots));
+    d.next_request_id = 0u;
+    d.on_error = &OnError;
+    d.context = this;
+    d.read_buffer = {reinterpret_cast<char*>(read_storage),
+                     static_cast<uint32_t>(sizeof(read_storage)), 0u};
+    d.read_handles_buffer = {
+        read_handles, static_cast<uint32_t>(MOJO_ARRAYSIZE(read_handles)), 0u};
+    d.write_buffer = {reinterpret_cast<char*>(write_storage),
+                      static_cast<uint32_t>(sizeof(write_storage)), 0u};
+    d.write_handles_buffer = {
+        write_handles, static_cast<uint32_t>(MOJO_ARRAYSIZE(write_handles)),
+        0u};
+  }
+  ~TestDispatcher() {
+    if (d.message_pipe != MOJO_HANDLE_INVALID)
+      MojoClose(d.message_pipe);
+    if (notified_handle != MOJO_HANDLE_INVALID)
+      MojoClose(notified_handle);
+  }
+
+  static TestDispatcher* From(struct MojomMessageDispatcher* d) {
+    return static_cast<TestDispatcher*>(d->context);
+  }
+
+  static void OnIncrement(struct MojomMessageDispatcher* d,
+                          const struct MojomMessage* message,
+                          struct MojomStructHeader* params) {
+    Params* request = reinterpret_cast<Params*>(params);
+    Params response = MakeParams(request->value + 1u, request->h);
+    EXPECT_EQ(MOJO_RESULT_OK,
+              MojomMessageDispatcher_SendResponse(
+                  d, message, &g_params_type_desc, &response.header));
+  }
+
+  static void OnNotify(struct MojomMessageDispatcher* d,
+                       const struct MojomMessage* message,
+                       struct MojomStructHeader* params) {
+    Params* request = reinterpret_cast<Params*>(params);
+    From(d)->notified_value = request->value;
+    From(d)->notified_handle = request->h;
+  }
+
+  static void OnError(struct MojomMessageDispatcher* d,
+                      MojoResult result,
+                      MojomValidationResult validation_result) {
+    From(d)->error_result = result;
+    From(d)->error_validation_result = validation_result;
+    MojoClose(d->message_pipe);
+    d->message_pipe = MOJO_HANDLE_INVALID;
+  }
+
+  static const struct MojomMessageHandler kHandlers[2];
+
+  MojomMessageDispatcher d;
+  uint64_t read_storage[16];
+  MojoHandle read_handles[2];
+  uint64_t write_storage[16];
+  MojoHandle write_handles[2];
+  MojomMessageResponseSlot slots[2] = {};
+
+  uint32_t notified_value = 0u;
+  MojoHandle notified_handle = MOJO_HANDLE_INVALID;
+  MojoResult error_result = MOJO_RESULT_OK;
+  MojomValidationResult error_validation_result = MOJOM_VALIDATION_ERROR_NONE;
+};
+
+const struct MojomMessageHandler TestDispatcher::kHandlers[2] = {
+    {kIncrementOrdinal, true, &g_params_type_desc,
+     &TestDispatcher::OnIncrement},
+    {kNotifyOrdinal, false, &g_params_type_desc, &TestDispatcher::OnNotify},
+};
+
+// Records the response to an Increment request.
+struct IncrementResponse {
+  static void Callback(void* context, struct MojomStructHeader* params) {
+    IncrementResponse* self = static_cast<IncrementResponse*>(context);
+    Params* response = reinterpret_cast<Params*>(params);
+    self->called = true;
+    self->value = response->value;
+    self->h = response->h;
+  }
+
+  bool called = false;
+  uint32_t value = 0u;
+  MojoHandle h = MOJO_HANDLE_INVALID;
+};
+
+TEST(MessageBuilderTest, Build) {
+  uint64_t storage[8] = {};
+  struct MojomBuffer buffer = {reinterpret_cast<char*>(storage),
+                               static_cast<uint32_t>(sizeof(storage)), 0u};
+  MojoHandle handles[1] = {};
+  struct MojomHandleBuffer handles_buffer = {handles, 1u, 0u};
+
+  // Without a request ID.
+  Params params = MakeParams(42u, MOJO_HANDLE_INVALID);
+  ASSERT_TRUE(MojomMessage_Build(&buffer, 7u, 0u, 0u, &g_params_type_desc,
+                                 &params.header, &handles_buffer));
+  EXPECT_EQ(sizeof(struct MojomMessage) + sizeof(Params),
+            buffer.num_bytes_used);
+  EXPECT_EQ(0u, handles_buffer.num_handles_used);
+  EXPECT_EQ(MOJOM_VALIDATION_ERROR_NONE,
+            MojomMessage_ValidateHeader(buffer.buf, buffer.num_bytes_used));
+  const struct MojomMessage* message =
+      reinterpret_cast<const struct MojomMessage*>(buffer.buf);
+  EXPECT_EQ(0u, message->header.version);
+  EXPECT_EQ(7u, message->ordinal);
+  EXPECT_EQ(0u, message->flags);
+  const Params* encoded =
+      reinterpret_cast<const Params*>(buffer.buf + sizeof(*message));
+  EXPECT_EQ(42u, encoded->value);
+  EXPECT_EQ(static_cast<MojoHandle>(-1), encoded->h);
+
+  // With a request ID (and a handle).
+  buffer.num_bytes_used = 0u;
+  params.h = 123u;
+  ASSERT_TRUE(MojomMessage_Build(&buffer, 7u,
+                                 MOJOM_MESSAGE_FLAGS_EXPECTS_RESPONSE, 99u,
+                                 &g_params_type_desc, &params.header,
+                                 &handles_buffer));
+  EXPECT_EQ(sizeof(struct MojomMessageWithRequestId) + sizeof(Params),
+            buffer.num_bytes_used);
+  EXPECT_EQ(1u, handles_buffer.num_handles_used);
+  EXPECT_EQ(123u, handles[0]);
+  EXPECT_EQ(MOJOM_VALIDATION_ERROR_NONE,
+            MojomMessage_ValidateHeader(buffer.buf, buffer.num_bytes_used));
+  const struct MojomMessageWithRequestId* message_with_id =
+      reinterpret_cast<const struct MojomMessageWithRequestId*>(buffer.buf);
+  EXPECT_EQ(1u, message_with_id->header.version);
+  EXPECT_EQ(MOJOM_MESSAGE_FLAGS_EXPECTS_RESPONSE, message_with_id->flags);
+  EXPECT_EQ(99u, message_with_id->request_id);
+  encoded = reinterpret_cast<const Params*>(buffer.buf +
+                                            sizeof(*message_with_id));
+  EXPECT_EQ(0u, encoded->h);
+
+  // Not enough space.
+  buffer.num_bytes_used = 0u;
+  buffer.buf_size = sizeof(struct MojomMessage) + sizeof(Params) - 8u;
+  EXPECT_FALSE(MojomMessage_Build(&buffer, 7u, 0u, 0u, &g_params_type_desc,
+                                  &params.header, &handles_buffer));
+}
+
+// The parameters of a message with an array of handles:
+//   struct HandlesParams { array<handle> handles; };
+struct HandlesParams {
+  struct MojomStructHeader header;
+  union MojomPointer handles;
+};
+
+struct MojomTypeDescriptorStructVersion g_handles_params_versions[] = {
+    {0u, static_cast<uint32_t>(sizeof(HandlesParams))},
+};
+const struct MojomTypeDescriptorArray g_handle_array_type_desc = {
+    MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE, nullptr, 0u, 32u, false,
+};
+const struct MojomTypeDescriptorStructEntry g_handles_params_entries[] = {
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR, &g_handle_array_type_desc, 0u, 0u,
+     false},
+};
+const struct MojomTypeDescriptorStruct g_handles_params_type_desc = {
+    1u, g_handles_params_versions, 1u, g_handles_params_entries,
+};
+
+// Building a message with more handles than |handles_buffer| has room for fails
+// (rather than writing past its end).
+TEST(MessageBuilderTest, TooManyHandles) {
+  struct {
+    struct MojomArrayHeader header;
+    MojoHandle handles[3];
+  } array = {{static_cast<uint32_t>(sizeof(array)), 3u}, {1u, 2u, 3u}};
+  HandlesParams params = {
+      {static_cast<uint32_t>(sizeof(HandlesParams)), 0u}, {&array}};
+
+  uint64_t storage[8] = {};
+  struct MojomBuffer buffer = {reinterpret_cast<char*>(storage),
+                               static_cast<uint32_t>(sizeof(storage)), 0u};
+  // One more slot than is available, which mustn't be written to.
+  MojoHandle handles[3] = {MOJO_HANDLE_INVALID, MOJO_HANDLE_INVALID,
+                           MOJO_HANDLE_INVALID};
+  struct MojomHandleBuffer handles_buffer = {handles, 2u, 0u};
+  EXPECT_FALSE(MojomMessage_Build(&buffer, 7u, 0u, 0u,
+                                  &g_handles_params_type_desc, &params.header,
+                                  &handles_buffer));
+  EXPECT_EQ(MOJO_HANDLE_INVALID, handles[2]);
+
+  // With room for all of them, it succeeds.
+  buffer.num_bytes_used = 0u;
+  handles_buffer = {handles, 3u, 0u};
+  ASSERT_TRUE(MojomMessage_Build(&buffer, 7u, 0u, 0u,
+                                 &g_handles_params_type_desc, &params.header,
+                                 &handles_buffer));
+  EXPECT_EQ(3u, handles_buffer.num_handles_used);
+  EXPECT_EQ(3u, handles[2]);
+}
+
+TEST(MessageDispatcherTest, RequestAndResponse) {
+  MojoHandle h0, h1;
+  ASSERT_EQ(MOJO_RESULT_OK, MojoCreateMessagePipe(nullptr, &h0, &h1));
+  TestDispatcher client(h0);
+  TestDispatcher service(h1);
+
+  // Send a handle along with the request, and get it back with the response.
+  MojoHandle h2, h3;
+  ASSERT_EQ(MOJO_RESULT_OK, MojoCreateMessagePipe(nullptr, &h2, &h3));
+  Params params = MakeParams(41u, h2);
+  IncrementResponse response;
+  ASSERT_EQ(MOJO_RESULT_OK,
+            MojomMessageDispatcher_SendRequest(
+                &client.d, kIncrementOrdinal, &g_params_type_desc,
+                &params.header, &g_params_type_desc,
+                &IncrementResponse::Callback, &response));
+  EXPECT_EQ(1u, client.d.next_request_id);
+
+  MojomValidationResult validation_result = MOJOM_VALIDATION_ERROR_NONE;
+  ASSERT_EQ(MOJO_RESULT_OK, MojomMessageDispatcher_ReadAndDispatch(
+                                &service.d, &validation_result));
+  EXPECT_EQ(MOJOM_VALIDATION_ERROR_NONE, validation_result);
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_SHOULD_WAIT,
+            MojomMessageDispatcher_ReadAndDispatch(&service.d,
+                                                   &validation_result));
+  EXPECT_FALSE(response.called);
+
+  ASSERT_EQ(MOJO_RESULT_OK, MojomMessageDispatcher_ReadAndDispatch(
+                                &client.d, &validation_result));
+  EXPECT_EQ(MOJOM_VALIDATION_ERROR_NONE, validation_result);
+  EXPECT_TRUE(response.called);
+  EXPECT_EQ(42u, response.value);
+  EXPECT_NE(MOJO_HANDLE_INVALID, response.h);
+  // The response slot is free again.
+  EXPECT_EQ(nullptr, client.slots[0].callback);
+
+  // The handle that came back is still connected to |h3|.
+  EXPECT_EQ(MOJO_RESULT_OK, MojoWriteMessage(response.h, nullptr, 0u, nullptr,
+                                             0u, MOJO_WRITE_MESSAGE_FLAG_NONE));
+  EXPECT_EQ(MOJO_RESULT_OK, MojoReadMessage(h3, nullptr, nullptr, nullptr,
+                                            nullptr,
+                                            MOJO_READ_MESSAGE_FLAG_NONE));
+  EXPECT_EQ(MOJO_RESULT_OK, MojoClose(response.h));
+  EXPECT_EQ(MOJO_RESULT_OK, MojoClose(h3));
+
+  // A request without a response.
+  params = MakeParams(7u, MOJO_HANDLE_INVALID);
+  ASSERT_EQ(MOJO_RESULT_OK, MojomMessageDispatcher_SendRequest(
+                                &client.d, kNotifyOrdinal, &g_params_type_desc,
+                                &params.header, nullptr, nullptr, nullptr));
+  EXPECT_EQ(1u, client.d.next_request_id);
+  ASSERT_EQ(MOJO_RESULT_OK, MojomMessageDispatcher_ReadAndDispatch(
+                                &service.d, &validation_result));
+  EXPECT_EQ(MOJOM_VALIDATION_ERROR_NONE, validation_result);
+  EXPECT_EQ(7u, service.notified_value);
+  EXPECT_EQ(MOJO_HANDLE_INVALID, service.notified_handle);
+}
+
+TEST(MessageDispatcherTest, ResponseSlotsExhausted) {
+  MojoHandle h0, h1;
+  ASSERT_EQ(MOJO_RESULT_OK, MojoCreateMessagePipe(nullptr, &h0, &h1));
+  TestDispatcher client(h0);
+  TestDispatcher service(h1);
+
+  Params params = MakeParams(0u, MOJO_HANDLE_INVALID);
+  IncrementResponse responses[3];
+  for (size_t i = 0u; i < 2u; i++) {
+    EXPECT_EQ(MOJO_RESULT_OK,
+              MojomMessageDispatcher_SendRequest(
+                  &client.d, kIncrementOrdinal, &g_params_type_desc,
+                  &params.header, &g_params_type_desc,
+                  &IncrementResponse::Callback, &responses[i]));
+  }
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_RESOURCE_EXHAUSTED,
+            MojomMessageDispatcher_SendRequest(
+                &client.d, kIncrementOrdinal, &g_params_type_desc,
+                &params.header, &g_params_type_desc,
+                &IncrementResponse::Callback, &responses[2]));
+
+  // Once a response arrives, its slot can be reused.
+  MojomValidationResult validation_result = MOJOM_VALIDATION_ERROR_NONE;
+  ASSERT_EQ(MOJO_RESULT_OK, MojomMessageDispatcher_ReadAndDispatch(
+                                &service.d, &validation_result));
+  ASSERT_EQ(MOJO_RESULT_OK, MojomMessageDispatcher_ReadAndDispatch(
+                                &client.d, &validation_result));
+  EXPECT_TRUE(responses[0].called);
+  EXPECT_EQ(MOJO_RESULT_OK,
+            MojomMessageDispatcher_SendRequest(
+                &client.d, kIncrementOrdinal, &g_params_type_desc,
+                &params.header, &g_params_type_desc,
+                &IncrementResponse::Callback, &responses[2]));
+}
+
+// A request whose response slot is still in use when the IDs come back around
+// to it doesn't keep the other slots from being used.
+TEST(MessageDispatcherTest, ResponseSlotInUseSkipped) {
+  MojoHandle h0, h1;
+  ASSERT_EQ(MOJO_RESULT_OK, MojoCreateMessagePipe(nullptr, &h0, &h1));
+  TestDispatcher client(h0);
+  TestDispatcher service(h1);
+
+  Params params = MakeParams(10u, MOJO_HANDLE_INVALID);
+  IncrementResponse responses[2];
+  EXPECT_EQ(MOJO_RESULT_OK,
+            MojomMessageDispatcher_SendRequest(
+                &client.d, kIncrementOrdinal, &g_params_type_desc,
+                &params.header, &g_params_type_desc,
+                &IncrementResponse::Callback, &responses[0]));
+
+  // As if the IDs had come back around to the first request's slot.
+  client.d.next_request_id = MOJO_ARRAYSIZE(client.slots);
+  params.value = 20u;
+  EXPECT_EQ(MOJO_RESULT_OK,
+            MojomMessageDispatcher_SendRequest(
+                &client.d, kIncrementOrdinal, &g_params_type_desc,
+                &params.header, &g_params_type_desc,
+                &IncrementResponse::Callback, &responses[1]));
+  EXPECT_EQ(MOJO_ARRAYSIZE(client.slots) + 2u, client.d.next_request_id);
+
+  MojomValidationResult validation_result = MOJOM_VALIDATION_ERROR_NONE;
+  for (size_t i = 0u; i < 2u; i++) {
+    ASSERT_EQ(MOJO_RESULT_OK, MojomMessageDispatcher_ReadAndDispatch(
+                                  &service.d, &validation_result));
+    ASSERT_EQ(MOJO_RESULT_OK, MojomMessageDispatcher_ReadAndDispatch(
+                                  &client.d, &validation_result));
+  }
+  EXPECT_TRUE(responses[0].called);
+  EXPECT_EQ(11u, responses[0].value);
+  EXPECT_TRUE(responses[1].called);
+  EXPECT_EQ(21u, responses[1].value);
+}
+
+TEST(MessageDispatcherTest, InvalidMessages) {
+  MojoHandle h0, h1;
+  ASSERT_EQ(MOJO_RESULT_OK, MojoCreateMessagePipe(nullptr, &h0, &h1));
+  TestDispatcher service(h1);
+
+  struct TestCase {
+    uint32_t ordinal;
+    uint32_t flags;
+    MojomValidationResult validation_result;
+  } cases[] = {
+      // Unknown ordinal.
+      {1u, 0u, MOJOM_VALIDATION_MESSAGE_HEADER_UNKNOWN_METHOD},
+      // Expects a response, but shouldn't.
+      {kNotifyOrdinal, MOJOM_MESSAGE_FLAGS_EXPECTS_RESPONSE,
+       MOJOM_VALIDATION_MESSAGE_HEADER_INVALID_FLAGS},
+      // Doesn't expect a response, but should.
+      {kIncrementOrdinal, 0u, MOJOM_VALIDATION_MESSAGE_HEADER_INVALID_FLAGS},
+      // A response to a request that wasn't sent.
+      {kIncrementOrdinal, MOJOM_MESSAGE_FLAGS_IS_RESPONSE,
+       MOJOM_VALIDATION_MESSAGE_HEADER_INVALID_FLAGS},
+  };
+
+  for (size_t i = 0u; i < MOJO_ARRAYSIZE(cases); ++i) {
+    uint64_t storage[8] = {};
+    struct MojomBuffer buffer = {reinterpret_cast<char*>(storage),
+                                 static_cast<uint32_t>(sizeof(storage)), 0u};
+    MojoHandle handles[1] = {};
+    struct MojomHandleBuffer handles_buffer = {handles, 1u, 0u};
+    Params params = MakeParams(0u, MOJO_HANDLE_INVALID);
+    ASSERT_TRUE(MojomMessage_Build(&buffer, cases[i].ordinal, cases[i].flags,
+                                   0u, &g_params_type_desc, &params.header,
+                                   &handles_buffer));
+    ASSERT_EQ(MOJO_RESULT_OK, MojomMessage_Write(h0, &buffer, &handles_buffer));
+
+    MojomValidationResult validation_result = MOJOM_VALIDATION_ERROR_NONE;
+    EXPECT_EQ(MOJO_RESULT_OK, MojomMessageDispatcher_ReadAndDispatch(
+                                  &service.d, &validation_result));
+    EXPECT_EQ(cases[i].validation_result, validation_result) << " case " << i;
+  }
+
+  // Invalid parameters: an out-of-range handle index.
+  uint64_t storage[8] = {};
+  struct MojomBuffer buffer = {reinterpret_cast<char*>(storage),
+                               static_cast<uint32_t>(sizeof(storage)), 0u};
+  MojoHandle handles[1] = {};
+  struct MojomHandleBuffer handles_buffer = {handles, 1u, 0u};
+  Params params = MakeParams(0u, MOJO_HANDLE_INVALID);
+  ASSERT_TRUE(MojomMessage_Build(&buffer, kNotifyOrdinal, 0u, 0u,
+                                 &g_params_type_desc, &params.header,
+                                 &handles_buffer));
+  reinterpret_cast<Params*>(buffer.buf + sizeof(struct MojomMessage))->h = 0u;
+  ASSERT_EQ(MOJO_RESULT_OK, MojomMessage_Write(h0, &buffer, &handles_buffer));
+  MojomValidationResult validation_result = MOJOM_VALIDATION_ERROR_NONE;
+  EXPECT_EQ(MOJO_RESULT_OK, MojomMessageDispatcher_ReadAndDispatch(
+                                &service.d, &validation_result));
+  EXPECT_EQ(MOJOM_VALIDATION_ILLEGAL_HANDLE, validation_result);
+
+  EXPECT_EQ(MOJO_RESULT_OK, MojoClose(h0));
+}
+
+TEST(MessageDispatcherTest, WaitAndDispatch) {
+  MojoHandle h0, h1;
+  ASSERT_EQ(MOJO_RESULT_OK, MojoCreateMessagePipe(nullptr, &h0, &h1));
+  TestDispatcher client(h0);
+  TestDispatcher service(h1);
+  MojoHandle wait_set;
+  ASSERT_EQ(MOJO_RESULT_OK, MojoCreateWaitSet(nullptr, &wait_set));
+  ASSERT_EQ(MOJO_RESULT_OK,
+            MojomMessageDispatcher_AddToWaitSet(&client.d, wait_set));
+  ASSERT_EQ(MOJO_RESULT_OK,
+            MojomMessageDispatcher_AddToWaitSet(&service.d, wait_set));
+
+  Params params = MakeParams(1u, MOJO_HANDLE_INVALID);
+  IncrementResponse response;
+  ASSERT_EQ(MOJO_RESULT_OK,
+            MojomMessageDispatcher_SendRequest(
+                &client.d, kIncrementOrdinal, &g_params_type_desc,
+                &params.header, &g_params_type_desc,
+                &IncrementResponse::Callback, &response));
+  while (!response.called) {
+    ASSERT_EQ(MOJO_RESULT_OK, MojomMessageDispatcher_WaitAndDispatch(
+                                  wait_set, MOJO_DEADLINE_INDEFINITE));
+  }
+  EXPECT_EQ(2u, response.value);
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_DEADLINE_EXCEEDED,
+            MojomMessageDispatcher_WaitAndDispatch(wait_set, 0u));
+
+  // Closing the client makes the service fail (and be removed from the wait
+  // set).
+  MojoClose(client.d.message_pipe);
+  client.d.message_pipe = MOJO_HANDLE_INVALID;
+  ASSERT_EQ(MOJO_RESULT_OK,
+            MojoWaitSetRemove(wait_set,
+                              reinterpret_cast<uintptr_t>(&client.d)));
+  ASSERT_EQ(MOJO_RESULT_OK, MojomMessageDispatcher_WaitAndDispatch(
+                                wait_set, MOJO_DEADLINE_INDEFINITE));
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_FAILED_PRECONDITION, service.error_result);
+  EXPECT_EQ(MOJO_HANDLE_INVALID, service.d.message_pipe);
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_DEADLINE_EXCEEDED,
+            MojomMessageDispatcher_WaitAndDispatch(wait_set, 0u));
+
+  EXPECT_EQ(MOJO_RESULT_OK, MojoClose(wait_set));
+}
+
 }  // namespace
@@ -0,0 +1,587 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This tests the performance of the C bindings on structs of a few shapes:
+// deeply nested ones, and ones modeled on the test mojoms (in
+// mojo/public/interfaces/bindings/tests) that hold arrays of structs, nested
+// arrays, unions and maps. Each operation reports the time it takes and the
+// number of bytes it processes.
+
+#include <mojo/bindings/struct.h>
+
+#include <assert.h>
+#include <mojo/bindings/array.h>
+#include <mojo/bindings/buffer.h>
+#include <mojo/bindings/internal/type_descriptor.h>
+#include <mojo/bindings/internal/util.h>
+#include <mojo/bindings/map.h>
+#include <mojo/macros.h>
+#include <mojo/system/handle.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mojo/public/c/tests/system/perftest_utils.h"
+
+namespace {
+
+// A linked list node:
+//   struct ListNode { ListNode? next; handle? h; };
+struct ListNode {
+  struct MojomStructHeader header;
+  union MojomPointer next;
+  MojoHandle h;
+  uint32_t pad;
+};
+
+extern const struct MojomTypeDescriptorStruct g_list_node_type_desc;
+
+struct MojomTypeDescriptorStructVersion g_list_node_versions[] = {
+    {0u, static_cast<uint32_t>(sizeof(ListNode))},
+};
+const struct MojomTypeDescriptorStructEntry g_list_node_entries[] = {
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR, &g_list_node_type_desc, 0u, 0u,
+     true},
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE, nullptr, 8u, 0u, true},
+};
+const struct MojomTypeDescriptorStruct g_list_node_type_desc = {
+    1u, g_list_node_versions, 2u, g_list_node_entries,
+};
+
+// A tree node:
+//   struct TreeNode { array<TreeNode>? children; string? name; };
+struct TreeNode {
+  struct MojomStructHeader header;
+  union MojomPointer children;
+  union MojomPointer name;
+};
+
+extern const struct MojomTypeDescriptorStruct g_tree_node_type_desc;
+
+const struct MojomTypeDescriptorArray g_tree_node_array_type_desc = {
+    MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR, &g_tree_node_type_desc, 0u, 64u,
+    false,
+};
+struct MojomTypeDescriptorStructVersion g_tree_node_versions[] = {
+    {0u, static_cast<uint32_t>(sizeof(TreeNode))},
+};
+const struct MojomTypeDescriptorStructEntry g_tree_node_entries[] = {
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR, &g_tree_node_array_type_desc, 0u,
+     0u, true},
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR, &g_mojom_string_type_description,
+     8u, 0u, true},
+};
+const struct MojomTypeDescriptorStruct g_tree_node_type_desc = {
+    1u, g_tree_node_versions, 2u, g_tree_node_entries,
+};
+
+// From rect.mojom and test_structs.mojom:
+//   struct Rect { int32 x; int32 y; int32 width; int32 height; };
+//   struct NamedRegion { string? name; array<Rect>? rects; };
+struct Rect {
+  struct MojomStructHeader header;
+  int32_t x;
+  int32_t y;
+  int32_t width;
+  int32_t height;
+};
+
+struct NamedRegion {
+  struct MojomStructHeader header;
+  union MojomPointer name;
+  union MojomPointer rects;
+};
+
+struct MojomTypeDescriptorStructVersion g_rect_versions[] = {
+    {0u, static_cast<uint32_t>(sizeof(Rect))},
+};
+const struct MojomTypeDescriptorStruct g_rect_type_desc = {
+    1u, g_rect_versions, 0u, nullptr,
+};
+const struct MojomTypeDescriptorArray g_rect_array_type_desc = {
+    MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR, &g_rect_type_desc, 0u, 64u, false,
+};
+struct MojomTypeDescriptorStructVersion g_named_region_versions[] = {
+    {0u, static_cast<uint32_t>(sizeof(NamedRegion))},
+};
+const struct MojomTypeDescriptorStructEntry g_named_region_entries[] = {
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR, &g_mojom_string_type_description,
+     0u, 0u, true},
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR, &g_rect_array_type_desc, 8u, 0u,
+     true},
+};
+const struct MojomTypeDescriptorStruct g_named_region_type_desc = {
+    1u, g_named_region_versions, 2u, g_named_region_entries,
+};
+
+// From test_structs.mojom:
+//   struct ArrayOfArrays { array<array<int32>?> a; array<array<int32>>? b; };
+struct ArrayOfArrays {
+  struct MojomStructHeader header;
+  union MojomPointer a;
+  union MojomPointer b;
+};
+
+const struct MojomTypeDescriptorArray g_int32_array_type_desc = {
+    MOJOM_TYPE_DESCRIPTOR_TYPE_POD, nullptr, 0u, 32u, false,
+};
+// array<array<int32>?> and array<array<int32>>:
+const struct MojomTypeDescriptorArray g_a_type_desc = {
+    MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR, &g_int32_array_type_desc, 0u, 64u,
+    true,
+};
+const struct MojomTypeDescriptorArray g_b_type_desc = {
+    MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR, &g_int32_array_type_desc, 0u, 64u,
+    false,
+};
+struct MojomTypeDescriptorStructVersion g_array_of_arrays_versions[] = {
+    {0u, static_cast<uint32_t>(sizeof(ArrayOfArrays))},
+};
+const struct MojomTypeDescriptorStructEntry g_array_of_arrays_entries[] = {
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR, &g_a_type_desc, 0u, 0u, false},
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR, &g_b_type_desc, 8u, 0u, true},
+};
+const struct MojomTypeDescriptorStruct g_array_of_arrays_type_desc = {
+    1u, g_array_of_arrays_versions, 2u, g_array_of_arrays_entries,
+};
+
+// The fields of SmallStruct (from test_unions.mojom) that hold an array of
+// unions and a map:
+//   struct UnionArrayAndMap {
+//     array<PodUnion>? pod_union_array;
+//     map<string, PodUnion>? pod_union_map;
+//   };
+struct PodUnion {
+  uint32_t size;
+  uint32_t tag;
+  union {
+    int32_t f_int32;
+    uint64_t padding;
+  } data;
+};
+
+struct UnionArrayAndMap {
+  struct MojomStructHeader header;
+  union MojomPointer pod_union_array;
+  union MojomPointer pod_union_map;
+};
+
+// PodUnion's f_int32 field.
+const uint32_t kPodUnionInt32Tag = 5u;
+
+const struct MojomTypeDescriptorUnion g_pod_union_type_desc = {
+    13u, 0u, nullptr,
+};
+const struct MojomTypeDescriptorArray g_pod_union_array_type_desc = {
+    MOJOM_TYPE_DESCRIPTOR_TYPE_UNION, &g_pod_union_type_desc, 0u, 128u, false,
+};
+const struct MojomTypeDescriptorArray g_string_array_type_desc = {
+    MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR, &g_mojom_string_type_description, 0u,
+    64u, false,
+};
+struct MojomTypeDescriptorStructVersion g_pod_union_map_versions[] = {
+    {0u, static_cast<uint32_t>(sizeof(struct MojomMapHeader))},
+};
+const struct MojomTypeDescriptorStructEntry g_pod_union_map_entries[] = {
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR, &g_string_array_type_desc, 0u, 0u,
+     false},
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR, &g_pod_union_array_type_desc, 8u,
+     0u, false},
+};
+const struct MojomTypeDescriptorStruct g_pod_union_map_type_desc = {
+    1u, g_pod_union_map_versions, 2u, g_pod_union_map_entries,
+};
+struct MojomTypeDescriptorStructVersion g_union_array_and_map_versions[] = {
+    {0u, static_cast<uint32_t>(sizeof(UnionArrayAndMap))},
+};
+const struct MojomTypeDescriptorStructEntry g_union_array_and_map_entries[] = {
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_ARRAY_PTR, &g_pod_union_array_type_desc, 0u,
+     0u, true},
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_MAP_PTR, &g_pod_union_map_type_desc, 8u, 0u,
+     true},
+};
+const struct MojomTypeDescriptorStruct g_union_array_and_map_type_desc = {
+    1u, g_union_array_and_map_versions, 2u, g_union_array_and_map_entries,
+};
+
+// Builds an (unencoded) list of |length| |ListNode|s in |buffer|. The handles
+// are all invalid, since they're never used.
+struct MojomStructHeader* MakeList(struct MojomBuffer* buffer,
+                                   uint32_t length) {
+  ListNode* head = nullptr;
+  ListNode* prev = nullptr;
+  for (uint32_t i = 0u; i < length; i++) {
+    ListNode* node =
+        static_cast<ListNode*>(MojomBuffer_Allocate(buffer, sizeof(ListNode)));
+    assert(node);
+    node->header.num_bytes = static_cast<uint32_t>(sizeof(ListNode));
+    node->header.version = 0u;
+    node->next.ptr = nullptr;
+    node->h = MOJO_HANDLE_INVALID;
+    if (prev)
+      prev->next.ptr = node;
+    else
+      head = node;
+    prev = node;
+  }
+  return &head->header;
+}
+
+// Builds an (unencoded) complete tree of |TreeNode|s of the given |depth|, in
+// which every non-leaf node has |fan_out| children, in |buffer|.
+struct MojomStructHeader* MakeTree(struct MojomBuffer* buffer,
+                                   uint32_t depth,
+                                   uint32_t fan_out) {
+  TreeNode* node =
+      static_cast<TreeNode*>(MojomBuffer_Allocate(buffer, sizeof(TreeNode)));
+  assert(node);
+  node->header.num_bytes = static_cast<uint32_t>(sizeof(TreeNode));
+  node->header.version = 0u;
+  node->children.ptr = nullptr;
+  if (depth > 1u) {
+    struct MojomArrayHeader* children =
+        MojomArray_New(buffer, fan_out, sizeof(union MojomPointer));
+    assert(children);
+    for (uint32_t i = 0u; i < fan_out; i++) {
+      MOJOM_ARRAY_INDEX(children, union MojomPointer, i)->ptr =
+          MakeTree(buffer, depth - 1u, fan_out);
+    }
+    node->children.ptr = children;
+  }
+  // (Allocated last, so that pointers keep pointing forward as validation
+  // requires.)
+  node->name.ptr = MojomArray_New(buffer, 4u, 1u);
+  assert(node->name.ptr);
+  return &node->header;
+}
+
+// Builds an (unencoded) |NamedRegion| with |num_rects| |Rect|s in |buffer|.
+struct MojomStructHeader* MakeNamedRegion(struct MojomBuffer* buffer,
+                                          uint32_t num_rects) {
+  NamedRegion* region = static_cast<NamedRegion*>(
+      MojomBuffer_Allocate(buffer, sizeof(NamedRegion)));
+  assert(region);
+  region->header.num_bytes = static_cast<uint32_t>(sizeof(NamedRegion));
+  region->header.version = 0u;
+  region->name.ptr = MojomArray_New(buffer, 16u, 1u);
+  assert(region->name.ptr);
+  struct MojomArrayHeader* rects =
+      MojomArray_New(buffer, num_rects, sizeof(union MojomPointer));
+  assert(rects);
+  for (uint32_t i = 0u; i < num_rects; i++) {
+    Rect* rect = static_cast<Rect*>(MojomBuffer_Allocate(buffer, sizeof(Rect)));
+    assert(rect);
+    *rect = Rect{{static_cast<uint32_t>(sizeof(Rect)), 0u},
+                 static_cast<int32_t>(i), static_cast<int32_t>(i), 10, 10};
+    MOJOM_ARRAY_INDEX(rects, union MojomPointer, i)->ptr = rect;
+  }
+  region->rects.ptr = rects;
+  return &region->header;
+}
+
+// Builds an (unencoded) |ArrayOfArrays| in |buffer| whose |a| holds
+// |num_arrays| arrays of |array_size| int32s (and whose |b| is null).
+struct MojomStructHeader* MakeArrayOfArrays(struct MojomBuffer* buffer,
+                                            uint32_t num_arrays,
+                                            uint32_t array_size) {
+  ArrayOfArrays* arrays = static_cast<ArrayOfArrays*>(
+      MojomBuffer_Allocate(buffer, sizeof(ArrayOfArrays)));
+  assert(arrays);
+  arrays->header.num_bytes = static_cast<uint32_t>(sizeof(ArrayOfArrays));
+  arrays->header.version = 0u;
+  struct MojomArrayHeader* a =
+      MojomArray_New(buffer, num_arrays, sizeof(union MojomPointer));
+  assert(a);
+  for (uint32_t i = 0u; i < num_arrays; i++) {
+    MOJOM_ARRAY_INDEX(a, union MojomPointer, i)->ptr =
+        MojomArray_New(buffer, array_size, sizeof(int32_t));
+    assert(MOJOM_ARRAY_INDEX(a, union MojomPointer, i)->ptr);
+  }
+  arrays->a.ptr = a;
+  arrays->b.ptr = nullptr;
+  return &arrays->header;
+}
+
+// Builds an (unencoded) array of |num_elements| |PodUnion|s in |buffer|.
+struct MojomArrayHeader* MakePodUnionArray(struct MojomBuffer* buffer,
+                                           uint32_t num_elements) {
+  struct MojomArrayHeader* array =
+      MojomArray_New(buffer, num_elements, sizeof(PodUnion));
+  assert(array);
+  for (uint32_t i = 0u; i < num_elements; i++) {
+    PodUnion* pod_union = MOJOM_ARRAY_INDEX(array, PodUnion, i);
+    pod_union->size = static_cast<uint32_t>(sizeof(PodUnion));
+    pod_union->tag = kPodUnionInt32Tag;
+    pod_union->data.padding = 0u;
+    pod_union->data.f_int32 = static_cast<int32_t>(i);
+  }
+  return array;
+}
+
+// Builds an (unencoded) |UnionArrayAndMap| in |buffer| whose array and map
+// both have |num_elements| elements.
+struct MojomStructHeader* MakeUnionArrayAndMap(struct MojomBuffer* buffer,
+                                               uint32_t num_elements) {
+  UnionArrayAndMap* in_struct = static_cast<UnionArrayAndMap*>(
+      MojomBuffer_Allocate(buffer, sizeof(UnionArrayAndMap)));
+  assert(in_struct);
+  in_struct->header.num_bytes =
+      static_cast<uint32_t>(sizeof(UnionArrayAndMap));
+  in_struct->header.version = 0u;
+  in_struct->pod_union_array.ptr = MakePodUnionArray(buffer, num_elements);
+
+  struct MojomMapHeader* map = static_cast<struct MojomMapHeader*>(
+      MojomBuffer_Allocate(buffer, sizeof(struct MojomMapHeader)));
+  assert(map);
+  map->header.num_bytes = static_cast<uint32_t>(sizeof(struct MojomMapHeader));
+  map->header.version = 0u;
+  map->keys.ptr =
+      MojomArray_New(buffer, num_elements, sizeof(union MojomPointer));
+  assert(map->keys.ptr);
+  for (uint32_t i = 0u; i < num_elements; i++) {
+    // (The keys' contents don't matter.)
+    MOJOM_ARRAY_INDEX(map->keys.ptr, union MojomPointer, i)->ptr =
+        MojomArray_New(buffer, 8u, 1u);
+    assert(MOJOM_ARRAY_INDEX(map->keys.ptr, union MojomPointer, i)->ptr);
+  }
+  map->values.ptr = MakePodUnionArray(buffer, num_elements);
+  in_struct->pod_union_map.ptr = map;
+  return &in_struct->header;
+}
+
+// Measures each operation on |in_struct|, which (along with everything it
+// refers to) takes up |num_bytes| at the start of |storage|.
+void DoStructTest(const char* sub_test_name,
+                  const struct MojomTypeDescriptorStruct* type_desc,
+                  const std::vector<uint64_t>& storage,
+                  struct MojomStructHeader* in_struct,
+                  uint32_t num_bytes) {
+  mojo::test::IterateAndReportPerIterationPerf(
+      "CBindings_StructComputeSerializedSize", sub_test_name, num_bytes,
+      [type_desc, in_struct, num_bytes]() {
+        size_t size = MojomStruct_ComputeSerializedSize(type_desc, in_struct);
+        MOJO_ALLOW_UNUSED_LOCAL(size);
+        assert(size == num_bytes);
+      });
+
+  mojo::test::IterateAndReportPerIterationPerf(
+      "CBindings_StructEncodeDecode", sub_test_name, num_bytes,
+      [type_desc, in_struct, num_bytes]() {
+        MojoHandle handles[1];
+        struct MojomHandleBuffer handle_buffer = {handles, 0u, 0u};
+        MojomStruct_EncodePointersAndHandles(type_desc, in_struct, num_bytes,
+                                             &handle_buffer);
+        MojomStruct_DecodePointersAndHandles(type_desc, in_struct, num_bytes,
+                                             handles, 0u);
+      });
+
+  MojoHandle handles[1];
+  struct MojomHandleBuffer handle_buffer = {handles, 0u, 0u};
+  MojomStruct_EncodePointersAndHandles(type_desc, in_struct, num_bytes,
+                                       &handle_buffer);
+  mojo::test::IterateAndReportPerIterationPerf(
+      "CBindings_StructValidate", sub_test_name, num_bytes,
+      [type_desc, in_struct, num_bytes]() {
+        struct MojomValidationContext context = {
+            0u, reinterpret_cast<char*>(in_struct)};
+        MojomValidationResult result = MojomStruct_Validate(
+            type_desc, in_struct, num_bytes, 0u, &context);
+        MOJO_ALLOW_UNUSED_LOCAL(result);
+        assert(result == MOJOM_VALIDATION_ERROR_NONE);
+      });
+  MojomStruct_DecodePointersAndHandles(type_desc, in_struct, num_bytes,
+                                       handles, 0u);
+
+  // Receiving: validating and then decoding, versus doing both in one pass.
+  // (Both include encoding, to have something to decode each time.)
+  mojo::test::IterateAndReportPerIterationPerf(
+      "CBindings_StructEncodeValidateDecode", sub_test_name, num_bytes,
+      [type_desc, in_struct, num_bytes]() {
+        MojoHandle handles[1];
+        struct MojomHandleBuffer handle_buffer = {handles, 0u, 0u};
+        MojomStruct_EncodePointersAndHandles(type_desc, in_struct, num_bytes,
+                                             &handle_buffer);
+        struct MojomValidationContext context = {
+            0u, reinterpret_cast<char*>(in_struct)};
+        MojomValidationResult result = MojomStruct_Validate(
+            type_desc, in_struct, num_bytes, 0u, &context);
+        MOJO_ALLOW_UNUSED_LOCAL(result);
+        assert(result == MOJOM_VALIDATION_ERROR_NONE);
+        MojomStruct_DecodePointersAndHandles(type_desc, in_struct, num_bytes,
+                                             handles, 0u);
+      });
+  mojo::test::IterateAndReportPerIterationPerf(
+      "CBindings_StructEncodeValidateAndDecode", sub_test_name, num_bytes,
+      [type_desc, in_struct, num_bytes]() {
+        MojoHandle handles[1];
+        struct MojomHandleBuffer handle_buffer = {handles, 0u, 0u};
+        MojomStruct_EncodePointersAndHandles(type_desc, in_struct, num_bytes,
+                                             &handle_buffer);
+        struct MojomValidationContext context = {
+            0u, reinterpret_cast<char*>(in_struct)};
+        MojomValidationResult result = MojomStruct_ValidateAndDecode(
+            type_desc, in_struct, num_bytes, handles, 0u, &context);
+        MOJO_ALLOW_UNUSED_LOCAL(result);
+        assert(result == MOJOM_VALIDATION_ERROR_NONE);
+      });
+
+  std::vector<uint64_t> copy_storage(storage.size());
+  mojo::test::IterateAndReportPerIterationPerf(
+      "CBindings_StructDeepCopy", sub_test_name, num_bytes,
+      [type_desc, in_struct, num_bytes, &copy_storage]() {
+        struct MojomBuffer copy_buffer = {
+            reinterpret_cast<char*>(copy_storage.data()),
+            static_cast<uint32_t>(copy_storage.size() * 8u), 0u};
+        struct MojomStructHeader* copy = nullptr;
+        bool success =
+            MojomStruct_DeepCopy(&copy_buffer, type_desc, in_struct, &copy);
+        MOJO_ALLOW_UNUSED_LOCAL(success);
+        assert(success);
+        assert(copy_buffer.num_bytes_used == num_bytes);
+      });
+
+  // Serializing: computing the size, copying and then encoding, versus doing
+  // it all in one pass.
+  mojo::test::IterateAndReportPerIterationPerf(
+      "CBindings_StructSizeCopyEncode", sub_test_name, num_bytes,
+      [type_desc, in_struct, &copy_storage]() {
+        size_t size = MojomStruct_ComputeSerializedSize(type_desc, in_struct);
+        assert(size <= copy_storage.size() * 8u);
+        struct MojomBuffer copy_buffer = {
+            reinterpret_cast<char*>(copy_storage.data()),
+            static_cast<uint32_t>(size), 0u};
+        struct MojomStructHeader* copy = nullptr;
+        bool success =
+            MojomStruct_DeepCopy(&copy_buffer, type_desc, in_struct, &copy);
+        MOJO_ALLOW_UNUSED_LOCAL(success);
+        assert(success);
+        MojoHandle handles[1];
+        struct MojomHandleBuffer handle_buffer = {handles, 0u, 0u};
+        MojomStruct_EncodePointersAndHandles(
+            type_desc, copy, copy_buffer.num_bytes_used, &handle_buffer);
+      });
+  mojo::test::IterateAndReportPerIterationPerf(
+      "CBindings_StructDeepCopyAndEncode", sub_test_name, num_bytes,
+      [type_desc, in_struct, num_bytes, &copy_storage]() {
+        struct MojomBuffer copy_buffer = {
+            reinterpret_cast<char*>(copy_storage.data()),
+            static_cast<uint32_t>(copy_storage.size() * 8u), 0u};
+        MojoHandle handles[1];
+        struct MojomHandleBuffer handle_buffer = {handles, 0u, 0u};
+        uint32_t offset = 0u;
+        bool success = MojomStruct_DeepCopyAndEncode(
+            &copy_buffer, type_desc, in_struct, &handle_buffer, &offset);
+        MOJO_ALLOW_UNUSED_LOCAL(success);
+        assert(success);
+        assert(copy_buffer.num_bytes_used == num_bytes);
+      });
+}
+
+void DoListTest(uint32_t length) {
+  std::vector<uint64_t> storage(length * sizeof(ListNode) / 8u);
+  struct MojomBuffer buffer = {reinterpret_cast<char*>(storage.data()),
+                               static_cast<uint32_t>(storage.size() * 8u), 0u};
+  struct MojomStructHeader* list = MakeList(&buffer, length);
+
+  char sub_test_name[100];
+  sprintf(sub_test_name, "List_%unodes", length);
+  DoStructTest(sub_test_name, &g_list_node_type_desc, storage, list,
+                     buffer.num_bytes_used);
+}
+
+void DoTreeTest(uint32_t depth, uint32_t fan_out) {
+  // Each node takes up 40 bytes (24 for itself and 16 for its name), plus the
+  // size of its array of children (if it isn't a leaf).
+  uint32_t num_bytes = 0u;
+  for (uint32_t i = 0u, n = 1u; i < depth; i++, n *= fan_out) {
+    num_bytes += n * 40u;
+    if (i + 1u < depth)
+      num_bytes += n * (8u + 8u * fan_out);
+  }
+  std::vector<uint64_t> storage(num_bytes / 8u);
+  struct MojomBuffer buffer = {reinterpret_cast<char*>(storage.data()),
+                               static_cast<uint32_t>(storage.size() * 8u), 0u};
+  struct MojomStructHeader* tree = MakeTree(&buffer, depth, fan_out);
+
+  char sub_test_name[100];
+  sprintf(sub_test_name, "Tree_%udeep_%ufanout", depth, fan_out);
+  DoStructTest(sub_test_name, &g_tree_node_type_desc, storage, tree,
+                     buffer.num_bytes_used);
+}
+
+void DoNamedRegionTest(uint32_t num_rects) {
+  // The region and its name take up 48 bytes, and each rect 32 (8 for its
+  // pointer and 24 for itself), plus 8 for the array header.
+  std::vector<uint64_t> storage((56u + num_rects * 32u) / 8u);
+  struct MojomBuffer buffer = {reinterpret_cast<char*>(storage.data()),
+                               static_cast<uint32_t>(storage.size() * 8u), 0u};
+  struct MojomStructHeader* region = MakeNamedRegion(&buffer, num_rects);
+
+  char sub_test_name[100];
+  sprintf(sub_test_name, "NamedRegion_%urects", num_rects);
+  DoStructTest(sub_test_name, &g_named_region_type_desc, storage, region,
+               buffer.num_bytes_used);
+}
+
+void DoArrayOfArraysTest(uint32_t num_arrays, uint32_t array_size) {
+  // The struct and the outer array's header take up 32 bytes, and each inner
+  // array 8 for its pointer, 8 for its header and 4 for each element (rounded
+  // up to 8).
+  const uint32_t inner_num_bytes = 16u + (array_size * 4u + 7u) / 8u * 8u;
+  std::vector<uint64_t> storage((32u + num_arrays * inner_num_bytes) / 8u);
+  struct MojomBuffer buffer = {reinterpret_cast<char*>(storage.data()),
+                               static_cast<uint32_t>(storage.size() * 8u), 0u};
+  struct MojomStructHeader* arrays =
+      MakeArrayOfArrays(&buffer, num_arrays, array_size);
+
+  char sub_test_name[100];
+  sprintf(sub_test_name, "ArrayOfArrays_%ux%u", num_arrays, array_size);
+  DoStructTest(sub_test_name, &g_array_of_arrays_type_desc, storage, arrays,
+               buffer.num_bytes_used);
+}
+
+void DoUnionArrayAndMapTest(uint32_t num_elements) {
+  // The struct, the map and the headers of its three arrays take up 72 bytes.
+  // Each element takes up 16 bytes in the array of unions, and 16 + 8 + 16 in
+  // the map (for a union, and a key's pointer and contents).
+  std::vector<uint64_t> storage((72u + num_elements * 56u) / 8u);
+  struct MojomBuffer buffer = {reinterpret_cast<char*>(storage.data()),
+                               static_cast<uint32_t>(storage.size() * 8u), 0u};
+  struct MojomStructHeader* in_struct =
+      MakeUnionArrayAndMap(&buffer, num_elements);
+
+  char sub_test_name[100];
+  sprintf(sub_test_name, "UnionArrayAndMap_%uelements", num_elements);
+  DoStructTest(sub_test_name, &g_union_array_and_map_type_desc, storage,
+               in_struct, buffer.num_bytes_used);
+}
+
+TEST(CBindingsStructPerftest, List) {
+  DoListTest(10u);
+  DoListTest(90u);
+}
+
+TEST(CBindingsStructPerftest, Tree) {
+  DoTreeTest(8u, 2u);
+  DoTreeTest(5u, 8u);
+}
+
+TEST(CBindingsStructPerftest, NamedRegion) {
+  DoNamedRegionTest(10u);
+  DoNamedRegionTest(1000u);
+}
+
+TEST(CBindingsStructPerftest, ArrayOfArrays) {
+  DoArrayOfArraysTest(10u, 10u);
+  DoArrayOfArraysTest(100u, 100u);
+}
+
+TEST(CBindingsStructPerftest, UnionArrayAndMap) {
+  DoUnionArrayAndMapTest(10u);
+  DoUnionArrayAndMapTest(1000u);
+}
+
+}  // namespace
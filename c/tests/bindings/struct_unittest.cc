@@ -6,10 +6,17 @@
 
 #include <mojo/bindings/struct.h>
 
+#include <assert.h>
 #include <mojo/bindings/array.h>
 #include <mojo/bindings/internal/util.h>
+#include <mojo/system/handle.h>
+#include <mojo/system/message_pipe.h>
+#include <mojo/system/result.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "mojo/public/c/tests/bindings/testing_util.h"
 #include "mojo/public/cpp/system/macros.h"
@@ -362,4 +369,500 @@ TEST(StructSerializationTest, StructWithHandle) {
   }
 }
 
+// A linked list node, described by hand so that its type descriptor can be
+// passed to |MojomStruct_DeepCopyAndEncode()|:
+//   struct ListNode { ListNode? next; handle? h; };
+struct ListNode {
+  struct MojomStructHeader header;
+  union MojomPointer next;
+  MojoHandle h;
+  uint32_t pad;
+};
+
+extern const struct MojomTypeDescriptorStruct g_list_node_type_desc;
+
+struct MojomTypeDescriptorStructVersion g_list_node_versions[] = {
+    {0u, static_cast<uint32_t>(sizeof(ListNode))},
+};
+const struct MojomTypeDescriptorStructEntry g_list_node_entries[] = {
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR, &g_list_node_type_desc, 0u, 0u,
+     true},
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE, nullptr, 8u, 0u, true},
+};
+const struct MojomTypeDescriptorStruct g_list_node_type_desc = {
+    1u, g_list_node_versions, 2u, g_list_node_entries,
+};
+
+TEST(StructSerializationTest, DeepCopyAndEncode) {
+  // A list of 3 nodes, the last of which has no handle.
+  ListNode nodes[3];
+  for (size_t i = 0; i < MOJO_ARRAYSIZE(nodes); i++) {
+    nodes[i] = ListNode{
+        {sizeof(ListNode), 0},
+        {i + 1 < MOJO_ARRAYSIZE(nodes) ? &nodes[i + 1] : NULL},
+        i + 1 < MOJO_ARRAYSIZE(nodes) ? static_cast<MojoHandle>(10 + i)
+                                      : MOJO_HANDLE_INVALID,
+        0u,
+    };
+  }
+
+  // Serialize it the usual way, in two passes...
+  char expected_bytes[1000] = {0};
+  struct MojomBuffer expected_buf = {expected_bytes, sizeof(expected_bytes), 0};
+  struct MojomStructHeader* expected = NULL;
+  ASSERT_TRUE(MojomStruct_DeepCopy(&expected_buf, &g_list_node_type_desc,
+                                   &nodes[0].header, &expected));
+  MojoHandle expected_handles[3];
+  struct MojomHandleBuffer expected_handle_buf = {
+      expected_handles, MOJO_ARRAYSIZE(expected_handles), 0u};
+  MojomStruct_EncodePointersAndHandles(&g_list_node_type_desc, expected,
+                                       expected_buf.num_bytes_used,
+                                       &expected_handle_buf);
+
+  // ... and in one, into a buffer that starts out too small and has to move.
+  struct MojomBuffer buf = {
+      static_cast<char*>(calloc(1, 8)), 8, 0, GrowWithRealloc, NULL,
+  };
+  MojoHandle handles[3];
+  struct MojomHandleBuffer handle_buf = {handles, MOJO_ARRAYSIZE(handles), 0u};
+  uint32_t offset = 1u;
+  ASSERT_TRUE(MojomStruct_DeepCopyAndEncode(&buf, &g_list_node_type_desc,
+                                            &nodes[0].header, &handle_buf,
+                                            &offset));
+  EXPECT_EQ(0u, offset);
+  EXPECT_EQ(3 * sizeof(ListNode), buf.num_bytes_used);
+  EXPECT_EQ(expected_buf.num_bytes_used, buf.num_bytes_used);
+  EXPECT_EQ(0, memcmp(expected_bytes, buf.buf, buf.num_bytes_used));
+  EXPECT_EQ(2u, handle_buf.num_handles_used);
+  EXPECT_EQ(expected_handle_buf.num_handles_used, handle_buf.num_handles_used);
+  EXPECT_EQ(0, memcmp(expected_handles, handles,
+                      handle_buf.num_handles_used * sizeof(MojoHandle)));
+
+  // The original still has its handles.
+  EXPECT_EQ(static_cast<MojoHandle>(10), nodes[0].h);
+
+  // Without a way to grow, it fails.
+  buf.num_bytes_used = buf.buf_size - 8u;
+  buf.grow = NULL;
+  handle_buf.num_handles_used = 0u;
+  EXPECT_FALSE(MojomStruct_DeepCopyAndEncode(&buf, &g_list_node_type_desc,
+                                             &nodes[0].header, &handle_buf,
+                                             &offset));
+  free(buf.buf);
+}
+
+// A struct with a handle but no pointers, whose type descriptor says so (as
+// the generator would):
+//   struct HandleHolder { handle? h; };
+//   struct HandleHolderPair { HandleHolder first; HandleHolder second; };
+struct HandleHolder {
+  struct MojomStructHeader header;
+  MojoHandle h;
+  uint32_t pad;
+};
+
+struct HandleHolderPair {
+  struct MojomStructHeader header;
+  union MojomPointer first;
+  union MojomPointer second;
+};
+
+struct MojomTypeDescriptorStructVersion g_handle_holder_versions[] = {
+    {0u, static_cast<uint32_t>(sizeof(HandleHolder))},
+};
+const struct MojomTypeDescriptorStructEntry g_handle_holder_entries[] = {
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_HANDLE, nullptr, 0u, 0u, true},
+};
+const struct MojomTypeDescriptorStruct g_handle_holder_type_desc = {
+    1u, g_handle_holder_versions, 1u, g_handle_holder_entries,
+    MOJOM_TYPE_DESCRIPTOR_FLAG_POINTER_FREE,
+};
+
+struct MojomTypeDescriptorStructVersion g_handle_holder_pair_versions[] = {
+    {0u, static_cast<uint32_t>(sizeof(HandleHolderPair))},
+};
+const struct MojomTypeDescriptorStructEntry g_handle_holder_pair_entries[] = {
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR, &g_handle_holder_type_desc, 0u, 0u,
+     false},
+    {MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR, &g_handle_holder_type_desc, 8u, 0u,
+     false},
+};
+const struct MojomTypeDescriptorStruct g_handle_holder_pair_type_desc = {
+    1u, g_handle_holder_pair_versions, 2u, g_handle_holder_pair_entries,
+};
+
+TEST(StructSerializationTest, PointerFreeStruct) {
+  EXPECT_EQ(MOJOM_TYPE_DESCRIPTOR_FLAG_POINTER_FREE,
+            MojomType_GetFlags(MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR,
+                               &g_handle_holder_type_desc));
+  EXPECT_EQ(MOJOM_TYPE_DESCRIPTOR_FLAG_NONE,
+            MojomType_GetFlags(MOJOM_TYPE_DESCRIPTOR_TYPE_STRUCT_PTR,
+                               &g_handle_holder_pair_type_desc));
+
+  HandleHolder first = {{sizeof(HandleHolder), 0}, 10u, 0u};
+  HandleHolder second = {{sizeof(HandleHolder), 0}, MOJO_HANDLE_INVALID, 0u};
+  HandleHolderPair pair = {{sizeof(HandleHolderPair), 0}, {&first}, {&second}};
+  EXPECT_EQ(sizeof(HandleHolderPair) + 2 * sizeof(HandleHolder),
+            MojomStruct_ComputeSerializedSize(&g_handle_holder_pair_type_desc,
+                                              &pair.header));
+
+  // The pointer-free structs are still copied, with their handles.
+  char buffer_bytes[1000] = {0};
+  struct MojomBuffer buf = {buffer_bytes, sizeof(buffer_bytes), 0};
+  struct MojomStructHeader* copy = NULL;
+  ASSERT_TRUE(MojomStruct_DeepCopy(&buf, &g_handle_holder_pair_type_desc,
+                                   &pair.header, &copy));
+  EXPECT_EQ(sizeof(HandleHolderPair) + 2 * sizeof(HandleHolder),
+            buf.num_bytes_used);
+  HandleHolderPair* pair_copy = reinterpret_cast<HandleHolderPair*>(copy);
+  EXPECT_NE(&first, pair_copy->first.ptr);
+  EXPECT_EQ(static_cast<MojoHandle>(10u),
+            static_cast<HandleHolder*>(pair_copy->first.ptr)->h);
+
+  // ... and their handles encoded and decoded.
+  MojoHandle handles[2];
+  struct MojomHandleBuffer handle_buf = {handles, MOJO_ARRAYSIZE(handles), 0u};
+  MojomStruct_EncodePointersAndHandles(&g_handle_holder_pair_type_desc, copy,
+                                       buf.num_bytes_used, &handle_buf);
+  EXPECT_EQ(1u, handle_buf.num_handles_used);
+  EXPECT_EQ(static_cast<MojoHandle>(10u), handles[0]);
+  HandleHolder* first_copy =
+      reinterpret_cast<HandleHolder*>(buffer_bytes + sizeof(HandleHolderPair));
+  EXPECT_EQ(0u, first_copy->h);
+  EXPECT_EQ(static_cast<MojoHandle>(-1), first_copy[1].h);
+
+  MojomStruct_DecodePointersAndHandles(&g_handle_holder_pair_type_desc, copy,
+                                       buf.num_bytes_used, handles,
+                                       handle_buf.num_handles_used);
+  EXPECT_EQ(static_cast<MojoHandle>(10u), first_copy->h);
+  EXPECT_EQ(MOJO_HANDLE_INVALID, first_copy[1].h);
+}
+
+TEST(StructValidationTest, VersionSizes) {
+  // A struct without pointers or handles whose version 2 added nothing.
+  struct MojomTypeDescriptorStructVersion versions[] = {
+      {0u, 16u}, {1u, 24u}, {3u, 32u}, {4u, 40u},
+  };
+  const struct MojomTypeDescriptorStruct type_desc = {
+      MOJO_ARRAYSIZE(versions), versions, 0u, nullptr,
+  };
+  struct {
+    uint32_t version;
+    uint32_t num_bytes;
+    MojomValidationResult expected;
+  } kCases[] = {
+      // Known versions must be of their exact size...
+      {0u, 16u, MOJOM_VALIDATION_ERROR_NONE},
+      {0u, 24u, MOJOM_VALIDATION_UNEXPECTED_STRUCT_HEADER},
+      {1u, 24u, MOJOM_VALIDATION_ERROR_NONE},
+      {1u, 16u, MOJOM_VALIDATION_UNEXPECTED_STRUCT_HEADER},
+      {3u, 32u, MOJOM_VALIDATION_ERROR_NONE},
+      {3u, 40u, MOJOM_VALIDATION_UNEXPECTED_STRUCT_HEADER},
+      {4u, 40u, MOJOM_VALIDATION_ERROR_NONE},
+      {4u, 48u, MOJOM_VALIDATION_UNEXPECTED_STRUCT_HEADER},
+      // ... and others at least the size of the version before them.
+      {2u, 24u, MOJOM_VALIDATION_ERROR_NONE},
+      {2u, 32u, MOJOM_VALIDATION_ERROR_NONE},
+      {2u, 16u, MOJOM_VALIDATION_UNEXPECTED_STRUCT_HEADER},
+      {5u, 48u, MOJOM_VALIDATION_ERROR_NONE},
+      {100u, 40u, MOJOM_VALIDATION_ERROR_NONE},
+      {5u, 32u, MOJOM_VALIDATION_UNEXPECTED_STRUCT_HEADER},
+  };
+  uint64_t bytes[8] = {0};
+  auto* header = reinterpret_cast<struct MojomStructHeader*>(bytes);
+  for (size_t i = 0; i < MOJO_ARRAYSIZE(kCases); i++) {
+    header->version = kCases[i].version;
+    header->num_bytes = kCases[i].num_bytes;
+    struct MojomValidationContext context = {0u,
+                                             reinterpret_cast<char*>(bytes)};
+    EXPECT_EQ(kCases[i].expected,
+              MojomStruct_Validate(&type_desc, header, sizeof(bytes), 0u,
+                                   &context))
+        << i;
+  }
+}
+
+// Encodes a list of |num_nodes| |ListNode|s (the first |num_handles| of which
+// have handles) into |buf| and |handles|. Returns the number of bytes used.
+uint32_t EncodeList(char* buf,
+                    uint32_t buf_size,
+                    size_t num_nodes,
+                    MojoHandle* handles,
+                    uint32_t num_handles) {
+  ListNode nodes[3];
+  assert(num_nodes <= MOJO_ARRAYSIZE(nodes));
+  for (size_t i = 0; i < num_nodes; i++) {
+    nodes[i] = ListNode{
+        {sizeof(ListNode), 0},
+        {i + 1 < num_nodes ? &nodes[i + 1] : NULL},
+        i < num_handles ? static_cast<MojoHandle>(10 + i) : MOJO_HANDLE_INVALID,
+        0u,
+    };
+  }
+  struct MojomBuffer mojom_buf = {buf, buf_size, 0};
+  struct MojomHandleBuffer handle_buf = {handles, num_handles, 0u};
+  uint32_t offset = 0u;
+  bool success = MojomStruct_DeepCopyAndEncode(
+      &mojom_buf, &g_list_node_type_desc, &nodes[0].header, &handle_buf,
+      &offset);
+  assert(success);
+  assert(handle_buf.num_handles_used == num_handles);
+  return mojom_buf.num_bytes_used;
+}
+
+TEST(StructValidateAndDecodeTest, Basic) {
+  uint64_t expected_bytes[16] = {0};
+  MojoHandle expected_handles[2];
+  uint32_t num_bytes =
+      EncodeList(reinterpret_cast<char*>(expected_bytes),
+                 sizeof(expected_bytes), 3, expected_handles, 2u);
+  uint64_t bytes[16];
+  memcpy(bytes, expected_bytes, sizeof(bytes));
+  MojoHandle handles[2];
+  memcpy(handles, expected_handles, sizeof(handles));
+
+  // Validating and then decoding...
+  auto* expected = reinterpret_cast<struct MojomStructHeader*>(expected_bytes);
+  struct MojomValidationContext context = {
+      0u, reinterpret_cast<char*>(expected_bytes)};
+  EXPECT_EQ(MOJOM_VALIDATION_ERROR_NONE,
+            MojomStruct_Validate(&g_list_node_type_desc, expected, num_bytes,
+                                 2u, &context));
+  MojomStruct_DecodePointersAndHandles(&g_list_node_type_desc, expected,
+                                       num_bytes, expected_handles, 2u);
+
+  // ... gives the same results as doing both at once.
+  auto* list = reinterpret_cast<struct MojomStructHeader*>(bytes);
+  context = {0u, reinterpret_cast<char*>(bytes)};
+  EXPECT_EQ(MOJOM_VALIDATION_ERROR_NONE,
+            MojomStruct_ValidateAndDecode(&g_list_node_type_desc, list,
+                                          num_bytes, handles, 2u, &context));
+  EXPECT_EQ(2u, context.next_handle_index);
+
+  auto* nodes = reinterpret_cast<ListNode*>(bytes);
+  EXPECT_EQ(&nodes[1], nodes[0].next.ptr);
+  EXPECT_EQ(&nodes[2], nodes[1].next.ptr);
+  EXPECT_EQ(NULL, nodes[2].next.ptr);
+  EXPECT_EQ(static_cast<MojoHandle>(10), nodes[0].h);
+  EXPECT_EQ(static_cast<MojoHandle>(11), nodes[1].h);
+  EXPECT_EQ(MOJO_HANDLE_INVALID, nodes[2].h);
+  EXPECT_EQ(MOJO_HANDLE_INVALID, handles[0]);
+  EXPECT_EQ(MOJO_HANDLE_INVALID, handles[1]);
+
+  // The pointers in |expected| point into |expected_bytes|, so compare the
+  // handles only.
+  auto* expected_nodes = reinterpret_cast<ListNode*>(expected_bytes);
+  for (size_t i = 0; i < 3; i++)
+    EXPECT_EQ(expected_nodes[i].h, nodes[i].h);
+  EXPECT_EQ(0, memcmp(expected_handles, handles, sizeof(handles)));
+}
+
+TEST(StructValidateAndDecodeTest, Invalid) {
+  uint64_t bytes[16] = {0};
+  MojoHandle handles[2];
+  uint32_t num_bytes = EncodeList(reinterpret_cast<char*>(bytes),
+                                  sizeof(bytes), 3, handles, 2u);
+  MojoHandle encoded_handles[2];
+  memcpy(encoded_handles, handles, sizeof(handles));
+  auto* list = reinterpret_cast<struct MojomStructHeader*>(bytes);
+  auto* nodes = reinterpret_cast<ListNode*>(bytes);
+
+  // The last node's handle refers to a handle that has already been claimed.
+  // The claimed handles must be left where they are.
+  nodes[2].h = 0u;
+  struct MojomValidationContext context = {0u, reinterpret_cast<char*>(bytes)};
+  EXPECT_EQ(MOJOM_VALIDATION_ILLEGAL_HANDLE,
+            MojomStruct_ValidateAndDecode(&g_list_node_type_desc, list,
+                                          num_bytes, handles, 2u, &context));
+  EXPECT_EQ(0, memcmp(encoded_handles, handles, sizeof(handles)));
+
+  // Too few handles.
+  num_bytes = EncodeList(reinterpret_cast<char*>(bytes), sizeof(bytes), 3,
+                         handles, 2u);
+  context = {0u, reinterpret_cast<char*>(bytes)};
+  EXPECT_EQ(MOJOM_VALIDATION_ILLEGAL_HANDLE,
+            MojomStruct_ValidateAndDecode(&g_list_node_type_desc, list,
+                                          num_bytes, handles, 1u, &context));
+  EXPECT_EQ(0, memcmp(encoded_handles, handles, sizeof(handles)));
+
+  // The last node is out of range.
+  num_bytes = EncodeList(reinterpret_cast<char*>(bytes), sizeof(bytes), 3,
+                         handles, 2u);
+  context = {0u, reinterpret_cast<char*>(bytes)};
+  EXPECT_EQ(MOJOM_VALIDATION_ILLEGAL_MEMORY_RANGE,
+            MojomStruct_ValidateAndDecode(&g_list_node_type_desc, list,
+                                          num_bytes - sizeof(ListNode),
+                                          handles, 2u, &context));
+  EXPECT_EQ(0, memcmp(encoded_handles, handles, sizeof(handles)));
+}
+
+TEST(StructValidateAndDecodeTest, SkippedHandles) {
+  uint64_t bytes[16] = {0};
+  MojoHandle handles[2];
+  uint32_t num_bytes = EncodeList(reinterpret_cast<char*>(bytes),
+                                  sizeof(bytes), 1, handles, 1u);
+  auto* list = reinterpret_cast<struct MojomStructHeader*>(bytes);
+  auto* nodes = reinterpret_cast<ListNode*>(bytes);
+
+  // Nothing refers to the first handle, which is closed.
+  MojoHandle h0 = MOJO_HANDLE_INVALID;
+  MojoHandle h1 = MOJO_HANDLE_INVALID;
+  ASSERT_EQ(MOJO_RESULT_OK, MojoCreateMessagePipe(nullptr, &h0, &h1));
+  handles[0] = h0;
+  handles[1] = h1;
+  nodes[0].h = 1u;
+  struct MojomValidationContext context = {0u, reinterpret_cast<char*>(bytes)};
+  EXPECT_EQ(MOJOM_VALIDATION_ERROR_NONE,
+            MojomStruct_ValidateAndDecode(&g_list_node_type_desc, list,
+                                          num_bytes, handles, 2u, &context));
+  EXPECT_EQ(h1, nodes[0].h);
+  EXPECT_EQ(MOJO_HANDLE_INVALID, handles[0]);
+  EXPECT_EQ(MOJO_HANDLE_INVALID, handles[1]);
+  EXPECT_EQ(MOJO_RESULT_INVALID_ARGUMENT, MojoClose(h0));
+  EXPECT_EQ(MOJO_RESULT_OK, MojoClose(h1));
+}
+
+// Copies and encodes a list of |num_nodes| |ListNode|s without handles into
+// |bytes|, both in two passes and in one (which must agree).
+void EncodeLongList(size_t num_nodes, std::vector<uint64_t>* bytes) {
+  std::vector<ListNode> nodes(num_nodes);
+  for (size_t i = 0; i < num_nodes; i++) {
+    nodes[i] = ListNode{
+        {sizeof(ListNode), 0},
+        {i + 1 < num_nodes ? &nodes[i + 1] : NULL},
+        MOJO_HANDLE_INVALID,
+        0u,
+    };
+  }
+  const uint32_t num_bytes =
+      static_cast<uint32_t>(num_nodes * sizeof(ListNode));
+  bytes->assign(num_bytes / sizeof(uint64_t), 0u);
+
+  struct MojomBuffer buf = {reinterpret_cast<char*>(bytes->data()), num_bytes,
+                            0};
+  struct MojomStructHeader* copy = NULL;
+  ASSERT_TRUE(MojomStruct_DeepCopy(&buf, &g_list_node_type_desc,
+                                   &nodes[0].header, &copy));
+  ASSERT_EQ(num_bytes, buf.num_bytes_used);
+  MojoHandle handles[1];
+  struct MojomHandleBuffer handle_buf = {handles, MOJO_ARRAYSIZE(handles), 0u};
+  MojomStruct_EncodePointersAndHandles(&g_list_node_type_desc, copy,
+                                       num_bytes, &handle_buf);
+
+  std::vector<uint64_t> one_pass_bytes(bytes->size(), 0u);
+  struct MojomBuffer one_pass_buf = {
+      reinterpret_cast<char*>(one_pass_bytes.data()), num_bytes, 0};
+  uint32_t offset = 1u;
+  ASSERT_TRUE(MojomStruct_DeepCopyAndEncode(&one_pass_buf,
+                                            &g_list_node_type_desc,
+                                            &nodes[0].header, &handle_buf,
+                                            &offset));
+  EXPECT_EQ(0u, offset);
+  ASSERT_EQ(num_bytes, one_pass_buf.num_bytes_used);
+  EXPECT_EQ(0, memcmp(bytes->data(), one_pass_bytes.data(), num_bytes));
+}
+
+// Structs may be nested up to |MOJOM_TRAVERSAL_MAX_DEPTH| deep; copying and
+// encoding don't care, but validation rejects anything deeper.
+TEST(StructValidateAndDecodeTest, MaxDepth) {
+  std::vector<uint64_t> bytes;
+  EncodeLongList(MOJOM_TRAVERSAL_MAX_DEPTH, &bytes);
+  uint32_t num_bytes = static_cast<uint32_t>(bytes.size() * sizeof(uint64_t));
+  auto* list = reinterpret_cast<struct MojomStructHeader*>(bytes.data());
+  struct MojomValidationContext context = {
+      0u, reinterpret_cast<char*>(bytes.data())};
+  EXPECT_EQ(MOJOM_VALIDATION_ERROR_NONE,
+            MojomStruct_Validate(&g_list_node_type_desc, list, num_bytes, 0u,
+                                 &context));
+  context = {0u, reinterpret_cast<char*>(bytes.data())};
+  EXPECT_EQ(MOJOM_VALIDATION_ERROR_NONE,
+            MojomStruct_ValidateAndDecode(&g_list_node_type_desc, list,
+                                          num_bytes, NULL, 0u, &context));
+  auto* nodes = reinterpret_cast<ListNode*>(bytes.data());
+  EXPECT_EQ(&nodes[1], nodes[0].next.ptr);
+  EXPECT_EQ(NULL, nodes[MOJOM_TRAVERSAL_MAX_DEPTH - 1].next.ptr);
+
+  // One more is too deep.
+  EncodeLongList(MOJOM_TRAVERSAL_MAX_DEPTH + 1, &bytes);
+  num_bytes = static_cast<uint32_t>(bytes.size() * sizeof(uint64_t));
+  list = reinterpret_cast<struct MojomStructHeader*>(bytes.data());
+  context = {0u, reinterpret_cast<char*>(bytes.data())};
+  EXPECT_EQ(MOJOM_VALIDATION_MAX_RECURSION_DEPTH,
+            MojomStruct_Validate(&g_list_node_type_desc, list, num_bytes, 0u,
+                                 &context));
+  context = {0u, reinterpret_cast<char*>(bytes.data())};
+  EXPECT_EQ(MOJOM_VALIDATION_MAX_RECURSION_DEPTH,
+            MojomStruct_ValidateAndDecode(&g_list_node_type_desc, list,
+                                          num_bytes, NULL, 0u, &context));
+}
+
+TEST(StructIncrementalValidationTest, Basic) {
+  uint64_t bytes[16] = {0};
+  MojoHandle handles[2];
+  uint32_t num_bytes = EncodeList(reinterpret_cast<char*>(bytes),
+                                  sizeof(bytes), 3, handles, 2u);
+  auto* list = reinterpret_cast<struct MojomStructHeader*>(bytes);
+
+  // Feeding the list in a few bytes at a time...
+  struct MojomIncrementalValidation validation;
+  MojomStruct_BeginIncrementalValidation(&g_list_node_type_desc, list,
+                                         num_bytes, 2u, &validation);
+  for (uint32_t received = 0; received < num_bytes; received += 4) {
+    EXPECT_EQ(MOJOM_VALIDATION_INCOMPLETE,
+              MojomStruct_ContinueIncrementalValidation(&validation, received))
+        << received;
+  }
+  EXPECT_EQ(MOJOM_VALIDATION_ERROR_NONE,
+            MojomStruct_ContinueIncrementalValidation(&validation, num_bytes));
+  EXPECT_EQ(2u, validation.context.next_handle_index);
+
+  // ... gives the same results as validating it all at once, however the bytes
+  // arrive.
+  MojomStruct_BeginIncrementalValidation(&g_list_node_type_desc, list,
+                                         num_bytes, 2u, &validation);
+  EXPECT_EQ(MOJOM_VALIDATION_INCOMPLETE,
+            MojomStruct_ContinueIncrementalValidation(&validation, 30u));
+  EXPECT_EQ(MOJOM_VALIDATION_ERROR_NONE,
+            MojomStruct_ContinueIncrementalValidation(&validation, 1000u));
+  EXPECT_EQ(MOJOM_VALIDATION_ERROR_NONE,
+            MojomStruct_ContinueIncrementalValidation(&validation, 1000u));
+}
+
+TEST(StructIncrementalValidationTest, Invalid) {
+  uint64_t bytes[16] = {0};
+  MojoHandle handles[2];
+  uint32_t num_bytes = EncodeList(reinterpret_cast<char*>(bytes),
+                                  sizeof(bytes), 3, handles, 2u);
+  auto* list = reinterpret_cast<struct MojomStructHeader*>(bytes);
+  auto* nodes = reinterpret_cast<ListNode*>(bytes);
+
+  // The last node's header is bad, which is found before the rest of it has
+  // arrived.
+  nodes[2].header.num_bytes = 4u;
+  struct MojomIncrementalValidation validation;
+  MojomStruct_BeginIncrementalValidation(&g_list_node_type_desc, list,
+                                         num_bytes, 2u, &validation);
+  EXPECT_EQ(MOJOM_VALIDATION_INCOMPLETE,
+            MojomStruct_ContinueIncrementalValidation(&validation,
+                                                      2 * sizeof(ListNode)));
+  EXPECT_EQ(MOJOM_VALIDATION_UNEXPECTED_STRUCT_HEADER,
+            MojomStruct_ContinueIncrementalValidation(
+                &validation, 2 * sizeof(ListNode) + 8u));
+  EXPECT_EQ(MOJOM_VALIDATION_UNEXPECTED_STRUCT_HEADER,
+            MojomStruct_ContinueIncrementalValidation(&validation, num_bytes));
+
+  // The last node claims the second node's handle (the list is validated back
+  // to front), which is found as soon as the last node's handle has arrived.
+  nodes[2].header.num_bytes = sizeof(ListNode);
+  nodes[2].h = 1u;
+  const uint32_t handle_end = 2 * sizeof(ListNode) + offsetof(ListNode, pad);
+  MojomStruct_BeginIncrementalValidation(&g_list_node_type_desc, list,
+                                         num_bytes, 2u, &validation);
+  EXPECT_EQ(MOJOM_VALIDATION_INCOMPLETE,
+            MojomStruct_ContinueIncrementalValidation(&validation,
+                                                      handle_end - 1u));
+  EXPECT_EQ(MOJOM_VALIDATION_ILLEGAL_HANDLE,
+            MojomStruct_ContinueIncrementalValidation(&validation, handle_end));
+}
+
 }  // namespace
@@ -9,10 +9,28 @@
 #include <mojo/system/handle.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "gtest/gtest.h"
 
+// A |MojomBufferGrowFunction| that uses realloc() to (at least) double the size
+// of the buffer, and counts how many times it was called in |grow_context| (an
+// int*), if set.
+inline bool GrowWithRealloc(struct MojomBuffer* buffer, uint32_t min_buf_size) {
+  uint32_t buf_size = buffer->buf_size * 2u;
+  if (buf_size < min_buf_size)
+    buf_size = min_buf_size;
+  char* buf = static_cast<char*>(realloc(buffer->buf, buf_size));
+  if (!buf)
+    return false;
+  buffer->buf = buf;
+  buffer->buf_size = buf_size;
+  if (buffer->grow_context)
+    (*static_cast<int*>(buffer->grow_context))++;
+  return true;
+}
+
 // This will copy the supplied |in_struct| and compare it against the new
 // copy, expecting them to be the same. It compares the encoded version to be
 // sure that they are the same, since a unencoded version will have pointers
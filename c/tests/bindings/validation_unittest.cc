@@ -56,6 +56,8 @@ const char* MojomValidationResultToString(MojomValidationResult error) {
       return "VALIDATION_ERROR_DIFFERENT_SIZED_ARRAYS_IN_MAP";
     case MOJOM_VALIDATION_UNEXPECTED_NULL_UNION:
       return "VALIDATION_ERROR_UNEXPECTED_NULL_UNION";
+    case MOJOM_VALIDATION_MAX_RECURSION_DEPTH:
+      return "VALIDATION_ERROR_MAX_RECURSION_DEPTH";
   }
 
   return "Unknown error";
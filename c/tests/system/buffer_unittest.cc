@@ -127,6 +127,40 @@ TEST(BufferTest, Basic) {
   EXPECT_EQ(MOJO_RESULT_OK, MojoClose(h2));
 }
 
+// The map flags other than |MOJO_MAP_BUFFER_FLAG_NONE| are hints: they should
+// either work or be rejected as unimplemented.
+TEST(BufferTest, MapFlags) {
+  static const MojoMapBufferFlags kFlags[] = {
+      MOJO_MAP_BUFFER_FLAG_READ_ONLY, MOJO_MAP_BUFFER_FLAG_PREFAULT,
+      MOJO_MAP_BUFFER_FLAG_HUGE_PAGES,
+      MOJO_MAP_BUFFER_FLAG_PREFAULT | MOJO_MAP_BUFFER_FLAG_HUGE_PAGES};
+
+  MojoHandle h = MOJO_HANDLE_INVALID;
+  EXPECT_EQ(MOJO_RESULT_OK, MojoCreateSharedBuffer(nullptr, 100, &h));
+
+  void* pointer = nullptr;
+  EXPECT_EQ(MOJO_RESULT_OK,
+            MojoMapBuffer(h, 0, 100, &pointer, MOJO_MAP_BUFFER_FLAG_NONE));
+  ASSERT_TRUE(pointer);
+  static_cast<char*>(pointer)[10] = 'x';
+  EXPECT_EQ(MOJO_RESULT_OK, MojoUnmapBuffer(pointer));
+
+  for (auto flags : kFlags) {
+    pointer = nullptr;
+    MojoResult result = MojoMapBuffer(h, 0, 100, &pointer, flags);
+    if (result == MOJO_SYSTEM_RESULT_UNIMPLEMENTED) {
+      EXPECT_FALSE(pointer);
+      continue;
+    }
+    EXPECT_EQ(MOJO_RESULT_OK, result) << flags;
+    ASSERT_TRUE(pointer);
+    EXPECT_EQ('x', static_cast<char*>(pointer)[10]);
+    EXPECT_EQ(MOJO_RESULT_OK, MojoUnmapBuffer(pointer));
+  }
+
+  EXPECT_EQ(MOJO_RESULT_OK, MojoClose(h));
+}
+
 // TODO(vtl): Add multi-threaded tests.
 
 }  // namespace
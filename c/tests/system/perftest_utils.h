@@ -6,6 +6,7 @@
 #define MOJO_PUBLIC_C_TESTS_SYSTEM_PERFTEST_UTILS_H_
 
 #include <mojo/system/time.h>
+#include <stddef.h>
 
 #include <functional>
 
@@ -21,6 +22,14 @@ void IterateAndReportPerf(const char* test_name,
                           const char* sub_test_name,
                           std::function<void()> single_iteration);
 
+// Like |IterateAndReportPerf()|, but reports the average time each iteration
+// took (in nanoseconds), along with |num_bytes_per_iteration| (the number of
+// bytes each iteration processes), so that changes in either show up.
+void IterateAndReportPerIterationPerf(const char* test_name,
+                                      const char* sub_test_name,
+                                      size_t num_bytes_per_iteration,
+                                      std::function<void()> single_iteration);
+
 // Sleeps for the given amount of time (in microseconds).
 void Sleep(MojoTimeTicks microseconds);
 
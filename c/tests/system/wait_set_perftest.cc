@@ -176,4 +176,88 @@ TEST(WaitSetPerftest, ThreadedWait) {
   DoWaitSetThreadedWaitTest(10000u);
 }
 
+// Each iteration creates |num_entries| message pipes, adds an entry for each to
+// a wait set, and then removes the entries and closes the message pipes (as a
+// run loop serving many short-lived clients might). If |bulk| is true, this
+// uses |MojoWaitSetAddMany()| and |MojoWaitSetRemoveMany()| (if supported).
+void DoWaitSetAddRemoveTest(unsigned num_entries, bool bulk) {
+  MojoHandle wait_set = MOJO_HANDLE_INVALID;
+  MojoResult result = MojoCreateWaitSet(nullptr, &wait_set);
+  MOJO_ALLOW_UNUSED_LOCAL(result);
+  assert(result == MOJO_RESULT_OK);
+
+  if (bulk) {
+    result = MojoWaitSetAddMany(wait_set, nullptr, 0u, nullptr, nullptr);
+    if (result == MOJO_SYSTEM_RESULT_UNIMPLEMENTED) {
+      // Nothing to measure, so nothing is reported.
+      Close(wait_set);
+      return;
+    }
+    assert(result == MOJO_RESULT_OK);
+  }
+
+  std::vector<MojoHandle> h0s(num_entries);
+  std::vector<MojoHandle> h1s(num_entries);
+  std::vector<MojoWaitSetEntry> entries(num_entries);
+  std::vector<uint64_t> cookies(num_entries);
+
+  char sub_test_name[100];
+  sprintf(sub_test_name, "%uentries", num_entries);
+  mojo::test::IterateAndReportPerf(
+      bulk ? "WaitSet_AddRemoveMany" : "WaitSet_AddRemove", sub_test_name,
+      [num_entries, bulk, wait_set, &h0s, &h1s, &entries, &cookies]() {
+        MojoResult result;
+        for (unsigned i = 0; i < num_entries; i++) {
+          result = MojoCreateMessagePipe(nullptr, &h0s[i], &h1s[i]);
+          MOJO_ALLOW_UNUSED_LOCAL(result);
+          assert(result == MOJO_RESULT_OK);
+        }
+
+        if (bulk) {
+          for (unsigned i = 0; i < num_entries; i++) {
+            entries[i].cookie = static_cast<uint64_t>(i);
+            entries[i].handle = h0s[i];
+            entries[i].signals = MOJO_HANDLE_SIGNAL_READABLE;
+            cookies[i] = static_cast<uint64_t>(i);
+          }
+          result = MojoWaitSetAddMany(wait_set, entries.data(), num_entries,
+                                      nullptr, nullptr);
+          assert(result == MOJO_RESULT_OK);
+          result = MojoWaitSetRemoveMany(wait_set, cookies.data(), num_entries,
+                                         nullptr);
+          assert(result == MOJO_RESULT_OK);
+        } else {
+          for (unsigned i = 0; i < num_entries; i++) {
+            result = MojoWaitSetAdd(wait_set, h0s[i],
+                                    MOJO_HANDLE_SIGNAL_READABLE,
+                                    static_cast<uint64_t>(i), nullptr);
+            assert(result == MOJO_RESULT_OK);
+          }
+          for (unsigned i = 0; i < num_entries; i++) {
+            result = MojoWaitSetRemove(wait_set, static_cast<uint64_t>(i));
+            assert(result == MOJO_RESULT_OK);
+          }
+        }
+
+        for (unsigned i = 0; i < num_entries; i++) {
+          Close(h0s[i]);
+          Close(h1s[i]);
+        }
+      });
+
+  Close(wait_set);
+}
+
+TEST(WaitSetPerftest, AddRemove) {
+  DoWaitSetAddRemoveTest(10u, false);
+  DoWaitSetAddRemoveTest(100u, false);
+  DoWaitSetAddRemoveTest(1000u, false);
+}
+
+TEST(WaitSetPerftest, AddRemoveMany) {
+  DoWaitSetAddRemoveTest(10u, true);
+  DoWaitSetAddRemoveTest(100u, true);
+  DoWaitSetAddRemoveTest(1000u, true);
+}
+
 }  // namespace
@@ -196,6 +196,102 @@ TEST(WaitSetTest, Remove) {
   EXPECT_EQ(MOJO_RESULT_OK, MojoClose(mph1));
 }
 
+// |MojoWaitSetAddMany()| and |MojoWaitSetRemoveMany()| are optional: they
+// should either work or be rejected as unimplemented.
+TEST(WaitSetTest, AddManyRemoveMany) {
+  MojoHandle h = MOJO_HANDLE_INVALID;
+  EXPECT_EQ(MOJO_RESULT_OK, MojoCreateWaitSet(nullptr, &h));
+  EXPECT_NE(h, MOJO_HANDLE_INVALID);
+
+  MojoHandle mph0 = MOJO_HANDLE_INVALID;
+  MojoHandle mph1 = MOJO_HANDLE_INVALID;
+  EXPECT_EQ(MOJO_RESULT_OK, MojoCreateMessagePipe(nullptr, &mph0, &mph1));
+
+  const MojoWaitSetEntry kEntries[] = {
+      {12u, mph0, MOJO_HANDLE_SIGNAL_READABLE},
+      {34u, mph1, MOJO_HANDLE_SIGNAL_WRITABLE},
+      {56u, mph0, MOJO_HANDLE_SIGNAL_WRITABLE},
+  };
+  MojoResult results[3] = {};
+  MojoResult result = MojoWaitSetAddMany(h, kEntries, 3u, nullptr, results);
+  if (result == MOJO_SYSTEM_RESULT_UNIMPLEMENTED) {
+    // Also check that removal is unimplemented.
+    const uint64_t kCookies[] = {12u};
+    EXPECT_EQ(MOJO_SYSTEM_RESULT_UNIMPLEMENTED,
+              MojoWaitSetRemoveMany(h, kCookies, 1u, nullptr));
+    EXPECT_EQ(MOJO_RESULT_OK, MojoClose(h));
+    EXPECT_EQ(MOJO_RESULT_OK, MojoClose(mph0));
+    EXPECT_EQ(MOJO_RESULT_OK, MojoClose(mph1));
+    return;
+  }
+  EXPECT_EQ(MOJO_RESULT_OK, result);
+  EXPECT_EQ(MOJO_RESULT_OK, results[0]);
+  EXPECT_EQ(MOJO_RESULT_OK, results[1]);
+  EXPECT_EQ(MOJO_RESULT_OK, results[2]);
+
+  // The entries should have been added.
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_ALREADY_EXISTS,
+            MojoWaitSetAdd(h, mph0, MOJO_HANDLE_SIGNAL_READABLE, 34u, nullptr));
+  {
+    uint32_t num_results = 10u;
+    MojoWaitSetResult wait_results[10] = {};
+    EXPECT_EQ(MOJO_RESULT_OK,
+              MojoWaitSetWait(h, MOJO_DEADLINE_INDEFINITE, &num_results,
+                              wait_results, nullptr));
+    // Only the writable entries should be satisfied.
+    EXPECT_EQ(2u, num_results);
+  }
+
+  // Partial failure: the invalid entry and the duplicate shouldn't be added,
+  // but the others should be.
+  const MojoWaitSetEntry kMoreEntries[] = {
+      {78u, mph1, MOJO_HANDLE_SIGNAL_READABLE},
+      {90u, MOJO_HANDLE_INVALID, MOJO_HANDLE_SIGNAL_READABLE},
+      {12u, mph1, MOJO_HANDLE_SIGNAL_READABLE},
+      {91u, mph1, MOJO_HANDLE_SIGNAL_READABLE},
+  };
+  MojoResult more_results[4] = {};
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_ABORTED,
+            MojoWaitSetAddMany(h, kMoreEntries, 4u, nullptr, more_results));
+  EXPECT_EQ(MOJO_RESULT_OK, more_results[0]);
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_INVALID_ARGUMENT, more_results[1]);
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_ALREADY_EXISTS, more_results[2]);
+  EXPECT_EQ(MOJO_RESULT_OK, more_results[3]);
+
+  // Remove some entries (including one that isn't there).
+  const uint64_t kCookies[] = {12u, 90u, 78u};
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_ABORTED,
+            MojoWaitSetRemoveMany(h, kCookies, 3u, results));
+  EXPECT_EQ(MOJO_RESULT_OK, results[0]);
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_NOT_FOUND, results[1]);
+  EXPECT_EQ(MOJO_RESULT_OK, results[2]);
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_NOT_FOUND, MojoWaitSetRemove(h, 12u));
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_NOT_FOUND, MojoWaitSetRemove(h, 78u));
+
+  // Remove the rest (without getting per-entry results).
+  const uint64_t kRemainingCookies[] = {34u, 56u, 91u};
+  EXPECT_EQ(MOJO_RESULT_OK,
+            MojoWaitSetRemoveMany(h, kRemainingCookies, 3u, nullptr));
+  {
+    uint32_t num_results = 10u;
+    MojoWaitSetResult wait_results[10] = {};
+    EXPECT_EQ(MOJO_SYSTEM_RESULT_DEADLINE_EXCEEDED,
+              MojoWaitSetWait(h, static_cast<MojoDeadline>(0), &num_results,
+                              wait_results, nullptr));
+  }
+
+  // Invalid wait set.
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_INVALID_ARGUMENT,
+            MojoWaitSetAddMany(MOJO_HANDLE_INVALID, kEntries, 3u, nullptr,
+                               nullptr));
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_INVALID_ARGUMENT,
+            MojoWaitSetRemoveMany(MOJO_HANDLE_INVALID, kCookies, 3u, nullptr));
+
+  EXPECT_EQ(MOJO_RESULT_OK, MojoClose(h));
+  EXPECT_EQ(MOJO_RESULT_OK, MojoClose(mph0));
+  EXPECT_EQ(MOJO_RESULT_OK, MojoClose(mph1));
+}
+
 // Helper to check if an array of |MojoWaitSetResult|s has a result |r| for the
 // given cookie, in which case:
 //    - |r.wait_result| must equal |wait_result|.
@@ -388,6 +484,163 @@ TEST(WaitSetTest, Wait) {
   EXPECT_EQ(MOJO_RESULT_OK, MojoClose(mph1));
 }
 
+// Note: Implementations may not support edge-triggered or one-shot entries, in
+// which case these tests don't test much.
+
+TEST(WaitSetTest, EdgeTriggered) {
+  MojoHandle h = MOJO_HANDLE_INVALID;
+  EXPECT_EQ(MOJO_RESULT_OK, MojoCreateWaitSet(nullptr, &h));
+  EXPECT_NE(h, MOJO_HANDLE_INVALID);
+
+  MojoHandle mph0 = MOJO_HANDLE_INVALID;
+  MojoHandle mph1 = MOJO_HANDLE_INVALID;
+  EXPECT_EQ(MOJO_RESULT_OK, MojoCreateMessagePipe(nullptr, &mph0, &mph1));
+
+  static constexpr MojoWaitSetAddOptions kOptions = {
+      static_cast<uint32_t>(sizeof(MojoWaitSetAddOptions)),
+      MOJO_WAIT_SET_ADD_OPTIONS_FLAG_EDGE_TRIGGERED,
+  };
+  MojoResult result =
+      MojoWaitSetAdd(h, mph0, MOJO_HANDLE_SIGNAL_READABLE, 1u, &kOptions);
+  if (result == MOJO_SYSTEM_RESULT_UNIMPLEMENTED) {
+    EXPECT_EQ(MOJO_RESULT_OK, MojoClose(h));
+    EXPECT_EQ(MOJO_RESULT_OK, MojoClose(mph0));
+    EXPECT_EQ(MOJO_RESULT_OK, MojoClose(mph1));
+    return;
+  }
+  EXPECT_EQ(MOJO_RESULT_OK, result);
+
+  // Write two messages to |mph1|.
+  EXPECT_EQ(MOJO_RESULT_OK, MojoWriteMessage(mph1, nullptr, 0, nullptr, 0,
+                                             MOJO_WRITE_MESSAGE_FLAG_NONE));
+  EXPECT_EQ(MOJO_RESULT_OK, MojoWriteMessage(mph1, nullptr, 0, nullptr, 0,
+                                             MOJO_WRITE_MESSAGE_FLAG_NONE));
+
+  // Should get cookie 1 once.
+  {
+    uint32_t num_results = 10u;
+    MojoWaitSetResult results[10] = {};
+    EXPECT_EQ(MOJO_RESULT_OK, MojoWaitSetWait(h, MOJO_DEADLINE_INDEFINITE,
+                                              &num_results, results, nullptr));
+    EXPECT_EQ(1u, num_results);
+    EXPECT_EQ(1u, results[0].cookie);
+    EXPECT_EQ(MOJO_RESULT_OK, results[0].wait_result);
+  }
+  {
+    uint32_t num_results = 10u;
+    MojoWaitSetResult results[10] = {};
+    EXPECT_EQ(MOJO_SYSTEM_RESULT_DEADLINE_EXCEEDED,
+              MojoWaitSetWait(h, static_cast<MojoDeadline>(0), &num_results,
+                              results, nullptr));
+  }
+
+  // Read one message; |mph0| is still readable, so it still shouldn't be
+  // reported.
+  EXPECT_EQ(MOJO_RESULT_OK,
+            MojoReadMessage(mph0, nullptr, nullptr, nullptr, nullptr,
+                            MOJO_READ_MESSAGE_FLAG_NONE));
+  {
+    uint32_t num_results = 10u;
+    MojoWaitSetResult results[10] = {};
+    EXPECT_EQ(MOJO_SYSTEM_RESULT_DEADLINE_EXCEEDED,
+              MojoWaitSetWait(h, static_cast<MojoDeadline>(0), &num_results,
+                              results, nullptr));
+  }
+
+  // Read the other message, then write another; |mph0| became unreadable and
+  // then readable again, so it should be reported again.
+  EXPECT_EQ(MOJO_RESULT_OK,
+            MojoReadMessage(mph0, nullptr, nullptr, nullptr, nullptr,
+                            MOJO_READ_MESSAGE_FLAG_NONE));
+  EXPECT_EQ(MOJO_RESULT_OK, MojoWriteMessage(mph1, nullptr, 0, nullptr, 0,
+                                             MOJO_WRITE_MESSAGE_FLAG_NONE));
+  {
+    uint32_t num_results = 10u;
+    MojoWaitSetResult results[10] = {};
+    EXPECT_EQ(MOJO_RESULT_OK, MojoWaitSetWait(h, MOJO_DEADLINE_INDEFINITE,
+                                              &num_results, results, nullptr));
+    EXPECT_EQ(1u, num_results);
+    EXPECT_EQ(1u, results[0].cookie);
+  }
+
+  // The entry should still be there.
+  EXPECT_EQ(MOJO_RESULT_OK, MojoWaitSetRemove(h, 1u));
+
+  EXPECT_EQ(MOJO_RESULT_OK, MojoClose(h));
+  EXPECT_EQ(MOJO_RESULT_OK, MojoClose(mph0));
+  EXPECT_EQ(MOJO_RESULT_OK, MojoClose(mph1));
+}
+
+TEST(WaitSetTest, OneShot) {
+  MojoHandle h = MOJO_HANDLE_INVALID;
+  EXPECT_EQ(MOJO_RESULT_OK, MojoCreateWaitSet(nullptr, &h));
+  EXPECT_NE(h, MOJO_HANDLE_INVALID);
+
+  MojoHandle mph0 = MOJO_HANDLE_INVALID;
+  MojoHandle mph1 = MOJO_HANDLE_INVALID;
+  EXPECT_EQ(MOJO_RESULT_OK, MojoCreateMessagePipe(nullptr, &mph0, &mph1));
+
+  static constexpr MojoWaitSetAddOptions kOptions = {
+      static_cast<uint32_t>(sizeof(MojoWaitSetAddOptions)),
+      MOJO_WAIT_SET_ADD_OPTIONS_FLAG_ONE_SHOT,
+  };
+  MojoResult result =
+      MojoWaitSetAdd(h, mph0, MOJO_HANDLE_SIGNAL_WRITABLE, 1u, &kOptions);
+  if (result == MOJO_SYSTEM_RESULT_UNIMPLEMENTED) {
+    EXPECT_EQ(MOJO_RESULT_OK, MojoClose(h));
+    EXPECT_EQ(MOJO_RESULT_OK, MojoClose(mph0));
+    EXPECT_EQ(MOJO_RESULT_OK, MojoClose(mph1));
+    return;
+  }
+  EXPECT_EQ(MOJO_RESULT_OK, result);
+  EXPECT_EQ(MOJO_RESULT_OK, MojoWaitSetAdd(h, mph1, MOJO_HANDLE_SIGNAL_WRITABLE,
+                                           2u, &kOptions));
+
+  // Only accept one result: only that entry should be removed.
+  uint64_t first_cookie = 0u;
+  {
+    uint32_t num_results = 1u;
+    MojoWaitSetResult results[1] = {};
+    uint32_t max_results = 1234u;
+    EXPECT_EQ(MOJO_RESULT_OK,
+              MojoWaitSetWait(h, MOJO_DEADLINE_INDEFINITE, &num_results,
+                              results, &max_results));
+    EXPECT_EQ(1u, num_results);
+    EXPECT_EQ(2u, max_results);
+    EXPECT_EQ(MOJO_RESULT_OK, results[0].wait_result);
+    first_cookie = results[0].cookie;
+    EXPECT_TRUE(first_cookie == 1u || first_cookie == 2u);
+  }
+  const uint64_t second_cookie = (first_cookie == 1u) ? 2u : 1u;
+  {
+    uint32_t num_results = 10u;
+    MojoWaitSetResult results[10] = {};
+    EXPECT_EQ(MOJO_RESULT_OK, MojoWaitSetWait(h, MOJO_DEADLINE_INDEFINITE,
+                                              &num_results, results, nullptr));
+    EXPECT_EQ(1u, num_results);
+    EXPECT_EQ(second_cookie, results[0].cookie);
+  }
+
+  // Both entries should be gone now.
+  {
+    uint32_t num_results = 10u;
+    MojoWaitSetResult results[10] = {};
+    EXPECT_EQ(MOJO_SYSTEM_RESULT_DEADLINE_EXCEEDED,
+              MojoWaitSetWait(h, static_cast<MojoDeadline>(0), &num_results,
+                              results, nullptr));
+  }
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_NOT_FOUND, MojoWaitSetRemove(h, 1u));
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_NOT_FOUND, MojoWaitSetRemove(h, 2u));
+
+  // The cookie may be reused.
+  EXPECT_EQ(MOJO_RESULT_OK, MojoWaitSetAdd(h, mph0, MOJO_HANDLE_SIGNAL_WRITABLE,
+                                           1u, &kOptions));
+
+  EXPECT_EQ(MOJO_RESULT_OK, MojoClose(h));
+  EXPECT_EQ(MOJO_RESULT_OK, MojoClose(mph0));
+  EXPECT_EQ(MOJO_RESULT_OK, MojoClose(mph1));
+}
+
 // TODO(vtl): Add threaded tests, especially those that actually ... wait.
 
 }  // namespace
@@ -152,6 +152,26 @@ class Binding {
     return internal_router_->WaitForIncomingMessage(deadline);
   }
 
+  // Enables scheduled dispatch of incoming calls: on each wakeup, at most
+  // |max_messages_per_wakeup| calls are dispatched before other handles on the
+  // run loop get a turn, those to methods with the highest [Priority]
+  // attribute first (see |internal::Connector::EnableScheduledDispatch()|).
+  // Requires that the Binding be bound.
+  void EnableScheduledDispatch(size_t max_messages_per_wakeup,
+                               size_t max_queued_messages) {
+    MOJO_DCHECK(internal_router_);
+    internal_router_->EnableScheduledDispatch(max_messages_per_wakeup,
+                                              max_queued_messages,
+                                              &Interface::GetMessagePriority_);
+  }
+
+  // Returns statistics on scheduled dispatch, including queue depths. Requires
+  // that the Binding be bound.
+  const internal::DispatchStats& dispatch_stats() const {
+    MOJO_DCHECK(internal_router_);
+    return internal_router_->dispatch_stats();
+  }
+
   // Closes the message pipe that was previously bound. Put this object into a
   // state where it can be rebound to a new pipe.
   void Close() {
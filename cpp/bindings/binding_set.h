@@ -7,11 +7,10 @@
 
 #include <assert.h>
 
-#include <algorithm>
 #include <memory>
-#include <vector>
 
 #include "mojo/public/cpp/bindings/binding.h"
+#include "mojo/public/cpp/bindings/lib/slot_map.h"
 #include "mojo/public/cpp/system/macros.h"
 
 namespace mojo {
@@ -28,27 +27,23 @@ class BindingSet {
   // a connection error occurs.  Does not take ownership of |impl|, which
   // must outlive the binding set.
   void AddBinding(Interface* impl, InterfaceRequest<Interface> request) {
-    bindings_.emplace_back(new Binding<Interface>(impl, request.Pass()));
-    auto* binding = bindings_.back().get();
+    auto key = bindings_.Insert(std::unique_ptr<Binding<Interface>>(
+        new Binding<Interface>(impl, request.Pass())));
     // Set the connection error handler for the newly added Binding to be a
-    // function that will erase it from the vector.
-    binding->set_connection_error_handler([this, binding]() {
-      auto it =
-          std::find_if(bindings_.begin(), bindings_.end(),
-                       [binding](const std::unique_ptr<Binding<Interface>>& b) {
-                         return (b.get() == binding);
-                       });
-      assert(it != bindings_.end());
-      bindings_.erase(it);
+    // function that will remove it from the set (in constant time).
+    (*bindings_.Find(key))->set_connection_error_handler([this, key]() {
+      bool removed = bindings_.Remove(key);
+      MOJO_ALLOW_UNUSED_LOCAL(removed);
+      assert(removed);
     });
   }
 
-  void CloseAllBindings() { bindings_.clear(); }
+  void CloseAllBindings() { bindings_.Clear(); }
 
   size_t size() const { return bindings_.size(); }
 
  private:
-  std::vector<std::unique_ptr<Binding<Interface>>> bindings_;
+  internal::SlotMap<std::unique_ptr<Binding<Interface>>> bindings_;
 
   MOJO_DISALLOW_COPY_AND_ASSIGN(BindingSet);
 };
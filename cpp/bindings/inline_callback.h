@@ -0,0 +1,205 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_PUBLIC_CPP_BINDINGS_INLINE_CALLBACK_H_
+#define MOJO_PUBLIC_CPP_BINDINGS_INLINE_CALLBACK_H_
+
+#include <stddef.h>
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "mojo/public/cpp/bindings/lib/callback_internal.h"
+#include "mojo/public/cpp/bindings/lib/template_util.h"
+#include "mojo/public/cpp/system/macros.h"
+
+namespace mojo {
+
+// The default number of bytes an |InlineCallback| can store its sink in
+// without allocating.
+const size_t kDefaultInlineCallbackSize = 4 * sizeof(void*);
+
+template <typename Sig, size_t InlineSize = kDefaultInlineCallbackSize>
+class InlineCallback;
+
+// Like |Callback|, represents a callback with any number of parameters and no
+// return value, which may be "null". Unlike |Callback|, it is move-only rather
+// than reference counted, and it stores sinks of up to |InlineSize| bytes
+// (such as lambdas with a few captures) in place instead of on the heap, so
+// creating, moving and destroying one doesn't allocate. Larger sinks are heap
+// allocated.
+template <typename... Args, size_t InlineSize>
+class InlineCallback<void(Args...), InlineSize> {
+ public:
+  // Constructs a "null" callback that does nothing.
+  InlineCallback() : ops_(nullptr) {}
+  InlineCallback(std::nullptr_t) : ops_(nullptr) {}
+
+  // Adapts any movable type that has a compatible operator() (such as a lambda
+  // or a function pointer) or, failing that, a compatible Run() method (such
+  // as a |Callback|).
+  template <typename Sink,
+            typename std::enable_if<!std::is_same<
+                typename std::decay<Sink>::type,
+                InlineCallback>::value>::type* = nullptr>
+  InlineCallback(Sink sink)
+      : ops_(&SinkOps<Sink>::kOps) {
+    SinkOps<Sink>::Construct(&storage_, std::move(sink));
+  }
+
+  // As above, but can take a compatible function pointer (including one to an
+  // overloaded function).
+  InlineCallback(void (*function_ptr)(
+      typename internal::Callback_ParamTraits<Args>::ForwardType...))
+      : ops_(&SinkOps<decltype(function_ptr)>::kOps) {
+    SinkOps<decltype(function_ptr)>::Construct(&storage_, function_ptr);
+  }
+
+  InlineCallback(InlineCallback&& other) : ops_(nullptr) {
+    MoveFrom(&other);
+  }
+
+  ~InlineCallback() { reset(); }
+
+  InlineCallback& operator=(InlineCallback&& other) {
+    if (this != &other) {
+      reset();
+      MoveFrom(&other);
+    }
+    return *this;
+  }
+
+  // Executes the callback function, invoking Pass() on move-only types.
+  void Run(typename internal::Callback_ParamTraits<Args>::ForwardType... args)
+      const {
+    if (ops_)
+      ops_->run(&storage_, internal::Forward(args)...);
+  }
+
+  bool is_null() const { return !ops_; }
+
+  // Resets the callback to the "null" state.
+  void reset() {
+    if (!ops_)
+      return;
+    // Become null before destroying the sink, in case its destructor reaches
+    // back into this callback.
+    const Ops* ops = ops_;
+    ops_ = nullptr;
+    ops->destroy(&storage_);
+  }
+
+ private:
+  using Storage = typename std::aligned_storage<InlineSize>::type;
+
+  static_assert(InlineSize >= sizeof(void*),
+                "InlineCallback must be able to store a pointer");
+
+  // Type-specific operations on the sink held in |storage_|.
+  struct Ops {
+    void (*run)(const Storage* storage,
+                typename internal::Callback_ParamTraits<Args>::ForwardType...);
+    // Move-constructs the sink in |to| from the one in |from|, and destroys the
+    // latter.
+    void (*move)(Storage* from, Storage* to);
+    void (*destroy)(Storage* storage);
+  };
+
+  // Whether |Sink| can be called with |Args|, as opposed to having a Run()
+  // method.
+  template <typename Sink>
+  struct IsFunctor {
+    template <typename S>
+    static char Test(decltype(std::declval<const S&>()(
+        std::declval<typename internal::Callback_ParamTraits<Args>::
+                         ForwardType>()...))*);
+    template <typename S>
+    static int Test(...);
+    static const bool value = sizeof(Test<Sink>(nullptr)) == sizeof(char);
+  };
+
+  template <typename Sink>
+  struct SinkOps {
+    static const bool kIsInline =
+        sizeof(Sink) <= sizeof(Storage) && alignof(Sink) <= alignof(Storage);
+    static const Ops kOps;
+
+    static void Construct(Storage* storage, Sink sink) {
+      if (kIsInline)
+        new (storage) Sink(std::move(sink));
+      else
+        *reinterpret_cast<Sink**>(storage) = new Sink(std::move(sink));
+    }
+
+    static const Sink* Get(const Storage* storage) {
+      return kIsInline ? reinterpret_cast<const Sink*>(storage)
+                       : *reinterpret_cast<Sink* const*>(storage);
+    }
+
+    static void Run(
+        const Storage* storage,
+        typename internal::Callback_ParamTraits<Args>::ForwardType... args) {
+      Invoke(std::integral_constant<bool, IsFunctor<Sink>::value>(),
+             *Get(storage), internal::Forward(args)...);
+    }
+
+    static void Move(Storage* from, Storage* to) {
+      if (kIsInline) {
+        Sink* sink = reinterpret_cast<Sink*>(from);
+        new (to) Sink(std::move(*sink));
+        sink->~Sink();
+      } else {
+        *reinterpret_cast<Sink**>(to) = *reinterpret_cast<Sink**>(from);
+      }
+    }
+
+    static void Destroy(Storage* storage) {
+      if (kIsInline)
+        reinterpret_cast<Sink*>(storage)->~Sink();
+      else
+        delete *reinterpret_cast<Sink**>(storage);
+    }
+
+    static void Invoke(
+        std::true_type,
+        const Sink& sink,
+        typename internal::Callback_ParamTraits<Args>::ForwardType... args) {
+      sink(internal::Forward(args)...);
+    }
+
+    static void Invoke(
+        std::false_type,
+        const Sink& sink,
+        typename internal::Callback_ParamTraits<Args>::ForwardType... args) {
+      sink.Run(internal::Forward(args)...);
+    }
+  };
+
+  void MoveFrom(InlineCallback* other) {
+    if (!other->ops_)
+      return;
+    other->ops_->move(&other->storage_, &storage_);
+    ops_ = other->ops_;
+    other->ops_ = nullptr;
+  }
+
+  const Ops* ops_;
+  Storage storage_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(InlineCallback);
+};
+
+template <typename... Args, size_t InlineSize>
+template <typename Sink>
+const typename InlineCallback<void(Args...), InlineSize>::Ops
+    InlineCallback<void(Args...), InlineSize>::SinkOps<Sink>::kOps = {
+        &SinkOps<Sink>::Run, &SinkOps<Sink>::Move, &SinkOps<Sink>::Destroy};
+
+// A specialization of InlineCallback which takes no parameters.
+typedef InlineCallback<void()> InlineClosure;
+
+}  // namespace mojo
+
+#endif  // MOJO_PUBLIC_CPP_BINDINGS_INLINE_CALLBACK_H_
@@ -96,6 +96,16 @@ class InterfacePtr {
   Interface* operator->() const { return get(); }
   Interface& operator*() const { return *get(); }
 
+  // Returns the local proxy, as get() does, but as the generated proxy class,
+  // which also has a variant of each method with a response that takes a
+  // timeout (in microseconds) and a callback to run if the response hasn't
+  // arrived in time:
+  //
+  //   ptr.proxy()->Method(args..., callback, timeout, timeout_callback);
+  typename Interface::Proxy_* proxy() const {
+    return internal_state_.proxy();
+  }
+
   // Returns the version number of the interface that the remote side supports.
   uint32_t version() const { return internal_state_.version(); }
 
@@ -162,6 +172,34 @@ class InterfacePtr {
     internal_state_.set_connection_error_handler(error_handler);
   }
 
+  // Enables flow control of the method calls made through this InterfacePtr,
+  // so that a remote side that handles them slowly can't make them pile up in
+  // the message pipe: at most |window| calls are sent but not yet dispatched
+  // at a time. Further calls are held here, in order, until the remote side
+  // catches up, so callers should check |write_would_block()| and wait for
+  // the writable handler rather than keep making calls. This requires the
+  // remote side to use the C++ bindings.
+  //
+  // This method may only be called after the InterfacePtr has been bound to a
+  // message pipe. Calls that are still held are dropped by
+  // PassInterfaceHandle().
+  void EnableFlowControl(uint32_t window) {
+    internal_state_.EnableFlowControl(window);
+  }
+
+  // Returns true if flow control is enabled and a method call made now would
+  // be held, rather than sent.
+  bool write_would_block() const { return internal_state_.write_would_block(); }
+
+  // Registers a handler to be called when method calls are sent again after
+  // |write_would_block()| has returned true.
+  //
+  // This method may only be called after the InterfacePtr has been bound to a
+  // message pipe.
+  void set_writable_handler(const Closure& writable_handler) {
+    internal_state_.set_writable_handler(writable_handler);
+  }
+
   // Unbinds the InterfacePtr and returns the information which could be used
   // to setup an InterfacePtr again. This method may be used to move the proxy
   // to a different thread (see class comments for details).
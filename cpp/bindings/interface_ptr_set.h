@@ -7,9 +7,10 @@
 
 #include <assert.h>
 
-#include <vector>
-
 #include "mojo/public/cpp/bindings/interface_ptr.h"
+#include "mojo/public/cpp/bindings/lib/message_capturer.h"
+#include "mojo/public/cpp/bindings/lib/slot_map.h"
+#include "mojo/public/cpp/system/macros.h"
 
 namespace mojo {
 
@@ -26,20 +27,13 @@ class InterfacePtrSet {
   // |ptr| must be bound to a message pipe.
   void AddInterfacePtr(InterfacePtr<Interface> ptr) {
     assert(ptr.is_bound());
-    ptrs_.emplace_back(ptr.Pass());
-    InterfacePtr<Interface>& intrfc_ptr = ptrs_.back();
-    Interface* pointer = intrfc_ptr.get();
+    auto key = ptrs_.Insert(ptr.Pass());
     // Set the connection error handler for the newly added InterfacePtr to be a
-    // function that will erase it from the vector.
-    intrfc_ptr.set_connection_error_handler([pointer, this]() {
-      // Since InterfacePtr itself is a movable type, the thing that uniquely
-      // identifies the InterfacePtr we wish to erase is its Interface*.
-      auto it = std::find_if(ptrs_.begin(), ptrs_.end(),
-                             [pointer](const InterfacePtr<Interface>& p) {
-                               return (p.get() == pointer);
-                             });
-      assert(it != ptrs_.end());
-      ptrs_.erase(it);
+    // function that will remove it from the set (in constant time).
+    ptrs_.Find(key)->set_connection_error_handler([this, key]() {
+      bool removed = ptrs_.Remove(key);
+      MOJO_ALLOW_UNUSED_LOCAL(removed);
+      assert(removed);
     });
   }
 
@@ -52,20 +46,41 @@ class InterfacePtrSet {
     }
   }
 
-  // Closes the MessagePipe associated with each of the InterfacePtrs in
-  // this set and clears the set.
-  void CloseAll() {
+  // Like |ForAllPtrs()|, but serializes the method calls made by |function|
+  // only once: |function| is applied to a proxy that doesn't send anything,
+  // and the messages it produces are then written to each of the
+  // InterfacePtrs' pipes. The methods must not expect responses and their
+  // arguments must not contain handles; if they do, nothing is sent and this
+  // returns false.
+  template <typename FunctionType>
+  bool Broadcast(FunctionType function) {
+    internal::MessageCapturer capturer;
+    typename Interface::Proxy_ proxy(&capturer);
+    function(static_cast<Interface*>(&proxy));
+    if (capturer.rejected())
+      return false;
+
     for (auto& it : ptrs_) {
-      if (it)
-        it.reset();
+      if (!it)
+        continue;
+      for (const auto& message : capturer.messages()) {
+        bool ok = it.internal_state()->AcceptMessage(message.get());
+        // As with a call through the proxy, !ok implies the Connector has
+        // encountered an error, which will be visible through other means.
+        MOJO_ALLOW_UNUSED_LOCAL(ok);
+      }
     }
-    ptrs_.clear();
+    return true;
   }
 
+  // Closes the MessagePipe associated with each of the InterfacePtrs in
+  // this set and clears the set.
+  void CloseAll() { ptrs_.Clear(); }
+
   size_t size() const { return ptrs_.size(); }
 
  private:
-  std::vector<InterfacePtr<Interface>> ptrs_;
+  internal::SlotMap<InterfacePtr<Interface>> ptrs_;
 };
 
 }  // namespace mojo
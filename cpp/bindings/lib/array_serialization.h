@@ -296,11 +296,16 @@ struct ArraySerializer<
       typename std::remove_pointer<typename WrapperTraits<S>::DataType>::type
           S_Data;
   static size_t GetSerializedSize(const Array<S>& input) {
+    // Nonzero for structs whose size the generator already knows.
+    const size_t element_size = StructDataTraits<S_Data>::kFixedSerializedSize;
     size_t size = sizeof(Array_Data<S_Data*>) +
                   input.size() * sizeof(StructPointer<S_Data>);
     for (size_t i = 0; i < input.size(); ++i) {
-      if (!input[i].is_null())
-        size += GetSerializedSize_(*(UnwrapConstStructPtr<S>::value(input[i])));
+      if (input[i].is_null())
+        continue;
+      size += element_size ? element_size
+                           : GetSerializedSize_(
+                                 *(UnwrapConstStructPtr<S>::value(input[i])));
     }
     return size;
   }
@@ -5,6 +5,8 @@
 #ifndef MOJO_PUBLIC_CPP_BINDINGS_LIB_BINDINGS_INTERNAL_H_
 #define MOJO_PUBLIC_CPP_BINDINGS_LIB_BINDINGS_INTERNAL_H_
 
+#include <stddef.h>
+
 #include <type_traits>
 
 #include "mojo/public/cpp/bindings/lib/template_util.h"
@@ -175,6 +177,36 @@ struct IsUnionDataType {
       sizeof(Test<T>(0)) == sizeof(YesType) && !std::is_const<T>::value;
 };
 
+template <typename T>
+struct IsStructDataType {
+  template <typename U>
+  static YesType Test(const typename U::MojomStructDataType*);
+
+  template <typename U>
+  static NoType Test(...);
+
+  static const bool value =
+      sizeof(Test<T>(0)) == sizeof(YesType) && !std::is_const<T>::value;
+};
+
+// Describes the serialized data type |T| of a struct, as far as the generator
+// knows it up front. Other data types (arrays, maps and strings) get the
+// conservative defaults.
+template <typename T, typename Enable = void>
+struct StructDataTraits {
+  static const bool kContainsPointersOrHandles = true;
+  static const size_t kFixedSerializedSize = 0;
+};
+
+template <typename T>
+struct StructDataTraits<
+    T,
+    typename std::enable_if<IsStructDataType<T>::value>::type> {
+  static const bool kContainsPointersOrHandles =
+      T::kContainsPointers || T::kContainsHandles;
+  static const size_t kFixedSerializedSize = T::kFixedSerializedSize;
+};
+
 // To introduce a new mojom type, you must define (partial or full) template
 // specializations for the following traits templates, which operate on the C++
 // wrapper types representing a mojom type:
@@ -7,6 +7,7 @@
 
 #include <mojo/system/handle.h>
 
+#include <type_traits>
 #include <vector>
 
 #include "mojo/public/cpp/bindings/lib/bindings_internal.h"
@@ -58,11 +59,13 @@ void DecodeHandle(Interface_Data* data, std::vector<Handle>* handles);
 void DecodeHandle(MojoHandle* handle, std::vector<Handle>* handles);
 
 // The following 2 functions are used to encode/decode all objects (structs and
-// arrays) in a consistent manner.
+// arrays) in a consistent manner. Structs that the generator knows to contain
+// no pointers or handles are not visited at all.
 
 template <typename T>
 inline void Encode(T* obj, std::vector<Handle>* handles) {
-  if (obj->ptr)
+  typedef typename std::remove_pointer<decltype(obj->ptr)>::type DataType;
+  if (StructDataTraits<DataType>::kContainsPointersOrHandles && obj->ptr)
     obj->ptr->EncodePointersAndHandles(handles);
   EncodePointer(obj->ptr, &obj->offset);
 }
@@ -70,8 +73,9 @@ inline void Encode(T* obj, std::vector<Handle>* handles) {
 // Note: This function doesn't validate the encoded pointer and handle values.
 template <typename T>
 inline void Decode(T* obj, std::vector<Handle>* handles) {
+  typedef typename std::remove_pointer<decltype(obj->ptr)>::type DataType;
   DecodePointer(&obj->offset, &obj->ptr);
-  if (obj->ptr)
+  if (StructDataTraits<DataType>::kContainsPointersOrHandles && obj->ptr)
     obj->ptr->DecodePointersAndHandles(handles);
 }
 
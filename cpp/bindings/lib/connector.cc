@@ -4,6 +4,10 @@
 
 #include "mojo/public/cpp/bindings/lib/connector.h"
 
+#include <algorithm>
+#include <utility>
+
+#include "mojo/public/cpp/bindings/lib/message_internal.h"
 #include "mojo/public/cpp/environment/logging.h"
 #include "mojo/public/cpp/system/macros.h"
 #include "mojo/public/cpp/system/wait.h"
@@ -22,6 +26,10 @@ Connector::Connector(ScopedMessagePipeHandle message_pipe,
       error_(false),
       drop_writes_(false),
       enforce_errors_from_incoming_receiver_(true),
+      max_messages_per_wakeup_(0u),
+      max_queued_messages_(0u),
+      priority_function_(nullptr),
+      dispatch_stats_(),
       destroyed_flag_(nullptr) {
   // Even though we don't have an incoming receiver, we still want to monitor
   // the message pipe to know if is closed or encounters an error.
@@ -42,6 +50,8 @@ void Connector::CloseMessagePipe() {
 
 ScopedMessagePipeHandle Connector::PassMessagePipe() {
   CancelWait();
+  queued_messages_.clear();
+  dispatch_stats_.queue_depth = 0u;
   return message_pipe_.Pass();
 }
 
@@ -49,6 +59,10 @@ bool Connector::WaitForIncomingMessage(MojoDeadline deadline) {
   if (error_)
     return false;
 
+  // A message that has already been read comes first.
+  if (!queued_messages_.empty())
+    return DispatchQueuedMessage();
+
   MojoResult rv =
       Wait(message_pipe_.get(), MOJO_HANDLE_SIGNAL_READABLE, deadline, nullptr);
   if (rv == MOJO_SYSTEM_RESULT_SHOULD_WAIT ||
@@ -62,6 +76,17 @@ bool Connector::WaitForIncomingMessage(MojoDeadline deadline) {
   return (rv == MOJO_RESULT_OK);
 }
 
+void Connector::EnableScheduledDispatch(
+    size_t max_messages_per_wakeup,
+    size_t max_queued_messages,
+    MessagePriorityFunction priority_function) {
+  MOJO_DCHECK(max_messages_per_wakeup > 0u);
+  MOJO_DCHECK(max_queued_messages >= max_messages_per_wakeup);
+  max_messages_per_wakeup_ = max_messages_per_wakeup;
+  max_queued_messages_ = max_queued_messages;
+  priority_function_ = priority_function;
+}
+
 bool Connector::Accept(Message* message) {
   if (error_)
     return false;
@@ -124,18 +149,33 @@ void Connector::CallOnHandleReady(void* closure, MojoResult result) {
 void Connector::OnHandleReady(MojoResult result) {
   MOJO_CHECK(async_wait_id_ != 0);
   async_wait_id_ = 0;
-  if (result != MOJO_RESULT_OK) {
+  // Messages that have already been read are dispatched even if the peer has
+  // since been closed, but not if the wait was aborted or cancelled (e.g.,
+  // because the run loop is being destroyed).
+  if (result != MOJO_RESULT_OK &&
+      (queued_messages_.empty() ||
+       result != MOJO_SYSTEM_RESULT_FAILED_PRECONDITION)) {
     NotifyError();
     return;
   }
-  ReadAllAvailableMessages();
+  if (max_messages_per_wakeup_)
+    ReadAndDispatchScheduledMessages();
+  else
+    ReadAllAvailableMessages();
   // At this point, this object might have been deleted. Return.
 }
 
 void Connector::WaitToReadMore() {
   MOJO_CHECK(!async_wait_id_);
+  // With messages still queued, we want to be woken up again as soon as the
+  // run loop has serviced the other handles, whether or not more messages
+  // arrive: the pipe is writable (unless its peer is closed, in which case the
+  // wait fails right away, and is handled in OnHandleReady()).
+  MojoHandleSignals signals = MOJO_HANDLE_SIGNAL_READABLE;
+  if (!queued_messages_.empty())
+    signals |= MOJO_HANDLE_SIGNAL_WRITABLE;
   async_wait_id_ = waiter_->AsyncWait(message_pipe_.get().value(),
-                                      MOJO_HANDLE_SIGNAL_READABLE,
+                                      signals,
                                       MOJO_DEADLINE_INDEFINITE,
                                       &Connector::CallOnHandleReady,
                                       this);
@@ -188,6 +228,86 @@ void Connector::ReadAllAvailableMessages() {
   }
 }
 
+void Connector::ReadAndDispatchScheduledMessages() {
+  dispatch_stats_.num_wakeups++;
+
+  MojoResult rv = MOJO_RESULT_OK;
+  while (dispatch_stats_.queue_depth < max_queued_messages_) {
+    std::unique_ptr<Message> message(new Message());
+    rv = ReadMessage(message_pipe_.get(), message.get());
+    if (rv != MOJO_RESULT_OK)
+      break;
+
+    // The message hasn't been validated yet, so it may not even have a header;
+    // the router will reject it when it is dispatched.
+    int32_t priority = 0;
+    if (priority_function_ &&
+        message->data_num_bytes() >= sizeof(MessageHeader))
+      priority = priority_function_(message->name());
+    queued_messages_[priority].push_back(std::move(message));
+    dispatch_stats_.queue_depth++;
+    dispatch_stats_.max_queue_depth = std::max(dispatch_stats_.max_queue_depth,
+                                               dispatch_stats_.queue_depth);
+  }
+
+  for (size_t i = 0u;
+       i < max_messages_per_wakeup_ && !queued_messages_.empty(); i++) {
+    // Return immediately if |this| was destroyed, or if dispatch has to stop.
+    // Do not touch any members!
+    if (!DispatchQueuedMessage())
+      return;
+  }
+
+  if (queued_messages_.empty()) {
+    if (rv != MOJO_RESULT_OK && rv != MOJO_SYSTEM_RESULT_SHOULD_WAIT) {
+      NotifyError();
+      return;
+    }
+  } else {
+    dispatch_stats_.num_yields++;
+  }
+  WaitToReadMore();
+}
+
+bool Connector::DispatchQueuedMessage() {
+  auto it = queued_messages_.begin();
+  std::unique_ptr<Message> message = std::move(it->second.front());
+  it->second.pop_front();
+  if (it->second.empty())
+    queued_messages_.erase(it);
+  dispatch_stats_.queue_depth--;
+  dispatch_stats_.num_messages_dispatched++;
+
+  bool receiver_result = false;
+  if (!Dispatch(message.get(), &receiver_result))
+    return false;
+
+  if (enforce_errors_from_incoming_receiver_ && !receiver_result) {
+    NotifyError();
+    return false;
+  }
+  // The receiver may have closed the pipe.
+  return !error_ && message_pipe_.is_valid();
+}
+
+bool Connector::Dispatch(Message* message, bool* receiver_result) {
+  // Detect if |this| was destroyed during message dispatch, as in
+  // ReadSingleMessage().
+  bool was_destroyed_during_dispatch = false;
+  bool* previous_destroyed_flag = destroyed_flag_;
+  destroyed_flag_ = &was_destroyed_during_dispatch;
+
+  *receiver_result = incoming_receiver_ && incoming_receiver_->Accept(message);
+
+  if (was_destroyed_during_dispatch) {
+    if (previous_destroyed_flag)
+      *previous_destroyed_flag = true;  // Propagate flag.
+    return false;
+  }
+  destroyed_flag_ = previous_destroyed_flag;
+  return true;
+}
+
 void Connector::CancelWait() {
   if (!async_wait_id_)
     return;
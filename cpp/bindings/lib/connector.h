@@ -8,6 +8,13 @@
 #include <mojo/environment/async_waiter.h>
 #include <mojo/system/result.h>
 #include <mojo/system/time.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
 
 #include "mojo/public/cpp/bindings/callback.h"
 #include "mojo/public/cpp/bindings/message.h"
@@ -18,6 +25,25 @@
 namespace mojo {
 namespace internal {
 
+// Returns the dispatch priority of messages named |name|; messages with higher
+// priorities are dispatched first. (See
+// |Connector::EnableScheduledDispatch()|.)
+typedef int32_t (*MessagePriorityFunction)(uint32_t name);
+
+// Statistics kept by a |Connector| with scheduled dispatch enabled.
+struct DispatchStats {
+  // The number of times the connector was woken up to read or dispatch.
+  uint64_t num_wakeups;
+  // The number of messages dispatched.
+  uint64_t num_messages_dispatched;
+  // The number of wakeups after which messages were left queued, so as to let
+  // the run loop service other handles.
+  uint64_t num_yields;
+  // The number of messages read but not yet dispatched, now and at most.
+  size_t queue_depth;
+  size_t max_queue_depth;
+};
+
 // The Connector class is responsible for performing read/write operations on a
 // MessagePipe. It writes messages it receives through the MessageReceiver
 // interface that it subclasses, and it forwards messages it reads through the
@@ -77,6 +103,23 @@ class Connector : public MessageReceiver {
   // Use |encountered_error| to see if an error occurred.
   bool WaitForIncomingMessage(MojoDeadline deadline);
 
+  // Enables scheduled dispatch. Normally, each time the pipe becomes readable,
+  // messages are dispatched in pipe order until it is empty, so a busy pipe
+  // can hold up the other handles of the run loop. With scheduled dispatch,
+  // available messages are read into a queue (of up to |max_queued_messages|),
+  // and at most |max_messages_per_wakeup| of them are dispatched before the
+  // run loop gets to service other handles; the queued messages with the
+  // highest priority, according to |priority_function| (if not null), are
+  // dispatched first, in pipe order.
+  //
+  // Note that queued messages are dropped if the pipe is passed with
+  // PassMessagePipe().
+  void EnableScheduledDispatch(size_t max_messages_per_wakeup,
+                               size_t max_queued_messages,
+                               MessagePriorityFunction priority_function);
+
+  const DispatchStats& dispatch_stats() const { return dispatch_stats_; }
+
   // MessageReceiver implementation:
   bool Accept(Message* message) override;
 
@@ -94,6 +137,20 @@ class Connector : public MessageReceiver {
   // |this| can be destroyed during message dispatch.
   void ReadAllAvailableMessages();
 
+  // Reads messages into |queued_messages_| and dispatches some of them, for
+  // scheduled dispatch. |this| can be destroyed during message dispatch.
+  void ReadAndDispatchScheduledMessages();
+
+  // Dispatches the first queued message. Returns false if |this| was destroyed
+  // during message dispatch, or if no more messages are to be dispatched (as an
+  // error was reported, or the pipe was closed).
+  MOJO_WARN_UNUSED_RESULT bool DispatchQueuedMessage();
+
+  // Dispatches |message| to |incoming_receiver_|. Returns false if |this| was
+  // destroyed during dispatch, in which case no members may be touched.
+  MOJO_WARN_UNUSED_RESULT bool Dispatch(Message* message,
+                                        bool* receiver_result);
+
   void NotifyError();
 
   // Cancels any calls made to |waiter_|.
@@ -110,6 +167,16 @@ class Connector : public MessageReceiver {
   bool drop_writes_;
   bool enforce_errors_from_incoming_receiver_;
 
+  // For scheduled dispatch; |max_messages_per_wakeup_| is 0 if it is disabled.
+  size_t max_messages_per_wakeup_;
+  size_t max_queued_messages_;
+  MessagePriorityFunction priority_function_;
+  // Messages read but not yet dispatched, by priority (highest first).
+  std::map<int32_t,
+           std::deque<std::unique_ptr<Message>>,
+           std::greater<int32_t>> queued_messages_;
+  DispatchStats dispatch_stats_;
+
   // If non-null, this will be set to true when the Connector is destroyed.  We
   // use this flag to allow for the Connector to be destroyed as a side-effect
   // of dispatching an incoming message.
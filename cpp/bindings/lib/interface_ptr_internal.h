@@ -14,6 +14,7 @@
 #include "mojo/public/cpp/bindings/lib/control_message_proxy.h"
 #include "mojo/public/cpp/bindings/lib/message_header_validator.h"
 #include "mojo/public/cpp/bindings/lib/router.h"
+#include "mojo/public/cpp/bindings/lib/weak_ref.h"
 #include "mojo/public/cpp/environment/logging.h"
 
 struct MojoAsyncWaiter;
@@ -24,8 +25,14 @@ namespace internal {
 template <typename Interface>
 class InterfacePtrState {
  public:
+  using Proxy = typename Interface::Proxy_;
+
   InterfacePtrState()
-      : proxy_(nullptr), router_(nullptr), waiter_(nullptr), version_(0u) {}
+      : proxy_(nullptr),
+        router_(nullptr),
+        waiter_(nullptr),
+        version_(0u),
+        weak_anchor_(this) {}
 
   ~InterfacePtrState() {
     // Destruction order matters here. We delete |proxy_| first, even though
@@ -42,15 +49,26 @@ class InterfacePtrState {
     return proxy_;
   }
 
+  Proxy* proxy() {
+    ConfigureProxyIfNecessary();
+
+    // This will be null if the object is not bound.
+    return proxy_;
+  }
+
   uint32_t version() const { return version_; }
 
   void QueryVersion(const Callback<void(uint32_t)>& callback) {
     ConfigureProxyIfNecessary();
 
-    // It is safe to capture |this| because the callback won't be run after this
-    // object goes away.
-    auto callback_wrapper = [this, callback](uint32_t version) {
-      this->version_ = version;
+    // The callback is only run while |router_| is alive, but by then |router_|
+    // may belong to another state (which the weak reference follows, see
+    // Swap()).
+    WeakRef<InterfacePtrState> weak_self = weak_anchor_.GetRef();
+    auto callback_wrapper = [weak_self, callback](uint32_t version) {
+      InterfacePtrState* self = weak_self.get();
+      if (self)
+        self->version_ = version;
       callback.Run(version);
     };
 
@@ -78,6 +96,7 @@ class InterfacePtrState {
     handle_.swap(other->handle_);
     swap(other->waiter_, waiter_);
     swap(other->version_, version_);
+    weak_anchor_.Swap(&other->weak_anchor_);
   }
 
   void Bind(InterfaceHandle<Interface> info, const MojoAsyncWaiter* waiter) {
@@ -121,14 +140,49 @@ class InterfacePtrState {
     router_->set_connection_error_handler(error_handler);
   }
 
+  void EnableFlowControl(uint32_t window) {
+    ConfigureProxyIfNecessary();
+
+    MOJO_DCHECK(router_);
+    router_->EnableFlowControl(window);
+  }
+
+  bool write_would_block() const {
+    return router_ ? router_->write_would_block() : false;
+  }
+
+  void set_writable_handler(const Closure& writable_handler) {
+    ConfigureProxyIfNecessary();
+
+    MOJO_DCHECK(router_);
+    router_->set_writable_handler(writable_handler);
+  }
+
+  // Writes an already-serialized |message| (which must not expect a response)
+  // to the pipe, as the proxy would.
+  bool AcceptMessage(Message* message) {
+    ConfigureProxyIfNecessary();
+
+    MOJO_DCHECK(router_);
+    return router_->Accept(message);
+  }
+
+  // As above, but for a |message| that expects a response, which will be given
+  // to |responder|.
+  bool AcceptMessageWithResponder(Message* message,
+                                  MessageReceiver* responder) {
+    ConfigureProxyIfNecessary();
+
+    MOJO_DCHECK(router_);
+    return router_->AcceptWithResponder(message, responder);
+  }
+
   Router* router_for_testing() {
     ConfigureProxyIfNecessary();
     return router_;
   }
 
  private:
-  using Proxy = typename Interface::Proxy_;
-
   void ConfigureProxyIfNecessary() {
     // The proxy has been configured.
     if (proxy_) {
@@ -164,6 +218,8 @@ class InterfacePtrState {
 
   uint32_t version_;
 
+  WeakAnchor<InterfacePtrState> weak_anchor_;
+
   MOJO_DISALLOW_COPY_AND_ASSIGN(InterfacePtrState);
 };
 
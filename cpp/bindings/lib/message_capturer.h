@@ -0,0 +1,62 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_PUBLIC_CPP_BINDINGS_LIB_MESSAGE_CAPTURER_H_
+#define MOJO_PUBLIC_CPP_BINDINGS_LIB_MESSAGE_CAPTURER_H_
+
+#include <memory>
+#include <vector>
+
+#include "mojo/public/cpp/bindings/message.h"
+#include "mojo/public/cpp/system/macros.h"
+
+namespace mojo {
+namespace internal {
+
+// |MessageCapturer| is a |MessageReceiverWithResponder| that keeps the
+// messages it is given instead of sending them anywhere. A proxy bound to it
+// serializes method calls without writing them to a pipe, so that the
+// serialized messages can then be written to many pipes.
+class MessageCapturer : public MessageReceiverWithResponder {
+ public:
+  MessageCapturer() : rejected_(false) {}
+  ~MessageCapturer() override {}
+
+  // Messages that carry handles can't be written more than once (the handles
+  // are transferred by the first write), so they are rejected (closing their
+  // handles), as are messages that expect a response.
+  bool Accept(Message* message) override {
+    if (!message->handles()->empty()) {
+      rejected_ = true;
+      return false;
+    }
+    messages_.push_back(std::unique_ptr<Message>(new Message()));
+    message->MoveTo(messages_.back().get());
+    return true;
+  }
+
+  bool AcceptWithResponder(Message* message,
+                           MessageReceiver* responder) override {
+    rejected_ = true;
+    return false;
+  }
+
+  // True if any message has been rejected.
+  bool rejected() const { return rejected_; }
+
+  const std::vector<std::unique_ptr<Message>>& messages() const {
+    return messages_;
+  }
+
+ private:
+  std::vector<std::unique_ptr<Message>> messages_;
+  bool rejected_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(MessageCapturer);
+};
+
+}  // namespace internal
+}  // namespace mojo
+
+#endif  // MOJO_PUBLIC_CPP_BINDINGS_LIB_MESSAGE_CAPTURER_H_
@@ -64,6 +64,16 @@ ValidationError ValidateMessageHeader(const MessageHeader* header,
   return ValidationError::NONE;
 }
 
+ValidationError ValidateFlowControlMessage(const Message* message,
+                                           std::string* err) {
+  ValidationError retval =
+      ValidateMessageIsRequestWithoutResponse(message, err);
+  if (retval != ValidationError::NONE)
+    return retval;
+
+  return ValidateMessagePayload<FlowControlMessageParams_Data>(message, err);
+}
+
 }  // namespace
 
 ValidationError MessageHeaderValidator::Validate(const Message* message,
@@ -101,6 +111,9 @@ ValidationError ValidateControlRequest(const Message* message,
                                                                       err);
     }
 
+    case kFlowControlMessageId:
+      return ValidateFlowControlMessage(message, err);
+
     default: {
       MOJO_INTERNAL_DEBUG_SET_ERROR_MSG(err)
           << "unknown InterfaceControlMessage request message name: "
@@ -114,6 +127,11 @@ ValidationError ValidateControlRequest(const Message* message,
 
 ValidationError ValidateControlResponse(const Message* message,
                                         std::string* err) {
+  // Flow control messages go both ways, so they are seen by the response
+  // validator of a proxy too.
+  if (message->header()->name == kFlowControlMessageId)
+    return ValidateFlowControlMessage(message, err);
+
   ValidationError retval = ValidateMessageIsResponse(message, err);
   if (retval != ValidationError::NONE)
     return retval;
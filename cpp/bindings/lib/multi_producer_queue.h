@@ -0,0 +1,86 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_PUBLIC_CPP_BINDINGS_LIB_MULTI_PRODUCER_QUEUE_H_
+#define MOJO_PUBLIC_CPP_BINDINGS_LIB_MULTI_PRODUCER_QUEUE_H_
+
+#include <stddef.h>
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include "mojo/public/cpp/system/macros.h"
+
+namespace mojo {
+namespace internal {
+
+// |MultiProducerQueue| is a lock-free queue of (movable) |T|s, onto which any
+// number of threads may push, and from which a single thread (the consumer)
+// takes everything pushed so far in one go. Pushing is a single
+// compare-and-swap; taking is a single exchange, after which the values are
+// handed out in the order they were pushed without further synchronization.
+template <typename T>
+class MultiProducerQueue {
+ public:
+  MultiProducerQueue() : head_(nullptr) {}
+  ~MultiProducerQueue() {
+    TakeAll([](T value) {});
+  }
+
+  // May be called on any thread. Returns true if the queue was empty, i.e., if
+  // the consumer may have to be told that there is something to take.
+  bool Push(T value) {
+    Node* node = new Node(std::move(value));
+    node->next = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_weak(node->next, node,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+    }
+    return !node->next;
+  }
+
+  // Takes all the values in the queue, and calls |function| with each one, in
+  // the order they were pushed. Values pushed while this runs (including by
+  // |function|) are left for the next call. Returns the number of values taken.
+  template <typename Function>
+  size_t TakeAll(Function function) {
+    // The values are linked newest first; reverse them.
+    Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+    Node* oldest = nullptr;
+    while (node) {
+      Node* next = node->next;
+      node->next = oldest;
+      oldest = node;
+      node = next;
+    }
+
+    size_t num_taken = 0u;
+    while (oldest) {
+      std::unique_ptr<Node> taken(oldest);
+      oldest = taken->next;
+      function(std::move(taken->value));
+      num_taken++;
+    }
+    return num_taken;
+  }
+
+ private:
+  struct Node {
+    explicit Node(T value) : value(std::move(value)), next(nullptr) {}
+
+    T value;
+    Node* next;
+  };
+
+  // The most recently pushed node.
+  std::atomic<Node*> head_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(MultiProducerQueue);
+};
+
+}  // namespace internal
+}  // namespace mojo
+
+#endif  // MOJO_PUBLIC_CPP_BINDINGS_LIB_MULTI_PRODUCER_QUEUE_H_
@@ -0,0 +1,53 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/bindings/response_executor.h"
+
+#include <utility>
+
+#include "mojo/public/cpp/environment/logging.h"
+#include "mojo/public/cpp/system/wait.h"
+
+namespace mojo {
+
+ResponseQueue::ResponseQueue() {
+  MojoResult result =
+      CreateMessagePipe(nullptr, &wake_sender_, &wake_receiver_);
+  MOJO_CHECK(result == MOJO_RESULT_OK);
+}
+
+ResponseQueue::~ResponseQueue() {}
+
+void ResponseQueue::Execute(InlineClosure task) {
+  if (!tasks_.Push(std::move(task)))
+    return;
+  MojoResult result = WriteMessageRaw(wake_sender_.get(), nullptr, 0u, nullptr,
+                                      0u, MOJO_WRITE_MESSAGE_FLAG_NONE);
+  MOJO_DCHECK(result == MOJO_RESULT_OK);
+}
+
+size_t ResponseQueue::RunPendingTasks() {
+  // Discard the wake-up messages before taking the tasks: a task queued after
+  // this is either taken below or followed by another wake-up message.
+  while (ReadMessageRaw(wake_receiver_.get(), nullptr, nullptr, nullptr,
+                        nullptr, MOJO_READ_MESSAGE_FLAG_MAY_DISCARD) ==
+         MOJO_RESULT_OK) {
+  }
+  return tasks_.TakeAll([](InlineClosure task) { task.Run(); });
+}
+
+size_t ResponseQueue::WaitAndRunPendingTasks(MojoDeadline deadline) {
+  size_t num_run = RunPendingTasks();
+  // A wake-up message may be left over from tasks that were already run, so
+  // waking up doesn't guarantee that there is a task to run.
+  while (!num_run) {
+    if (Wait(wake_receiver_.get(), MOJO_HANDLE_SIGNAL_READABLE, deadline,
+             nullptr) != MOJO_RESULT_OK)
+      break;
+    num_run = RunPendingTasks();
+  }
+  return num_run;
+}
+
+}  // namespace mojo
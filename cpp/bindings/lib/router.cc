@@ -4,26 +4,42 @@
 
 #include "mojo/public/cpp/bindings/lib/router.h"
 
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
 #include <string>
 #include <utility>
 
+#include "mojo/public/cpp/bindings/lib/control_message_handler.h"
+#include "mojo/public/cpp/bindings/lib/message_builder.h"
 #include "mojo/public/cpp/bindings/message_validator.h"
 #include "mojo/public/cpp/environment/logging.h"
+#include "mojo/public/cpp/system/time.h"
+#include "mojo/public/interfaces/bindings/interface_control_messages.mojom.h"
 
 namespace mojo {
 namespace internal {
+namespace {
+
+// Per-call timeouts are handled to a resolution of a millisecond; a turn of the
+// wheel is about a second.
+const MojoTimeTicks kTimeoutTickDuration = 1000;
+const size_t kNumTimeoutSlots = 1024u;
+
+}  // namespace
 
 // ----------------------------------------------------------------------------
 
 class ResponderThunk : public MessageReceiverWithStatus {
  public:
-  explicit ResponderThunk(const SharedData<Router*>& router)
+  explicit ResponderThunk(const WeakRef<Router>& router)
       : router_(router), accept_was_invoked_(false) {}
   ~ResponderThunk() override {
     if (!accept_was_invoked_) {
       // The Mojo application handled a message that was expecting a response
       // but did not send a response.
-      Router* router = router_.value();
+      Router* router = router_.get();
       if (router) {
         // We close the pipe here as a way of signaling to the calling
         // application that an error condition occurred. Without this the
@@ -41,7 +57,7 @@ class ResponderThunk : public MessageReceiverWithStatus {
 
     bool result = false;
 
-    Router* router = router_.value();
+    Router* router = router_.get();
     if (router)
       result = router->Accept(message);
 
@@ -50,12 +66,12 @@ class ResponderThunk : public MessageReceiverWithStatus {
 
   // MessageReceiverWithStatus implementation:
   bool IsValid() override {
-    Router* router = router_.value();
+    Router* router = router_.get();
     return router && !router->encountered_error() && router->is_valid();
   }
 
  private:
-  SharedData<Router*> router_;
+  WeakRef<Router> router_;
   bool accept_was_invoked_;
 };
 
@@ -72,33 +88,51 @@ bool Router::HandleIncomingMessageThunk::Accept(Message* message) {
 
 // ----------------------------------------------------------------------------
 
+// static
+const size_t Router::kMaxTimedOutRequestIds;
+
 Router::Router(ScopedMessagePipeHandle message_pipe,
                MessageValidatorList validators,
                const MojoAsyncWaiter* waiter)
     : thunk_(this),
       validators_(std::move(validators)),
       connector_(message_pipe.Pass(), waiter),
-      weak_self_(this),
+      weak_anchor_(this),
       incoming_receiver_(nullptr),
       next_request_id_(0),
-      testing_mode_(false) {
+      testing_mode_(false),
+      waiter_(waiter),
+      timeouts_(kTimeoutTickDuration, kNumTimeoutSlots),
+      timed_out_request_ids_floor_(0),
+      timeout_wait_id_(0),
+      timeout_wait_time_(0),
+      flow_control_enabled_(false),
+      send_credits_(0u),
+      grant_batch_size_(0u),
+      num_ungranted_messages_(0u) {
   // This receiver thunk redirects to Router::HandleIncomingMessage.
   connector_.set_incoming_receiver(&thunk_);
 }
 
 Router::~Router() {
-  weak_self_.set_value(nullptr);
+  weak_anchor_.Invalidate();
+  if (timeout_wait_id_)
+    waiter_->CancelWait(timeout_wait_id_);
 
   for (ResponderMap::const_iterator i = responders_.begin();
        i != responders_.end();
        ++i) {
     delete i->second;
   }
+  for (const auto& coalesced : coalesced_requests_) {
+    for (MessageReceiver* responder : coalesced.second.responders)
+      delete responder;
+  }
 }
 
 bool Router::Accept(Message* message) {
   MOJO_DCHECK(!message->has_flag(kMessageExpectsResponse));
-  return connector_.Accept(message);
+  return WriteMessage(message);
 }
 
 bool Router::AcceptWithResponder(Message* message, MessageReceiver* responder) {
@@ -110,7 +144,7 @@ bool Router::AcceptWithResponder(Message* message, MessageReceiver* responder) {
     request_id = next_request_id_++;
 
   message->set_request_id(request_id);
-  if (!connector_.Accept(message))
+  if (!WriteMessage(message))
     return false;
 
   // We assume ownership of |responder|.
@@ -118,6 +152,64 @@ bool Router::AcceptWithResponder(Message* message, MessageReceiver* responder) {
   return true;
 }
 
+bool Router::AcceptWithResponderAndTimeout(Message* message,
+                                           MessageReceiver* responder,
+                                           MojoDeadline timeout,
+                                           const Closure& timeout_callback) {
+  if (timeout == MOJO_DEADLINE_INDEFINITE)
+    return AcceptWithResponder(message, responder);
+
+  MojoTimeTicks now = GetTimeTicksNow();
+  // Timeouts too long to be represented never happen either.
+  if (timeout >= static_cast<MojoDeadline>(
+                     std::numeric_limits<MojoTimeTicks>::max() - now))
+    return AcceptWithResponder(message, responder);
+
+  if (!AcceptWithResponder(message, responder))
+    return false;
+
+  uint64_t request_id = next_request_id_ - 1;
+  timeout_callbacks_[request_id] = timeout_callback;
+  timeouts_.Add(request_id, now + static_cast<MojoTimeTicks>(timeout));
+  WaitForTimeouts();
+  return true;
+}
+
+bool Router::AcceptWithCoalescedResponder(Message* message,
+                                          MessageReceiver* responder) {
+  // Handles can't be shared by several requests.
+  if (!message->handles()->empty())
+    return AcceptWithResponder(message, responder);
+
+  uint32_t name = message->name();
+  std::string key(reinterpret_cast<const char*>(&name), sizeof(name));
+  key.append(reinterpret_cast<const char*>(message->payload()),
+             message->payload_num_bytes());
+
+  auto it = coalesced_request_ids_.find(key);
+  if (it != coalesced_request_ids_.end()) {
+    // We assume ownership of |responder|.
+    coalesced_requests_[it->second].responders.push_back(responder);
+    return true;
+  }
+
+  if (!AcceptWithResponder(message, responder))
+    return false;
+
+  uint64_t request_id = next_request_id_ - 1;
+  coalesced_request_ids_[key] = request_id;
+  coalesced_requests_[request_id].key = std::move(key);
+  return true;
+}
+
+void Router::EnableFlowControl(uint32_t window) {
+  MOJO_DCHECK(window > 0u);
+  MOJO_DCHECK(!flow_control_enabled_);
+  flow_control_enabled_ = true;
+  send_credits_ = window;
+  SendFlowControlMessage(window, 0u);
+}
+
 void Router::EnableTestingMode() {
   testing_mode_ = true;
   connector_.set_enforce_errors_from_incoming_receiver(false);
@@ -134,9 +226,22 @@ bool Router::HandleIncomingMessage(Message* message) {
   if (result != ValidationError::NONE)
     return false;
 
+  if (ControlMessageHandler::IsControlMessage(message)) {
+    if (message->header()->name == kFlowControlMessageId)
+      return HandleFlowControlMessage(message);
+  } else if (grant_batch_size_) {
+    // Grant the credit for |message| as it is dispatched (afterwards, |this|
+    // may have been destroyed).
+    if (++num_ungranted_messages_ >= grant_batch_size_) {
+      SendFlowControlMessage(0u, num_ungranted_messages_);
+      num_ungranted_messages_ = 0u;
+    }
+  }
+
   if (message->has_flag(kMessageExpectsResponse)) {
     if (incoming_receiver_) {
-      MessageReceiverWithStatus* responder = new ResponderThunk(weak_self_);
+      MessageReceiverWithStatus* responder =
+          new ResponderThunk(weak_anchor_.GetRef());
       bool ok = incoming_receiver_->AcceptWithResponder(message, responder);
       if (!ok)
         delete responder;
@@ -150,13 +255,57 @@ bool Router::HandleIncomingMessage(Message* message) {
     uint64_t request_id = message->request_id();
     ResponderMap::iterator it = responders_.find(request_id);
     if (it == responders_.end()) {
+      // The call has timed out, so the response is no longer wanted.
+      if (timed_out_request_ids_.erase(request_id) ||
+          request_id < timed_out_request_ids_floor_)
+        return true;
       MOJO_DCHECK(testing_mode_);
       return false;
     }
     MessageReceiver* responder = it->second;
     responders_.erase(it);
+    timeout_callbacks_.erase(request_id);
+
+    auto coalesced_it = coalesced_requests_.find(request_id);
+    if (coalesced_it == coalesced_requests_.end()) {
+      bool ok = responder->Accept(message);
+      delete responder;
+      return ok;
+    }
+
+    // The request may be sent again from now on.
+    std::vector<MessageReceiver*> coalesced_responders;
+    coalesced_responders.swap(coalesced_it->second.responders);
+    coalesced_request_ids_.erase(coalesced_it->second.key);
+    coalesced_requests_.erase(coalesced_it);
+
+    // Coalesced methods have no handles in their responses, so any handles
+    // the other end sent anyway are closed. Each responder gets a copy of the
+    // rest, since responders decode the response in place. |this| may be
+    // destroyed by any of them, after which the others are deleted without
+    // it, as they would have been by ~Router().
+    for (Handle handle : *message->mutable_handles()) {
+      if (handle.is_valid())
+        CloseRaw(handle);
+    }
+    message->mutable_handles()->clear();
+    Message response;
+    response.AllocUninitializedData(message->data_num_bytes());
+    memcpy(response.mutable_data(), message->data(), message->data_num_bytes());
+
+    WeakRef<Router> weak_self = weak_anchor_.GetRef();
     bool ok = responder->Accept(message);
     delete responder;
+    for (MessageReceiver* coalesced_responder : coalesced_responders) {
+      if (weak_self.get()) {
+        Message response_copy;
+        response_copy.AllocUninitializedData(response.data_num_bytes());
+        memcpy(response_copy.mutable_data(), response.data(),
+               response.data_num_bytes());
+        ok = coalesced_responder->Accept(&response_copy) && ok;
+      }
+      delete coalesced_responder;
+    }
     return ok;
   } else {
     if (incoming_receiver_)
@@ -167,6 +316,170 @@ bool Router::HandleIncomingMessage(Message* message) {
   return false;
 }
 
+void Router::WaitForTimeouts() {
+  if (timeouts_.empty())
+    return;
+
+  MojoTimeTicks wake_up_time = timeouts_.GetNextWakeUpTime();
+  if (timeout_wait_id_) {
+    if (timeout_wait_time_ <= wake_up_time)
+      return;
+    waiter_->CancelWait(timeout_wait_id_);
+    timeout_wait_id_ = 0;
+  }
+
+  if (!timeout_wait_handle_.is_valid()) {
+    MojoResult result = CreateMessagePipe(nullptr, &timeout_wait_handle_,
+                                          &timeout_wait_peer_handle_);
+    MOJO_CHECK(result == MOJO_RESULT_OK);
+  }
+
+  MojoTimeTicks now = GetTimeTicksNow();
+  timeout_wait_time_ = wake_up_time;
+  timeout_wait_id_ = waiter_->AsyncWait(
+      timeout_wait_handle_.get().value(), MOJO_HANDLE_SIGNAL_READABLE,
+      static_cast<MojoDeadline>(std::max(wake_up_time - now, MojoTimeTicks())),
+      &Router::CallOnTimeoutWaitDone, this);
+}
+
+// static
+void Router::CallOnTimeoutWaitDone(void* closure, MojoResult result) {
+  static_cast<Router*>(closure)->OnTimeoutWaitDone(result);
+}
+
+void Router::OnTimeoutWaitDone(MojoResult result) {
+  MOJO_CHECK(timeout_wait_id_ != 0);
+  timeout_wait_id_ = 0;
+  // Nothing is ever written to the pipe, so unless the wait has timed out, it
+  // was aborted or cancelled (e.g., because the run loop is being destroyed),
+  // and mustn't be started again.
+  if (result != MOJO_SYSTEM_RESULT_DEADLINE_EXCEEDED)
+    return;
+
+  std::vector<uint64_t> expired_request_ids;
+  timeouts_.Expire(GetTimeTicksNow(), &expired_request_ids);
+
+  WeakRef<Router> weak_self = weak_anchor_.GetRef();
+  for (uint64_t request_id : expired_request_ids) {
+    auto it = timeout_callbacks_.find(request_id);
+    // Skip calls whose responses have arrived.
+    if (it == timeout_callbacks_.end())
+      continue;
+    Closure timeout_callback = it->second;
+    timeout_callbacks_.erase(it);
+
+    ResponderMap::iterator responder_it = responders_.find(request_id);
+    MOJO_DCHECK(responder_it != responders_.end());
+    MessageReceiver* responder = responder_it->second;
+    responders_.erase(responder_it);
+    timed_out_request_ids_.insert(request_id);
+    if (timed_out_request_ids_.size() > kMaxTimedOutRequestIds) {
+      auto oldest_it = timed_out_request_ids_.begin();
+      timed_out_request_ids_floor_ = *oldest_it + 1;
+      timed_out_request_ids_.erase(oldest_it);
+    }
+
+    // |this| may be destroyed by either of the following.
+    delete responder;
+    if (!weak_self.get())
+      return;
+    timeout_callback.Run();
+    if (!weak_self.get())
+      return;
+  }
+
+  WaitForTimeouts();
+}
+
+bool Router::HandleFlowControlMessage(Message* message) {
+  FlowControlMessageParams_Data* params =
+      reinterpret_cast<FlowControlMessageParams_Data*>(
+          message->mutable_payload());
+  params->DecodePointersAndHandles(message->mutable_handles());
+
+  FlowControlMessageParamsPtr params_ptr(FlowControlMessageParams::New());
+  Deserialize_(params, params_ptr.get());
+
+  if (params_ptr->window) {
+    // Grant credits once half of the window has been used up, so that the
+    // other end needn't stop sending if we keep up.
+    grant_batch_size_ = std::max(params_ptr->window / 2u, 1u);
+    num_ungranted_messages_ = 0u;
+  }
+
+  if (params_ptr->credits && flow_control_enabled_) {
+    bool was_blocked = write_would_block();
+    send_credits_ += params_ptr->credits;
+    WritePendingMessages();
+    if (was_blocked && !write_would_block() && !writable_handler_.is_null()) {
+      // |this| may be destroyed by the handler.
+      Closure writable_handler = writable_handler_;
+      writable_handler.Run();
+    }
+  }
+  return true;
+}
+
+bool Router::WriteMessage(Message* message) {
+  if (!write_would_block()) {
+    if (!connector_.Accept(message))
+      return false;
+    if (flow_control_enabled_ &&
+        !ControlMessageHandler::IsControlMessage(message))
+      send_credits_--;
+    return true;
+  }
+
+  if (connector_.encountered_error())
+    return false;
+  // Control messages are held too, so as to stay in order. As with a write to
+  // the pipe, the handles are taken but the data is left to the caller, which
+  // may send the same message elsewhere (e.g. InterfacePtrSet::Broadcast()).
+  std::unique_ptr<Message> pending_message(new Message());
+  pending_message->AllocUninitializedData(message->data_num_bytes());
+  memcpy(pending_message->mutable_data(), message->data(),
+         message->data_num_bytes());
+  pending_message->mutable_handles()->swap(*message->mutable_handles());
+  pending_messages_.push_back(std::move(pending_message));
+  return true;
+}
+
+void Router::WritePendingMessages() {
+  while (!pending_messages_.empty()) {
+    Message* message = pending_messages_.front().get();
+    bool is_control_message = ControlMessageHandler::IsControlMessage(message);
+    if (!is_control_message && send_credits_ == 0u)
+      return;
+    if (!connector_.Accept(message)) {
+      // The pipe is broken, so the messages can't be sent anyway.
+      pending_messages_.clear();
+      return;
+    }
+    if (!is_control_message)
+      send_credits_--;
+    pending_messages_.pop_front();
+  }
+}
+
+void Router::SendFlowControlMessage(uint32_t window, uint32_t credits) {
+  FlowControlMessageParamsPtr params_ptr(FlowControlMessageParams::New());
+  params_ptr->window = window;
+  params_ptr->credits = credits;
+
+  size_t size = GetSerializedSize_(*params_ptr);
+  MessageBuilder builder(kFlowControlMessageId, size);
+
+  FlowControlMessageParams_Data* params = nullptr;
+  auto result = Serialize_(params_ptr.get(), builder.buffer(), &params);
+  MOJO_DCHECK(result == ValidationError::NONE);
+
+  params->EncodePointersAndHandles(builder.message()->mutable_handles());
+  // Flow control messages bypass flow control (and so may overtake held
+  // messages), or both ends could end up waiting for credits.
+  bool ok = connector_.Accept(builder.message());
+  MOJO_ALLOW_UNUSED_LOCAL(ok);
+}
+
 // ----------------------------------------------------------------------------
 
 }  // namespace internal
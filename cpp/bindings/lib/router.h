@@ -5,12 +5,21 @@
 #ifndef MOJO_PUBLIC_CPP_BINDINGS_LIB_ROUTER_H_
 #define MOJO_PUBLIC_CPP_BINDINGS_LIB_ROUTER_H_
 
+#include <stdint.h>
+
+#include <deque>
 #include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "mojo/public/cpp/bindings/callback.h"
 #include "mojo/public/cpp/bindings/lib/connector.h"
-#include "mojo/public/cpp/bindings/lib/shared_data.h"
+#include "mojo/public/cpp/bindings/lib/timer_wheel.h"
 #include "mojo/public/cpp/bindings/lib/validation_errors.h"
+#include "mojo/public/cpp/bindings/lib/weak_ref.h"
 #include "mojo/public/cpp/bindings/message_validator.h"
 #include "mojo/public/cpp/environment/environment.h"
 
@@ -21,6 +30,8 @@ namespace internal {
 // response messages back to the sender.
 class Router : public MessageReceiverWithResponder {
  public:
+  static const size_t kMaxTimedOutRequestIds = 1024u;
+
   Router(ScopedMessagePipeHandle message_pipe,
          MessageValidatorList validators,
          const MojoAsyncWaiter* waiter = Environment::GetDefaultAsyncWaiter());
@@ -55,6 +66,18 @@ class Router : public MessageReceiverWithResponder {
   bool Accept(Message* message) override;
   bool AcceptWithResponder(Message* message,
                            MessageReceiver* responder) override;
+  // The timeout is measured while the run loop (through |waiter|) runs; a
+  // response read by WaitForIncomingMessage() is accepted even if it is late,
+  // as long as the timeout hasn't been handled yet. Later responses are
+  // discarded; to recognize them, the IDs of the last |kMaxTimedOutRequestIds|
+  // timed-out requests are remembered, and any response to an older request
+  // is taken to be late.
+  bool AcceptWithResponderAndTimeout(Message* message,
+                                     MessageReceiver* responder,
+                                     MojoDeadline timeout,
+                                     const Closure& timeout_callback) override;
+  bool AcceptWithCoalescedResponder(Message* message,
+                                    MessageReceiver* responder) override;
 
   // Blocks the current thread until the first incoming method call, i.e.,
   // either a call to a client method or a callback method, or |deadline|.
@@ -66,6 +89,41 @@ class Router : public MessageReceiverWithResponder {
     return connector_.WaitForIncomingMessage(deadline);
   }
 
+  // See |Connector::EnableScheduledDispatch()|.
+  void EnableScheduledDispatch(size_t max_messages_per_wakeup,
+                               size_t max_queued_messages,
+                               MessagePriorityFunction priority_function) {
+    connector_.EnableScheduledDispatch(max_messages_per_wakeup,
+                                       max_queued_messages, priority_function);
+  }
+
+  const DispatchStats& dispatch_stats() const {
+    return connector_.dispatch_stats();
+  }
+
+  // Enables credit-based flow control of the messages (other than control
+  // messages) sent from this end, so that a slow receiver can't make them pile
+  // up in the pipe: at most |window| of them are in the pipe, or not yet
+  // dispatched at the other end, at any time. Messages sent beyond that are
+  // held here, in order, until the other end grants more credits; the sender
+  // is expected to check |write_would_block()| and stop sending until its
+  // writable handler is called. (The other end must also be a Router, which
+  // grants credits as it dispatches the messages.)
+  void EnableFlowControl(uint32_t window);
+
+  // Returns true if flow control is enabled and a message sent now would be
+  // held here, rather than written to the pipe.
+  bool write_would_block() const {
+    return flow_control_enabled_ &&
+           (send_credits_ == 0u || !pending_messages_.empty());
+  }
+
+  // Sets the handler to be called when messages may be written to the pipe
+  // again after |write_would_block()| has returned true.
+  void set_writable_handler(const Closure& writable_handler) {
+    writable_handler_ = writable_handler;
+  }
+
   // Sets this object to testing mode.
   // In testing mode:
   // - the object is more tolerant of unrecognized response messages;
@@ -78,6 +136,15 @@ class Router : public MessageReceiverWithResponder {
  private:
   typedef std::map<uint64_t, MessageReceiver*> ResponderMap;
 
+  // The identical requests that are waiting for the response to a request that
+  // was sent (see AcceptWithCoalescedResponder()).
+  struct CoalescedRequests {
+    // The name and payload of the requests.
+    std::string key;
+    // The responders of the requests that weren't sent.
+    std::vector<MessageReceiver*> responders;
+  };
+
   // This class is registered for incoming messages from the |Connector|.  It
   // simply forwards them to |Router::HandleIncomingMessages|.
   class HandleIncomingMessageThunk : public MessageReceiver {
@@ -94,14 +161,62 @@ class Router : public MessageReceiverWithResponder {
 
   bool HandleIncomingMessage(Message* message);
 
+  // Waits (through |waiter_|) until the next time |timeouts_| has to be looked
+  // at, if there is one earlier than the current wait.
+  void WaitForTimeouts();
+  static void CallOnTimeoutWaitDone(void* closure, MojoResult result);
+  void OnTimeoutWaitDone(MojoResult result);
+  bool HandleFlowControlMessage(Message* message);
+
+  // Writes |message| to the pipe, or holds it in |pending_messages_| if flow
+  // control doesn't allow it yet.
+  bool WriteMessage(Message* message);
+  // Writes as many of |pending_messages_| as flow control allows.
+  void WritePendingMessages();
+  void SendFlowControlMessage(uint32_t window, uint32_t credits);
+
   HandleIncomingMessageThunk thunk_;
   MessageValidatorList validators_;
   Connector connector_;
-  SharedData<Router*> weak_self_;
+  WeakAnchor<Router> weak_anchor_;
   MessageReceiverWithResponderStatus* incoming_receiver_;
   ResponderMap responders_;
   uint64_t next_request_id_;
   bool testing_mode_;
+
+  // For per-call timeouts: when they are up, the request IDs in |timeouts_|
+  // that are still in |timeout_callbacks_| (and |responders_|) time out, and
+  // are moved to |timed_out_request_ids_| until their late responses arrive.
+  // Beyond |kMaxTimedOutRequestIds| of them, the oldest are forgotten, and
+  // |timed_out_request_ids_floor_| is raised above them instead.
+  const MojoAsyncWaiter* const waiter_;
+  TimerWheel timeouts_;
+  std::map<uint64_t, Closure> timeout_callbacks_;
+  std::set<uint64_t> timed_out_request_ids_;
+  uint64_t timed_out_request_ids_floor_;
+  // A pipe that never becomes readable, which is waited on with a deadline to
+  // be called back once it has passed.
+  ScopedMessagePipeHandle timeout_wait_handle_;
+  ScopedMessagePipeHandle timeout_wait_peer_handle_;
+  MojoAsyncWaitID timeout_wait_id_;
+  MojoTimeTicks timeout_wait_time_;
+
+  // For coalesced requests: the ID of the request awaiting its response for
+  // each name and payload, and the requests coalesced with it by its ID.
+  std::unordered_map<std::string, uint64_t> coalesced_request_ids_;
+  std::map<uint64_t, CoalescedRequests> coalesced_requests_;
+
+  // Flow control of the messages sent from this end (see EnableFlowControl()).
+  bool flow_control_enabled_;
+  uint32_t send_credits_;
+  std::deque<std::unique_ptr<Message>> pending_messages_;
+  Closure writable_handler_;
+
+  // Flow control of the messages sent from the other end, if it has enabled
+  // it: credits are granted in batches of |grant_batch_size_| (0 if flow
+  // control isn't enabled).
+  uint32_t grant_batch_size_;
+  uint32_t num_ungranted_messages_;
 };
 
 }  // namespace internal
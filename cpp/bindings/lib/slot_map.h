@@ -0,0 +1,159 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_PUBLIC_CPP_BINDINGS_LIB_SLOT_MAP_H_
+#define MOJO_PUBLIC_CPP_BINDINGS_LIB_SLOT_MAP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+#include "mojo/public/cpp/system/macros.h"
+
+namespace mojo {
+namespace internal {
+
+// |SlotMap| is a container of (movable) |T|s that hands out a |Key| for each
+// value inserted, which can be used to look up or remove that value in
+// constant time. The values are stored contiguously, so iterating over them
+// is fast; removing one moves the last one into its place, so removal
+// invalidates pointers and iterators to values (but not keys).
+//
+// A key stays valid until its value is removed; after that it no longer
+// refers to any value, even once its slot is reused for a new value.
+//
+// Values are destroyed only once the map is consistent again, so destroying a
+// value may itself insert or remove values.
+template <typename T>
+class SlotMap {
+ public:
+  struct Key {
+    // Index into |slots_|.
+    uint32_t slot;
+    // Generation of that slot when the key was handed out.
+    uint32_t generation;
+  };
+
+  typedef typename std::vector<T>::iterator iterator;
+  typedef typename std::vector<T>::const_iterator const_iterator;
+
+  SlotMap() : free_slot_(kNoSlot) {}
+  ~SlotMap() { Clear(); }
+
+  Key Insert(T value) {
+    uint32_t slot = free_slot_;
+    if (slot != kNoSlot) {
+      free_slot_ = slots_[slot].index;
+    } else {
+      slot = static_cast<uint32_t>(slots_.size());
+      slots_.push_back(Slot{0u, 0u});
+    }
+    slots_[slot].index = static_cast<uint32_t>(values_.size());
+    values_.push_back(std::move(value));
+    value_slots_.push_back(slot);
+    return Key{slot, slots_[slot].generation};
+  }
+
+  // Returns the value for |key|, or null if it has been removed.
+  T* Find(Key key) {
+    if (key.slot >= slots_.size() ||
+        slots_[key.slot].generation != key.generation)
+      return nullptr;
+    return &values_[slots_[key.slot].index];
+  }
+
+  // Removes (and destroys) the value for |key|. Returns false if it had
+  // already been removed.
+  bool Remove(Key key) {
+    if (!Find(key))
+      return false;
+
+    const uint32_t index = slots_[key.slot].index;
+    T removed(std::move(values_[index]));
+    const size_t last = values_.size() - 1u;
+    if (index != last) {
+      values_[index] = std::move(values_[last]);
+      value_slots_[index] = value_slots_[last];
+      slots_[value_slots_[index]].index = index;
+    }
+    values_.pop_back();
+    value_slots_.pop_back();
+    FreeSlot(key.slot);
+    return true;
+  }
+
+  // Removes (and destroys) all the values for which |predicate| returns true,
+  // in a single pass.
+  template <typename Predicate>
+  void RemoveIf(Predicate predicate) {
+    std::vector<T> removed;
+    size_t num_kept = 0u;
+    for (size_t i = 0u; i < values_.size(); i++) {
+      if (predicate(values_[i])) {
+        removed.push_back(std::move(values_[i]));
+        FreeSlot(value_slots_[i]);
+        continue;
+      }
+      if (num_kept != i) {
+        values_[num_kept] = std::move(values_[i]);
+        value_slots_[num_kept] = value_slots_[i];
+        slots_[value_slots_[num_kept]].index =
+            static_cast<uint32_t>(num_kept);
+      }
+      num_kept++;
+    }
+    values_.erase(values_.begin() + num_kept, values_.end());
+    value_slots_.resize(num_kept);
+  }
+
+  // Removes (and destroys) all the values at once.
+  void Clear() {
+    std::vector<T> removed;
+    removed.swap(values_);
+    for (uint32_t slot : value_slots_)
+      FreeSlot(slot);
+    value_slots_.clear();
+  }
+
+  size_t size() const { return values_.size(); }
+  bool empty() const { return values_.empty(); }
+
+  iterator begin() { return values_.begin(); }
+  iterator end() { return values_.end(); }
+  const_iterator begin() const { return values_.begin(); }
+  const_iterator end() const { return values_.end(); }
+
+ private:
+  static const uint32_t kNoSlot = static_cast<uint32_t>(-1);
+
+  struct Slot {
+    // If the slot is in use, the index of its value in |values_|; otherwise,
+    // the next free slot (or |kNoSlot|).
+    uint32_t index;
+    // Incremented each time the slot is freed, which invalidates its keys.
+    uint32_t generation;
+  };
+
+  void FreeSlot(uint32_t slot) {
+    slots_[slot].generation++;
+    slots_[slot].index = free_slot_;
+    free_slot_ = slot;
+  }
+
+  std::vector<T> values_;
+  // The slot of each value in |values_|.
+  std::vector<uint32_t> value_slots_;
+  std::vector<Slot> slots_;
+  // Head of the list of free slots (linked through |Slot::index|).
+  uint32_t free_slot_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(SlotMap);
+};
+
+}  // namespace internal
+}  // namespace mojo
+
+#endif  // MOJO_PUBLIC_CPP_BINDINGS_LIB_SLOT_MAP_H_
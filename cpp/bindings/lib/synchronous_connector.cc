@@ -7,18 +7,21 @@
 #include <mojo/system/handle.h>
 #include <mojo/system/time.h>
 
+#include <string>
 #include <utility>
 
+#include "mojo/public/cpp/bindings/lib/message_header_validator.h"
 #include "mojo/public/cpp/bindings/message.h"
 #include "mojo/public/cpp/environment/logging.h"
 #include "mojo/public/cpp/system/message_pipe.h"
+#include "mojo/public/cpp/system/time.h"
 #include "mojo/public/cpp/system/wait.h"
 
 namespace mojo {
 namespace internal {
 
 SynchronousConnector::SynchronousConnector(ScopedMessagePipeHandle handle)
-    : handle_(std::move(handle)) {}
+    : handle_(std::move(handle)), next_request_id_(1u) {}
 
 SynchronousConnector::~SynchronousConnector() {}
 
@@ -73,5 +76,87 @@ bool SynchronousConnector::BlockingRead(Message* received_msg) {
   return true;
 }
 
+bool SynchronousConnector::WriteRequest(Message* request,
+                                        uint64_t* request_id) {
+  MOJO_DCHECK(request->has_flag(kMessageExpectsResponse));
+  MOJO_DCHECK(request_id);
+
+  // Unlike a Router, we reserve 0 for the blocking calls made with Write() and
+  // BlockingRead().
+  uint64_t id = next_request_id_++;
+  if (id == 0u)
+    id = next_request_id_++;
+
+  request->set_request_id(id);
+  if (!Write(request))
+    return false;
+
+  responses_[id] = nullptr;
+  *request_id = id;
+  return true;
+}
+
+bool SynchronousConnector::ReadResponse(uint64_t request_id,
+                                        Message* response,
+                                        MojoDeadline deadline) {
+  MOJO_DCHECK(handle_.is_valid());
+  MOJO_DCHECK(response);
+
+  auto it = responses_.find(request_id);
+  if (it == responses_.end()) {
+    MOJO_LOG(WARNING) << "No outstanding request with ID " << request_id;
+    return false;
+  }
+
+  MojoTimeTicks start_time = GetTimeTicksNow();
+  while (!it->second) {
+    MojoDeadline remaining = MOJO_DEADLINE_INDEFINITE;
+    if (deadline != MOJO_DEADLINE_INDEFINITE) {
+      MojoDeadline elapsed =
+          static_cast<MojoDeadline>(GetTimeTicksNow() - start_time);
+      remaining = elapsed < deadline ? deadline - elapsed : 0u;
+    }
+
+    MojoResult rv =
+        Wait(handle_.get(), MOJO_HANDLE_SIGNAL_READABLE, remaining, nullptr);
+    if (rv == MOJO_SYSTEM_RESULT_DEADLINE_EXCEEDED)
+      return false;
+    if (rv != MOJO_RESULT_OK) {
+      MOJO_LOG(WARNING) << "Failed waiting for a response. error = " << rv;
+      return false;
+    }
+
+    std::unique_ptr<Message> message(new Message());
+    rv = ReadMessage(handle_.get(), message.get());
+    if (rv != MOJO_RESULT_OK) {
+      MOJO_LOG(WARNING) << "Failed reading the response message. error = "
+                        << rv;
+      return false;
+    }
+
+    // Only the header is validated here, to find the request the message is a
+    // response to; the rest is up to the caller.
+    std::string err;
+    if (MessageHeaderValidator().Validate(message.get(), &err) !=
+            ValidationError::NONE ||
+        !message->has_flag(kMessageIsResponse)) {
+      MOJO_LOG(WARNING) << "Received a message that isn't a response. " << err;
+      return false;
+    }
+
+    auto response_it = responses_.find(message->request_id());
+    if (response_it == responses_.end() || response_it->second) {
+      MOJO_LOG(WARNING) << "Received an unexpected response with request ID "
+                        << message->request_id();
+      return false;
+    }
+    response_it->second = std::move(message);
+  }
+
+  it->second->MoveTo(response);
+  responses_.erase(it);
+  return true;
+}
+
 }  // namespace internal
 }  // namespace mojo
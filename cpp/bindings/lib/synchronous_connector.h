@@ -5,6 +5,12 @@
 #ifndef MOJO_PUBLIC_CPP_BINDINGS_LIB_SYNCHRONOUS_CONNECTOR_H_
 #define MOJO_PUBLIC_CPP_BINDINGS_LIB_SYNCHRONOUS_CONNECTOR_H_
 
+#include <mojo/system/time.h>
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+
 #include "mojo/public/cpp/bindings/message.h"
 #include "mojo/public/cpp/system/macros.h"
 #include "mojo/public/cpp/system/message_pipe.h"
@@ -30,6 +36,22 @@ class SynchronousConnector {
   // TODO(vardhan): Add a timeout mechanism.
   bool BlockingRead(Message* received_msg);
 
+  // Writes |request|, which must expect a response, without waiting for the
+  // response: the request is given a new request ID, which is returned in
+  // |*request_id| (and is to be given to ReadResponse()). Any number of
+  // requests may be outstanding at once. Returns true on a successful write.
+  bool WriteRequest(Message* request, uint64_t* request_id);
+
+  // Blocks until the response to the outstanding request with |request_id|
+  // has been read, or |deadline| (in microseconds) has passed. Responses to
+  // other outstanding requests that are read in the meantime are kept until
+  // they are asked for. |response| must be non-null and be empty. Returns true
+  // on a successful read; the request is no longer outstanding then, but still
+  // is if the deadline passed.
+  bool ReadResponse(uint64_t request_id,
+                    Message* response,
+                    MojoDeadline deadline);
+
   ScopedMessagePipeHandle PassHandle() { return std::move(handle_); }
 
   // Returns true if the underlying MessagePipe is valid.
@@ -38,6 +60,11 @@ class SynchronousConnector {
  private:
   ScopedMessagePipeHandle handle_;
 
+  uint64_t next_request_id_;
+  // The outstanding requests, by ID, with their responses once they have been
+  // read (null until then).
+  std::map<uint64_t, std::unique_ptr<Message>> responses_;
+
   MOJO_DISALLOW_COPY_AND_ASSIGN(SynchronousConnector);
 };
 
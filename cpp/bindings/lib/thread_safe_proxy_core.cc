@@ -0,0 +1,136 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/bindings/lib/thread_safe_proxy_core.h"
+
+#include <utility>
+
+#include "mojo/public/cpp/environment/logging.h"
+
+namespace mojo {
+namespace internal {
+namespace {
+
+// Gives the response to |responder| (if there is one), then destroys
+// |responder|. Run by a |ResponseExecutor|.
+struct RunResponder {
+  void operator()() const {
+    if (message)
+      ignore_result(responder->Accept(message.get()));
+  }
+
+  std::unique_ptr<MessageReceiver> responder;
+  std::unique_ptr<Message> message;
+};
+
+// Stands in for a responder on the pipe thread, and hands the response (and
+// the responder itself, so that it is also destroyed there) over to
+// |executor_|.
+class ResponseForwarder : public MessageReceiver {
+ public:
+  ResponseForwarder(MessageReceiver* responder, ResponseExecutor* executor)
+      : responder_(responder), executor_(executor) {}
+
+  ~ResponseForwarder() override {
+    // The response never came.
+    if (responder_)
+      executor_->Execute(RunResponder{std::move(responder_), nullptr});
+  }
+
+  bool Accept(Message* message) override {
+    std::unique_ptr<Message> response(new Message());
+    message->MoveTo(response.get());
+    executor_->Execute(
+        RunResponder{std::move(responder_), std::move(response)});
+    return true;
+  }
+
+ private:
+  std::unique_ptr<MessageReceiver> responder_;
+  ResponseExecutor* const executor_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(ResponseForwarder);
+};
+
+}  // namespace
+
+ThreadSafeProxyCore::ThreadSafeProxyCore(MessageReceiverWithResponder* sink,
+                                         const MojoAsyncWaiter* waiter)
+    : sink_(sink), waiter_(waiter), async_wait_id_(0) {
+  MojoResult result =
+      CreateMessagePipe(nullptr, &wake_sender_, &wake_receiver_);
+  MOJO_CHECK(result == MOJO_RESULT_OK);
+  WaitForWakeUp();
+}
+
+ThreadSafeProxyCore::~ThreadSafeProxyCore() {
+  if (async_wait_id_)
+    waiter_->CancelWait(async_wait_id_);
+}
+
+void ThreadSafeProxyCore::Enqueue(Message* message,
+                                  MessageReceiver* responder,
+                                  ResponseExecutor* executor) {
+  PendingCall call;
+  call.message.reset(new Message());
+  message->MoveTo(call.message.get());
+  if (responder && executor)
+    call.responder.reset(new ResponseForwarder(responder, executor));
+  else
+    call.responder.reset(responder);
+
+  if (!calls_.Push(std::move(call)))
+    return;
+  MojoResult result = WriteMessageRaw(wake_sender_.get(), nullptr, 0u, nullptr,
+                                      0u, MOJO_WRITE_MESSAGE_FLAG_NONE);
+  MOJO_DCHECK(result == MOJO_RESULT_OK);
+}
+
+void ThreadSafeProxyCore::Flush() {
+  // Discard the wake-up messages before taking the calls: a call enqueued
+  // after this is either taken below or followed by another wake-up message.
+  while (ReadMessageRaw(wake_receiver_.get(), nullptr, nullptr, nullptr,
+                        nullptr, MOJO_READ_MESSAGE_FLAG_MAY_DISCARD) ==
+         MOJO_RESULT_OK) {
+  }
+
+  calls_.TakeAll([this](PendingCall call) {
+    // As with a call through a proxy, a failure here implies that the
+    // Connector has encountered an error, which will be visible through other
+    // means.
+    if (!call.responder) {
+      ignore_result(sink_->Accept(call.message.get()));
+    } else if (sink_->AcceptWithResponder(call.message.get(),
+                                          call.responder.get())) {
+      ignore_result(call.responder.release());
+    }
+  });
+}
+
+// static
+void ThreadSafeProxyCore::CallOnWakeUp(void* closure, MojoResult result) {
+  static_cast<ThreadSafeProxyCore*>(closure)->OnWakeUp(result);
+}
+
+void ThreadSafeProxyCore::OnWakeUp(MojoResult result) {
+  MOJO_CHECK(async_wait_id_ != 0);
+  async_wait_id_ = 0;
+  // We own both ends of the wake-up pipe, so this can't fail.
+  MOJO_DCHECK(result == MOJO_RESULT_OK);
+  if (result != MOJO_RESULT_OK)
+    return;
+
+  Flush();
+  WaitForWakeUp();
+}
+
+void ThreadSafeProxyCore::WaitForWakeUp() {
+  MOJO_DCHECK(!async_wait_id_);
+  async_wait_id_ = waiter_->AsyncWait(
+      wake_receiver_.get().value(), MOJO_HANDLE_SIGNAL_READABLE,
+      MOJO_DEADLINE_INDEFINITE, &ThreadSafeProxyCore::CallOnWakeUp, this);
+}
+
+}  // namespace internal
+}  // namespace mojo
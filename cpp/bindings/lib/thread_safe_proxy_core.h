@@ -0,0 +1,103 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_PUBLIC_CPP_BINDINGS_LIB_THREAD_SAFE_PROXY_CORE_H_
+#define MOJO_PUBLIC_CPP_BINDINGS_LIB_THREAD_SAFE_PROXY_CORE_H_
+
+#include <mojo/environment/async_waiter.h>
+#include <mojo/system/result.h>
+
+#include <memory>
+
+#include "mojo/public/cpp/bindings/lib/multi_producer_queue.h"
+#include "mojo/public/cpp/bindings/message.h"
+#include "mojo/public/cpp/bindings/response_executor.h"
+#include "mojo/public/cpp/system/macros.h"
+#include "mojo/public/cpp/system/message_pipe.h"
+
+namespace mojo {
+namespace internal {
+
+// |ThreadSafeProxyCore| is the part of |ThreadSafeInterfacePtr| that doesn't
+// depend on the interface. Calls may be enqueued on it from any thread; they
+// are passed on to |sink| on the thread it was created on (the "pipe thread"),
+// a batch at a time. The pipe thread is woken up, by way of |waiter|, only when
+// a call is enqueued while the queue is empty.
+class ThreadSafeProxyCore {
+ public:
+  // Doesn't take ownership of |sink|. It must outlive this object.
+  ThreadSafeProxyCore(MessageReceiverWithResponder* sink,
+                      const MojoAsyncWaiter* waiter);
+  // Discards any calls not yet passed on to |sink|.
+  ~ThreadSafeProxyCore();
+
+  // May be called on any thread. Takes the contents of |message| and ownership
+  // of |responder| (which may be null), which will be given the response on
+  // |executor| (or on the pipe thread, if |executor| is null).
+  void Enqueue(Message* message,
+               MessageReceiver* responder,
+               ResponseExecutor* executor);
+
+  // Passes the calls enqueued so far on to |sink|, in the order they were
+  // enqueued. Must be called on the pipe thread.
+  void Flush();
+
+ private:
+  struct PendingCall {
+    std::unique_ptr<Message> message;
+    // Null if the call doesn't expect a response.
+    std::unique_ptr<MessageReceiver> responder;
+  };
+
+  static void CallOnWakeUp(void* closure, MojoResult result);
+  void OnWakeUp(MojoResult result);
+  void WaitForWakeUp();
+
+  // Not owned.
+  MessageReceiverWithResponder* const sink_;
+  const MojoAsyncWaiter* const waiter_;
+  MojoAsyncWaitID async_wait_id_;
+
+  MultiProducerQueue<PendingCall> calls_;
+
+  // A message is written to |wake_sender_| whenever a call is enqueued while
+  // |calls_| is empty.
+  ScopedMessagePipeHandle wake_sender_;
+  ScopedMessagePipeHandle wake_receiver_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(ThreadSafeProxyCore);
+};
+
+// |CallEnqueuer| is a |MessageReceiverWithResponder| that enqueues the calls
+// made through a proxy bound to it on a |ThreadSafeProxyCore|, with responses
+// going to |executor|. It is meant to be created, with the proxy, on the
+// calling thread, for a few calls.
+class CallEnqueuer : public MessageReceiverWithResponder {
+ public:
+  CallEnqueuer(ThreadSafeProxyCore* core, ResponseExecutor* executor)
+      : core_(core), executor_(executor) {}
+  ~CallEnqueuer() override {}
+
+  bool Accept(Message* message) override {
+    core_->Enqueue(message, nullptr, executor_);
+    return true;
+  }
+
+  bool AcceptWithResponder(Message* message,
+                           MessageReceiver* responder) override {
+    core_->Enqueue(message, responder, executor_);
+    return true;
+  }
+
+ private:
+  ThreadSafeProxyCore* const core_;
+  ResponseExecutor* const executor_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(CallEnqueuer);
+};
+
+}  // namespace internal
+}  // namespace mojo
+
+#endif  // MOJO_PUBLIC_CPP_BINDINGS_LIB_THREAD_SAFE_PROXY_CORE_H_
@@ -0,0 +1,72 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/bindings/lib/timer_wheel.h"
+
+#include <algorithm>
+
+#include "mojo/public/cpp/environment/logging.h"
+
+namespace mojo {
+namespace internal {
+
+TimerWheel::TimerWheel(MojoTimeTicks tick_duration, size_t num_slots)
+    : tick_duration_(tick_duration),
+      slots_(num_slots),
+      current_tick_(0),
+      size_(0u) {
+  MOJO_DCHECK(tick_duration_ > 0);
+  MOJO_DCHECK(num_slots > 0u);
+}
+
+TimerWheel::~TimerWheel() {}
+
+void TimerWheel::Add(uint64_t id, MojoTimeTicks expiry) {
+  // Round up, so as never to expire early, but not to before the ticks that
+  // have already passed.
+  int64_t tick = std::max((expiry + tick_duration_ - 1) / tick_duration_,
+                          current_tick_);
+  slots_[static_cast<size_t>(tick) % slots_.size()].push_back(Entry{id, tick});
+  size_++;
+}
+
+void TimerWheel::Expire(MojoTimeTicks now, std::vector<uint64_t>* expired) {
+  int64_t now_tick = now / tick_duration_;
+  if (now_tick < current_tick_)
+    return;
+
+  // Each slot needs to be looked at at most once, however many ticks have
+  // passed.
+  int64_t last_tick = std::min(
+      now_tick, current_tick_ + static_cast<int64_t>(slots_.size()) - 1);
+  for (int64_t tick = current_tick_; tick <= last_tick; ++tick) {
+    std::vector<Entry>& slot =
+        slots_[static_cast<size_t>(tick) % slots_.size()];
+    // Entries for later turns of the wheel stay.
+    auto it = std::partition(slot.begin(), slot.end(),
+                             [now_tick](const Entry& entry) {
+                               return entry.tick > now_tick;
+                             });
+    for (auto expired_it = it; expired_it != slot.end(); ++expired_it)
+      expired->push_back(expired_it->id);
+    size_ -= slot.end() - it;
+    slot.erase(it, slot.end());
+  }
+  current_tick_ = now_tick + 1;
+}
+
+MojoTimeTicks TimerWheel::GetNextWakeUpTime() const {
+  MOJO_DCHECK(!empty());
+
+  // The first non-empty slot is no later than the slot of the earliest expiry
+  // (its entries may be for later turns of the wheel, though, in which case
+  // nothing will have expired by then).
+  for (int64_t tick = current_tick_;; ++tick) {
+    if (!slots_[static_cast<size_t>(tick) % slots_.size()].empty())
+      return tick * tick_duration_;
+  }
+}
+
+}  // namespace internal
+}  // namespace mojo
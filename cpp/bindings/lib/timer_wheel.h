@@ -0,0 +1,63 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_PUBLIC_CPP_BINDINGS_LIB_TIMER_WHEEL_H_
+#define MOJO_PUBLIC_CPP_BINDINGS_LIB_TIMER_WHEEL_H_
+
+#include <mojo/system/time.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "mojo/public/cpp/system/macros.h"
+
+namespace mojo {
+namespace internal {
+
+// |TimerWheel| keeps track of when each of a number of IDs (e.g., request IDs)
+// expires, to a resolution of |tick_duration|. It is a hashed timer wheel: an
+// ID is put in one of |num_slots| slots according to the tick it expires in,
+// so adding one takes constant time, and expiring IDs only looks at the slots
+// of the ticks that have passed. IDs can't be removed; one that is no longer of
+// interest should just be ignored when it expires.
+class TimerWheel {
+ public:
+  TimerWheel(MojoTimeTicks tick_duration, size_t num_slots);
+  ~TimerWheel();
+
+  bool empty() const { return size_ == 0u; }
+
+  // Adds |id|, to expire at |expiry| (or up to a tick later, but never
+  // earlier).
+  void Add(uint64_t id, MojoTimeTicks expiry);
+
+  // Removes the IDs that have expired as of |now|, and appends them to
+  // |expired|.
+  void Expire(MojoTimeTicks now, std::vector<uint64_t>* expired);
+
+  // Returns a time at which Expire() should next be called, which is no later
+  // than the first time at which it would return an ID. The wheel must not be
+  // empty.
+  MojoTimeTicks GetNextWakeUpTime() const;
+
+ private:
+  struct Entry {
+    uint64_t id;
+    int64_t tick;
+  };
+
+  const MojoTimeTicks tick_duration_;
+  std::vector<std::vector<Entry>> slots_;
+  // The first tick that hasn't been expired yet.
+  int64_t current_tick_;
+  size_t size_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(TimerWheel);
+};
+
+}  // namespace internal
+}  // namespace mojo
+
+#endif  // MOJO_PUBLIC_CPP_BINDINGS_LIB_TIMER_WHEEL_H_
@@ -0,0 +1,132 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/bindings/lib/weak_ref.h"
+
+#include <stddef.h>
+
+#include <atomic>
+
+#include "mojo/public/cpp/environment/logging.h"
+
+namespace mojo {
+namespace internal {
+namespace {
+
+// Slots are allocated in chunks, which are never freed (or moved), so a slot
+// can be read without locking.
+const uint32_t kChunkShift = 10u;
+const uint32_t kChunkSize = 1u << kChunkShift;
+const uint32_t kMaxChunks = 4096u;
+
+struct Slot {
+  // Only changed by the thread that uses the slot's object, but read (to be
+  // compared) on any thread that holds a stale handle.
+  std::atomic<uint32_t> generation;
+  // The next free slot, while this one is free.
+  std::atomic<uint32_t> next_free;
+  void* object;
+};
+
+std::atomic<Slot*> g_chunks[kMaxChunks];
+
+// The number of slots that have ever been handed out.
+std::atomic<uint32_t> g_num_slots(0u);
+
+// The head of the list of free slots (in the low 32 bits), tagged with a
+// counter (in the high 32 bits) that changes on every update, so that a
+// compare-and-swap can't be fooled by a slot that has been taken and put back.
+std::atomic<uint64_t> g_free_list(WeakSlab::kNoSlot);
+
+Slot* GetSlot(uint32_t slot) {
+  return &g_chunks[slot >> kChunkShift].load(std::memory_order_acquire)
+              [slot & (kChunkSize - 1u)];
+}
+
+uint64_t MakeFreeList(uint64_t old_free_list, uint32_t head) {
+  return (((old_free_list >> 32) + 1u) << 32) | head;
+}
+
+uint32_t PopFreeSlot() {
+  uint64_t free_list = g_free_list.load(std::memory_order_acquire);
+  for (;;) {
+    uint32_t slot = static_cast<uint32_t>(free_list);
+    if (slot == WeakSlab::kNoSlot)
+      return WeakSlab::kNoSlot;
+    uint32_t next = GetSlot(slot)->next_free.load(std::memory_order_relaxed);
+    if (g_free_list.compare_exchange_weak(free_list,
+                                          MakeFreeList(free_list, next),
+                                          std::memory_order_acquire)) {
+      return slot;
+    }
+  }
+}
+
+uint32_t NewSlot() {
+  uint32_t slot = g_num_slots.fetch_add(1u, std::memory_order_relaxed);
+  MOJO_CHECK(slot < kMaxChunks * kChunkSize);
+
+  // Allocate the slot's chunk if nobody has yet.
+  std::atomic<Slot*>& chunk = g_chunks[slot >> kChunkShift];
+  if (!chunk.load(std::memory_order_acquire)) {
+    Slot* new_chunk = new Slot[kChunkSize]();
+    Slot* expected = nullptr;
+    if (!chunk.compare_exchange_strong(expected, new_chunk,
+                                       std::memory_order_acq_rel))
+      delete[] new_chunk;
+  }
+  return slot;
+}
+
+}  // namespace
+
+// static
+const uint32_t WeakSlab::kNoSlot;
+
+// static
+WeakSlab::Handle WeakSlab::Acquire(void* object) {
+  uint32_t slot = PopFreeSlot();
+  if (slot == kNoSlot)
+    slot = NewSlot();
+
+  Slot* s = GetSlot(slot);
+  s->object = object;
+  return Handle{slot, s->generation.load(std::memory_order_relaxed)};
+}
+
+// static
+void* WeakSlab::Get(Handle handle) {
+  Slot* s = GetSlot(handle.slot);
+  if (s->generation.load(std::memory_order_relaxed) != handle.generation)
+    return nullptr;
+  return s->object;
+}
+
+// static
+void WeakSlab::Set(Handle handle, void* object) {
+  Slot* s = GetSlot(handle.slot);
+  MOJO_DCHECK(s->generation.load(std::memory_order_relaxed) ==
+              handle.generation);
+  s->object = object;
+}
+
+// static
+void WeakSlab::Release(Handle handle) {
+  Slot* s = GetSlot(handle.slot);
+  MOJO_DCHECK(s->generation.load(std::memory_order_relaxed) ==
+              handle.generation);
+  s->generation.store(handle.generation + 1u, std::memory_order_relaxed);
+  s->object = nullptr;
+
+  uint64_t free_list = g_free_list.load(std::memory_order_relaxed);
+  do {
+    s->next_free.store(static_cast<uint32_t>(free_list),
+                       std::memory_order_relaxed);
+  } while (!g_free_list.compare_exchange_weak(
+      free_list, MakeFreeList(free_list, handle.slot),
+      std::memory_order_release, std::memory_order_relaxed));
+}
+
+}  // namespace internal
+}  // namespace mojo
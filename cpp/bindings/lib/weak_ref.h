@@ -0,0 +1,118 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_PUBLIC_CPP_BINDINGS_LIB_WEAK_REF_H_
+#define MOJO_PUBLIC_CPP_BINDINGS_LIB_WEAK_REF_H_
+
+#include <stdint.h>
+
+#include "mojo/public/cpp/system/macros.h"
+
+namespace mojo {
+namespace internal {
+
+// |WeakSlab| is a process-wide slab of slots, each of which holds a pointer to
+// an object and a generation counter. A slot is acquired for an object, and
+// released (which increments its generation) when the object goes away. A
+// |Handle| (the slot and its generation at the time it was acquired) thus
+// refers to the object until the slot is released, and to nothing afterwards,
+// even once the slot has been reused: checking it is a load and a compare, and
+// copying it is two words, with no reference counting or allocation.
+//
+// Slots are acquired and released without locking, on any thread, and are
+// never freed. (A handle could in theory be fooled once its slot's 32-bit
+// generation has wrapped around.)
+class WeakSlab {
+ public:
+  struct Handle {
+    uint32_t slot;
+    uint32_t generation;
+  };
+
+  // A handle that refers to nothing.
+  static const uint32_t kNoSlot = static_cast<uint32_t>(-1);
+
+  static Handle Acquire(void* object);
+
+  // Returns the object |handle| refers to, or null if its slot has been
+  // released since. Must be called on the thread that uses that object.
+  static void* Get(Handle handle);
+
+  // Makes the (still acquired) slot of |handle| refer to |object| instead.
+  static void Set(Handle handle, void* object);
+
+  static void Release(Handle handle);
+};
+
+// A weak reference to a |T| that owns a |WeakAnchor<T>|. It may be copied
+// freely (it is two words), and yields null once the anchor is gone.
+template <typename T>
+class WeakRef {
+ public:
+  WeakRef() : handle_{WeakSlab::kNoSlot, 0u} {}
+
+  T* get() const {
+    return handle_.slot == WeakSlab::kNoSlot
+               ? nullptr
+               : static_cast<T*>(WeakSlab::Get(handle_));
+  }
+
+ private:
+  template <typename U>
+  friend class WeakAnchor;
+
+  explicit WeakRef(WeakSlab::Handle handle) : handle_(handle) {}
+
+  WeakSlab::Handle handle_;
+};
+
+// A |WeakAnchor<T>| is owned by a |T| (normally as a member) that hands out
+// |WeakRef<T>|s to itself. A slot is only acquired once the first reference is
+// handed out; the references are invalidated when the anchor is destroyed (or
+// |Invalidate()| is called).
+template <typename T>
+class WeakAnchor {
+ public:
+  explicit WeakAnchor(T* object)
+      : object_(object), handle_{WeakSlab::kNoSlot, 0u} {}
+  ~WeakAnchor() { Invalidate(); }
+
+  WeakRef<T> GetRef() {
+    if (handle_.slot == WeakSlab::kNoSlot)
+      handle_ = WeakSlab::Acquire(object_);
+    return WeakRef<T>(handle_);
+  }
+
+  // Invalidates the references handed out so far.
+  void Invalidate() {
+    if (handle_.slot == WeakSlab::kNoSlot)
+      return;
+    WeakSlab::Release(handle_);
+    handle_.slot = WeakSlab::kNoSlot;
+  }
+
+  // Exchanges the references of this anchor and |other|, for owners that swap
+  // their contents: references to this anchor's object then refer to |other|'s
+  // object, and vice versa.
+  void Swap(WeakAnchor* other) {
+    WeakSlab::Handle handle = handle_;
+    handle_ = other->handle_;
+    other->handle_ = handle;
+    if (handle_.slot != WeakSlab::kNoSlot)
+      WeakSlab::Set(handle_, object_);
+    if (other->handle_.slot != WeakSlab::kNoSlot)
+      WeakSlab::Set(other->handle_, other->object_);
+  }
+
+ private:
+  T* const object_;
+  WeakSlab::Handle handle_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(WeakAnchor);
+};
+
+}  // namespace internal
+}  // namespace mojo
+
+#endif  // MOJO_PUBLIC_CPP_BINDINGS_LIB_WEAK_REF_H_
@@ -5,8 +5,11 @@
 #ifndef MOJO_PUBLIC_CPP_BINDINGS_MESSAGE_H_
 #define MOJO_PUBLIC_CPP_BINDINGS_MESSAGE_H_
 
+#include <mojo/system/time.h>
+
 #include <vector>
 
+#include "mojo/public/cpp/bindings/callback.h"
 #include "mojo/public/cpp/bindings/lib/message_internal.h"
 #include "mojo/public/cpp/environment/logging.h"
 
@@ -108,6 +111,34 @@ class MessageReceiverWithResponder : public MessageReceiver {
   //
   virtual bool AcceptWithResponder(Message* message, MessageReceiver* responder)
       MOJO_WARN_UNUSED_RESULT = 0;
+
+  // A variant on AcceptWithResponder that gives up on the response if it
+  // hasn't arrived within |timeout| (in microseconds): |responder| is then
+  // deleted without its Accept method being called, and |timeout_callback| is
+  // run. A response that arrives later is discarded.
+  //
+  // Receivers that don't keep track of time ignore |timeout|, and never run
+  // |timeout_callback|.
+  virtual bool AcceptWithResponderAndTimeout(Message* message,
+                                             MessageReceiver* responder,
+                                             MojoDeadline timeout,
+                                             const Closure& timeout_callback)
+      MOJO_WARN_UNUSED_RESULT {
+    return AcceptWithResponder(message, responder);
+  }
+
+  // A variant on AcceptWithResponder for idempotent requests: if a request
+  // identical to |message| (with the same name and payload) is still awaiting
+  // its response, |message| isn't sent, and |responder| is given a copy of
+  // that response instead. Requests carrying handles are always sent, and their
+  // responses mustn't carry handles.
+  //
+  // Receivers that don't keep track of their requests send every one.
+  virtual bool AcceptWithCoalescedResponder(Message* message,
+                                            MessageReceiver* responder)
+      MOJO_WARN_UNUSED_RESULT {
+    return AcceptWithResponder(message, responder);
+  }
 };
 
 // A MessageReceiver that is also able to provide status about the state
@@ -0,0 +1,67 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_PUBLIC_CPP_BINDINGS_RESPONSE_EXECUTOR_H_
+#define MOJO_PUBLIC_CPP_BINDINGS_RESPONSE_EXECUTOR_H_
+
+#include <mojo/system/time.h>
+#include <stddef.h>
+
+#include "mojo/public/cpp/bindings/inline_callback.h"
+#include "mojo/public/cpp/bindings/lib/multi_producer_queue.h"
+#include "mojo/public/cpp/system/macros.h"
+#include "mojo/public/cpp/system/message_pipe.h"
+
+namespace mojo {
+
+// A |ResponseExecutor| runs the response callbacks for calls made through a
+// |ThreadSafeInterfacePtr|, on a thread of its choosing.
+class ResponseExecutor {
+ public:
+  virtual ~ResponseExecutor() {}
+
+  // Runs |task|, now or later, on a thread of the executor's choosing. (It may
+  // instead destroy |task| without running it, e.g., when the executor itself
+  // is destroyed.) Called on the thread that the |ThreadSafeInterfacePtr| is
+  // bound on.
+  virtual void Execute(InlineClosure task) = 0;
+};
+
+// A |ResponseExecutor| that queues tasks until the thread that owns it runs
+// them, e.g., a worker thread that makes calls through a
+// |ThreadSafeInterfacePtr| and then waits for their responses. Tasks may be
+// queued from any thread, without locking; all other methods must be called on
+// the owning thread. Tasks still queued on destruction are destroyed without
+// being run.
+class ResponseQueue : public ResponseExecutor {
+ public:
+  ResponseQueue();
+  ~ResponseQueue() override;
+
+  // May be called on any thread.
+  void Execute(InlineClosure task) override;
+
+  // Runs the tasks queued so far, in the order they were queued. Returns the
+  // number of tasks run.
+  size_t RunPendingTasks();
+
+  // Blocks until at least one task has been run, or until no task has been
+  // queued for |deadline| microseconds. Returns the number of tasks run.
+  size_t WaitAndRunPendingTasks(
+      MojoDeadline deadline = MOJO_DEADLINE_INDEFINITE);
+
+ private:
+  internal::MultiProducerQueue<InlineClosure> tasks_;
+
+  // A message is written to |wake_sender_| whenever a task is queued while
+  // |tasks_| is empty, so that the owning thread can wait on |wake_receiver_|.
+  ScopedMessagePipeHandle wake_sender_;
+  ScopedMessagePipeHandle wake_receiver_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(ResponseQueue);
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_PUBLIC_CPP_BINDINGS_RESPONSE_EXECUTOR_H_
@@ -7,11 +7,10 @@
 
 #include <assert.h>
 
-#include <algorithm>
 #include <memory>
-#include <vector>
 
 #include "mojo/public/cpp/bindings/binding.h"
+#include "mojo/public/cpp/bindings/lib/slot_map.h"
 #include "mojo/public/cpp/system/macros.h"
 
 namespace mojo {
@@ -29,44 +28,37 @@ class StrongBindingSet {
   // a connection error occurs.  Takes ownership of |impl|, which
   // will be deleted when the binding is closed.
   void AddBinding(Interface* impl, InterfaceRequest<Interface> request) {
-    bindings_.emplace_back(new Binding<Interface>(impl, request.Pass()));
-    auto* binding = bindings_.back().get();
+    auto key = bindings_.Insert(std::unique_ptr<Binding<Interface>>(
+        new Binding<Interface>(impl, request.Pass())));
     // Set the connection error handler for the newly added Binding to be a
-    // function that will erase it from the vector.
-    binding->set_connection_error_handler([this, binding]() {
-      auto it =
-          std::find_if(bindings_.begin(), bindings_.end(),
-                       [binding](const std::unique_ptr<Binding<Interface>>& b) {
-                         return (b.get() == binding);
-                       });
-      assert(it != bindings_.end());
-      delete binding->impl();
-      bindings_.erase(it);
+    // function that will remove it from the set (in constant time).
+    (*bindings_.Find(key))->set_connection_error_handler([this, key]() {
+      auto* binding = bindings_.Find(key);
+      assert(binding);
+      delete (*binding)->impl();
+      bindings_.Remove(key);
     });
   }
 
   // Removes all bindings for the specified interface implementation.
   // The implementation object is not destroyed.
   void RemoveBindings(Interface* impl) {
-    bindings_.erase(
-        std::remove_if(bindings_.begin(), bindings_.end(),
-                       [impl](const std::unique_ptr<Binding<Interface>>& b) {
-                         return (b->impl() == impl);
-                       }));
+    bindings_.RemoveIf([impl](const std::unique_ptr<Binding<Interface>>& b) {
+      return (b->impl() == impl);
+    });
   }
 
   // Closes all bindings and deletes their associated interfaces.
   void CloseAllBindings() {
-    for (auto it = bindings_.begin(); it != bindings_.end(); ++it) {
-      delete (*it)->impl();
-    }
-    bindings_.clear();
+    for (const auto& binding : bindings_)
+      delete binding->impl();
+    bindings_.Clear();
   }
 
   size_t size() const { return bindings_.size(); }
 
  private:
-  std::vector<std::unique_ptr<Binding<Interface>>> bindings_;
+  internal::SlotMap<std::unique_ptr<Binding<Interface>>> bindings_;
 
   MOJO_DISALLOW_COPY_AND_ASSIGN(StrongBindingSet);
 };
@@ -5,6 +5,8 @@
 // Note: This file tests both binding.h (mojo::Binding) and strong_binding.h
 // (mojo::StrongBinding).
 
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "mojo/public/cpp/bindings/binding.h"
 #include "mojo/public/cpp/bindings/strong_binding.h"
@@ -220,6 +222,44 @@ TEST_F(BindingTest, SetInterfaceHandleVersion) {
   EXPECT_EQ(3u, handle.version());
 }
 
+class PrioritizedLogImpl : public sample::PrioritizedLog {
+ public:
+  PrioritizedLogImpl() {}
+  ~PrioritizedLogImpl() override {}
+
+  const std::vector<int32_t>& values() const { return values_; }
+
+ private:
+  // sample::PrioritizedLog implementation.
+  void Log(int32_t value) override { values_.push_back(value); }
+  void LogUrgent(int32_t value) override { values_.push_back(value); }
+
+  std::vector<int32_t> values_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(PrioritizedLogImpl);
+};
+
+// Tests that with scheduled dispatch enabled, queued calls to methods with a
+// higher [Priority] are dispatched first, and calls of equal priority stay in
+// order.
+TEST_F(BindingTest, ScheduledDispatchPriority) {
+  PrioritizedLogImpl impl;
+  sample::PrioritizedLogPtr ptr;
+  Binding<sample::PrioritizedLog> binding(&impl, GetProxy(&ptr));
+  binding.EnableScheduledDispatch(1u, 10u);
+
+  ptr->Log(1);
+  ptr->Log(2);
+  ptr->LogUrgent(3);
+  ptr->Log(4);
+  ptr->LogUrgent(5);
+  loop().RunUntilIdle();
+
+  EXPECT_EQ((std::vector<int32_t>{3, 5, 1, 2, 4}), impl.values());
+  EXPECT_EQ(5u, binding.dispatch_stats().num_messages_dispatched);
+  EXPECT_EQ(5u, binding.dispatch_stats().max_queue_depth);
+}
+
 // StrongBindingTest -----------------------------------------------------------
 
 using StrongBindingTest = BindingTestBase;
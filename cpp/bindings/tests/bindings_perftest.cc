@@ -2,11 +2,21 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "mojo/public/cpp/bindings/binding.h"
+#include "mojo/public/cpp/bindings/binding_set.h"
+#include "mojo/public/cpp/bindings/interface_ptr_set.h"
+#include "mojo/public/cpp/bindings/synchronous_interface_ptr.h"
 #include "mojo/public/cpp/test_support/test_support.h"
 #include "mojo/public/cpp/utility/run_loop.h"
+#include "mojo/public/interfaces/bindings/tests/ping_service.mojom-sync.h"
 #include "mojo/public/interfaces/bindings/tests/ping_service.mojom.h"
+#include "mojo/public/interfaces/bindings/tests/sample_factory.mojom.h"
 
 namespace mojo {
 namespace {
@@ -116,5 +126,168 @@ TEST_F(MojoBindingsPerftest, InProcessPingPong) {
   }
 }
 
+// Runs a |PingService| on its own thread, with its own |RunLoop|, until the
+// other end of |request| is closed.
+void RunPingService(InterfaceRequest<test::PingService> request) {
+  RunLoop loop;
+  PingServiceImpl impl;
+  Binding<test::PingService> binding(&impl, request.Pass());
+  binding.set_connection_error_handler([&loop]() { loop.Quit(); });
+  loop.Run();
+}
+
+// Pings a service on another thread through a |SynchronousInterfacePtr|, first
+// waiting for each response before sending the next ping, then keeping up to
+// |kBatchSize| pings in flight at a time.
+TEST_F(MojoBindingsPerftest, SynchronousPingPong) {
+  const unsigned int kIterations = 10000;
+  const unsigned int kBatchSize = 16;
+
+  SynchronousInterfacePtr<test::PingService> service;
+  std::thread server(RunPingService, GetSynchronousProxy(&service));
+
+  MojoTimeTicks start_time = MojoGetTimeTicksNow();
+  for (unsigned int i = 0; i < kIterations; i++)
+    ASSERT_TRUE(service->Ping());
+  MojoTimeTicks end_time = MojoGetTimeTicksNow();
+  test::LogPerfResult("SynchronousPingPong", "Blocking",
+                      kIterations / MojoTicksToSeconds(end_time - start_time),
+                      "pings/second");
+
+  start_time = MojoGetTimeTicksNow();
+  uint64_t request_ids[kBatchSize];
+  for (unsigned int i = 0; i < kIterations; i += kBatchSize) {
+    for (unsigned int j = 0; j < kBatchSize; j++)
+      ASSERT_TRUE(service->BeginPing(&request_ids[j]));
+    for (unsigned int j = 0; j < kBatchSize; j++)
+      ASSERT_TRUE(service->EndPing(request_ids[j], MOJO_DEADLINE_INDEFINITE));
+  }
+  end_time = MojoGetTimeTicksNow();
+  test::LogPerfResult("SynchronousPingPong", "Pipelined",
+                      kIterations / MojoTicksToSeconds(end_time - start_time),
+                      "pings/second");
+
+  service.reset();
+  server.join();
+}
+
+const size_t kNumChurnClients = 100000;
+
+void LogChurnResult(const char* test_name,
+                    const char* sub_test_name,
+                    MojoTimeTicks start_time,
+                    MojoTimeTicks end_time) {
+  test::LogPerfResult(
+      test_name, sub_test_name,
+      kNumChurnClients / MojoTicksToSeconds(end_time - start_time),
+      "clients/second");
+}
+
+// Connects |kNumChurnClients| clients to a |BindingSet|, then disconnects them
+// from the front, so each removal comes from the start of the set.
+TEST_F(MojoBindingsPerftest, BindingSetChurn) {
+  PingServiceImpl impl;
+  BindingSet<test::PingService> binding_set;
+  std::vector<test::PingServicePtr> clients(kNumChurnClients);
+
+  MojoTimeTicks start_time = MojoGetTimeTicksNow();
+  for (auto& client : clients)
+    binding_set.AddBinding(&impl, GetProxy(&client));
+  MojoTimeTicks end_time = MojoGetTimeTicksNow();
+  LogChurnResult("BindingSetChurn", "Connect", start_time, end_time);
+
+  start_time = MojoGetTimeTicksNow();
+  for (auto& client : clients)
+    client.reset();
+  run_loop_.RunUntilIdle();
+  end_time = MojoGetTimeTicksNow();
+  EXPECT_EQ(0u, binding_set.size());
+  LogChurnResult("BindingSetChurn", "Disconnect", start_time, end_time);
+}
+
+// Like |BindingSetChurn|, but for an |InterfacePtrSet| whose bindings go away.
+TEST_F(MojoBindingsPerftest, InterfacePtrSetChurn) {
+  InterfacePtrSet<test::PingService> ptr_set;
+  std::vector<InterfaceRequest<test::PingService>> requests(kNumChurnClients);
+
+  MojoTimeTicks start_time = MojoGetTimeTicksNow();
+  for (auto& request : requests) {
+    test::PingServicePtr ptr;
+    request = GetProxy(&ptr);
+    ptr_set.AddInterfacePtr(ptr.Pass());
+  }
+  MojoTimeTicks end_time = MojoGetTimeTicksNow();
+  LogChurnResult("InterfacePtrSetChurn", "Connect", start_time, end_time);
+
+  start_time = MojoGetTimeTicksNow();
+  for (auto& request : requests)
+    request = nullptr;
+  run_loop_.RunUntilIdle();
+  end_time = MojoGetTimeTicksNow();
+  EXPECT_EQ(0u, ptr_set.size());
+  LogChurnResult("InterfacePtrSetChurn", "Disconnect", start_time, end_time);
+}
+
+class NamedObjectImpl : public sample::NamedObject {
+ public:
+  NamedObjectImpl() {}
+  ~NamedObjectImpl() override {}
+
+  // |NamedObject| methods:
+  void SetName(const String& name) override { set_name_count_++; }
+  void GetName(const Callback<void(String)>& callback) override {}
+
+  size_t set_name_count() const { return set_name_count_; }
+
+ private:
+  size_t set_name_count_ = 0u;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(NamedObjectImpl);
+};
+
+// Sends the same event to 10000 subscribers, once through |ForAllPtrs()|
+// (serializing it for each subscriber) and once through |Broadcast()|
+// (serializing it once).
+TEST_F(MojoBindingsPerftest, InterfacePtrSetFanOut) {
+  const size_t kNumSubscribers = 10000;
+  const unsigned int kIterations = 10;
+  const String kEvent(std::string(1024, 'x'));
+
+  NamedObjectImpl impl;
+  BindingSet<sample::NamedObject> binding_set;
+  InterfacePtrSet<sample::NamedObject> ptr_set;
+  for (size_t i = 0; i < kNumSubscribers; i++) {
+    sample::NamedObjectPtr ptr;
+    binding_set.AddBinding(&impl, GetProxy(&ptr));
+    ptr_set.AddInterfacePtr(ptr.Pass());
+  }
+
+  MojoTimeTicks start_time = MojoGetTimeTicksNow();
+  for (unsigned int i = 0; i < kIterations; i++) {
+    ptr_set.ForAllPtrs(
+        [&kEvent](sample::NamedObject* object) { object->SetName(kEvent); });
+  }
+  MojoTimeTicks end_time = MojoGetTimeTicksNow();
+  test::LogPerfResult(
+      "InterfacePtrSetFanOut", "ForAllPtrs",
+      kNumSubscribers * kIterations / MojoTicksToSeconds(end_time - start_time),
+      "messages/second");
+  run_loop_.RunUntilIdle();
+  EXPECT_EQ(kNumSubscribers * kIterations, impl.set_name_count());
+
+  start_time = MojoGetTimeTicksNow();
+  for (unsigned int i = 0; i < kIterations; i++) {
+    ptr_set.Broadcast(
+        [&kEvent](sample::NamedObject* object) { object->SetName(kEvent); });
+  }
+  end_time = MojoGetTimeTicksNow();
+  test::LogPerfResult(
+      "InterfacePtrSetFanOut", "Broadcast",
+      kNumSubscribers * kIterations / MojoTicksToSeconds(end_time - start_time),
+      "messages/second");
+  run_loop_.RunUntilIdle();
+  EXPECT_EQ(2u * kNumSubscribers * kIterations, impl.set_name_count());
+}
+
 }  // namespace
 }  // namespace mojo
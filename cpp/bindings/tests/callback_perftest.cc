@@ -0,0 +1,118 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file has microbenchmarks comparing |Callback| with |InlineCallback|, for
+// the things the bindings do with a response callback: create one from a
+// lambda (or runnable), hand it over a couple of times, run it and destroy it.
+// Each test reports the time per callback.
+
+#include <mojo/system/time.h>
+#include <stdint.h>
+
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "mojo/public/cpp/bindings/callback.h"
+#include "mojo/public/cpp/bindings/inline_callback.h"
+#include "mojo/public/cpp/test_support/test_support.h"
+
+namespace mojo {
+namespace {
+
+constexpr unsigned kIterations = 1000000u;
+
+void LogTimePerCallback(const char* test_name,
+                        const char* sub_test_name,
+                        MojoTimeTicks start_time,
+                        MojoTimeTicks end_time) {
+  test::LogPerfResult(test_name, sub_test_name,
+                      (end_time - start_time) * 1000.0 / kIterations,
+                      "ns/callback");
+}
+
+// Stands in for a generated |ProxyToResponder|.
+struct Responder {
+  void Run(uint32_t value) const { *sum += value + request_id; }
+
+  uint64_t request_id;
+  uint64_t* sum;
+};
+
+// Passes |callback| on the way the bindings do (e.g., into a
+// |ForwardToCallback|), then runs it.
+void PassAndRun(const Callback<void(uint32_t)>& callback, uint32_t value) {
+  Callback<void(uint32_t)> stored(callback);
+  stored.Run(value);
+}
+
+void PassAndRun(InlineCallback<void(uint32_t)> callback, uint32_t value) {
+  InlineCallback<void(uint32_t)> stored(std::move(callback));
+  stored.Run(value);
+}
+
+template <typename CallbackType>
+void DoLambdaTest(const char* sub_test_name) {
+  uint64_t sum = 0u;
+  uint64_t bias = 1u;
+  const MojoTimeTicks start_time = MojoGetTimeTicksNow();
+  for (unsigned i = 0u; i < kIterations; i++) {
+    CallbackType callback = [&sum, &bias](uint32_t value) {
+      sum += value + bias;
+    };
+    PassAndRun(std::move(callback), i);
+  }
+  const MojoTimeTicks end_time = MojoGetTimeTicksNow();
+  EXPECT_NE(0u, sum);
+  LogTimePerCallback("CallbackPerftest.Lambda", sub_test_name, start_time,
+                     end_time);
+}
+
+template <typename CallbackType>
+void DoRunnableTest(const char* sub_test_name) {
+  uint64_t sum = 0u;
+  const MojoTimeTicks start_time = MojoGetTimeTicksNow();
+  for (unsigned i = 0u; i < kIterations; i++) {
+    CallbackType callback = Responder{i, &sum};
+    PassAndRun(std::move(callback), i);
+  }
+  const MojoTimeTicks end_time = MojoGetTimeTicksNow();
+  EXPECT_NE(0u, sum);
+  LogTimePerCallback("CallbackPerftest.Runnable", sub_test_name, start_time,
+                     end_time);
+}
+
+TEST(CallbackPerftest, Lambda) {
+  DoLambdaTest<Callback<void(uint32_t)>>("Callback");
+  DoLambdaTest<InlineCallback<void(uint32_t)>>("InlineCallback");
+}
+
+TEST(CallbackPerftest, Runnable) {
+  DoRunnableTest<Callback<void(uint32_t)>>("Callback");
+  DoRunnableTest<InlineCallback<void(uint32_t)>>("InlineCallback");
+}
+
+// Only runs an existing callback (which both kinds do with one indirect call).
+TEST(CallbackPerftest, Run) {
+  uint64_t sum = 0u;
+  Callback<void(uint32_t)> callback = [&sum](uint32_t value) { sum += value; };
+  MojoTimeTicks start_time = MojoGetTimeTicksNow();
+  for (unsigned i = 0u; i < kIterations; i++)
+    callback.Run(i);
+  MojoTimeTicks end_time = MojoGetTimeTicksNow();
+  LogTimePerCallback("CallbackPerftest.Run", "Callback", start_time, end_time);
+
+  InlineCallback<void(uint32_t)> inline_callback = [&sum](uint32_t value) {
+    sum += value;
+  };
+  start_time = MojoGetTimeTicksNow();
+  for (unsigned i = 0u; i < kIterations; i++)
+    inline_callback.Run(i);
+  end_time = MojoGetTimeTicksNow();
+  EXPECT_NE(0u, sum);
+  LogTimePerCallback("CallbackPerftest.Run", "InlineCallback", start_time,
+                     end_time);
+}
+
+}  // namespace
+}  // namespace mojo
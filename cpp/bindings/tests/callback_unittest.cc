@@ -2,8 +2,12 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <memory>
+#include <utility>
+
 #include "gtest/gtest.h"
 #include "mojo/public/cpp/bindings/callback.h"
+#include "mojo/public/cpp/bindings/inline_callback.h"
 #include "mojo/public/cpp/bindings/map.h"
 #include "mojo/public/cpp/bindings/string.h"
 
@@ -160,6 +164,136 @@ TEST(Callback, CreateFromOverloadedFunctionPtr) {
   g_overloaded_function_with_double_param_called = false;
 }
 
+// Tests constructing and invoking a mojo::InlineCallback from runnables,
+// lambdas, function pointers and mojo::Callbacks.
+TEST(InlineCallback, Create) {
+  int calls = 0;
+
+  InlineCallback<void()> cb;
+  EXPECT_TRUE(cb.is_null());
+  // Running a null callback does nothing.
+  cb.Run();
+
+  cb = RunnableNoArgs(&calls);
+  EXPECT_FALSE(cb.is_null());
+  cb.Run();
+  EXPECT_EQ(1, calls);
+
+  cb = [&calls]() { calls++; };
+  cb.Run();
+  EXPECT_EQ(2, calls);
+
+  InlineCallback<void(int)> cb_with_param = RunnableOneArg(&calls);
+  cb_with_param.Run(1);
+  EXPECT_EQ(3, calls);
+
+  InlineCallback<void(String)> cb_with_string_param =
+      [&calls](const String& s) { calls++; };
+  cb_with_string_param.Run(String("hello world"));
+  EXPECT_EQ(4, calls);
+
+  ExampleMoveOnlyType m;
+  InlineCallback<void(ExampleMoveOnlyType)> cb_with_move_only_param =
+      [&calls](ExampleMoveOnlyType m) { calls++; };
+  cb_with_move_only_param.Run(m.Clone());
+  EXPECT_EQ(5, calls);
+
+  g_calls = &calls;
+  cb = &FunctionNoArgs;
+  cb.Run();
+  EXPECT_EQ(6, calls);
+  g_calls = nullptr;
+
+  g_overloaded_function_with_int_param_called = false;
+  cb_with_param = &OverloadedFunction;
+  cb_with_param.Run(123);
+  EXPECT_TRUE(g_overloaded_function_with_int_param_called);
+  g_overloaded_function_with_int_param_called = false;
+
+  mojo::Callback<void(int)> callback = [&calls](int increment) {
+    calls += increment;
+  };
+  cb_with_param = callback;
+  cb_with_param.Run(2);
+  EXPECT_EQ(8, calls);
+
+  cb.reset();
+  EXPECT_TRUE(cb.is_null());
+}
+
+// Counts the live instances of itself (or, since it is only ever moved, of
+// the sink it represents).
+class CountedSink {
+ public:
+  CountedSink(int* live, int* calls) : live_(live), calls_(calls) {
+    (*live_)++;
+  }
+  CountedSink(CountedSink&& other) : live_(other.live_), calls_(other.calls_) {
+    other.live_ = nullptr;
+  }
+  ~CountedSink() {
+    if (live_)
+      (*live_)--;
+  }
+
+  void operator()() const { (*calls_)++; }
+
+ private:
+  int* live_;
+  int* calls_;
+  // Makes it move-only.
+  std::unique_ptr<int> unused_;
+};
+
+// Like |CountedSink|, but too large to be stored inline.
+class LargeCountedSink : public CountedSink {
+ public:
+  LargeCountedSink(int* live, int* calls) : CountedSink(live, calls) {}
+  LargeCountedSink(LargeCountedSink&& other)
+      : CountedSink(std::move(other)) {}
+
+ private:
+  char padding_[2 * kDefaultInlineCallbackSize];
+};
+
+template <typename Sink>
+void TestMoveOnlySink() {
+  int live = 0;
+  int calls = 0;
+  {
+    InlineClosure cb = Sink(&live, &calls);
+    EXPECT_EQ(1, live);
+
+    // Moving the callback moves its sink; the moved-from callback becomes null.
+    InlineClosure cb2(std::move(cb));
+    EXPECT_TRUE(cb.is_null());
+    EXPECT_EQ(1, live);
+    cb2.Run();
+    EXPECT_EQ(1, calls);
+
+    cb = std::move(cb2);
+    EXPECT_TRUE(cb2.is_null());
+    cb.Run();
+    EXPECT_EQ(2, calls);
+
+    // Replacing the sink destroys the old one.
+    cb = Sink(&live, &calls);
+    EXPECT_EQ(1, live);
+    cb.reset();
+    EXPECT_EQ(0, live);
+
+    cb = Sink(&live, &calls);
+  }
+  // Destroying the callback destroys its sink.
+  EXPECT_EQ(0, live);
+}
+
+// Tests that InlineCallback takes move-only sinks, stored inline or not.
+TEST(InlineCallback, MoveOnlySink) {
+  TestMoveOnlySink<CountedSink>();
+  TestMoveOnlySink<LargeCountedSink>();
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace mojo
@@ -5,7 +5,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <memory>
 #include <string>
+#include <thread>
 
 #include "gtest/gtest.h"
 #include "mojo/public/cpp/bindings/lib/connector.h"
@@ -30,8 +32,12 @@ class ConnectorTest : public testing::Test {
   void TearDown() override {}
 
   void AllocMessage(const char* text, Message* message) {
+    AllocMessage(1u, text, message);
+  }
+
+  void AllocMessage(uint32_t name, const char* text, Message* message) {
     size_t payload_size = strlen(text) + 1;  // Plus null terminator.
-    MessageBuilder builder(1, payload_size);
+    MessageBuilder builder(name, payload_size);
     memcpy(builder.buffer()->Allocate(payload_size), text, payload_size);
 
     builder.message()->MoveTo(message);
@@ -464,6 +470,178 @@ TEST_F(ConnectorTest, DISABLED_NoTaskStarvation) {
   EXPECT_GE(replier.num_accepted(), 10u);
 }
 
+// With scheduled dispatch, the same test shouldn't starve the run loop.
+TEST_F(ConnectorTest, NoTaskStarvation_ScheduledDispatch) {
+  internal::Connector connector0(handle0_.Pass());
+  internal::Connector connector1(handle1_.Pass());
+  connector1.EnableScheduledDispatch(1u, 1u, nullptr);
+
+  NoTaskStarvationReplier replier(&connector0);
+  connector1.set_incoming_receiver(&replier);
+
+  MessageBuilder builder(1u, 0u);
+  ASSERT_TRUE(connector0.Accept(builder.message()));
+
+  PumpMessages();
+
+  EXPECT_GE(replier.num_accepted(), 10u);
+  EXPECT_GT(connector1.dispatch_stats().num_yields, 0u);
+}
+
+int32_t PriorityOfNameTwo(uint32_t name) {
+  return name == 2u ? 1 : 0;
+}
+
+TEST_F(ConnectorTest, ScheduledDispatch_Priority) {
+  internal::Connector connector0(handle0_.Pass());
+  internal::Connector connector1(handle1_.Pass());
+  connector1.EnableScheduledDispatch(10u, 10u, &PriorityOfNameTwo);
+
+  const char* const kText[] = {"a", "b", "urgent"};
+  const uint32_t kName[] = {1u, 1u, 2u};
+
+  for (size_t i = 0; i < MOJO_ARRAYSIZE(kText); ++i) {
+    Message message;
+    AllocMessage(kName[i], kText[i], &message);
+    connector0.Accept(&message);
+  }
+
+  MessageAccumulator accumulator;
+  connector1.set_incoming_receiver(&accumulator);
+
+  PumpMessages();
+
+  // The message with the higher priority is dispatched first; the others keep
+  // their order.
+  const char* const kExpectedText[] = {"urgent", "a", "b"};
+  for (size_t i = 0; i < MOJO_ARRAYSIZE(kExpectedText); ++i) {
+    ASSERT_FALSE(accumulator.IsEmpty());
+
+    Message message_received;
+    accumulator.Pop(&message_received);
+
+    EXPECT_EQ(
+        std::string(kExpectedText[i]),
+        std::string(reinterpret_cast<const char*>(message_received.payload())));
+  }
+  EXPECT_TRUE(accumulator.IsEmpty());
+
+  EXPECT_EQ(3u, connector1.dispatch_stats().num_messages_dispatched);
+  EXPECT_EQ(3u, connector1.dispatch_stats().max_queue_depth);
+  EXPECT_EQ(0u, connector1.dispatch_stats().queue_depth);
+}
+
+TEST_F(ConnectorTest, ScheduledDispatch_Yields) {
+  internal::Connector connector0(handle0_.Pass());
+  internal::Connector connector1(handle1_.Pass());
+  connector1.EnableScheduledDispatch(2u, 4u, nullptr);
+
+  const size_t kNumMessages = 10u;
+  for (size_t i = 0; i < kNumMessages; ++i) {
+    Message message;
+    AllocMessage(std::to_string(i).c_str(), &message);
+    connector0.Accept(&message);
+  }
+
+  MessageAccumulator accumulator;
+  connector1.set_incoming_receiver(&accumulator);
+
+  PumpMessages();
+
+  for (size_t i = 0; i < kNumMessages; ++i) {
+    ASSERT_FALSE(accumulator.IsEmpty());
+
+    Message message_received;
+    accumulator.Pop(&message_received);
+
+    EXPECT_EQ(
+        std::to_string(i),
+        std::string(reinterpret_cast<const char*>(message_received.payload())));
+  }
+  EXPECT_TRUE(accumulator.IsEmpty());
+
+  EXPECT_EQ(kNumMessages, connector1.dispatch_stats().num_messages_dispatched);
+  EXPECT_GT(connector1.dispatch_stats().num_yields, 0u);
+  EXPECT_LE(connector1.dispatch_stats().max_queue_depth, 4u);
+}
+
+// Messages that were queued when the peer was closed are still dispatched
+// before the error is reported.
+TEST_F(ConnectorTest, ScheduledDispatch_PeerClosed) {
+  internal::Connector connector1(handle1_.Pass());
+  connector1.EnableScheduledDispatch(1u, 4u, nullptr);
+
+  {
+    internal::Connector connector0(handle0_.Pass());
+    const char* const kText[] = {"hello", "world"};
+    for (size_t i = 0; i < MOJO_ARRAYSIZE(kText); ++i) {
+      Message message;
+      AllocMessage(kText[i], &message);
+      connector0.Accept(&message);
+    }
+  }
+
+  MessageAccumulator accumulator;
+  connector1.set_incoming_receiver(&accumulator);
+
+  PumpMessages();
+
+  EXPECT_EQ(2u, connector1.dispatch_stats().num_messages_dispatched);
+  EXPECT_TRUE(connector1.encountered_error());
+}
+
+// Quits the current run loop whenever it accepts a message.
+class QuittingMessageAccumulator : public MessageAccumulator {
+ public:
+  QuittingMessageAccumulator() {}
+
+  bool Accept(Message* message) override {
+    RunLoop::current()->Quit();
+    return MessageAccumulator::Accept(message);
+  }
+
+ private:
+  MOJO_DISALLOW_COPY_AND_ASSIGN(QuittingMessageAccumulator);
+};
+
+// Messages that are still queued when the run loop is destroyed aren't
+// dispatched (during its destruction); the error is reported right away.
+TEST_F(ConnectorTest, ScheduledDispatch_RunLoopDestroyed) {
+  internal::Connector connector0(handle0_.Pass());
+  const char* const kText[] = {"hello", "world", "again"};
+  for (size_t i = 0; i < MOJO_ARRAYSIZE(kText); ++i) {
+    Message message;
+    AllocMessage(kText[i], &message);
+    connector0.Accept(&message);
+  }
+
+  QuittingMessageAccumulator accumulator;
+  bool encountered_error = false;
+  ScopedMessagePipeHandle handle1 = handle1_.Pass();
+  // The run loop is destroyed on another thread, which has its own.
+  std::thread thread([&accumulator, &encountered_error, &handle1]() {
+    std::unique_ptr<internal::Connector> connector1;
+    {
+      RunLoop loop;
+      connector1.reset(new internal::Connector(handle1.Pass()));
+      connector1->EnableScheduledDispatch(1u, 4u, nullptr);
+      connector1->set_incoming_receiver(&accumulator);
+      connector1->set_connection_error_handler(
+          [&encountered_error]() { encountered_error = true; });
+
+      // This quits after the first message, leaving the others queued.
+      loop.Run();
+      EXPECT_EQ(1u, connector1->dispatch_stats().num_messages_dispatched);
+      EXPECT_EQ(2u, connector1->dispatch_stats().queue_depth);
+    }
+    EXPECT_EQ(1u, connector1->dispatch_stats().num_messages_dispatched);
+    EXPECT_TRUE(connector1->encountered_error());
+  });
+  thread.join();
+
+  EXPECT_TRUE(encountered_error);
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace mojo
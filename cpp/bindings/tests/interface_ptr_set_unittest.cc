@@ -4,11 +4,14 @@
 
 #include "mojo/public/cpp/bindings/interface_ptr_set.h"
 
+#include <string>
+
 #include "gtest/gtest.h"
 #include "mojo/public/cpp/bindings/binding.h"
 #include "mojo/public/cpp/system/macros.h"
 #include "mojo/public/cpp/utility/run_loop.h"
 #include "mojo/public/interfaces/bindings/tests/minimal_interface.mojom.h"
+#include "mojo/public/interfaces/bindings/tests/sample_factory.mojom.h"
 
 namespace mojo {
 namespace common {
@@ -33,6 +36,31 @@ class MinimalInterfaceImpl : public test::MinimalInterface {
   MOJO_DISALLOW_COPY_AND_ASSIGN(MinimalInterfaceImpl);
 };
 
+class NamedObjectImpl : public sample::NamedObject {
+ public:
+  explicit NamedObjectImpl(InterfaceRequest<sample::NamedObject> request)
+      : binding_(this, request.Pass()) {}
+
+  void SetName(const mojo::String& name) override {
+    name_ = name;
+    set_name_count_++;
+  }
+
+  void GetName(const mojo::Callback<void(mojo::String)>& callback) override {
+    callback.Run(name_);
+  }
+
+  const std::string& name() const { return name_; }
+  int set_name_count() const { return set_name_count_; }
+
+ private:
+  Binding<sample::NamedObject> binding_;
+  std::string name_;
+  int set_name_count_ = 0;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(NamedObjectImpl);
+};
+
 // Tests all of the functionality of InterfacePtrSet.
 TEST(InterfacePtrSetTest, FullLifeCycle) {
   RunLoop loop;
@@ -113,6 +141,91 @@ TEST(InterfacePtrSetTest, FullLifeCycle) {
   EXPECT_EQ(0u, intrfc_ptr_set.size());
 }
 
+// Tests that Broadcast() delivers the same method calls to every InterfacePtr.
+TEST(InterfacePtrSetTest, Broadcast) {
+  RunLoop loop;
+
+  const size_t kNumObjects = 10;
+  InterfacePtrSet<sample::NamedObject> intrfc_ptr_set;
+  std::unique_ptr<NamedObjectImpl> impls[kNumObjects];
+  for (size_t i = 0; i < kNumObjects; i++) {
+    sample::NamedObjectPtr ptr;
+    impls[i].reset(new NamedObjectImpl(GetProxy(&ptr)));
+    intrfc_ptr_set.AddInterfacePtr(ptr.Pass());
+  }
+
+  EXPECT_TRUE(intrfc_ptr_set.Broadcast([](sample::NamedObject* object) {
+    object->SetName("first");
+    object->SetName("second");
+  }));
+  loop.RunUntilIdle();
+  for (const std::unique_ptr<NamedObjectImpl>& impl : impls) {
+    EXPECT_EQ(2, impl->set_name_count());
+    EXPECT_EQ("second", impl->name());
+  }
+
+  // Closed pipes are skipped.
+  impls[0].reset();
+  loop.RunUntilIdle();
+  EXPECT_EQ(kNumObjects - 1, intrfc_ptr_set.size());
+  EXPECT_TRUE(intrfc_ptr_set.Broadcast(
+      [](sample::NamedObject* object) { object->SetName("third"); }));
+  loop.RunUntilIdle();
+  for (size_t i = 1; i < kNumObjects; i++) {
+    EXPECT_EQ(3, impls[i]->set_name_count());
+    EXPECT_EQ("third", impls[i]->name());
+  }
+}
+
+// Tests that a message held back by flow control on one InterfacePtr is still
+// delivered intact to the InterfacePtrs after it.
+TEST(InterfacePtrSetTest, BroadcastWithFlowControl) {
+  RunLoop loop;
+
+  const size_t kNumObjects = 3;
+  InterfacePtrSet<sample::NamedObject> intrfc_ptr_set;
+  std::unique_ptr<NamedObjectImpl> impls[kNumObjects];
+  for (size_t i = 0; i < kNumObjects; i++) {
+    sample::NamedObjectPtr ptr;
+    impls[i].reset(new NamedObjectImpl(GetProxy(&ptr)));
+    // With a window of one, the first InterfacePtr holds the second message
+    // until its credit comes back.
+    if (i == 0)
+      ptr.EnableFlowControl(1u);
+    intrfc_ptr_set.AddInterfacePtr(ptr.Pass());
+  }
+
+  EXPECT_TRUE(intrfc_ptr_set.Broadcast([](sample::NamedObject* object) {
+    object->SetName("first");
+    object->SetName("second");
+  }));
+  loop.RunUntilIdle();
+  for (const std::unique_ptr<NamedObjectImpl>& impl : impls) {
+    EXPECT_EQ(2, impl->set_name_count());
+    EXPECT_EQ("second", impl->name());
+  }
+}
+
+// Tests that Broadcast() refuses to send methods that expect responses.
+TEST(InterfacePtrSetTest, BroadcastWithResponse) {
+  RunLoop loop;
+
+  sample::NamedObjectPtr ptr;
+  NamedObjectImpl impl(GetProxy(&ptr));
+  InterfacePtrSet<sample::NamedObject> intrfc_ptr_set;
+  intrfc_ptr_set.AddInterfacePtr(ptr.Pass());
+
+  bool called = false;
+  EXPECT_FALSE(
+      intrfc_ptr_set.Broadcast([&called](sample::NamedObject* object) {
+        object->SetName("name");
+        object->GetName([&called](const mojo::String&) { called = true; });
+      }));
+  loop.RunUntilIdle();
+  EXPECT_EQ(0, impl.set_name_count());
+  EXPECT_FALSE(called);
+}
+
 }  // namespace
 }  // namespace common
 }  // namespace mojo
@@ -417,6 +417,25 @@ TEST_F(InterfacePtrTest, QueryVersion) {
   EXPECT_EQ(3u, ptr.version());
 }
 
+// The version is recorded by whichever InterfacePtr has the pipe when the
+// response arrives.
+TEST_F(InterfacePtrTest, QueryVersionAfterMove) {
+  IntegerAccessorImpl impl;
+  sample::IntegerAccessorPtr ptr;
+  Binding<sample::IntegerAccessor> binding(&impl, GetProxy(&ptr));
+
+  uint32_t reported_version = 0u;
+  ptr.QueryVersion(
+      [&reported_version](uint32_t version) { reported_version = version; });
+
+  sample::IntegerAccessorPtr moved_ptr = ptr.Pass();
+  ptr.reset();
+  PumpMessages();
+
+  EXPECT_EQ(3u, reported_version);
+  EXPECT_EQ(3u, moved_ptr.version());
+}
+
 TEST_F(InterfacePtrTest, RequireVersion) {
   IntegerAccessorImpl impl;
   sample::IntegerAccessorPtr ptr;
@@ -0,0 +1,86 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/bindings/lib/multi_producer_queue.h"
+
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace mojo {
+namespace test {
+namespace {
+
+using internal::MultiProducerQueue;
+
+TEST(MultiProducerQueueTest, PushAndTakeAll) {
+  MultiProducerQueue<std::unique_ptr<int>> queue;
+  EXPECT_TRUE(queue.Push(std::unique_ptr<int>(new int(0))));
+  for (int i = 1; i < 10; i++)
+    EXPECT_FALSE(queue.Push(std::unique_ptr<int>(new int(i))));
+
+  std::vector<int> taken;
+  EXPECT_EQ(10u, queue.TakeAll([&taken](std::unique_ptr<int> value) {
+    taken.push_back(*value);
+  }));
+  ASSERT_EQ(10u, taken.size());
+  for (int i = 0; i < 10; i++)
+    EXPECT_EQ(i, taken[i]);
+
+  // The queue is empty again.
+  EXPECT_EQ(0u, queue.TakeAll([](std::unique_ptr<int> value) {}));
+  EXPECT_TRUE(queue.Push(std::unique_ptr<int>(new int(10))));
+}
+
+// Values pushed while taking are left for the next |TakeAll()|.
+TEST(MultiProducerQueueTest, PushWhileTaking) {
+  MultiProducerQueue<int> queue;
+  queue.Push(1);
+  queue.Push(2);
+
+  std::vector<int> taken;
+  EXPECT_EQ(2u, queue.TakeAll([&queue, &taken](int value) {
+    taken.push_back(value);
+    EXPECT_EQ(value == 1, queue.Push(value + 10));
+  }));
+  EXPECT_EQ(2u, queue.TakeAll([&taken](int value) { taken.push_back(value); }));
+  EXPECT_EQ((std::vector<int>{1, 2, 11, 12}), taken);
+}
+
+// Each thread's values come out in the order that thread pushed them.
+TEST(MultiProducerQueueTest, ManyProducers) {
+  const int kNumThreads = 4;
+  const int kNumValuesPerThread = 10000;
+
+  MultiProducerQueue<std::pair<int, int>> queue;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.push_back(std::thread([&queue, i]() {
+      for (int j = 0; j < kNumValuesPerThread; j++)
+        queue.Push(std::make_pair(i, j));
+    }));
+  }
+
+  std::vector<int> next_values(kNumThreads, 0);
+  int num_taken = 0;
+  auto take = [&next_values](std::pair<int, int> value) {
+    EXPECT_EQ(next_values[value.first], value.second);
+    next_values[value.first] = value.second + 1;
+  };
+  while (num_taken < kNumThreads * kNumValuesPerThread)
+    num_taken += static_cast<int>(queue.TakeAll(take));
+
+  for (auto& thread : threads)
+    thread.join();
+  EXPECT_EQ(0u, queue.TakeAll(take));
+  for (int i = 0; i < kNumThreads; i++)
+    EXPECT_EQ(kNumValuesPerThread, next_values[i]);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mojo
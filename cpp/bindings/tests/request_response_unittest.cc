@@ -2,10 +2,14 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <utility>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "mojo/public/cpp/bindings/binding.h"
 #include "mojo/public/cpp/test_support/test_utils.h"
 #include "mojo/public/cpp/utility/run_loop.h"
+#include "mojo/public/interfaces/bindings/tests/inline_callback_interfaces.mojom.h"
 #include "mojo/public/interfaces/bindings/tests/sample_import.mojom.h"
 #include "mojo/public/interfaces/bindings/tests/sample_interfaces.mojom.h"
 
@@ -50,6 +54,64 @@ class ProviderImpl : public sample::Provider {
   Binding<sample::Provider> binding_;
 };
 
+// Like ProviderImpl, but its response callbacks are InlineCallbacks, which it
+// gets by value. It holds on to the callback for Ping() until RespondToPing().
+class InlineCallbackProviderImpl : public InlineCallbackProvider {
+ public:
+  explicit InlineCallbackProviderImpl(
+      InterfaceRequest<InlineCallbackProvider> request)
+      : binding_(this, request.Pass()) {}
+
+  void EchoString(const String& a, EchoStringCallback callback) override {
+    callback.Run(a);
+  }
+
+  void EchoStrings(const String& a,
+                   const String& b,
+                   EchoStringsCallback callback) override {
+    callback.Run(a, b);
+  }
+
+  void EchoMessagePipeHandle(ScopedMessagePipeHandle a,
+                             EchoMessagePipeHandleCallback callback) override {
+    callback.Run(a.Pass());
+  }
+
+  void Ping(PingCallback callback) override {
+    ping_callback_ = std::move(callback);
+  }
+
+  bool has_ping_callback() const { return !ping_callback_.is_null(); }
+
+  void RespondToPing() {
+    PingCallback callback = std::move(ping_callback_);
+    callback.Run();
+  }
+
+ private:
+  Binding<InlineCallbackProvider> binding_;
+  PingCallback ping_callback_;
+};
+
+// Looks up the length of the key, and counts the calls.
+class CoalescedLookupImpl : public sample::CoalescedLookup {
+ public:
+  explicit CoalescedLookupImpl(
+      InterfaceRequest<sample::CoalescedLookup> request)
+      : binding_(this, request.Pass()), num_calls_(0) {}
+
+  void Lookup(const String& key, const LookupCallback& callback) override {
+    num_calls_++;
+    callback.Run(static_cast<int32_t>(key.size()));
+  }
+
+  int num_calls() const { return num_calls_; }
+
+ private:
+  Binding<sample::CoalescedLookup> binding_;
+  int num_calls_;
+};
+
 class StringRecorder {
  public:
   explicit StringRecorder(std::string* buf) : buf_(buf) {}
@@ -145,6 +207,77 @@ TEST_F(RequestResponseTest, EchoEnum) {
   EXPECT_EQ(sample::Enum::VALUE, value);
 }
 
+TEST_F(RequestResponseTest, InlineCallbacks) {
+  InlineCallbackProviderPtr provider;
+  InlineCallbackProviderImpl provider_impl(GetProxy(&provider));
+
+  std::string buf;
+  provider->EchoString(String::From("hello"), StringRecorder(&buf));
+
+  PumpMessages();
+
+  EXPECT_EQ(std::string("hello"), buf);
+
+  provider->EchoStrings(String::From("hello"), String::From(" world"),
+                        StringRecorder(&buf));
+
+  PumpMessages();
+
+  EXPECT_EQ(std::string("hello world"), buf);
+
+  MessagePipe pipe2;
+  provider->EchoMessagePipeHandle(pipe2.handle1.Pass(),
+                                  MessagePipeWriter("hello"));
+
+  PumpMessages();
+
+  std::string value;
+  ReadTextMessage(pipe2.handle0.get(), &value);
+  EXPECT_EQ(std::string("hello"), value);
+
+  // The implementation may hold on to the callback and respond later.
+  bool pinged = false;
+  provider->Ping([&pinged]() { pinged = true; });
+
+  PumpMessages();
+
+  EXPECT_TRUE(provider_impl.has_ping_callback());
+  EXPECT_FALSE(pinged);
+
+  provider_impl.RespondToPing();
+  PumpMessages();
+
+  EXPECT_FALSE(provider_impl.has_ping_callback());
+  EXPECT_TRUE(pinged);
+}
+
+// Identical calls to a [Coalesce] method are sent once while awaiting their
+// response, and each callback is run with it.
+TEST_F(RequestResponseTest, CoalescedLookup) {
+  sample::CoalescedLookupPtr lookup;
+  CoalescedLookupImpl lookup_impl(GetProxy(&lookup));
+
+  std::vector<int32_t> values;
+  auto record = [&values](int32_t value) { values.push_back(value); };
+  lookup->Lookup(String::From("a"), record);
+  lookup->Lookup(String::From("a"), record);
+  lookup->Lookup(String::From("bb"), record);
+  lookup->Lookup(String::From("a"), record);
+
+  PumpMessages();
+
+  EXPECT_EQ(2, lookup_impl.num_calls());
+  EXPECT_EQ((std::vector<int32_t>{1, 1, 1, 2}), values);
+
+  // Once the response has arrived, the call is sent again.
+  lookup->Lookup(String::From("a"), record);
+
+  PumpMessages();
+
+  EXPECT_EQ(3, lookup_impl.num_calls());
+  EXPECT_EQ((std::vector<int32_t>{1, 1, 1, 2, 1}), values);
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace mojo
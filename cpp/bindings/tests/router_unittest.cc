@@ -5,6 +5,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "mojo/public/cpp/bindings/lib/message_builder.h"
 #include "mojo/public/cpp/bindings/lib/router.h"
@@ -35,6 +40,14 @@ void AllocResponseMessage(uint32_t name,
   builder.message()->MoveTo(message);
 }
 
+void AllocMessage(uint32_t name, const char* text, Message* message) {
+  size_t payload_size = strlen(text) + 1;  // Plus null terminator.
+  MessageBuilder builder(name, payload_size);
+  memcpy(builder.buffer()->Allocate(payload_size), text, payload_size);
+
+  builder.message()->MoveTo(message);
+}
+
 class MessageAccumulator : public MessageReceiver {
  public:
   explicit MessageAccumulator(MessageQueue* queue) : queue_(queue) {}
@@ -48,6 +61,22 @@ class MessageAccumulator : public MessageReceiver {
   MessageQueue* queue_;
 };
 
+// Runs a closure after accepting each message.
+class ClosureMessageAccumulator : public MessageAccumulator {
+ public:
+  ClosureMessageAccumulator(MessageQueue* queue, const Closure& closure)
+      : MessageAccumulator(queue), closure_(closure) {}
+
+  bool Accept(Message* message) override {
+    bool result = MessageAccumulator::Accept(message);
+    closure_.Run();
+    return result;
+  }
+
+ private:
+  Closure closure_;
+};
+
 class ResponseGenerator : public MessageReceiverWithResponderStatus {
  public:
   ResponseGenerator() {}
@@ -79,6 +108,61 @@ class ResponseGenerator : public MessageReceiverWithResponderStatus {
   }
 };
 
+// Accepts messages that don't expect responses.
+class OneWayMessageAccumulator : public MessageReceiverWithResponderStatus {
+ public:
+  explicit OneWayMessageAccumulator(MessageQueue* queue) : queue_(queue) {}
+
+  bool Accept(Message* message) override {
+    queue_->Push(message);
+    return true;
+  }
+
+  bool AcceptWithResponder(Message* message,
+                           MessageReceiverWithStatus* responder) override {
+    return false;
+  }
+
+ private:
+  MessageQueue* queue_;
+};
+
+// Counts the requests it responds to.
+class CountingResponseGenerator : public ResponseGenerator {
+ public:
+  CountingResponseGenerator() : num_requests_(0u) {}
+
+  bool AcceptWithResponder(Message* message,
+                           MessageReceiverWithStatus* responder) override {
+    num_requests_++;
+    return ResponseGenerator::AcceptWithResponder(message, responder);
+  }
+
+  size_t num_requests() const { return num_requests_; }
+
+ private:
+  size_t num_requests_;
+};
+
+// Responds with a message pipe handle, which the responses it is given to
+// don't expect.
+class HandleResponseGenerator : public ResponseGenerator {
+ public:
+  HandleResponseGenerator() {}
+
+  bool AcceptWithResponder(Message* message,
+                           MessageReceiverWithStatus* responder) override {
+    Message response;
+    AllocResponseMessage(message->name(), "hello world!",
+                         message->request_id(), &response);
+    MessagePipe pipe;
+    response.mutable_handles()->push_back(pipe.handle0.release());
+    bool result = responder->Accept(&response);
+    delete responder;
+    return result;
+  }
+};
+
 class LazyResponseGenerator : public ResponseGenerator {
  public:
   LazyResponseGenerator() : responder_(nullptr), name_(0), request_id_(0) {}
@@ -122,6 +206,53 @@ class LazyResponseGenerator : public ResponseGenerator {
   std::string request_string_;
 };
 
+// Holds on to the requests it gets, so as to respond to them all at once.
+class BatchResponseGenerator : public ResponseGenerator {
+ public:
+  BatchResponseGenerator() {}
+
+  ~BatchResponseGenerator() override {
+    for (const PendingRequest& request : requests_)
+      delete request.responder;
+  }
+
+  bool AcceptWithResponder(Message* message,
+                           MessageReceiverWithStatus* responder) override {
+    PendingRequest request;
+    request.name = message->name();
+    request.request_id = message->request_id();
+    request.request_string =
+        std::string(reinterpret_cast<const char*>(message->payload()));
+    request.responder = responder;
+    requests_.push_back(request);
+    return true;
+  }
+
+  size_t num_requests() const { return requests_.size(); }
+
+  // Sends the responses and deletes the responders.
+  void CompleteWithResponses() {
+    for (const PendingRequest& request : requests_) {
+      SendResponse(request.name, request.request_id,
+                   request.request_string.c_str(), request.responder);
+      delete request.responder;
+    }
+    requests_.clear();
+  }
+
+ private:
+  struct PendingRequest {
+    uint32_t name;
+    uint64_t request_id;
+    std::string request_string;
+    MessageReceiverWithStatus* responder;
+  };
+
+  std::vector<PendingRequest> requests_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(BatchResponseGenerator);
+};
+
 class RouterTest : public testing::Test {
  public:
   RouterTest() {}
@@ -457,6 +588,291 @@ TEST_F(RouterTest, LateResponse) {
   generator.CompleteWithResponse();  // This should end up doing nothing.
 }
 
+TEST_F(RouterTest, FlowControl) {
+  internal::Router router0(handle0_.Pass(), internal::MessageValidatorList());
+  internal::Router router1(handle1_.Pass(), internal::MessageValidatorList());
+
+  MessageQueue message_queue;
+  OneWayMessageAccumulator accumulator(&message_queue);
+  router1.set_incoming_receiver(&accumulator);
+
+  bool writable = false;
+  router0.EnableFlowControl(4u);
+  router0.set_writable_handler([&writable]() { writable = true; });
+
+  const char* const kText[] = {"0", "1", "2", "3", "4", "5"};
+  for (size_t i = 0; i < MOJO_ARRAYSIZE(kText); ++i) {
+    // Only the first four messages are written to the pipe; the others are
+    // held.
+    EXPECT_EQ(i >= 4u, router0.write_would_block());
+    Message message;
+    AllocMessage(1, kText[i], &message);
+    EXPECT_TRUE(router0.Accept(&message));
+  }
+
+  // Without running |router0|'s side of the loop, only the four messages in
+  // the pipe (after the flow control message that enabled flow control) can be
+  // read.
+  size_t num_read = 0;
+  while (router1.WaitForIncomingMessage(0u))
+    num_read++;
+  EXPECT_EQ(5u, num_read);
+  EXPECT_FALSE(router1.encountered_error());
+  EXPECT_FALSE(writable);
+
+  // Once |router0| gets its credits back, it sends the others.
+  PumpMessages();
+
+  EXPECT_TRUE(writable);
+  EXPECT_FALSE(router0.write_would_block());
+  for (size_t i = 0; i < MOJO_ARRAYSIZE(kText); ++i) {
+    ASSERT_FALSE(message_queue.IsEmpty());
+
+    Message message;
+    message_queue.Pop(&message);
+    EXPECT_EQ(std::string(kText[i]),
+              std::string(reinterpret_cast<const char*>(message.payload())));
+  }
+  EXPECT_TRUE(message_queue.IsEmpty());
+}
+
+TEST_F(RouterTest, Timeout) {
+  internal::Router router0(handle0_.Pass(), internal::MessageValidatorList());
+  internal::Router router1(handle1_.Pass(), internal::MessageValidatorList());
+
+  LazyResponseGenerator generator;
+  router1.set_incoming_receiver(&generator);
+
+  Message request;
+  AllocRequestMessage(1, "hello", &request);
+
+  MessageQueue message_queue;
+  bool timed_out = false;
+  EXPECT_TRUE(router0.AcceptWithResponderAndTimeout(
+      &request, new MessageAccumulator(&message_queue), 1000u,
+      [&timed_out]() {
+        timed_out = true;
+        RunLoop::current()->Quit();
+      }));
+
+  RunLoop::current()->Run();
+
+  EXPECT_TRUE(timed_out);
+  EXPECT_TRUE(generator.has_responder());
+
+  // The late response is discarded (and isn't an error).
+  generator.CompleteWithResponse();
+  PumpMessages();
+
+  EXPECT_TRUE(message_queue.IsEmpty());
+  EXPECT_FALSE(router0.encountered_error());
+}
+
+// Only the last |kMaxTimedOutRequestIds| timed-out requests are remembered,
+// but late responses to the older ones are discarded all the same.
+TEST_F(RouterTest, Timeout_ManyLateResponses) {
+  internal::Router router0(handle0_.Pass(), internal::MessageValidatorList());
+  internal::Router router1(handle1_.Pass(), internal::MessageValidatorList());
+
+  BatchResponseGenerator generator;
+  router1.set_incoming_receiver(&generator);
+
+  const size_t kNumRequests = internal::Router::kMaxTimedOutRequestIds + 1u;
+  MessageQueue message_queue;
+  size_t num_timed_out = 0u;
+  for (size_t i = 0; i < kNumRequests; ++i) {
+    Message request;
+    AllocRequestMessage(1, "hello", &request);
+    EXPECT_TRUE(router0.AcceptWithResponderAndTimeout(
+        &request, new MessageAccumulator(&message_queue), 1000u,
+        [&num_timed_out]() {
+          if (++num_timed_out == kNumRequests)
+            RunLoop::current()->Quit();
+        }));
+  }
+
+  RunLoop::current()->Run();
+  PumpMessages();
+
+  EXPECT_EQ(kNumRequests, num_timed_out);
+  EXPECT_EQ(kNumRequests, generator.num_requests());
+
+  generator.CompleteWithResponses();
+  PumpMessages();
+
+  EXPECT_TRUE(message_queue.IsEmpty());
+  EXPECT_FALSE(router0.encountered_error());
+}
+
+// A timed call that is still pending when the run loop is destroyed doesn't
+// time out, and its timeout isn't waited for any longer.
+TEST_F(RouterTest, Timeout_RunLoopDestroyed) {
+  bool timed_out = false;
+  ScopedMessagePipeHandle handle0 = handle0_.Pass();
+  ScopedMessagePipeHandle handle1 = handle1_.Pass();
+  // The run loop is destroyed on another thread, which has its own.
+  std::thread thread([&timed_out, &handle0, &handle1]() {
+    LazyResponseGenerator generator;
+    MessageQueue message_queue;
+    std::unique_ptr<internal::Router> router0;
+    std::unique_ptr<internal::Router> router1;
+    {
+      RunLoop loop;
+      router0.reset(new internal::Router(handle0.Pass(),
+                                           internal::MessageValidatorList()));
+      router1.reset(new internal::Router(handle1.Pass(),
+                                           internal::MessageValidatorList()));
+      router1->set_incoming_receiver(&generator);
+
+      Message request;
+      AllocRequestMessage(1, "hello", &request);
+      EXPECT_TRUE(router0->AcceptWithResponderAndTimeout(
+          &request, new MessageAccumulator(&message_queue), 10000000u,
+          [&timed_out]() { timed_out = true; }));
+
+      loop.RunUntilIdle();
+      EXPECT_TRUE(generator.has_responder());
+    }
+    EXPECT_TRUE(router0->encountered_error());
+    // This mustn't cancel a wait on the destroyed run loop.
+    router0.reset();
+  });
+  thread.join();
+
+  EXPECT_FALSE(timed_out);
+}
+
+TEST_F(RouterTest, ResponseBeforeTimeout) {
+  internal::Router router0(handle0_.Pass(), internal::MessageValidatorList());
+  internal::Router router1(handle1_.Pass(), internal::MessageValidatorList());
+
+  ResponseGenerator generator;
+  router1.set_incoming_receiver(&generator);
+
+  Message request;
+  AllocRequestMessage(1, "hello", &request);
+
+  MessageQueue message_queue;
+  bool timed_out = false;
+  EXPECT_TRUE(router0.AcceptWithResponderAndTimeout(
+      &request, new MessageAccumulator(&message_queue), 10000000u,
+      [&timed_out]() { timed_out = true; }));
+
+  PumpMessages();
+
+  EXPECT_FALSE(message_queue.IsEmpty());
+  EXPECT_FALSE(timed_out);
+}
+
+// Identical requests awaiting their response are sent once, and the response
+// is given to each of them.
+TEST_F(RouterTest, CoalescedRequests) {
+  internal::Router router0(handle0_.Pass(), internal::MessageValidatorList());
+  internal::Router router1(handle1_.Pass(), internal::MessageValidatorList());
+
+  CountingResponseGenerator generator;
+  router1.set_incoming_receiver(&generator);
+
+  MessageQueue message_queue;
+  const char* const kTexts[] = {"hello", "hello", "goodbye", "hello"};
+  for (const char* text : kTexts) {
+    Message request;
+    AllocRequestMessage(1, text, &request);
+    EXPECT_TRUE(router0.AcceptWithCoalescedResponder(
+        &request, new MessageAccumulator(&message_queue)));
+  }
+
+  PumpMessages();
+
+  EXPECT_EQ(2u, generator.num_requests());
+  const char* const kResponses[] = {"hello world!", "hello world!",
+                                    "hello world!", "goodbye world!"};
+  for (const char* expected : kResponses) {
+    ASSERT_FALSE(message_queue.IsEmpty());
+    Message response;
+    message_queue.Pop(&response);
+    EXPECT_EQ(std::string(expected),
+              std::string(reinterpret_cast<const char*>(response.payload())));
+  }
+  EXPECT_TRUE(message_queue.IsEmpty());
+
+  // Once the response has arrived, the request is sent again.
+  Message request;
+  AllocRequestMessage(1, "hello", &request);
+  EXPECT_TRUE(router0.AcceptWithCoalescedResponder(
+      &request, new MessageAccumulator(&message_queue)));
+
+  PumpMessages();
+
+  EXPECT_EQ(3u, generator.num_requests());
+  EXPECT_FALSE(message_queue.IsEmpty());
+}
+
+// Handles that come with the response to a coalesced request are closed, and
+// each responder gets the response without them.
+TEST_F(RouterTest, CoalescedRequests_ResponseWithHandles) {
+  internal::Router router0(handle0_.Pass(), internal::MessageValidatorList());
+  internal::Router router1(handle1_.Pass(), internal::MessageValidatorList());
+
+  HandleResponseGenerator generator;
+  router1.set_incoming_receiver(&generator);
+
+  MessageQueue message_queue;
+  for (size_t i = 0; i < 2u; ++i) {
+    Message request;
+    AllocRequestMessage(1, "hello", &request);
+    EXPECT_TRUE(router0.AcceptWithCoalescedResponder(
+        &request, new MessageAccumulator(&message_queue)));
+  }
+
+  PumpMessages();
+
+  for (size_t i = 0; i < 2u; ++i) {
+    ASSERT_FALSE(message_queue.IsEmpty());
+    Message response;
+    message_queue.Pop(&response);
+    EXPECT_EQ(std::string("hello world!"),
+              std::string(reinterpret_cast<const char*>(response.payload())));
+    EXPECT_TRUE(response.handles()->empty());
+  }
+  EXPECT_TRUE(message_queue.IsEmpty());
+  EXPECT_FALSE(router0.encountered_error());
+}
+
+// If the Router is destroyed by one of the responders to a coalesced request,
+// the others don't get the response.
+TEST_F(RouterTest, CoalescedRequests_RouterDestroyed) {
+  std::unique_ptr<internal::Router> router0(
+      new internal::Router(handle0_.Pass(), internal::MessageValidatorList()));
+  internal::Router router1(handle1_.Pass(), internal::MessageValidatorList());
+
+  CountingResponseGenerator generator;
+  router1.set_incoming_receiver(&generator);
+
+  MessageQueue message_queue;
+  for (size_t i = 0; i < 3u; ++i) {
+    Message request;
+    AllocRequestMessage(1, "hello", &request);
+    MessageReceiver* responder = nullptr;
+    if (i == 0u) {
+      responder = new ClosureMessageAccumulator(
+          &message_queue, [&router0]() { router0.reset(); });
+    } else {
+      responder = new MessageAccumulator(&message_queue);
+    }
+    EXPECT_TRUE(router0->AcceptWithCoalescedResponder(&request, responder));
+  }
+
+  PumpMessages();
+
+  EXPECT_EQ(1u, generator.num_requests());
+  EXPECT_FALSE(router0);
+  ASSERT_FALSE(message_queue.IsEmpty());
+  Message response;
+  message_queue.Pop(&response);
+  EXPECT_TRUE(message_queue.IsEmpty());
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace mojo
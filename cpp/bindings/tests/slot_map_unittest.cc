@@ -0,0 +1,156 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/bindings/lib/slot_map.h"
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace mojo {
+namespace test {
+namespace {
+
+using internal::SlotMap;
+
+typedef SlotMap<std::unique_ptr<int>> IntSlotMap;
+
+TEST(SlotMapTest, InsertFindRemove) {
+  IntSlotMap map;
+  EXPECT_TRUE(map.empty());
+
+  std::vector<IntSlotMap::Key> keys;
+  for (int i = 0; i < 10; i++)
+    keys.push_back(map.Insert(std::unique_ptr<int>(new int(i))));
+  EXPECT_EQ(10u, map.size());
+
+  for (int i = 0; i < 10; i++) {
+    ASSERT_TRUE(map.Find(keys[i]));
+    EXPECT_EQ(i, **map.Find(keys[i]));
+  }
+
+  EXPECT_TRUE(map.Remove(keys[3]));
+  EXPECT_FALSE(map.Remove(keys[3]));
+  EXPECT_FALSE(map.Find(keys[3]));
+  EXPECT_EQ(9u, map.size());
+
+  // The other values must still be found after the last one moved into the
+  // removed one's place.
+  for (int i = 0; i < 10; i++) {
+    if (i == 3)
+      continue;
+    ASSERT_TRUE(map.Find(keys[i]));
+    EXPECT_EQ(i, **map.Find(keys[i]));
+  }
+}
+
+TEST(SlotMapTest, StaleKeyAfterSlotReuse) {
+  IntSlotMap map;
+  IntSlotMap::Key old_key = map.Insert(std::unique_ptr<int>(new int(1)));
+  EXPECT_TRUE(map.Remove(old_key));
+
+  IntSlotMap::Key new_key = map.Insert(std::unique_ptr<int>(new int(2)));
+  EXPECT_EQ(old_key.slot, new_key.slot);
+  EXPECT_FALSE(map.Find(old_key));
+  EXPECT_FALSE(map.Remove(old_key));
+  ASSERT_TRUE(map.Find(new_key));
+  EXPECT_EQ(2, **map.Find(new_key));
+}
+
+TEST(SlotMapTest, RemoveIf) {
+  IntSlotMap map;
+  std::vector<IntSlotMap::Key> keys;
+  for (int i = 0; i < 10; i++)
+    keys.push_back(map.Insert(std::unique_ptr<int>(new int(i))));
+
+  map.RemoveIf([](const std::unique_ptr<int>& value) {
+    return *value % 2 == 0;
+  });
+  EXPECT_EQ(5u, map.size());
+
+  for (int i = 0; i < 10; i++) {
+    if (i % 2 == 0) {
+      EXPECT_FALSE(map.Find(keys[i]));
+    } else {
+      ASSERT_TRUE(map.Find(keys[i]));
+      EXPECT_EQ(i, **map.Find(keys[i]));
+    }
+  }
+
+  int sum = 0;
+  for (const auto& value : map)
+    sum += *value;
+  EXPECT_EQ(1 + 3 + 5 + 7 + 9, sum);
+}
+
+TEST(SlotMapTest, Clear) {
+  IntSlotMap map;
+  std::vector<IntSlotMap::Key> keys;
+  for (int i = 0; i < 10; i++)
+    keys.push_back(map.Insert(std::unique_ptr<int>(new int(i))));
+
+  map.Clear();
+  EXPECT_TRUE(map.empty());
+  for (const auto& key : keys)
+    EXPECT_FALSE(map.Find(key));
+
+  IntSlotMap::Key key = map.Insert(std::unique_ptr<int>(new int(42)));
+  ASSERT_TRUE(map.Find(key));
+  EXPECT_EQ(42, **map.Find(key));
+}
+
+// Destroying a value may remove another value from the same map (as a
+// binding's destructor may, by way of its error handler).
+TEST(SlotMapTest, RemoveFromDestructor) {
+  struct Value {
+    Value(SlotMap<Value>* map, bool* destroyed)
+        : map(map), destroyed(destroyed) {}
+    Value(Value&& other)
+        : map(other.map),
+          other_key(other.other_key),
+          has_other(other.has_other),
+          destroyed(other.destroyed) {
+      other.has_other = false;
+      other.destroyed = nullptr;
+    }
+    Value& operator=(Value&& other) {
+      map = other.map;
+      other_key = other.other_key;
+      has_other = other.has_other;
+      destroyed = other.destroyed;
+      other.has_other = false;
+      other.destroyed = nullptr;
+      return *this;
+    }
+    ~Value() {
+      if (destroyed)
+        *destroyed = true;
+      if (has_other)
+        map->Remove(other_key);
+    }
+
+    SlotMap<Value>* map;
+    SlotMap<Value>::Key other_key = {0u, 0u};
+    bool has_other = false;
+    bool* destroyed;
+  };
+
+  SlotMap<Value> map;
+  bool first_destroyed = false;
+  bool second_destroyed = false;
+  SlotMap<Value>::Key first = map.Insert(Value(&map, &first_destroyed));
+  SlotMap<Value>::Key second = map.Insert(Value(&map, &second_destroyed));
+  map.Find(first)->other_key = second;
+  map.Find(first)->has_other = true;
+
+  EXPECT_TRUE(map.Remove(first));
+  EXPECT_TRUE(first_destroyed);
+  EXPECT_TRUE(second_destroyed);
+  EXPECT_TRUE(map.empty());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mojo
@@ -111,6 +111,47 @@ TEST(StrongBindingSetTest, FullLifeCycle) {
   }
 }
 
+// Tests that RemoveBindings() removes every binding for an implementation,
+// without deleting it.
+TEST(StrongBindingSetTest, RemoveBindings) {
+  RunLoop loop;
+
+  // Bind the even InterfacePtrs to |shared_impl| and each odd one to its own
+  // MinimalInterfaceImpl.
+  const size_t kNumObjects = 6;
+  InterfacePtr<test::MinimalInterface> intrfc_ptrs[kNumObjects];
+  MinimalInterfaceImpl* impls[kNumObjects];
+  bool deleted_flags[kNumObjects] = {};
+  bool shared_deleted = false;
+  MinimalInterfaceImpl* shared_impl = new MinimalInterfaceImpl(&shared_deleted);
+
+  StrongBindingSet<test::MinimalInterface> binding_set;
+  for (size_t i = 0; i < kNumObjects; i++) {
+    impls[i] = (i % 2 == 0) ? shared_impl
+                            : new MinimalInterfaceImpl(&deleted_flags[i]);
+    binding_set.AddBinding(impls[i], GetProxy(&intrfc_ptrs[i]));
+  }
+  EXPECT_EQ(kNumObjects, binding_set.size());
+
+  binding_set.RemoveBindings(shared_impl);
+  EXPECT_EQ(kNumObjects / 2, binding_set.size());
+  EXPECT_FALSE(shared_deleted);
+
+  // Only the odd implementations should still receive messages.
+  for (InterfacePtr<test::MinimalInterface>& ptr : intrfc_ptrs)
+    ptr->Message();
+  loop.RunUntilIdle();
+  EXPECT_EQ(0, shared_impl->call_count());
+  for (size_t i = 1; i < kNumObjects; i += 2)
+    EXPECT_EQ(1, impls[i]->call_count());
+
+  delete shared_impl;
+  binding_set.CloseAllBindings();
+  EXPECT_EQ(0u, binding_set.size());
+  for (size_t i = 1; i < kNumObjects; i += 2)
+    EXPECT_TRUE(deleted_flags[i]);
+}
+
 }  // namespace
 }  // namespace common
 }  // namespace mojo
@@ -25,6 +25,28 @@ void AllocMessage(const std::string& text, Message* message) {
   builder.message()->MoveTo(message);
 }
 
+void AllocRequestMessage(const std::string& text, Message* message) {
+  size_t payload_size = text.length() + 1;  // Plus null terminator.
+  RequestMessageBuilder builder(1, payload_size);
+  memcpy(builder.buffer()->Allocate(payload_size), text.c_str(), payload_size);
+
+  builder.message()->MoveTo(message);
+}
+
+// Reads a request from |connector| and writes a response to it, with " world"
+// appended to the request's text.
+void Respond(internal::SynchronousConnector* connector) {
+  Message request;
+  ASSERT_TRUE(connector->BlockingRead(&request));
+
+  std::string text(reinterpret_cast<const char*>(request.payload()));
+  text += " world";
+  size_t payload_size = text.length() + 1;  // Plus null terminator.
+  ResponseMessageBuilder builder(1, payload_size, request.request_id());
+  memcpy(builder.buffer()->Allocate(payload_size), text.c_str(), payload_size);
+  EXPECT_TRUE(connector->Write(builder.message()));
+}
+
 // Simple success case.
 TEST(SynchronousConnectorTest, Basic) {
   MessagePipe pipe;
@@ -69,6 +91,58 @@ TEST(SynchronousConnectorTest, ReadFromClosedPipe) {
   EXPECT_FALSE(connector0.BlockingRead(&message));
 }
 
+// Many requests may be outstanding, and their responses read in any order.
+TEST(SynchronousConnectorTest, PipelinedRequests) {
+  MessagePipe pipe;
+  internal::SynchronousConnector connector0(std::move(pipe.handle0));
+  internal::SynchronousConnector connector1(std::move(pipe.handle1));
+
+  const std::string kText[] = {"hello", "goodbye", "hello again"};
+  uint64_t request_ids[3];
+  for (size_t i = 0; i < 3; ++i) {
+    Message request;
+    AllocRequestMessage(kText[i], &request);
+    EXPECT_TRUE(connector0.WriteRequest(&request, &request_ids[i]));
+  }
+  for (size_t i = 0; i < 3; ++i)
+    Respond(&connector1);
+
+  // The other responses are kept while the last one is read.
+  const size_t kOrder[] = {2, 0, 1};
+  for (size_t i : kOrder) {
+    Message response;
+    EXPECT_TRUE(
+        connector0.ReadResponse(request_ids[i], &response,
+                                MOJO_DEADLINE_INDEFINITE));
+    EXPECT_EQ(kText[i] + " world",
+              std::string(reinterpret_cast<const char*>(response.payload())));
+  }
+
+  // A response can't be read twice.
+  Message response;
+  EXPECT_FALSE(connector0.ReadResponse(request_ids[0], &response, 0u));
+}
+
+// A response may be waited for again after the deadline has passed.
+TEST(SynchronousConnectorTest, ReadResponseDeadline) {
+  MessagePipe pipe;
+  internal::SynchronousConnector connector0(std::move(pipe.handle0));
+  internal::SynchronousConnector connector1(std::move(pipe.handle1));
+
+  Message request;
+  AllocRequestMessage("hello", &request);
+  uint64_t request_id = 0u;
+  EXPECT_TRUE(connector0.WriteRequest(&request, &request_id));
+
+  Message response;
+  EXPECT_FALSE(connector0.ReadResponse(request_id, &response, 1000u));
+
+  Respond(&connector1);
+  EXPECT_TRUE(connector0.ReadResponse(request_id, &response, 1000000u));
+  EXPECT_EQ(std::string("hello world"),
+            std::string(reinterpret_cast<const char*>(response.payload())));
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace mojo
@@ -94,6 +94,28 @@ TEST_F(SynchronousInterfacePtrTest, EndToEnd) {
   server.join();
 }
 
+// Many calls may be in flight at once, with their responses read in any
+// order.
+TEST_F(SynchronousInterfacePtrTest, Pipelined) {
+  SynchronousInterfacePtr<math::Calculator> calc;
+  std::thread server(StartMathCalculator, GetSynchronousProxy(&calc));
+
+  uint64_t request_ids[3];
+  for (size_t i = 0; i < 3; ++i)
+    EXPECT_TRUE(calc->BeginAdd(1.0, &request_ids[i]));
+
+  double out;
+  EXPECT_TRUE(calc->EndAdd(request_ids[2], &out, MOJO_DEADLINE_INDEFINITE));
+  EXPECT_EQ(3.0, out);
+  EXPECT_TRUE(calc->EndAdd(request_ids[0], &out, MOJO_DEADLINE_INDEFINITE));
+  EXPECT_EQ(1.0, out);
+  EXPECT_TRUE(calc->EndAdd(request_ids[1], &out, MOJO_DEADLINE_INDEFINITE));
+  EXPECT_EQ(2.0, out);
+
+  calc.PassInterfaceHandle();
+  server.join();
+}
+
 // Move them around.
 TEST_F(SynchronousInterfacePtrTest, Movable) {
   SynchronousInterfacePtr<math::Calculator> a;
@@ -0,0 +1,168 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/bindings/thread_safe_interface_ptr.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mojo/public/cpp/bindings/binding.h"
+#include "mojo/public/cpp/bindings/interface_request.h"
+#include "mojo/public/cpp/bindings/response_executor.h"
+#include "mojo/public/cpp/utility/run_loop.h"
+#include "mojo/public/interfaces/bindings/tests/math_calculator.mojom.h"
+
+namespace mojo {
+namespace test {
+namespace {
+
+class MathCalculatorImpl : public math::Calculator {
+ public:
+  explicit MathCalculatorImpl(InterfaceRequest<math::Calculator> request)
+      : total_(0.0), binding_(this, request.Pass()) {}
+  ~MathCalculatorImpl() override {}
+
+  void Clear(const ClearCallback& callback) override {
+    total_ = 0.0;
+    callback.Run(total_);
+  }
+
+  void Add(double value, const AddCallback& callback) override {
+    total_ += value;
+    callback.Run(total_);
+  }
+
+  void Multiply(double value, const MultiplyCallback& callback) override {
+    total_ *= value;
+    callback.Run(total_);
+  }
+
+ private:
+  double total_;
+  Binding<math::Calculator> binding_;
+};
+
+class ThreadSafeInterfacePtrTest : public testing::Test {
+ public:
+  ThreadSafeInterfacePtrTest() {}
+  ~ThreadSafeInterfacePtrTest() override { loop_.RunUntilIdle(); }
+
+  void PumpMessages() { loop_.RunUntilIdle(); }
+
+ private:
+  RunLoop loop_;
+};
+
+// Calls made on the pipe thread itself are sent, in order, by |Flush()| (or
+// once the run loop gets to them).
+TEST_F(ThreadSafeInterfacePtrTest, CallsFromPipeThread) {
+  InterfaceHandle<math::Calculator> handle;
+  MathCalculatorImpl calculator_impl(GetProxy(&handle));
+  ThreadSafeInterfacePtr<math::Calculator> calculator(handle.Pass());
+
+  ResponseQueue responses;
+  std::vector<double> totals;
+  calculator.Post(
+      [&totals](math::Calculator* proxy) {
+        proxy->Add(2.0, [&totals](double total) { totals.push_back(total); });
+        proxy->Multiply(5.0,
+                        [&totals](double total) { totals.push_back(total); });
+      },
+      &responses);
+  calculator.Post(
+      [&totals](math::Calculator* proxy) {
+        proxy->Add(1.0, [&totals](double total) { totals.push_back(total); });
+      },
+      &responses);
+  calculator.Flush();
+  PumpMessages();
+
+  // The responses have arrived, but are only run once the queue is run.
+  EXPECT_TRUE(totals.empty());
+  EXPECT_EQ(3u, responses.RunPendingTasks());
+  EXPECT_EQ((std::vector<double>{2.0, 10.0, 11.0}), totals);
+}
+
+// Calls may be made from any number of threads, with their responses run on
+// the calling threads.
+TEST_F(ThreadSafeInterfacePtrTest, CallsFromManyThreads) {
+  const int kNumThreads = 4;
+  const int kNumCallsPerThread = 100;
+
+  InterfaceHandle<math::Calculator> handle;
+  MathCalculatorImpl calculator_impl(GetProxy(&handle));
+  ThreadSafeInterfacePtr<math::Calculator> calculator(handle.Pass());
+
+  std::atomic<int> num_threads_done(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.push_back(std::thread([&calculator, &num_threads_done]() {
+      ResponseQueue responses;
+      int num_responses = 0;
+      double last_total = 0.0;
+      for (int j = 0; j < kNumCallsPerThread; j++) {
+        calculator.Post(
+            [&num_responses, &last_total](math::Calculator* proxy) {
+              proxy->Add(1.0, [&num_responses, &last_total](double total) {
+                // Each thread's calls are handled in order.
+                EXPECT_LT(last_total, total);
+                last_total = total;
+                num_responses++;
+              });
+            },
+            &responses);
+      }
+      while (num_responses < kNumCallsPerThread)
+        responses.WaitAndRunPendingTasks();
+      num_threads_done++;
+    }));
+  }
+
+  // The test thread is the pipe thread, so it has to keep pumping messages
+  // until the other threads are done.
+  while (num_threads_done < kNumThreads)
+    PumpMessages();
+  for (auto& thread : threads)
+    thread.join();
+
+  ResponseQueue responses;
+  double total = 0.0;
+  calculator.Post(
+      [&total](math::Calculator* proxy) {
+        proxy->Multiply(1.0, [&total](double value) { total = value; });
+      },
+      &responses);
+  calculator.Flush();
+  PumpMessages();
+  EXPECT_EQ(1u, responses.RunPendingTasks());
+  EXPECT_EQ(static_cast<double>(kNumThreads * kNumCallsPerThread), total);
+}
+
+// Responses that never come are destroyed by the executor without being run.
+TEST_F(ThreadSafeInterfacePtrTest, DestroyWithCallsPending) {
+  InterfaceHandle<math::Calculator> handle;
+  InterfaceRequest<math::Calculator> request = GetProxy(&handle);
+
+  ResponseQueue responses;
+  bool called = false;
+  {
+    ThreadSafeInterfacePtr<math::Calculator> calculator(handle.Pass());
+    calculator.Post(
+        [&called](math::Calculator* proxy) {
+          proxy->Add(1.0, [&called](double total) { called = true; });
+        },
+        &responses);
+    calculator.Flush();
+  }
+  PumpMessages();
+
+  EXPECT_EQ(1u, responses.RunPendingTasks());
+  EXPECT_FALSE(called);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mojo
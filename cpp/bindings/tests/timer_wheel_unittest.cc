@@ -0,0 +1,84 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/bindings/lib/timer_wheel.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace mojo {
+namespace test {
+namespace {
+
+using internal::TimerWheel;
+
+std::vector<uint64_t> Expire(TimerWheel* wheel, MojoTimeTicks now) {
+  std::vector<uint64_t> expired;
+  wheel->Expire(now, &expired);
+  std::sort(expired.begin(), expired.end());
+  return expired;
+}
+
+TEST(TimerWheelTest, Basic) {
+  TimerWheel wheel(10, 8u);
+  EXPECT_TRUE(wheel.empty());
+
+  wheel.Add(1u, 25);
+  wheel.Add(2u, 30);
+  wheel.Add(3u, 31);
+  EXPECT_FALSE(wheel.empty());
+  EXPECT_LE(wheel.GetNextWakeUpTime(), 30);
+
+  // Expiry is rounded up to the next tick, so nothing expires early.
+  EXPECT_TRUE(Expire(&wheel, 24).empty());
+  EXPECT_TRUE(Expire(&wheel, 29).empty());
+  EXPECT_EQ((std::vector<uint64_t>{1u, 2u}), Expire(&wheel, 30));
+  EXPECT_LE(wheel.GetNextWakeUpTime(), 40);
+  EXPECT_EQ((std::vector<uint64_t>{3u}), Expire(&wheel, 45));
+  EXPECT_TRUE(wheel.empty());
+}
+
+// Expiries more than a turn of the wheel away stay until their turn.
+TEST(TimerWheelTest, LaterTurns) {
+  TimerWheel wheel(10, 4u);
+
+  wheel.Add(1u, 10);
+  wheel.Add(2u, 50);
+  wheel.Add(3u, 90);
+
+  EXPECT_EQ((std::vector<uint64_t>{1u}), Expire(&wheel, 10));
+  EXPECT_LE(wheel.GetNextWakeUpTime(), 50);
+  EXPECT_EQ((std::vector<uint64_t>{2u}), Expire(&wheel, 55));
+  EXPECT_LE(wheel.GetNextWakeUpTime(), 90);
+  EXPECT_TRUE(Expire(&wheel, 85).empty());
+  EXPECT_EQ((std::vector<uint64_t>{3u}), Expire(&wheel, 90));
+  EXPECT_TRUE(wheel.empty());
+}
+
+// Any number of ticks may pass between calls to Expire().
+TEST(TimerWheelTest, LongGap) {
+  TimerWheel wheel(10, 4u);
+
+  for (uint64_t i = 0; i < 100u; ++i)
+    wheel.Add(i, static_cast<MojoTimeTicks>(i * 7u));
+
+  EXPECT_EQ(100u, Expire(&wheel, 10000).size());
+  EXPECT_TRUE(wheel.empty());
+}
+
+// Expiries that have already passed expire the next time.
+TEST(TimerWheelTest, AddPastExpiry) {
+  TimerWheel wheel(10, 4u);
+
+  EXPECT_TRUE(Expire(&wheel, 100).empty());
+  wheel.Add(1u, 50);
+  EXPECT_LE(wheel.GetNextWakeUpTime(), 110);
+  EXPECT_EQ((std::vector<uint64_t>{1u}), Expire(&wheel, 110));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mojo
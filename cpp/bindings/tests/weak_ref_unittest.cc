@@ -0,0 +1,113 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/bindings/lib/weak_ref.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace mojo {
+namespace test {
+namespace {
+
+using internal::WeakAnchor;
+using internal::WeakRef;
+
+struct Object {
+  Object() : anchor(this) {}
+
+  WeakAnchor<Object> anchor;
+};
+
+TEST(WeakRefTest, Basic) {
+  WeakRef<Object> null_ref;
+  EXPECT_FALSE(null_ref.get());
+
+  WeakRef<Object> ref;
+  {
+    Object object;
+    ref = object.anchor.GetRef();
+    WeakRef<Object> copy = ref;
+    EXPECT_EQ(&object, ref.get());
+    EXPECT_EQ(&object, copy.get());
+  }
+  EXPECT_FALSE(ref.get());
+}
+
+TEST(WeakRefTest, Invalidate) {
+  Object object;
+  WeakRef<Object> ref = object.anchor.GetRef();
+  object.anchor.Invalidate();
+  EXPECT_FALSE(ref.get());
+
+  // New references may be handed out afterwards.
+  WeakRef<Object> new_ref = object.anchor.GetRef();
+  EXPECT_EQ(&object, new_ref.get());
+  EXPECT_FALSE(ref.get());
+}
+
+// A reference stays invalid after its slot is reused for another object.
+TEST(WeakRefTest, StaleAfterSlotReuse) {
+  std::vector<WeakRef<Object>> stale_refs;
+  for (int i = 0; i < 100; i++) {
+    Object object;
+    stale_refs.push_back(object.anchor.GetRef());
+  }
+
+  std::vector<std::unique_ptr<Object>> objects;
+  for (int i = 0; i < 100; i++) {
+    objects.push_back(std::unique_ptr<Object>(new Object()));
+    EXPECT_EQ(objects.back().get(), objects.back()->anchor.GetRef().get());
+  }
+  for (const auto& ref : stale_refs)
+    EXPECT_FALSE(ref.get());
+}
+
+TEST(WeakRefTest, Swap) {
+  Object object1;
+  Object object2;
+  Object object3;
+  WeakRef<Object> ref1 = object1.anchor.GetRef();
+  WeakRef<Object> ref3 = object3.anchor.GetRef();
+
+  object1.anchor.Swap(&object2.anchor);
+  EXPECT_EQ(&object2, ref1.get());
+  EXPECT_EQ(&object2, object2.anchor.GetRef().get());
+  EXPECT_EQ(&object1, object1.anchor.GetRef().get());
+
+  object2.anchor.Swap(&object3.anchor);
+  EXPECT_EQ(&object3, ref1.get());
+  EXPECT_EQ(&object2, ref3.get());
+}
+
+// Slots may be acquired and released on many threads at once.
+TEST(WeakRefTest, ManyThreads) {
+  const int kNumThreads = 4;
+  const int kNumObjectsPerThread = 10000;
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.push_back(std::thread([]() {
+      std::vector<WeakRef<Object>> stale_refs;
+      for (int j = 0; j < kNumObjectsPerThread; j++) {
+        Object object;
+        WeakRef<Object> ref = object.anchor.GetRef();
+        EXPECT_EQ(&object, ref.get());
+        if (j % 100 == 0)
+          stale_refs.push_back(ref);
+      }
+      for (const auto& ref : stale_refs)
+        EXPECT_FALSE(ref.get());
+    }));
+  }
+  for (auto& thread : threads)
+    thread.join();
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mojo
@@ -0,0 +1,113 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_PUBLIC_CPP_BINDINGS_THREAD_SAFE_INTERFACE_PTR_H_
+#define MOJO_PUBLIC_CPP_BINDINGS_THREAD_SAFE_INTERFACE_PTR_H_
+
+#include "mojo/public/cpp/bindings/callback.h"
+#include "mojo/public/cpp/bindings/interface_handle.h"
+#include "mojo/public/cpp/bindings/interface_ptr.h"
+#include "mojo/public/cpp/bindings/lib/thread_safe_proxy_core.h"
+#include "mojo/public/cpp/bindings/message.h"
+#include "mojo/public/cpp/bindings/response_executor.h"
+#include "mojo/public/cpp/environment/environment.h"
+#include "mojo/public/cpp/system/macros.h"
+
+namespace mojo {
+
+// A pointer to a local proxy of a remote Interface implementation, like
+// |InterfacePtr|, except that calls may be made through it from any thread.
+//
+// It must be created and destroyed on the thread whose run loop will read and
+// write its message pipe (the "pipe thread"). Calls made through it (see
+// |Post()|) are queued without locking, and are written to the pipe in batches
+// on the pipe thread, in the order they were queued; the pipe thread is only
+// woken up when a call is queued while no other call is pending. The response
+// callback of each call is run, and destroyed, by the |ResponseExecutor| given
+// for it.
+//
+// |Callback| is reference counted, non-atomically, so the executor must run
+// tasks on the calling thread (as a |ResponseQueue| owned by that thread does),
+// unless the interface was generated with |cpp_inline_callbacks|, whose
+// callbacks are move-only and may be run anywhere.
+template <typename Interface>
+class ThreadSafeInterfacePtr {
+ public:
+  // Binds to |info|, using |waiter| as in |InterfacePtr::Bind()|; |waiter|
+  // must belong to the pipe thread.
+  explicit ThreadSafeInterfacePtr(
+      InterfaceHandle<Interface> info,
+      const MojoAsyncWaiter* waiter = Environment::GetDefaultAsyncWaiter())
+      : ptr_(InterfacePtr<Interface>::Create(info.Pass(), waiter)),
+        sink_(&ptr_),
+        core_(&sink_, waiter) {}
+
+  // Closes the message pipe. Calls still queued are dropped, and pending
+  // response callbacks are destroyed (by their executors) without being run.
+  ~ThreadSafeInterfacePtr() {}
+
+  // May be called on any thread. Calls |function| with a proxy (an
+  // |Interface*|), through which it may make any number of calls, which are
+  // queued to be written to the pipe. Responses to those calls are run by
+  // |executor|, which must stay alive until they have all been handed to it
+  // (or this object is destroyed). If no call expects a response, or the
+  // callbacks are move-only (see above), |executor| may be null; any responses
+  // are then run on the pipe thread.
+  template <typename FunctionType>
+  void Post(FunctionType function, ResponseExecutor* executor = nullptr) {
+    internal::CallEnqueuer enqueuer(&core_, executor);
+    typename Interface::Proxy_ proxy(&enqueuer);
+    function(static_cast<Interface*>(&proxy));
+  }
+
+  // Writes the calls queued so far to the pipe now, instead of when the pipe
+  // thread's run loop gets to them. Must be called on the pipe thread.
+  void Flush() { core_.Flush(); }
+
+  // Indicates whether the message pipe has encountered an error. Must be
+  // called on the pipe thread.
+  bool encountered_error() const { return ptr_.encountered_error(); }
+
+  // Registers a handler to receive error notifications, which is called on the
+  // pipe thread. Must be called on the pipe thread.
+  void set_connection_error_handler(const Closure& error_handler) {
+    ptr_.set_connection_error_handler(error_handler);
+  }
+
+ private:
+  // Passes the calls on to |ptr_|'s router on the pipe thread. Calls made
+  // while unbound are dropped.
+  class Sink : public MessageReceiverWithResponder {
+   public:
+    explicit Sink(InterfacePtr<Interface>* ptr) : ptr_(ptr) {}
+    ~Sink() override {}
+
+    bool Accept(Message* message) override {
+      return ptr_->is_bound() &&
+             ptr_->internal_state()->AcceptMessage(message);
+    }
+
+    bool AcceptWithResponder(Message* message,
+                             MessageReceiver* responder) override {
+      return ptr_->is_bound() &&
+             ptr_->internal_state()->AcceptMessageWithResponder(message,
+                                                                responder);
+    }
+
+   private:
+    InterfacePtr<Interface>* const ptr_;
+
+    MOJO_DISALLOW_COPY_AND_ASSIGN(Sink);
+  };
+
+  InterfacePtr<Interface> ptr_;
+  Sink sink_;
+  internal::ThreadSafeProxyCore core_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(ThreadSafeInterfacePtr);
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_PUBLIC_CPP_BINDINGS_THREAD_SAFE_INTERFACE_PTR_H_
@@ -16,6 +16,10 @@ namespace mojo {
 // A class that waits until a handle is ready and calls |callback| with the
 // result. If the AsyncWaiter is deleted before the handle is ready, the wait is
 // cancelled and the callback will not be called.
+//
+// To avoid being woken up for small amounts of data on a data pipe, wait for
+// MOJO_HANDLE_SIGNAL_READ_THRESHOLD (or MOJO_HANDLE_SIGNAL_WRITE_THRESHOLD)
+// after setting a threshold on the handle; see |RunLoop::AddHandler()|.
 class AsyncWaiter {
  public:
   typedef mojo::Callback<void(MojoResult)> Callback;
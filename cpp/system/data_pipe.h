@@ -76,6 +76,41 @@ inline MojoResult CreateDataPipe(
   return rv;
 }
 
+// Sets data pipe producer options to their defaults. See
+// |MojoSetDataPipeProducerOptions()| for complete documentation.
+inline MojoResult SetDataPipeProducerOptionsToDefault(
+    DataPipeProducerHandle data_pipe_producer) {
+  return MojoSetDataPipeProducerOptions(data_pipe_producer.value(), nullptr);
+}
+
+// Sets data pipe producer options (in an "unwrapped" format). See
+// |MojoSetDataPipeProducerOptions()| for complete documentation.
+inline MojoResult SetDataPipeProducerOptions(
+    DataPipeProducerHandle data_pipe_producer,
+    uint32_t write_threshold_num_bytes) {
+  MojoDataPipeProducerOptions options = {
+      static_cast<uint32_t>(sizeof(MojoDataPipeProducerOptions)),
+      write_threshold_num_bytes};
+  return MojoSetDataPipeProducerOptions(data_pipe_producer.value(), &options);
+}
+
+// Gets data pipe producer options (in an "unwrapped" format). See
+// |MojoGetDataPipeProducerOptions()| for complete documentation.
+inline MojoResult GetDataPipeProducerOptions(
+    DataPipeProducerHandle data_pipe_producer,
+    uint32_t* write_threshold_num_bytes) {
+  MojoDataPipeProducerOptions options = {};
+  MojoResult rv =
+      MojoGetDataPipeProducerOptions(data_pipe_producer.value(), &options,
+                                     static_cast<uint32_t>(sizeof(options)));
+  if (rv == MOJO_RESULT_OK) {
+    // No need to check |struct_size|, since all versions of the struct have
+    // this field.
+    *write_threshold_num_bytes = options.write_threshold_num_bytes;
+  }
+  return rv;
+}
+
 // Writes to a data pipe. See |MojoWriteData| for complete documentation.
 inline MojoResult WriteDataRaw(DataPipeProducerHandle data_pipe_producer,
                                const void* elements,
@@ -117,5 +117,44 @@ TEST(DataPipe, Basic) {
             Wait(ch.get(), MOJO_HANDLE_SIGNAL_READ_THRESHOLD, 1000, nullptr));
 }
 
+TEST(DataPipe, WriteThreshold) {
+  const MojoCreateDataPipeOptions options = {
+      static_cast<uint32_t>(sizeof(MojoCreateDataPipeOptions)),
+      MOJO_CREATE_DATA_PIPE_OPTIONS_FLAG_NONE, 1u, 2u};
+  ScopedDataPipeProducerHandle ph;
+  ScopedDataPipeConsumerHandle ch;
+  ASSERT_EQ(MOJO_RESULT_OK, CreateDataPipe(&options, &ph, &ch));
+
+  uint32_t write_threshold = 123u;
+  EXPECT_EQ(MOJO_RESULT_OK,
+            GetDataPipeProducerOptions(ph.get(), &write_threshold));
+  EXPECT_EQ(0u, write_threshold);
+
+  EXPECT_EQ(MOJO_RESULT_OK, SetDataPipeProducerOptions(ph.get(), 2u));
+
+  EXPECT_EQ(MOJO_RESULT_OK,
+            GetDataPipeProducerOptions(ph.get(), &write_threshold));
+  EXPECT_EQ(2u, write_threshold);
+
+  // Write a byte.
+  static const char kA = 'A';
+  uint32_t num_bytes = 1u;
+  EXPECT_EQ(MOJO_RESULT_OK,
+            WriteDataRaw(ph.get(), &kA, &num_bytes, MOJO_WRITE_DATA_FLAG_NONE));
+
+  // Waiting for "write threshold" should fail, though it should be writable.
+  MojoHandleSignalsState state;
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_DEADLINE_EXCEEDED,
+            Wait(ph.get(), MOJO_HANDLE_SIGNAL_WRITE_THRESHOLD, 0, &state));
+  EXPECT_EQ(MOJO_HANDLE_SIGNAL_WRITABLE, state.satisfied_signals);
+
+  // Reset the write threshold/options.
+  EXPECT_EQ(MOJO_RESULT_OK, SetDataPipeProducerOptionsToDefault(ph.get()));
+
+  // Waiting for "write threshold" should now succeed.
+  EXPECT_EQ(MOJO_RESULT_OK,
+            Wait(ph.get(), MOJO_HANDLE_SIGNAL_WRITE_THRESHOLD, 0, nullptr));
+}
+
 }  // namespace mojo
 }  // namespace
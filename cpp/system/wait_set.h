@@ -62,6 +62,35 @@ inline MojoResult WaitSetRemove(WaitSetHandle wait_set, uint64_t cookie) {
   return MojoWaitSetRemove(wait_set.value(), cookie);
 }
 
+// Adds entries in bulk. See |MojoWaitSetAddMany()| for complete documentation.
+// If |results| is non-null, it is resized to |entries.size()| (its contents are
+// only meaningful if the result is |MOJO_RESULT_OK| or
+// |MOJO_SYSTEM_RESULT_ABORTED|).
+inline MojoResult WaitSetAddMany(WaitSetHandle wait_set,
+                                 const std::vector<MojoWaitSetEntry>& entries,
+                                 const struct MojoWaitSetAddOptions* options,
+                                 std::vector<MojoResult>* results) {
+  assert(entries.size() <= static_cast<uint32_t>(-1));
+  if (results)
+    results->resize(entries.size());
+  return MojoWaitSetAddMany(wait_set.value(), entries.data(),
+                            static_cast<uint32_t>(entries.size()), options,
+                            results ? results->data() : nullptr);
+}
+
+// Removes entries in bulk. See |MojoWaitSetRemoveMany()| for complete
+// documentation. |results| is treated as for |WaitSetAddMany()|.
+inline MojoResult WaitSetRemoveMany(WaitSetHandle wait_set,
+                                    const std::vector<uint64_t>& cookies,
+                                    std::vector<MojoResult>* results) {
+  assert(cookies.size() <= static_cast<uint32_t>(-1));
+  if (results)
+    results->resize(cookies.size());
+  return MojoWaitSetRemoveMany(wait_set.value(), cookies.data(),
+                               static_cast<uint32_t>(cookies.size()),
+                               results ? results->data() : nullptr);
+}
+
 inline MojoResult WaitSetWait(WaitSetHandle wait_set,
                               MojoDeadline deadline,
                               std::vector<MojoWaitSetResult>* results,
@@ -0,0 +1,110 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_PUBLIC_CPP_UTILITY_BUFFER_MAPPING_CACHE_H_
+#define MOJO_PUBLIC_CPP_UTILITY_BUFFER_MAPPING_CACHE_H_
+
+#include <mojo/system/buffer.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+
+#include "mojo/public/cpp/system/buffer.h"
+#include "mojo/public/cpp/system/macros.h"
+
+namespace mojo {
+
+// Caches shared buffer mappings, so that repeatedly mapping the same range of
+// the same buffer (e.g., for every frame) reuses a single mapping instead of
+// mapping and unmapping each time. Mappings are keyed on the buffer handle, the
+// range (offset and size), and the map flags.
+//
+// Each successful |Map()| must be balanced by a |Release()|. Released mappings
+// are kept (and reused by later |Map()|s) until |Trim()|, |Invalidate()|, or
+// destruction.
+//
+// Since handle values may be reused after a handle is closed, |Invalidate()|
+// must be called for a buffer handle before it is closed (or transferred).
+// Mappings remain valid after the handle is closed, so mappings that are still
+// in use are only unmapped once they're released.
+//
+// The map flags other than |MOJO_MAP_BUFFER_FLAG_NONE| are treated as hints: if
+// the implementation doesn't support them, the range is mapped without them.
+//
+// This class is not thread-safe.
+class BufferMappingCache {
+ public:
+  BufferMappingCache();
+  // All mappings must have been released.
+  ~BufferMappingCache();
+
+  // Maps (or reuses an existing mapping of) the range of |buffer| given by
+  // |offset| and |num_bytes|. On success, sets |*pointer| to the mapped memory.
+  // See |MapBuffer()| for possible errors.
+  MojoResult Map(SharedBufferHandle buffer,
+                 uint64_t offset,
+                 uint64_t num_bytes,
+                 MojoMapBufferFlags flags,
+                 void** pointer);
+
+  // Releases a mapping obtained from |Map()| (|pointer| must be the value
+  // returned by |Map()|).
+  void Release(void* pointer);
+
+  // Forgets all mappings of |buffer|, unmapping those that aren't in use.
+  void Invalidate(SharedBufferHandle buffer);
+
+  // Unmaps all mappings that aren't in use.
+  void Trim();
+
+  // Returns the number of mappings (including those not in use). (This is
+  // mostly used for testing.)
+  size_t num_mappings() const { return mappings_.size(); }
+
+ private:
+  struct Key {
+    Key(MojoHandle handle,
+        uint64_t offset,
+        uint64_t num_bytes,
+        MojoMapBufferFlags flags)
+        : handle(handle), offset(offset), num_bytes(num_bytes), flags(flags) {}
+
+    bool operator<(const Key& other) const;
+
+    MojoHandle handle;
+    uint64_t offset;
+    uint64_t num_bytes;
+    MojoMapBufferFlags flags;
+  };
+
+  struct MappingInfo {
+    explicit MappingInfo(const Key& key) : key(key) {}
+
+    Key key;
+    // Number of outstanding |Map()|s (not yet |Release()|d).
+    unsigned ref_count = 0u;
+    // If false, the mapping is no longer in |key_to_pointer_| (and will be
+    // unmapped when |ref_count| drops to zero).
+    bool is_cached = true;
+  };
+
+  using KeyToPointerMap = std::map<Key, void*>;
+  using PointerToMappingInfoMap = std::map<void*, MappingInfo>;
+
+  // Unmaps the mapping given by |it| and erases it from |mappings_|.
+  void Unmap(PointerToMappingInfoMap::iterator it);
+
+  // Contains only the mappings that may be reused by |Map()|.
+  KeyToPointerMap key_to_pointer_;
+  // All mappings, including those that have been invalidated but not yet
+  // released.
+  PointerToMappingInfoMap mappings_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(BufferMappingCache);
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_PUBLIC_CPP_UTILITY_BUFFER_MAPPING_CACHE_H_
@@ -0,0 +1,92 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_PUBLIC_CPP_UTILITY_DATA_PIPE_DRAINER_H_
+#define MOJO_PUBLIC_CPP_UTILITY_DATA_PIPE_DRAINER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mojo/public/cpp/system/data_pipe.h"
+#include "mojo/public/cpp/system/macros.h"
+#include "mojo/public/cpp/utility/run_loop_handler.h"
+
+namespace mojo {
+
+class RunLoop;
+
+// Asynchronously reads all the data from a data pipe consumer handle, using the
+// current thread's |RunLoop|, and hands it to a |Client| in chunks. Each time
+// the handle becomes ready, *all* the data that is currently available is read
+// (using two-phase reads, so no copy is made) before waiting again; thus a busy
+// pipe costs one wakeup per batch of chunks instead of one wakeup per chunk.
+//
+// If a nonzero |read_threshold_num_bytes| is given, the consumer's read
+// threshold is set to it and the drainer waits for
+// |MOJO_HANDLE_SIGNAL_READ_THRESHOLD| instead of |MOJO_HANDLE_SIGNAL_READABLE|,
+// so that it isn't woken up for small amounts of data. (Any data remaining
+// below the threshold when the producer is closed is still delivered.)
+//
+// This class is not thread-safe.
+class DataPipeDrainer : public RunLoopHandler {
+ public:
+  class Client {
+   public:
+    // Called with each chunk of data that is read. |data| is only valid for the
+    // duration of the call. This must not destroy the |DataPipeDrainer|.
+    virtual void OnDataAvailable(const void* data, size_t num_bytes) = 0;
+
+    // Called (once) when all the data has been read and the producer has been
+    // closed (or if some other error occurs). The |DataPipeDrainer| may be
+    // destroyed from within this call.
+    virtual void OnDataComplete() = 0;
+
+   protected:
+    virtual ~Client() {}
+  };
+
+  // Counters, mainly for tuning and testing.
+  struct Stats {
+    // Number of times the drainer was woken up by the |RunLoop|.
+    uint64_t num_wakeups = 0u;
+    // Number of (two-phase) reads completed.
+    uint64_t num_chunks = 0u;
+    uint64_t num_bytes = 0u;
+  };
+
+  DataPipeDrainer(Client* client, ScopedDataPipeConsumerHandle source);
+  DataPipeDrainer(Client* client,
+                  ScopedDataPipeConsumerHandle source,
+                  uint32_t read_threshold_num_bytes);
+  ~DataPipeDrainer() override;
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  // Registers with the |RunLoop| to wait for more data.
+  void WaitForData();
+
+  // Reads all the currently-available data. Returns false if no more data will
+  // become available (i.e., the producer has been closed and all data has been
+  // read, or there was some other error).
+  bool ReadAvailableData();
+
+  // |RunLoopHandler|:
+  void OnHandleReady(Id id) override;
+  void OnHandleError(Id id, MojoResult result) override;
+
+  Client* const client_;
+  ScopedDataPipeConsumerHandle source_;
+  MojoHandleSignals wait_signals_;
+  RunLoop* const run_loop_;
+  // Nonzero if registered with |run_loop_|.
+  Id handler_id_ = 0u;
+  Stats stats_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(DataPipeDrainer);
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_PUBLIC_CPP_UTILITY_DATA_PIPE_DRAINER_H_
@@ -0,0 +1,111 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_PUBLIC_CPP_UTILITY_DATA_PIPE_FILLER_H_
+#define MOJO_PUBLIC_CPP_UTILITY_DATA_PIPE_FILLER_H_
+
+#include <stdint.h>
+
+#include "mojo/public/cpp/system/data_pipe.h"
+#include "mojo/public/cpp/system/macros.h"
+#include "mojo/public/cpp/utility/run_loop_handler.h"
+
+namespace mojo {
+
+class RunLoop;
+
+// Asynchronously writes data, provided by a |Client|, to a data pipe producer
+// handle, using the current thread's |RunLoop|. Each time the handle becomes
+// writable, the client is asked to fill *all* the space that is currently
+// available (using two-phase writes, so the client writes directly into the
+// data pipe) before waiting again; thus a fast client costs one wakeup per
+// batch of chunks instead of one wakeup per chunk. When the client indicates
+// that it is done, the producer handle is closed.
+//
+// If a nonzero |write_threshold_num_bytes| is given, the producer's write
+// threshold is set to it and the filler waits for
+// |MOJO_HANDLE_SIGNAL_WRITE_THRESHOLD| instead of
+// |MOJO_HANDLE_SIGNAL_WRITABLE|, so that it isn't woken up whenever the
+// consumer frees up a small amount of space.
+//
+// This class is not thread-safe.
+class DataPipeFiller : public RunLoopHandler {
+ public:
+  class Client {
+   public:
+    // Called with a buffer of |buffer_num_bytes| bytes of free space in the
+    // data pipe. The client should write (up to) that many bytes to |buffer|
+    // and return the number of bytes written, which must be a multiple of the
+    // data pipe's element size. The client should set |*is_done| to true if it
+    // has no further data (in which case the producer handle will be closed).
+    // If the client returns zero without setting |*is_done|, the filler stops
+    // waiting for space until |Resume()| is called. This must not destroy the
+    // |DataPipeFiller|.
+    virtual uint32_t OnSpaceAvailable(void* buffer,
+                                      uint32_t buffer_num_bytes,
+                                      bool* is_done) = 0;
+
+    // Called (once) when the producer handle has been closed. |result| is
+    // |MOJO_RESULT_OK| if the client indicated that it was done, or an error
+    // (typically |MOJO_SYSTEM_RESULT_FAILED_PRECONDITION|, if the consumer was
+    // closed). The |DataPipeFiller| may be destroyed from within this call.
+    virtual void OnFillComplete(MojoResult result) = 0;
+
+   protected:
+    virtual ~Client() {}
+  };
+
+  // Counters, mainly for tuning and testing.
+  struct Stats {
+    // Number of times the filler was woken up by the |RunLoop|.
+    uint64_t num_wakeups = 0u;
+    // Number of (two-phase) writes completed.
+    uint64_t num_chunks = 0u;
+    uint64_t num_bytes = 0u;
+  };
+
+  DataPipeFiller(Client* client, ScopedDataPipeProducerHandle destination);
+  DataPipeFiller(Client* client,
+                 ScopedDataPipeProducerHandle destination,
+                 uint32_t write_threshold_num_bytes);
+  ~DataPipeFiller() override;
+
+  // Resumes waiting for space after the client declined to write any data. (It
+  // is harmless to call this if the filler is already waiting.) This must not
+  // be called from within |Client::OnSpaceAvailable()|.
+  void Resume();
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  // Registers with the |RunLoop| to wait for space.
+  void WaitForSpace();
+
+  // Has the client fill all the currently-available space. Returns
+  // |MOJO_SYSTEM_RESULT_SHOULD_WAIT| if it should wait for more space,
+  // |MOJO_SYSTEM_RESULT_BUSY| if the client declined to write, |MOJO_RESULT_OK|
+  // if the client is done, and some other error on failure.
+  MojoResult WriteAvailableSpace();
+
+  // Closes the producer handle and notifies the client.
+  void Complete(MojoResult result);
+
+  // |RunLoopHandler|:
+  void OnHandleReady(Id id) override;
+  void OnHandleError(Id id, MojoResult result) override;
+
+  Client* const client_;
+  ScopedDataPipeProducerHandle destination_;
+  MojoHandleSignals wait_signals_;
+  RunLoop* const run_loop_;
+  // Nonzero if registered with |run_loop_|.
+  Id handler_id_ = 0u;
+  Stats stats_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(DataPipeFiller);
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_PUBLIC_CPP_UTILITY_DATA_PIPE_FILLER_H_
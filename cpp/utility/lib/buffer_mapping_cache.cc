@@ -0,0 +1,115 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/utility/buffer_mapping_cache.h"
+
+#include <assert.h>
+
+#include <iterator>
+#include <tuple>
+#include <utility>
+
+namespace mojo {
+namespace {
+
+// Flags that may be dropped if the implementation doesn't support them.
+constexpr MojoMapBufferFlags kMapBufferHintFlags =
+    MOJO_MAP_BUFFER_FLAG_READ_ONLY | MOJO_MAP_BUFFER_FLAG_PREFAULT |
+    MOJO_MAP_BUFFER_FLAG_HUGE_PAGES;
+
+}  // namespace
+
+bool BufferMappingCache::Key::operator<(const Key& other) const {
+  return std::tie(handle, offset, num_bytes, flags) <
+         std::tie(other.handle, other.offset, other.num_bytes, other.flags);
+}
+
+BufferMappingCache::BufferMappingCache() {}
+
+BufferMappingCache::~BufferMappingCache() {
+  while (!mappings_.empty()) {
+    assert(!mappings_.begin()->second.ref_count);
+    Unmap(mappings_.begin());
+  }
+}
+
+MojoResult BufferMappingCache::Map(SharedBufferHandle buffer,
+                                   uint64_t offset,
+                                   uint64_t num_bytes,
+                                   MojoMapBufferFlags flags,
+                                   void** pointer) {
+  assert(pointer);
+
+  Key key(buffer.value(), offset, num_bytes, flags);
+  auto it = key_to_pointer_.find(key);
+  if (it != key_to_pointer_.end()) {
+    auto mapping_it = mappings_.find(it->second);
+    assert(mapping_it != mappings_.end());
+    mapping_it->second.ref_count++;
+    *pointer = it->second;
+    return MOJO_RESULT_OK;
+  }
+
+  void* new_pointer = nullptr;
+  MojoResult result = MapBuffer(buffer, offset, num_bytes, &new_pointer, flags);
+  if (result == MOJO_SYSTEM_RESULT_UNIMPLEMENTED &&
+      (flags & kMapBufferHintFlags)) {
+    result = MapBuffer(buffer, offset, num_bytes, &new_pointer,
+                       flags & ~kMapBufferHintFlags);
+  }
+  if (result != MOJO_RESULT_OK)
+    return result;
+
+  key_to_pointer_.insert(std::make_pair(key, new_pointer));
+  auto mapping_it =
+      mappings_.insert(std::make_pair(new_pointer, MappingInfo(key))).first;
+  mapping_it->second.ref_count = 1u;
+  *pointer = new_pointer;
+  return MOJO_RESULT_OK;
+}
+
+void BufferMappingCache::Release(void* pointer) {
+  auto it = mappings_.find(pointer);
+  assert(it != mappings_.end());
+  assert(it->second.ref_count > 0u);
+  if (--it->second.ref_count == 0u && !it->second.is_cached)
+    Unmap(it);
+}
+
+void BufferMappingCache::Invalidate(SharedBufferHandle buffer) {
+  // |Key|s are ordered by handle first, so all the mappings for |buffer| are
+  // contiguous.
+  auto it = key_to_pointer_.lower_bound(Key(buffer.value(), 0u, 0u, 0u));
+  while (it != key_to_pointer_.end() && it->first.handle == buffer.value()) {
+    auto mapping_it = mappings_.find(it->second);
+    assert(mapping_it != mappings_.end());
+    it = key_to_pointer_.erase(it);
+    if (mapping_it->second.ref_count)
+      mapping_it->second.is_cached = false;
+    else
+      Unmap(mapping_it);
+  }
+}
+
+void BufferMappingCache::Trim() {
+  for (auto it = mappings_.begin(); it != mappings_.end();) {
+    auto next_it = std::next(it);
+    if (!it->second.ref_count) {
+      // Since it's not in use, it must still be cached.
+      assert(it->second.is_cached);
+      key_to_pointer_.erase(it->second.key);
+      Unmap(it);
+    }
+    it = next_it;
+  }
+}
+
+void BufferMappingCache::Unmap(PointerToMappingInfoMap::iterator it) {
+  MojoResult result = UnmapBuffer(it->first);
+  MOJO_ALLOW_UNUSED_LOCAL(result);
+  assert(result == MOJO_RESULT_OK);
+  mappings_.erase(it);
+}
+
+}  // namespace mojo
@@ -0,0 +1,104 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/utility/data_pipe_drainer.h"
+
+#include <assert.h>
+#include <mojo/system/time.h>
+
+#include "mojo/public/cpp/utility/run_loop.h"
+
+namespace mojo {
+
+DataPipeDrainer::DataPipeDrainer(Client* client,
+                                 ScopedDataPipeConsumerHandle source)
+    : DataPipeDrainer(client, source.Pass(), 0u) {}
+
+DataPipeDrainer::DataPipeDrainer(Client* client,
+                                 ScopedDataPipeConsumerHandle source,
+                                 uint32_t read_threshold_num_bytes)
+    : client_(client),
+      source_(source.Pass()),
+      wait_signals_(MOJO_HANDLE_SIGNAL_READABLE),
+      run_loop_(RunLoop::current()) {
+  assert(client_);
+  assert(source_.is_valid());
+  assert(run_loop_);
+
+  if (read_threshold_num_bytes) {
+    MojoResult result =
+        SetDataPipeConsumerOptions(source_.get(), read_threshold_num_bytes);
+    MOJO_ALLOW_UNUSED_LOCAL(result);
+    assert(result == MOJO_RESULT_OK);
+    wait_signals_ = MOJO_HANDLE_SIGNAL_READ_THRESHOLD;
+  }
+
+  WaitForData();
+}
+
+DataPipeDrainer::~DataPipeDrainer() {
+  if (handler_id_)
+    run_loop_->RemoveHandler(handler_id_);
+}
+
+void DataPipeDrainer::WaitForData() {
+  assert(!handler_id_);
+  handler_id_ = run_loop_->AddHandler(this, source_.get(), wait_signals_,
+                                      MOJO_DEADLINE_INDEFINITE);
+}
+
+bool DataPipeDrainer::ReadAvailableData() {
+  for (;;) {
+    const void* buffer = nullptr;
+    uint32_t num_bytes = 0u;
+    MojoResult result = BeginReadDataRaw(source_.get(), &buffer, &num_bytes,
+                                         MOJO_READ_DATA_FLAG_NONE);
+    if (result == MOJO_SYSTEM_RESULT_SHOULD_WAIT)
+      return true;
+    // |MOJO_SYSTEM_RESULT_FAILED_PRECONDITION| means that the producer was
+    // closed and there's no more data; anything else is unexpected, but there's
+    // nothing we can do about it.
+    if (result != MOJO_RESULT_OK)
+      return false;
+
+    client_->OnDataAvailable(buffer, num_bytes);
+
+    result = EndReadDataRaw(source_.get(), num_bytes);
+    MOJO_ALLOW_UNUSED_LOCAL(result);
+    assert(result == MOJO_RESULT_OK);
+
+    stats_.num_chunks++;
+    stats_.num_bytes += num_bytes;
+  }
+}
+
+void DataPipeDrainer::OnHandleReady(Id id) {
+  assert(id == handler_id_);
+  // The |RunLoop| unregisters us before calling us.
+  handler_id_ = 0u;
+  stats_.num_wakeups++;
+
+  if (ReadAvailableData())
+    WaitForData();
+  else
+    client_->OnDataComplete();
+}
+
+void DataPipeDrainer::OnHandleError(Id id, MojoResult result) {
+  assert(id == handler_id_);
+  handler_id_ = 0u;
+
+  // The signal we're waiting for becomes unsatisfiable once the producer is
+  // closed, but there may still be data in the data pipe (in particular, if
+  // we're waiting for |MOJO_HANDLE_SIGNAL_READ_THRESHOLD| and less than the
+  // threshold remains).
+  if (result == MOJO_SYSTEM_RESULT_FAILED_PRECONDITION) {
+    stats_.num_wakeups++;
+    ReadAvailableData();
+  }
+
+  client_->OnDataComplete();
+}
+
+}  // namespace mojo
@@ -0,0 +1,120 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/utility/data_pipe_filler.h"
+
+#include <assert.h>
+#include <mojo/system/time.h>
+
+#include "mojo/public/cpp/utility/run_loop.h"
+
+namespace mojo {
+
+DataPipeFiller::DataPipeFiller(Client* client,
+                               ScopedDataPipeProducerHandle destination)
+    : DataPipeFiller(client, destination.Pass(), 0u) {}
+
+DataPipeFiller::DataPipeFiller(Client* client,
+                               ScopedDataPipeProducerHandle destination,
+                               uint32_t write_threshold_num_bytes)
+    : client_(client),
+      destination_(destination.Pass()),
+      wait_signals_(MOJO_HANDLE_SIGNAL_WRITABLE),
+      run_loop_(RunLoop::current()) {
+  assert(client_);
+  assert(destination_.is_valid());
+  assert(run_loop_);
+
+  if (write_threshold_num_bytes) {
+    MojoResult result = SetDataPipeProducerOptions(destination_.get(),
+                                                   write_threshold_num_bytes);
+    MOJO_ALLOW_UNUSED_LOCAL(result);
+    assert(result == MOJO_RESULT_OK);
+    wait_signals_ = MOJO_HANDLE_SIGNAL_WRITE_THRESHOLD;
+  }
+
+  WaitForSpace();
+}
+
+DataPipeFiller::~DataPipeFiller() {
+  if (handler_id_)
+    run_loop_->RemoveHandler(handler_id_);
+}
+
+void DataPipeFiller::Resume() {
+  if (handler_id_ || !destination_.is_valid())
+    return;
+  WaitForSpace();
+}
+
+void DataPipeFiller::WaitForSpace() {
+  assert(!handler_id_);
+  handler_id_ = run_loop_->AddHandler(this, destination_.get(), wait_signals_,
+                                      MOJO_DEADLINE_INDEFINITE);
+}
+
+MojoResult DataPipeFiller::WriteAvailableSpace() {
+  for (;;) {
+    void* buffer = nullptr;
+    uint32_t buffer_num_bytes = 0u;
+    MojoResult result =
+        BeginWriteDataRaw(destination_.get(), &buffer, &buffer_num_bytes,
+                          MOJO_WRITE_DATA_FLAG_NONE);
+    if (result != MOJO_RESULT_OK)
+      return result;
+
+    bool is_done = false;
+    uint32_t num_bytes =
+        client_->OnSpaceAvailable(buffer, buffer_num_bytes, &is_done);
+    assert(num_bytes <= buffer_num_bytes);
+
+    result = EndWriteDataRaw(destination_.get(), num_bytes);
+    if (result != MOJO_RESULT_OK)
+      return result;
+
+    if (num_bytes) {
+      stats_.num_chunks++;
+      stats_.num_bytes += num_bytes;
+    }
+
+    if (is_done)
+      return MOJO_RESULT_OK;
+    if (!num_bytes)
+      return MOJO_SYSTEM_RESULT_BUSY;
+  }
+}
+
+void DataPipeFiller::Complete(MojoResult result) {
+  destination_.reset();
+  client_->OnFillComplete(result);
+}
+
+void DataPipeFiller::OnHandleReady(Id id) {
+  assert(id == handler_id_);
+  // The |RunLoop| unregisters us before calling us.
+  handler_id_ = 0u;
+  stats_.num_wakeups++;
+
+  MojoResult result = WriteAvailableSpace();
+  switch (result) {
+    case MOJO_SYSTEM_RESULT_SHOULD_WAIT:
+      WaitForSpace();
+      break;
+    case MOJO_SYSTEM_RESULT_BUSY:
+      // Wait for |Resume()|.
+      break;
+    default:
+      Complete(result);
+      break;
+  }
+}
+
+void DataPipeFiller::OnHandleError(Id id, MojoResult result) {
+  assert(id == handler_id_);
+  handler_id_ = 0u;
+
+  Complete(result);
+}
+
+}  // namespace mojo
@@ -25,6 +25,10 @@ namespace {
 constexpr uint32_t kInitialWaitSetNumResults = 16u;
 constexpr uint32_t kMaximumWaitSetNumResults = 256u;
 
+constexpr MojoWaitSetAddOptions kOneShotWaitSetAddOptions = {
+    static_cast<uint32_t>(sizeof(MojoWaitSetAddOptions)),
+    MOJO_WAIT_SET_ADD_OPTIONS_FLAG_ONE_SHOT};
+
 pthread_key_t g_current_run_loop_key;
 
 // Ensures that the "current run loop" functionality is available (i.e., that we
@@ -130,12 +134,9 @@ RunLoopHandler::Id RunLoop::AddHandler(RunLoopHandler* handler,
 
   // Add an entry to |handlers_|.
   handlers_.insert(std::make_pair(
-      id, HandlerInfo(handler, handle_signals, absolute_deadline)));
+      id, HandlerInfo(handler, handle, handle_signals, absolute_deadline)));
   // Add an entry to the wait set.
-  MojoResult result =
-      WaitSetAdd(wait_set_.get(), handle, handle_signals, id, nullptr);
-  MOJO_ALLOW_UNUSED_LOCAL(result);
-  assert(result == MOJO_RESULT_OK);
+  AddWaitSetEntry(id);
 
   return id;
 }
@@ -147,11 +148,9 @@ void RunLoop::RemoveHandler(RunLoopHandler::Id id) {
   auto it = handlers_.find(id);
   if (it == handlers_.end())
     return;
-  handlers_.erase(it);
   // Remove the entry from the wait set.
-  MojoResult result = WaitSetRemove(wait_set_.get(), id);
-  MOJO_ALLOW_UNUSED_LOCAL(result);
-  assert(result == MOJO_RESULT_OK);
+  RemoveWaitSetEntry(id, it->second);
+  handlers_.erase(it);
 }
 
 void RunLoop::PostDelayedTask(const Closure& task, MojoTimeTicks delay) {
@@ -234,17 +233,30 @@ bool RunLoop::DoIteration(bool quit_when_idle) {
 
   // Next, "wait" and deal with handles/handlers.
 
+  // Bring |wait_set_| up to date (even if there are no handlers, since it may
+  // have entries that need to be removed).
+  should_continue |= FlushWaitSetChanges();
+  if (run_state.should_quit)
+    return false;
+
   if (handlers_.empty())
     return should_continue;
 
+  // The handlers notified by |FlushWaitSetChanges()| may have added (or
+  // removed) handlers, whose entries are only brought up to date on the next
+  // iteration; until then, the wait mustn't block.
+  bool has_pending_wait_set_changes = !pending_wait_set_adds_.empty() ||
+                                      !pending_wait_set_removes_.empty();
+  should_continue |= has_pending_wait_set_changes;
+
   // Calculate the deadline for the wait. Don't wait if |quit_when_idle| is
-  // true. Otherwise, the minimum of the earliest delayed task run time and the
-  // earliest handler deadline (or "forever" if there are no delayed tasks and
-  // no handler deadlines). (Warning: |CalculateAbsoluteDeadline()| may return a
-  // deadline earlier than |now|.)
+  // true (or there are pending changes). Otherwise, the minimum of the earliest
+  // delayed task run time and the earliest handler deadline (or "forever" if
+  // there are no delayed tasks and no handler deadlines). (Warning:
+  // |CalculateAbsoluteDeadline()| may return a deadline earlier than |now|.)
   bool absolute_deadline_is_for_delayed_task = false;
   MojoTimeTicks absolute_deadline =
-      quit_when_idle
+      (quit_when_idle || has_pending_wait_set_changes)
           ? now
           : CalculateAbsoluteDeadline(&absolute_deadline_is_for_delayed_task);
   MojoDeadline relative_deadline =
@@ -331,11 +343,153 @@ MojoTimeTicks RunLoop::CalculateAbsoluteDeadline(bool* is_delayed_task) {
   return absolute_deadline;
 }
 
+void RunLoop::AddWaitSetEntry(RunLoopHandler::Id id) {
+  pending_wait_set_adds_.push_back(id);
+}
+
+void RunLoop::RemoveWaitSetEntry(RunLoopHandler::Id id,
+                                 const HandlerInfo& info) {
+  // If the entry hasn't been added yet, |FlushWaitSetChanges()| will skip it
+  // (since the handler will no longer be in |handlers_|).
+  if (info.in_wait_set)
+    pending_wait_set_removes_.push_back(id);
+}
+
+bool RunLoop::FlushWaitSetChanges() {
+  // Do removals first, so that we don't have more entries than necessary.
+  if (!pending_wait_set_removes_.empty()) {
+    RemoveWaitSetEntries(pending_wait_set_removes_);
+    pending_wait_set_removes_.clear();
+  }
+
+  if (pending_wait_set_adds_.empty())
+    return false;
+
+  std::vector<MojoWaitSetEntry> entries;
+  entries.reserve(pending_wait_set_adds_.size());
+  for (auto id : pending_wait_set_adds_) {
+    auto it = handlers_.find(id);
+    if (it == handlers_.end() || it->second.in_wait_set)
+      continue;
+    MojoWaitSetEntry entry = {id, it->second.handle.value(),
+                              it->second.handle_signals};
+    entries.push_back(entry);
+  }
+  pending_wait_set_adds_.clear();
+  if (entries.empty())
+    return false;
+
+  std::vector<MojoResult> results;
+  AddWaitSetEntries(entries, &results);
+  assert(results.size() == entries.size());
+
+  std::vector<std::pair<RunLoopHandler::Id, MojoResult>> failures;
+  for (size_t i = 0u; i < entries.size(); i++) {
+    if (results[i] == MOJO_RESULT_OK)
+      handlers_.find(entries[i].cookie)->second.in_wait_set = true;
+    else
+      failures.push_back(std::make_pair(entries[i].cookie, results[i]));
+  }
+
+  // Notify the handlers whose entries couldn't be added. This happens if a
+  // handle is closed while its handler is registered (but before its entry was
+  // added), in which case we report what the wait would have: that the handle
+  // was closed.
+  bool did_work = false;
+  for (size_t i = 0u; i < failures.size(); i++) {
+    auto id = failures[i].first;
+    auto it = handlers_.find(id);
+    // A handler that we invoke may remove other handlers.
+    if (it == handlers_.end())
+      continue;
+
+    auto handler = it->second.handler;
+    handlers_.erase(it);
+    MojoResult result = failures[i].second;
+    if (result == MOJO_SYSTEM_RESULT_INVALID_ARGUMENT)
+      result = MOJO_SYSTEM_RESULT_CANCELLED;
+    handler->OnHandleError(id, result);
+    did_work = true;
+
+    if (current_run_state_->should_quit) {
+      // Try again next time for the remaining handlers.
+      for (i++; i < failures.size(); i++)
+        pending_wait_set_adds_.push_back(failures[i].first);
+      break;
+    }
+  }
+  return did_work;
+}
+
+void RunLoop::AddWaitSetEntries(const std::vector<MojoWaitSetEntry>& entries,
+                                std::vector<MojoResult>* results) {
+  if (use_bulk_wait_set_ops_) {
+    MojoResult result = WaitSetAddMany(
+        wait_set_.get(), entries,
+        use_one_shot_entries_ ? &kOneShotWaitSetAddOptions : nullptr, results);
+    if (result == MOJO_RESULT_OK || result == MOJO_SYSTEM_RESULT_ABORTED)
+      return;
+    assert(result == MOJO_SYSTEM_RESULT_UNIMPLEMENTED);
+  }
+
+  // Either bulk adds or one-shot entries (or both) aren't supported. Adding the
+  // entries one at a time will tell us whether it's the latter.
+  bool was_using_one_shot_entries = use_one_shot_entries_;
+  results->resize(entries.size());
+  for (size_t i = 0u; i < entries.size(); i++) {
+    const auto& entry = entries[i];
+    MojoResult result = MOJO_SYSTEM_RESULT_UNIMPLEMENTED;
+    if (use_one_shot_entries_) {
+      result = WaitSetAdd(wait_set_.get(), Handle(entry.handle), entry.signals,
+                          entry.cookie, &kOneShotWaitSetAddOptions);
+      // Fall back to removing entries ourselves.
+      if (result == MOJO_SYSTEM_RESULT_UNIMPLEMENTED)
+        use_one_shot_entries_ = false;
+    }
+    if (!use_one_shot_entries_) {
+      result = WaitSetAdd(wait_set_.get(), Handle(entry.handle), entry.signals,
+                          entry.cookie, nullptr);
+    }
+    (*results)[i] = result;
+  }
+  if (use_one_shot_entries_ == was_using_one_shot_entries)
+    use_bulk_wait_set_ops_ = false;
+}
+
+void RunLoop::RemoveWaitSetEntries(const std::vector<uint64_t>& cookies) {
+  if (use_bulk_wait_set_ops_) {
+    MojoResult result = WaitSetRemoveMany(wait_set_.get(), cookies, nullptr);
+    if (result != MOJO_SYSTEM_RESULT_UNIMPLEMENTED) {
+      // We only remove entries that we know are in the wait set.
+      assert(result == MOJO_RESULT_OK);
+      return;
+    }
+    use_bulk_wait_set_ops_ = false;
+  }
+
+  for (auto cookie : cookies) {
+    MojoResult result = WaitSetRemove(wait_set_.get(), cookie);
+    MOJO_ALLOW_UNUSED_LOCAL(result);
+    assert(result == MOJO_RESULT_OK);
+  }
+}
+
 bool RunLoop::NotifyResults(const std::vector<MojoWaitSetResult>& results) {
   assert(!results.empty());
 
+  // One-shot entries have already been removed from the wait set.
+  if (use_one_shot_entries_) {
+    for (const auto& result : results) {
+      auto it = handlers_.find(result.cookie);
+      if (it != handlers_.end())
+        it->second.in_wait_set = false;
+    }
+  }
+
   bool did_work = false;
-  for (const auto& result : results) {
+  size_t i = 0u;
+  for (; i < results.size(); i++) {
+    const auto& result = results[i];
     auto id = result.cookie;
     auto it = handlers_.find(id);
     // Though we should find an entry for the first result, a handler that we
@@ -344,19 +498,29 @@ bool RunLoop::NotifyResults(const std::vector<MojoWaitSetResult>& results) {
       continue;
 
     auto handler = it->second.handler;
+    RemoveWaitSetEntry(id, it->second);
     handlers_.erase(it);
-    MojoResult r = WaitSetRemove(wait_set_.get(), id);
-    MOJO_ALLOW_UNUSED_LOCAL(r);
-    assert(r == MOJO_RESULT_OK);
     if (result.wait_result == MOJO_RESULT_OK)
       handler->OnHandleReady(id);
     else
       handler->OnHandleError(id, result.wait_result);
     did_work = true;
 
-    if (current_run_state_->should_quit)
+    if (current_run_state_->should_quit) {
+      i++;
       break;
+    }
   }
+
+  // If we quit early, the wait set will have removed the one-shot entries for
+  // the remaining results, so we have to add them back.
+  if (use_one_shot_entries_) {
+    for (; i < results.size(); i++) {
+      if (handlers_.find(results[i].cookie) != handlers_.end())
+        AddWaitSetEntry(results[i].cookie);
+    }
+  }
+
   return did_work;
 }
 
@@ -382,6 +546,7 @@ bool RunLoop::NotifyHandlersDeadlineExceeded(MojoTimeTicks absolute_deadline) {
 
     auto handler = it->second.handler;
     auto id = info.id;
+    RemoveWaitSetEntry(id, it->second);
     handlers_.erase(it);       // Invalidates |it|.
     handler_deadlines_.pop();  // Invalidates |info|.
     handler->OnHandleError(id, MOJO_SYSTEM_RESULT_DEADLINE_EXCEEDED);
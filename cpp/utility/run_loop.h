@@ -9,6 +9,7 @@
 
 #include <map>
 #include <queue>
+#include <vector>
 
 #include "mojo/public/cpp/bindings/callback.h"
 #include "mojo/public/cpp/system/handle.h"
@@ -46,6 +47,22 @@ class RunLoop {
   // being destroyed, the newly-added handler's OnHandleError() will also be
   // called; this may lead to an infinite loop if it again calls AddHandler() ad
   // infinitum.
+  //
+  // For data pipe handles, |handle_signals| may be one of the "threshold"
+  // signals (MOJO_HANDLE_SIGNAL_READ_THRESHOLD or
+  // MOJO_HANDLE_SIGNAL_WRITE_THRESHOLD) instead of MOJO_HANDLE_SIGNAL_READABLE
+  // or MOJO_HANDLE_SIGNAL_WRITABLE. The handler is then only woken up once the
+  // threshold set using |SetDataPipeConsumerOptions()| or
+  // |SetDataPipeProducerOptions()| is met, rather than once for every element
+  // that arrives (or is freed up); e.g., a consumer reading 1 MB from a
+  // producer that writes it 64 bytes at a time may be woken up as many as 16384
+  // times waiting for READABLE, but at most 16 times waiting for READ_THRESHOLD
+  // with a 64 KB threshold (if it reads all available data each time).
+  //
+  // Note that a threshold signal becomes unsatisfiable when the peer is closed,
+  // so OnHandleError() is called with MOJO_SYSTEM_RESULT_FAILED_PRECONDITION
+  // even though less than the threshold amount of data may still remain to be
+  // read. (|DataPipeDrainer| and |DataPipeFiller| take care of this.)
   RunLoopHandler::Id AddHandler(RunLoopHandler* handler,
                                 const Handle& handle,
                                 MojoHandleSignals handle_signals,
@@ -77,19 +94,25 @@ class RunLoop {
   // stored in |handlers|, which is a map from |RunLoopHandler::Id|s
   // (generated/returned by |AddHandler()| to |HandlerInfo|s. Each entry in
   // |handlers_| also has a corresponding entry in |wait_set_| (with cookie the
-  // |RunLoopHandler::Id|).
+  // |RunLoopHandler::Id|), though adding it may be pending (see
+  // |FlushWaitSetChanges()|).
   struct HandlerInfo {
     HandlerInfo(RunLoopHandler* handler,
+                Handle handle,
                 MojoHandleSignals handle_signals,
                 MojoTimeTicks absolute_deadline)
         : handler(handler),
+          handle(handle),
           handle_signals(handle_signals),
           absolute_deadline(absolute_deadline) {}
 
     RunLoopHandler* handler;
+    Handle handle;
     MojoHandleSignals handle_signals;
     // |kInvalidTimeTicks| means forever/no deadline/indefinite.
     MojoTimeTicks absolute_deadline;
+    // Whether |wait_set_| (currently) has an entry for this handler.
+    bool in_wait_set = false;
   };
   using IdToHandlerInfoMap = std::map<RunLoopHandler::Id, HandlerInfo>;
 
@@ -152,6 +175,34 @@ class RunLoop {
   // continue.
   bool DoIteration(bool quit_when_idle);
 
+  // Changes to |wait_set_| aren't made immediately. Instead they're
+  // accumulated and made in bulk (using |WaitSetAddMany()| and
+  // |WaitSetRemoveMany()|, if supported) once per iteration, just before
+  // waiting, by |FlushWaitSetChanges()|. This makes registering and
+  // unregistering many (e.g., short-lived) handlers much cheaper.
+
+  // Schedules adding an entry for the given handler to |wait_set_| (one-shot,
+  // if supported).
+  void AddWaitSetEntry(RunLoopHandler::Id id);
+
+  // Schedules removing the entry (if any) for the given handler from
+  // |wait_set_|. This should be called before the handler is removed from
+  // |handlers_|.
+  void RemoveWaitSetEntry(RunLoopHandler::Id id, const HandlerInfo& info);
+
+  // Makes the changes to |wait_set_| scheduled by |AddWaitSetEntry()| and
+  // |RemoveWaitSetEntry()|. Handlers whose entries can't be added (e.g.,
+  // because their handles have been closed) are notified of the error. Returns
+  // true if work was done (i.e., any handler was called).
+  bool FlushWaitSetChanges();
+
+  // Helpers for |FlushWaitSetChanges()|: add/remove the given entries to/from
+  // |wait_set_|, falling back to adding/removing them one at a time if
+  // necessary. |AddWaitSetEntries()| sets |*results| to the per-entry results.
+  void AddWaitSetEntries(const std::vector<MojoWaitSetEntry>& entries,
+                         std::vector<MojoResult>* results);
+  void RemoveWaitSetEntries(const std::vector<uint64_t>& cookies);
+
   // Notifies handlers corresponding to the wait results in |results| (which
   // should not be empty). Returns true if work was done (i.e., any handler was
   // called).
@@ -171,6 +222,17 @@ class RunLoop {
   RunLoopHandler::Id next_id_ = 1u;
   IdToHandlerInfoMap handlers_;
   ScopedWaitSetHandle wait_set_;
+  // Whether |wait_set_| supports MOJO_WAIT_SET_ADD_OPTIONS_FLAG_ONE_SHOT (in
+  // which case the wait set removes entries for us as they're reported). This
+  // is determined by the first |WaitSetAdd()|.
+  bool use_one_shot_entries_ = true;
+  // Whether |wait_set_| supports |WaitSetAddMany()| and |WaitSetRemoveMany()|.
+  bool use_bulk_wait_set_ops_ = true;
+  // The |RunLoopHandler::Id|s of handlers whose entries have yet to be added to
+  // |wait_set_| (which may have been removed from |handlers_| in the meantime).
+  std::vector<RunLoopHandler::Id> pending_wait_set_adds_;
+  // The cookies of entries that have yet to be removed from |wait_set_|.
+  std::vector<uint64_t> pending_wait_set_removes_;
   HandlerDeadlineQueue handler_deadlines_;
   DelayedTaskQueue delayed_tasks_;
 
@@ -0,0 +1,99 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/utility/buffer_mapping_cache.h"
+
+#include "gtest/gtest.h"
+#include "mojo/public/cpp/system/buffer.h"
+
+namespace mojo {
+namespace {
+
+TEST(BufferMappingCacheTest, ReusesMappings) {
+  SharedBuffer buffer(1000u);
+  BufferMappingCache cache;
+
+  void* pointer1 = nullptr;
+  EXPECT_EQ(MOJO_RESULT_OK, cache.Map(buffer.handle.get(), 0u, 100u,
+                                      MOJO_MAP_BUFFER_FLAG_NONE, &pointer1));
+  ASSERT_TRUE(pointer1);
+  static_cast<char*>(pointer1)[0] = 'x';
+
+  // Mapping the same range again (even while the first is still in use) should
+  // give the same mapping.
+  void* pointer2 = nullptr;
+  EXPECT_EQ(MOJO_RESULT_OK, cache.Map(buffer.handle.get(), 0u, 100u,
+                                      MOJO_MAP_BUFFER_FLAG_NONE, &pointer2));
+  EXPECT_EQ(pointer1, pointer2);
+  EXPECT_EQ(1u, cache.num_mappings());
+  cache.Release(pointer2);
+  cache.Release(pointer1);
+
+  // It should still be cached after being released.
+  EXPECT_EQ(1u, cache.num_mappings());
+  pointer2 = nullptr;
+  EXPECT_EQ(MOJO_RESULT_OK, cache.Map(buffer.handle.get(), 0u, 100u,
+                                      MOJO_MAP_BUFFER_FLAG_NONE, &pointer2));
+  EXPECT_EQ(pointer1, pointer2);
+  EXPECT_EQ('x', static_cast<char*>(pointer2)[0]);
+
+  // A different range should get a different mapping.
+  void* pointer3 = nullptr;
+  EXPECT_EQ(MOJO_RESULT_OK, cache.Map(buffer.handle.get(), 500u, 100u,
+                                      MOJO_MAP_BUFFER_FLAG_NONE, &pointer3));
+  EXPECT_NE(pointer2, pointer3);
+  EXPECT_EQ(2u, cache.num_mappings());
+  cache.Release(pointer3);
+
+  // Trimming should only unmap the mapping that isn't in use.
+  cache.Trim();
+  EXPECT_EQ(1u, cache.num_mappings());
+  cache.Release(pointer2);
+  cache.Trim();
+  EXPECT_EQ(0u, cache.num_mappings());
+}
+
+TEST(BufferMappingCacheTest, Invalidate) {
+  SharedBuffer buffer(1000u);
+  BufferMappingCache cache;
+
+  void* pointer1 = nullptr;
+  EXPECT_EQ(MOJO_RESULT_OK, cache.Map(buffer.handle.get(), 0u, 100u,
+                                      MOJO_MAP_BUFFER_FLAG_NONE, &pointer1));
+  void* pointer2 = nullptr;
+  EXPECT_EQ(MOJO_RESULT_OK, cache.Map(buffer.handle.get(), 100u, 100u,
+                                      MOJO_MAP_BUFFER_FLAG_NONE, &pointer2));
+  cache.Release(pointer2);
+  EXPECT_EQ(2u, cache.num_mappings());
+
+  // Only the mapping that isn't in use can be unmapped immediately.
+  cache.Invalidate(buffer.handle.get());
+  EXPECT_EQ(1u, cache.num_mappings());
+  buffer.handle.reset();
+
+  // The mapping that's still in use should still be usable, and be unmapped
+  // once released.
+  static_cast<char*>(pointer1)[0] = 'x';
+  cache.Release(pointer1);
+  EXPECT_EQ(0u, cache.num_mappings());
+}
+
+TEST(BufferMappingCacheTest, HintFlags) {
+  SharedBuffer buffer(1000u);
+  BufferMappingCache cache;
+
+  // Whether or not the hints are supported, mapping should succeed.
+  void* pointer = nullptr;
+  EXPECT_EQ(MOJO_RESULT_OK,
+            cache.Map(buffer.handle.get(), 0u, 1000u,
+                      MOJO_MAP_BUFFER_FLAG_PREFAULT |
+                          MOJO_MAP_BUFFER_FLAG_HUGE_PAGES,
+                      &pointer));
+  ASSERT_TRUE(pointer);
+  static_cast<char*>(pointer)[999] = 'x';
+  cache.Release(pointer);
+}
+
+}  // namespace
+}  // namespace mojo
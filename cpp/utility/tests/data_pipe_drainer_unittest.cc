@@ -0,0 +1,112 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/utility/data_pipe_drainer.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "mojo/public/cpp/system/data_pipe.h"
+#include "mojo/public/cpp/system/macros.h"
+#include "mojo/public/cpp/utility/run_loop.h"
+
+namespace mojo {
+namespace {
+
+class TestDrainerClient : public DataPipeDrainer::Client {
+ public:
+  TestDrainerClient() {}
+  ~TestDrainerClient() override {}
+
+  const std::string& data() const { return data_; }
+  bool is_complete() const { return is_complete_; }
+
+  // |DataPipeDrainer::Client|:
+  void OnDataAvailable(const void* data, size_t num_bytes) override {
+    EXPECT_FALSE(is_complete_);
+    data_.append(static_cast<const char*>(data), num_bytes);
+  }
+  void OnDataComplete() override {
+    EXPECT_FALSE(is_complete_);
+    is_complete_ = true;
+  }
+
+ private:
+  std::string data_;
+  bool is_complete_ = false;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(TestDrainerClient);
+};
+
+void WriteString(DataPipeProducerHandle producer, const std::string& s) {
+  uint32_t num_bytes = static_cast<uint32_t>(s.size());
+  ASSERT_EQ(MOJO_RESULT_OK,
+            WriteDataRaw(producer, s.data(), &num_bytes,
+                         MOJO_WRITE_DATA_FLAG_ALL_OR_NONE));
+  ASSERT_EQ(s.size(), num_bytes);
+}
+
+TEST(DataPipeDrainerTest, Basic) {
+  RunLoop run_loop;
+  DataPipe data_pipe;
+  WriteString(data_pipe.producer_handle.get(), "hello ");
+  WriteString(data_pipe.producer_handle.get(), "world");
+  data_pipe.producer_handle.reset();
+
+  TestDrainerClient client;
+  DataPipeDrainer drainer(&client, data_pipe.consumer_handle.Pass());
+  run_loop.Run();
+
+  EXPECT_TRUE(client.is_complete());
+  EXPECT_EQ("hello world", client.data());
+  EXPECT_EQ(11u, drainer.stats().num_bytes);
+  // All the data was available at once, so it should have been read in a
+  // single wakeup (plus possibly one to notice that the producer was closed).
+  EXPECT_LE(drainer.stats().num_wakeups, 2u);
+  EXPECT_EQ(0u, run_loop.num_handlers());
+}
+
+TEST(DataPipeDrainerTest, ReadThreshold) {
+  RunLoop run_loop;
+  DataPipe data_pipe;
+  WriteString(data_pipe.producer_handle.get(), "abc");
+
+  TestDrainerClient client;
+  DataPipeDrainer drainer(&client, data_pipe.consumer_handle.Pass(), 5u);
+
+  // Below the threshold, so nothing should be read.
+  run_loop.RunUntilIdle();
+  EXPECT_EQ(std::string(), client.data());
+  EXPECT_EQ(0u, drainer.stats().num_wakeups);
+
+  WriteString(data_pipe.producer_handle.get(), "def");
+  run_loop.RunUntilIdle();
+  EXPECT_EQ("abcdef", client.data());
+  EXPECT_FALSE(client.is_complete());
+
+  // Data below the threshold should still be delivered once the producer is
+  // closed.
+  WriteString(data_pipe.producer_handle.get(), "gh");
+  data_pipe.producer_handle.reset();
+  run_loop.Run();
+  EXPECT_TRUE(client.is_complete());
+  EXPECT_EQ("abcdefgh", client.data());
+  EXPECT_EQ(0u, run_loop.num_handlers());
+}
+
+TEST(DataPipeDrainerTest, DestroyBeforeComplete) {
+  RunLoop run_loop;
+  DataPipe data_pipe;
+
+  TestDrainerClient client;
+  {
+    DataPipeDrainer drainer(&client, data_pipe.consumer_handle.Pass());
+    EXPECT_EQ(1u, run_loop.num_handlers());
+  }
+  EXPECT_EQ(0u, run_loop.num_handlers());
+  EXPECT_FALSE(client.is_complete());
+}
+
+}  // namespace
+}  // namespace mojo
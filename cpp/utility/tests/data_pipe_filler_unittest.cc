@@ -0,0 +1,158 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/utility/data_pipe_filler.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "mojo/public/cpp/system/data_pipe.h"
+#include "mojo/public/cpp/system/macros.h"
+#include "mojo/public/cpp/utility/run_loop.h"
+
+namespace mojo {
+namespace {
+
+// Writes the contents of a string (in chunks of at most |max_chunk_size|).
+class StringFillerClient : public DataPipeFiller::Client {
+ public:
+  StringFillerClient(const std::string& data, uint32_t max_chunk_size)
+      : data_(data), max_chunk_size_(max_chunk_size) {}
+  ~StringFillerClient() override {}
+
+  bool is_complete() const { return is_complete_; }
+  MojoResult complete_result() const { return complete_result_; }
+
+  // |DataPipeFiller::Client|:
+  uint32_t OnSpaceAvailable(void* buffer,
+                            uint32_t buffer_num_bytes,
+                            bool* is_done) override {
+    EXPECT_FALSE(is_complete_);
+    size_t num_bytes = std::min(
+        data_.size() - offset_,
+        static_cast<size_t>(std::min(buffer_num_bytes, max_chunk_size_)));
+    memcpy(buffer, data_.data() + offset_, num_bytes);
+    offset_ += num_bytes;
+    *is_done = (offset_ == data_.size());
+    return static_cast<uint32_t>(num_bytes);
+  }
+  void OnFillComplete(MojoResult result) override {
+    EXPECT_FALSE(is_complete_);
+    is_complete_ = true;
+    complete_result_ = result;
+  }
+
+ private:
+  const std::string data_;
+  const uint32_t max_chunk_size_;
+  size_t offset_ = 0u;
+  bool is_complete_ = false;
+  MojoResult complete_result_ = MOJO_SYSTEM_RESULT_UNKNOWN;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(StringFillerClient);
+};
+
+std::string ReadAll(DataPipeConsumerHandle consumer) {
+  std::string rv;
+  for (;;) {
+    char buffer[64] = {};
+    uint32_t num_bytes = static_cast<uint32_t>(sizeof(buffer));
+    if (ReadDataRaw(consumer, buffer, &num_bytes, MOJO_READ_DATA_FLAG_NONE) !=
+        MOJO_RESULT_OK)
+      break;
+    rv.append(buffer, num_bytes);
+  }
+  return rv;
+}
+
+TEST(DataPipeFillerTest, Basic) {
+  RunLoop run_loop;
+  DataPipe data_pipe;
+
+  StringFillerClient client("hello world", 3u);
+  DataPipeFiller filler(&client, data_pipe.producer_handle.Pass());
+  run_loop.Run();
+
+  EXPECT_TRUE(client.is_complete());
+  EXPECT_EQ(MOJO_RESULT_OK, client.complete_result());
+  EXPECT_EQ(11u, filler.stats().num_bytes);
+  EXPECT_EQ(4u, filler.stats().num_chunks);
+  // All the chunks should have been written in a single wakeup.
+  EXPECT_EQ(1u, filler.stats().num_wakeups);
+  EXPECT_EQ(0u, run_loop.num_handlers());
+
+  EXPECT_EQ("hello world", ReadAll(data_pipe.consumer_handle.get()));
+}
+
+// Reads |num_bytes| bytes, which must be available.
+std::string ReadNumBytes(DataPipeConsumerHandle consumer, uint32_t num_bytes) {
+  std::string rv(num_bytes, '\0');
+  EXPECT_EQ(MOJO_RESULT_OK,
+            ReadDataRaw(consumer, &rv[0], &num_bytes,
+                        MOJO_READ_DATA_FLAG_ALL_OR_NONE));
+  return rv;
+}
+
+TEST(DataPipeFillerTest, WriteThreshold) {
+  RunLoop run_loop;
+  const MojoCreateDataPipeOptions options = {
+      static_cast<uint32_t>(sizeof(MojoCreateDataPipeOptions)),
+      MOJO_CREATE_DATA_PIPE_OPTIONS_FLAG_NONE, 1u, 20u};
+  DataPipe data_pipe(options);
+  DataPipeProducerHandle producer = data_pipe.producer_handle.get();
+  DataPipeConsumerHandle consumer = data_pipe.consumer_handle.get();
+
+  const std::string data = "0123456789abcdefghijABCDEFGHIJklmnopqrst";
+  StringFillerClient client(data, 64u);
+  DataPipeFiller filler(&client, data_pipe.producer_handle.Pass(), 10u);
+  uint32_t write_threshold_num_bytes = 0u;
+  EXPECT_EQ(MOJO_RESULT_OK,
+            GetDataPipeProducerOptions(producer, &write_threshold_num_bytes));
+  EXPECT_EQ(10u, write_threshold_num_bytes);
+
+  // The empty pipe is filled in one wakeup.
+  run_loop.RunUntilIdle();
+  EXPECT_EQ(1u, filler.stats().num_wakeups);
+  EXPECT_EQ(20u, filler.stats().num_bytes);
+
+  // Freeing up less than the threshold doesn't wake the filler...
+  EXPECT_EQ(data.substr(0, 5), ReadNumBytes(consumer, 5u));
+  run_loop.RunUntilIdle();
+  EXPECT_EQ(1u, filler.stats().num_wakeups);
+  EXPECT_EQ(20u, filler.stats().num_bytes);
+
+  // ... but freeing up the threshold does.
+  EXPECT_EQ(data.substr(5, 5), ReadNumBytes(consumer, 5u));
+  run_loop.RunUntilIdle();
+  EXPECT_EQ(2u, filler.stats().num_wakeups);
+  EXPECT_EQ(30u, filler.stats().num_bytes);
+  EXPECT_FALSE(client.is_complete());
+
+  EXPECT_EQ(data.substr(10, 20), ReadNumBytes(consumer, 20u));
+  run_loop.Run();
+  EXPECT_TRUE(client.is_complete());
+  EXPECT_EQ(MOJO_RESULT_OK, client.complete_result());
+  EXPECT_EQ(3u, filler.stats().num_wakeups);
+  EXPECT_EQ(data.substr(30), ReadAll(consumer));
+}
+
+TEST(DataPipeFillerTest, ConsumerClosed) {
+  RunLoop run_loop;
+  DataPipe data_pipe;
+  data_pipe.consumer_handle.reset();
+
+  StringFillerClient client("hello world", 3u);
+  DataPipeFiller filler(&client, data_pipe.producer_handle.Pass());
+  run_loop.Run();
+
+  EXPECT_TRUE(client.is_complete());
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_FAILED_PRECONDITION, client.complete_result());
+  EXPECT_EQ(0u, filler.stats().num_bytes);
+}
+
+}  // namespace
+}  // namespace mojo
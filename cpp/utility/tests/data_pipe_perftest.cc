@@ -0,0 +1,125 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file has perf tests for streaming data through a data pipe to a
+// |DataPipeDrainer| (on a |RunLoop|), with and without a read threshold. Each
+// test streams 1 GB, written by another thread in chunks of various sizes, and
+// reports both the throughput and the number of times the consumer was woken
+// up per megabyte.
+
+#include <mojo/system/time.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mojo/public/cpp/system/data_pipe.h"
+#include "mojo/public/cpp/system/macros.h"
+#include "mojo/public/cpp/system/wait.h"
+#include "mojo/public/cpp/test_support/test_support.h"
+#include "mojo/public/cpp/utility/data_pipe_drainer.h"
+#include "mojo/public/cpp/utility/run_loop.h"
+
+namespace mojo {
+namespace {
+
+constexpr uint64_t kTotalNumBytes = 1024u * 1024u * 1024u;
+constexpr uint32_t kCapacityNumBytes = 1024u * 1024u;
+constexpr uint32_t kReadThresholdNumBytes = 64u * 1024u;
+
+class CountingDrainerClient : public DataPipeDrainer::Client {
+ public:
+  CountingDrainerClient() {}
+  ~CountingDrainerClient() override {}
+
+  uint64_t num_bytes() const { return num_bytes_; }
+
+  // |DataPipeDrainer::Client|:
+  void OnDataAvailable(const void* /*data*/, size_t num_bytes) override {
+    num_bytes_ += num_bytes;
+  }
+  void OnDataComplete() override { RunLoop::current()->Quit(); }
+
+ private:
+  uint64_t num_bytes_ = 0u;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(CountingDrainerClient);
+};
+
+// Writes |kTotalNumBytes| to |producer| in chunks of |chunk_num_bytes|, then
+// closes it.
+void WriteAll(ScopedDataPipeProducerHandle producer, uint32_t chunk_num_bytes) {
+  std::vector<char> chunk(chunk_num_bytes, 'x');
+  uint64_t num_bytes_left = kTotalNumBytes;
+  while (num_bytes_left) {
+    uint32_t num_bytes = static_cast<uint32_t>(
+        std::min(static_cast<uint64_t>(chunk_num_bytes), num_bytes_left));
+    MojoResult result = WriteDataRaw(producer.get(), chunk.data(), &num_bytes,
+                                     MOJO_WRITE_DATA_FLAG_NONE);
+    if (result == MOJO_SYSTEM_RESULT_SHOULD_WAIT) {
+      result = Wait(producer.get(), MOJO_HANDLE_SIGNAL_WRITABLE,
+                    MOJO_DEADLINE_INDEFINITE, nullptr);
+      ASSERT_EQ(MOJO_RESULT_OK, result);
+      continue;
+    }
+    ASSERT_EQ(MOJO_RESULT_OK, result);
+    num_bytes_left -= num_bytes;
+  }
+}
+
+void DoStreamingPerfTest(const char* test_name,
+                         uint32_t read_threshold_num_bytes) {
+  static const uint32_t kChunkSizes[] = {64u, 1024u, 16u * 1024u, 64u * 1024u};
+  for (uint32_t chunk_num_bytes : kChunkSizes) {
+    RunLoop run_loop;
+
+    const MojoCreateDataPipeOptions options = {
+        static_cast<uint32_t>(sizeof(MojoCreateDataPipeOptions)),
+        MOJO_CREATE_DATA_PIPE_OPTIONS_FLAG_NONE, 1u, kCapacityNumBytes};
+    DataPipe data_pipe(options);
+
+    CountingDrainerClient client;
+    DataPipeDrainer drainer(&client, data_pipe.consumer_handle.Pass(),
+                            read_threshold_num_bytes);
+
+    MojoTimeTicks start_time = MojoGetTimeTicksNow();
+    std::thread writer(WriteAll, data_pipe.producer_handle.Pass(),
+                       chunk_num_bytes);
+    run_loop.Run();
+    MojoTimeTicks end_time = MojoGetTimeTicksNow();
+    writer.join();
+
+    EXPECT_EQ(kTotalNumBytes, client.num_bytes());
+
+    static constexpr double kNumMegabytes =
+        static_cast<double>(kTotalNumBytes) / (1024.0 * 1024.0);
+    char sub_test_name[100] = {};
+    sprintf(sub_test_name, "%uByteChunks",
+            static_cast<unsigned>(chunk_num_bytes));
+    test::LogPerfResult(test_name, sub_test_name,
+                        kNumMegabytes /
+                            (static_cast<double>(end_time - start_time) /
+                             1000000.0),
+                        "MB/second");
+    test::LogPerfResult(
+        test_name, sub_test_name,
+        static_cast<double>(drainer.stats().num_wakeups) / kNumMegabytes,
+        "wakeups/MB");
+  }
+}
+
+TEST(DataPipePerftest, StreamReadable) {
+  DoStreamingPerfTest("DataPipePerftest.StreamReadable", 0u);
+}
+
+TEST(DataPipePerftest, StreamReadThreshold) {
+  DoStreamingPerfTest("DataPipePerftest.StreamReadThreshold",
+                      kReadThresholdNumBytes);
+}
+
+}  // namespace
+}  // namespace mojo
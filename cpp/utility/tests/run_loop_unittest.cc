@@ -5,6 +5,7 @@
 #include "mojo/public/cpp/utility/run_loop.h"
 
 #include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "mojo/public/cpp/system/macros.h"
@@ -153,6 +154,92 @@ TEST(RunLoopTest, QuitFromReady) {
   }
 }
 
+// Verifies that a handler whose handle was ready when Quit() was called (by
+// another handler) still gets notified by a subsequent Run().
+TEST(RunLoopTest, QuitFromReadyWithOtherHandleReady) {
+  QuitOnReadyRunLoopHandler handler;
+  MessagePipe test_pipe;
+  EXPECT_TRUE(test::WriteTextMessage(test_pipe.handle0.get(), std::string()));
+  EXPECT_TRUE(test::WriteTextMessage(test_pipe.handle1.get(), std::string()));
+
+  RunLoop run_loop;
+  handler.set_run_loop(&run_loop);
+  run_loop.AddHandler(&handler, test_pipe.handle0.get(),
+                      MOJO_HANDLE_SIGNAL_READABLE, MOJO_DEADLINE_INDEFINITE);
+  run_loop.AddHandler(&handler, test_pipe.handle1.get(),
+                      MOJO_HANDLE_SIGNAL_READABLE, MOJO_DEADLINE_INDEFINITE);
+  run_loop.Run();
+  EXPECT_EQ(1, handler.ready_count());
+  EXPECT_EQ(1u, run_loop.num_handlers());
+
+  run_loop.Run();
+  EXPECT_EQ(2, handler.ready_count());
+  EXPECT_EQ(0, handler.error_count());
+  EXPECT_EQ(0u, run_loop.num_handlers());
+}
+
+// Verifies that handlers added and removed in bulk (between iterations) are
+// handled correctly.
+TEST(RunLoopTest, AddAndRemoveManyHandlers) {
+  constexpr size_t kNumPipes = 1000u;
+
+  TestRunLoopHandler handler;
+  std::vector<MessagePipe> pipes(kNumPipes);
+  RunLoop run_loop;
+  std::vector<RunLoopHandler::Id> ids;
+  for (size_t i = 0u; i < kNumPipes; i++) {
+    EXPECT_TRUE(test::WriteTextMessage(pipes[i].handle1.get(), std::string()));
+    ids.push_back(run_loop.AddHandler(&handler, pipes[i].handle0.get(),
+                                      MOJO_HANDLE_SIGNAL_READABLE,
+                                      MOJO_DEADLINE_INDEFINITE));
+  }
+  // Remove every other handler (before any of them have been added to the
+  // underlying wait set).
+  for (size_t i = 0u; i < kNumPipes; i += 2u)
+    run_loop.RemoveHandler(ids[i]);
+  EXPECT_EQ(kNumPipes / 2u, run_loop.num_handlers());
+
+  run_loop.Run();
+  EXPECT_EQ(static_cast<int>(kNumPipes / 2u), handler.ready_count());
+  EXPECT_EQ(0, handler.error_count());
+  EXPECT_EQ(0u, run_loop.num_handlers());
+
+  // Add them all again, and remove them all after the loop has started
+  // watching them.
+  ids.clear();
+  for (size_t i = 0u; i < kNumPipes; i++) {
+    ids.push_back(run_loop.AddHandler(&handler, pipes[i].handle1.get(),
+                                      MOJO_HANDLE_SIGNAL_READABLE,
+                                      MOJO_DEADLINE_INDEFINITE));
+  }
+  run_loop.RunUntilIdle();
+  EXPECT_EQ(kNumPipes, run_loop.num_handlers());
+  for (auto id : ids)
+    run_loop.RemoveHandler(id);
+  EXPECT_EQ(0u, run_loop.num_handlers());
+  run_loop.RunUntilIdle();
+  EXPECT_EQ(static_cast<int>(kNumPipes / 2u), handler.ready_count());
+  EXPECT_EQ(0, handler.error_count());
+}
+
+// Verifies that a handler whose handle is closed before the loop gets around
+// to watching it gets notified.
+TEST(RunLoopTest, HandleClosedBeforeRun) {
+  TestRunLoopHandler handler;
+  MessagePipe test_pipe;
+  RunLoop run_loop;
+  auto id = run_loop.AddHandler(&handler, test_pipe.handle0.get(),
+                                MOJO_HANDLE_SIGNAL_READABLE,
+                                MOJO_DEADLINE_INDEFINITE);
+  handler.set_expected_handler_id(id);
+  test_pipe.handle0.reset();
+  run_loop.Run();
+  EXPECT_EQ(0, handler.ready_count());
+  EXPECT_EQ(1, handler.error_count());
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_CANCELLED, handler.last_error_result());
+  EXPECT_EQ(0u, run_loop.num_handlers());
+}
+
 class QuitOnErrorRunLoopHandler : public TestRunLoopHandler {
  public:
   QuitOnErrorRunLoopHandler() {}
@@ -296,6 +383,59 @@ TEST(RunLoopTest, AddHandlerOnError) {
   EXPECT_EQ(2, handler.error_count());
 }
 
+// Adds a handler for |handle_| the first time its OnHandleError() is called,
+// and quits the loop once that handle is ready.
+class AddHandlerOnCancelledHandler : public TestRunLoopHandler {
+ public:
+  AddHandlerOnCancelledHandler() {}
+  ~AddHandlerOnCancelledHandler() override {}
+
+  void set_run_loop(RunLoop* run_loop) { run_loop_ = run_loop; }
+  void set_handle(Handle handle) { handle_ = handle; }
+
+  // RunLoopHandler:
+  void OnHandleReady(Id id) override {
+    run_loop_->Quit();
+    TestRunLoopHandler::OnHandleReady(id);
+  }
+
+  void OnHandleError(Id id, MojoResult result) override {
+    TestRunLoopHandler::OnHandleError(id, result);
+    if (error_count() == 1) {
+      run_loop_->AddHandler(this, handle_, MOJO_HANDLE_SIGNAL_READABLE,
+                            MOJO_DEADLINE_INDEFINITE);
+    }
+  }
+
+ private:
+  RunLoop* run_loop_ = nullptr;
+  Handle handle_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(AddHandlerOnCancelledHandler);
+};
+
+// Verifies that a handler added by an OnHandleError() called while the wait
+// set is brought up to date is waited on (rather than the loop blocking
+// without it).
+TEST(RunLoopTest, AddHandlerOnErrorBeforeWait) {
+  AddHandlerOnCancelledHandler handler;
+  MessagePipe closed_pipe;
+  MessagePipe test_pipe;
+  EXPECT_TRUE(test::WriteTextMessage(test_pipe.handle1.get(), std::string()));
+
+  RunLoop run_loop;
+  handler.set_run_loop(&run_loop);
+  handler.set_handle(test_pipe.handle0.get());
+  run_loop.AddHandler(&handler, closed_pipe.handle0.get(),
+                      MOJO_HANDLE_SIGNAL_READABLE, MOJO_DEADLINE_INDEFINITE);
+  closed_pipe.handle0.reset();
+  run_loop.Run();
+  EXPECT_EQ(1, handler.error_count());
+  EXPECT_EQ(MOJO_SYSTEM_RESULT_CANCELLED, handler.last_error_result());
+  EXPECT_EQ(1, handler.ready_count());
+  EXPECT_EQ(0u, run_loop.num_handlers());
+}
+
 TEST(RunLoopTest, Current) {
   EXPECT_TRUE(RunLoop::current() == nullptr);
   {
@@ -348,3 +348,26 @@ MojoResult MojoWaitSetWait(MojoHandle wait_set_handle,
   return irt_mojo->MojoWaitSetWait(wait_set_handle, deadline, num_results,
                                    results, max_results);
 }
+
+MojoResult MojoWaitSetAddMany(MojoHandle wait_set_handle,
+                              const struct MojoWaitSetEntry* entries,
+                              uint32_t num_entries,
+                              const struct MojoWaitSetAddOptions* options,
+                              MojoResult* results) {
+  struct nacl_irt_mojo* irt_mojo = get_irt_mojo();
+  if (!irt_mojo)
+    abort();
+  return irt_mojo->MojoWaitSetAddMany(wait_set_handle, entries, num_entries,
+                                      options, results);
+}
+
+MojoResult MojoWaitSetRemoveMany(MojoHandle wait_set_handle,
+                                 const uint64_t* cookies,
+                                 uint32_t num_cookies,
+                                 MojoResult* results) {
+  struct nacl_irt_mojo* irt_mojo = get_irt_mojo();
+  if (!irt_mojo)
+    abort();
+  return irt_mojo->MojoWaitSetRemoveMany(wait_set_handle, cookies, num_cookies,
+                                         results);
+}
@@ -124,6 +124,16 @@ struct nacl_irt_mojo {
                                 uint32_t* num_results,
                                 struct MojoWaitSetResult* results,
                                 uint32_t* max_results);
+  MojoResult (*MojoWaitSetAddMany)(
+      MojoHandle wait_set_handle,
+      const struct MojoWaitSetEntry* entries,
+      uint32_t num_entries,
+      const struct MojoWaitSetAddOptions* options,
+      MojoResult* results);
+  MojoResult (*MojoWaitSetRemoveMany)(MojoHandle wait_set_handle,
+                                      const uint64_t* cookies,
+                                      uint32_t num_cookies,
+                                      MojoResult* results);
 };
 
 #endif  // MOJO_PUBLIC_PLATFORM_NACL_MOJO_IRT_H_
@@ -256,6 +256,25 @@ MojoResult MojoWaitSetWait(MojoHandle wait_set_handle,
                               max_results);
 }
 
+MojoResult MojoWaitSetAddMany(MojoHandle wait_set_handle,
+                              const struct MojoWaitSetEntry* entries,
+                              uint32_t num_entries,
+                              const struct MojoWaitSetAddOptions* options,
+                              MojoResult* results) {
+  assert(g_thunks.WaitSetAddMany);
+  return g_thunks.WaitSetAddMany(wait_set_handle, entries, num_entries, options,
+                                 results);
+}
+
+MojoResult MojoWaitSetRemoveMany(MojoHandle wait_set_handle,
+                                 const uint64_t* cookies,
+                                 uint32_t num_cookies,
+                                 MojoResult* results) {
+  assert(g_thunks.WaitSetRemoveMany);
+  return g_thunks.WaitSetRemoveMany(wait_set_handle, cookies, num_cookies,
+                                    results);
+}
+
 THUNK_EXPORT size_t
 MojoSetSystemThunks(const struct MojoSystemThunks* system_thunks) {
   if (system_thunks->size >= sizeof(g_thunks))
@@ -149,6 +149,15 @@ struct MojoSystemThunks {
                             uint32_t* num_results,
                             struct MojoWaitSetResult* results,
                             uint32_t* max_results);
+  MojoResult (*WaitSetAddMany)(MojoHandle wait_set_handle,
+                               const struct MojoWaitSetEntry* entries,
+                               uint32_t num_entries,
+                               const struct MojoWaitSetAddOptions* options,
+                               MojoResult* results);
+  MojoResult (*WaitSetRemoveMany)(MojoHandle wait_set_handle,
+                                  const uint64_t* cookies,
+                                  uint32_t num_cookies,
+                                  MojoResult* results);
 };
 #pragma pack(pop)
 
@@ -189,6 +198,8 @@ inline MojoSystemThunks MojoMakeSystemThunks() {
       MojoWaitSetAdd,
       MojoWaitSetRemove,
       MojoWaitSetWait,
+      MojoWaitSetAddMany,
+      MojoWaitSetRemoveMany,
   };
   return system_thunks;
 }
@@ -185,6 +185,9 @@ cdef extern from "mojo/system/buffer.h" nogil:
 
   ctypedef uint32_t MojoMapBufferFlags
   const MojoMapBufferFlags MOJO_MAP_BUFFER_FLAG_NONE
+  const MojoMapBufferFlags MOJO_MAP_BUFFER_FLAG_READ_ONLY
+  const MojoMapBufferFlags MOJO_MAP_BUFFER_FLAG_PREFAULT
+  const MojoMapBufferFlags MOJO_MAP_BUFFER_FLAG_HUGE_PAGES
 
   MojoResult MojoCreateSharedBuffer(
       const MojoCreateSharedBufferOptions* options,
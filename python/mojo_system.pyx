@@ -74,6 +74,9 @@ READ_DATA_FLAG_DISCARD = c_core.MOJO_READ_DATA_FLAG_DISCARD
 READ_DATA_FLAG_QUERY = c_core.MOJO_READ_DATA_FLAG_QUERY
 READ_DATA_FLAG_PEEK = c_core.MOJO_READ_DATA_FLAG_PEEK
 MAP_BUFFER_FLAG_NONE = c_core.MOJO_MAP_BUFFER_FLAG_NONE
+MAP_BUFFER_FLAG_READ_ONLY = c_core.MOJO_MAP_BUFFER_FLAG_READ_ONLY
+MAP_BUFFER_FLAG_PREFAULT = c_core.MOJO_MAP_BUFFER_FLAG_PREFAULT
+MAP_BUFFER_FLAG_HUGE_PAGES = c_core.MOJO_MAP_BUFFER_FLAG_HUGE_PAGES
 
 _WAITMANY_NO_SIGNAL_STATE_ERRORS = [SYSTEM_RESULT_INVALID_ARGUMENT,
                                     SYSTEM_RESULT_RESOURCE_EXHAUSTED]
@@ -9,6 +9,7 @@ import mojom.generate.module as mojom
 import mojom.generate.pack as pack
 from mojom.generate.template_expander import UseJinja
 
+GENERATOR_PREFIX = 'cpp'
 
 _kind_to_cpp_type = {
   mojom.BOOL:                  "bool",
@@ -344,6 +345,26 @@ def ShouldInlineStruct(struct):
 def ShouldInlineUnion(union):
   return not any(mojom.IsMoveOnlyKind(field.kind) for field in union.fields)
 
+def GetMethodPriority(method):
+  """Returns the dispatch priority given by the [Priority] attribute of
+  |method|, or 0 if it has none."""
+  if method.attributes and 'Priority' in method.attributes:
+    return int(method.attributes['Priority'])
+  return 0
+
+def MethodCoalesces(method):
+  """Returns whether |method| has the [Coalesce] attribute, i.e., whether its
+  proxy sends identical calls awaiting their response just once."""
+  if not method.attributes or 'Coalesce' not in method.attributes:
+    return False
+  if method.response_parameters is None:
+    raise Exception("[Coalesce] method %s has no response" % method.name)
+  for param in method.parameters + method.response_parameters:
+    if not mojom.IsCloneableKind(param.kind):
+      raise Exception("[Coalesce] method %s has parameter %s with handles" %
+                      (method.name, param.name))
+  return True
+
 def GetArrayValidateParamsCtorArgs(kind):
   if mojom.IsStringKind(kind):
     expected_num_elements = 0
@@ -379,8 +400,14 @@ def GetMapValidateParamsCtorArgs(value_kind):
 
 class Generator(generator.Generator):
 
+  # Whether response callbacks should be move-only |mojo::InlineCallback|s
+  # (passed by value) rather than |mojo::Callback|s.
+  use_inline_callbacks = False
+
   cpp_filters = {
     "constant_value": ConstantValue,
+    "contains_handles": lambda kind: mojom.ContainsHandles(kind, set()),
+    "contains_pointers": mojom.ContainsPointers,
     "cpp_const_wrapper_type": GetCppConstWrapperType,
     "cpp_field_type": GetCppFieldType,
     "cpp_union_field_type": GetCppUnionFieldType,
@@ -391,6 +418,7 @@ class Generator(generator.Generator):
     "cpp_wrapper_type": GetCppWrapperType,
     "default_value": DefaultValue,
     "expression_to_text": ExpressionToText,
+    "fixed_serialized_size": pack.GetFixedSerializedSize,
     "get_array_validate_params_ctor_args": GetArrayValidateParamsCtorArgs,
     "get_map_validate_params_ctor_args": GetMapValidateParamsCtorArgs,
     "get_name_for_kind": GetNameForKind,
@@ -412,6 +440,9 @@ class Generator(generator.Generator):
     "is_string_kind": mojom.IsStringKind,
     "is_struct_kind": mojom.IsStructKind,
     "is_union_kind": mojom.IsUnionKind,
+    "method_coalesces": MethodCoalesces,
+    "method_priority": GetMethodPriority,
+    "num_bytes_by_version": pack.GetNumBytesByVersion,
     "struct_size": lambda ps: ps.GetTotalSize() + _HEADER_SIZE,
     "stylize_method": generator.StudlyCapsToCamel,
     "to_all_caps": generator.CamelCaseToAllCaps,
@@ -429,6 +460,7 @@ class Generator(generator.Generator):
       "structs": self.GetStructs(),
       "unions": self.GetUnions(),
       "interfaces": self.GetInterfaces(),
+      "use_inline_callbacks": self.use_inline_callbacks,
     }
 
   @UseJinja("cpp_templates/module.h.tmpl", filters=cpp_filters)
@@ -460,6 +492,8 @@ class Generator(generator.Generator):
     return self.GetJinjaExports()
 
   def GenerateFiles(self, args):
+    self.use_inline_callbacks = "--cpp_inline_callbacks" in args
+
     self.Write(self.GenerateModuleHeader(),
         self.MatchMojomFilePath("%s.h" % self.module.name))
     self.Write(self.GenerateModuleInternalHeader(),
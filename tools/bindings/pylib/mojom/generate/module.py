@@ -579,6 +579,18 @@ def ContainsHandles(kind, visited_kinds):
   return False
 
 
+def ContainsPointers(kind):
+  """Returns whether the serialized form of |kind| refers to any out-of-line
+  data, either directly or through (the inline data of) a union."""
+  if IsUnionKind(kind):
+    return any(IsObjectKind(field.kind) for field in kind.fields)
+  if IsStructKind(kind):
+    return any(IsPointerKind(field.kind) or
+               (IsUnionKind(field.kind) and ContainsPointers(field.kind))
+               for field in kind.fields)
+  return IsPointerKind(kind)
+
+
 def IsCloneableKind(kind):
   return not ContainsHandles(kind, set())
 
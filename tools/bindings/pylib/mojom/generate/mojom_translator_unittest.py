@@ -683,6 +683,7 @@ class TestUserDefinedTypeFromMojom(unittest.TestCase):
     self.assertEquals(mojom_method.ordinal, method.ordinal)
     self.assertEquals(mojom_method.min_version, method.min_version)
     self.assertIsNone(method.response_parameters)
+    self.assertIsNone(method.attributes)
     self.assertEquals(
         len(mojom_method.parameters.fields), len(method.parameters))
     self.assertEquals(param1.decl_data.short_name, method.parameters[0].name)
@@ -711,6 +712,12 @@ class TestUserDefinedTypeFromMojom(unittest.TestCase):
     self.assertEquals(
         param1.decl_data.short_name, method.response_parameters[0].name)
 
+    # Add attributes.
+    mojom_method.decl_data.attributes = [mojom_types_mojom.Attribute(
+        key='Priority', value=self.literal_value(5))]
+    method = translator.MethodFromMojom(mojom_method, interface)
+    self.assertEquals({'Priority': 5}, method.attributes)
+
   def test_parameter(self):
     # Parameters are encoded as fields in a struct.
     mojom_param = mojom_types_mojom.StructField(
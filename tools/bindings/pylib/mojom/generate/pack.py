@@ -92,6 +92,32 @@ class PackedStruct(object):
         self.packed_fields_in_ordinal_order]
     self.packed_fields.sort(key=lambda f: (f.offset, f.bit))
 
+
+def GetFixedSerializedSize(struct, structs_in_progress=None):
+  """Returns the number of bytes that any instance of |struct| (of its latest
+  version) serializes to, including everything it refers to, or 0 if that
+  depends on the instance. That is the case as soon as |struct| refers to a
+  string, array or map, or to a nullable struct. Structs with union fields are
+  not given a fixed size either."""
+  if structs_in_progress is None:
+    structs_in_progress = set()
+  if struct in structs_in_progress:
+    return 0
+  structs_in_progress.add(struct)
+  size = struct.versions[-1].num_bytes
+  for field in struct.fields:
+    kind = field.kind
+    if mojom.IsStructKind(kind) and not mojom.IsNullableKind(kind):
+      field_size = GetFixedSerializedSize(kind, structs_in_progress)
+      if not field_size:
+        return 0
+      size += field_size
+    elif mojom.IsObjectKind(kind):
+      return 0
+  structs_in_progress.remove(struct)
+  return size
+
+
 class ByteInfo(object):
   def __init__(self):
     self.is_padding = False
@@ -125,3 +151,14 @@ class VersionInfo(object):
     self.num_fields = num_fields
     self.num_bytes = num_bytes
 
+
+def GetNumBytesByVersion(struct):
+  """Returns a list, indexed by version, of the size of |struct| for each of its
+  versions up to the latest one. A version that isn't in |struct.versions| has
+  the size of the most recent version before it."""
+  num_bytes_by_version = []
+  for version_info in struct.versions:
+    while len(num_bytes_by_version) < version_info.version:
+      num_bytes_by_version.append(num_bytes_by_version[-1])
+    num_bytes_by_version.append(version_info.num_bytes)
+  return num_bytes_by_version
@@ -35,3 +35,50 @@ class ModuleTest(unittest.TestCase):
     self.assertEquals(
         e.exception.__str__(),
         'Interface request requires \'x:TestStruct\' to be an interface.')
+
+  def testContainsPointers(self):
+    """Tests which kinds refer to out-of-line data."""
+    module = mojom.Module('test_module', 'test_namespace')
+    self.assertFalse(mojom.ContainsPointers(mojom.INT32))
+    self.assertFalse(mojom.ContainsPointers(mojom.HANDLE))
+    self.assertTrue(mojom.ContainsPointers(mojom.STRING))
+    self.assertTrue(mojom.ContainsPointers(mojom.Array(mojom.INT32)))
+    self.assertTrue(
+        mojom.ContainsPointers(mojom.Map(mojom.STRING, mojom.INT32)))
+
+    pod = mojom.Struct('Pod', module=module)
+    pod.AddField('a', mojom.INT32)
+    pod.AddField('h', mojom.HANDLE)
+    self.assertFalse(mojom.ContainsPointers(pod))
+
+    for kind in (mojom.STRING, mojom.NULLABLE_STRING,
+                 mojom.Array(mojom.INT32), mojom.Map(mojom.STRING, mojom.INT32),
+                 pod, pod.MakeNullableKind()):
+      struct = mojom.Struct('HasPointer', module=module)
+      struct.AddField('a', mojom.INT32)
+      struct.AddField('p', kind)
+      self.assertTrue(mojom.ContainsPointers(struct), kind.spec)
+
+    # A union's fields are inline, so a union of plain data doesn't make a
+    # struct refer to anything, but one with an object field does.
+    pod_union = mojom.Union('PodUnion', module=module)
+    pod_union.AddField('a', mojom.INT32)
+    pod_union.AddField('b', mojom.DOUBLE)
+    self.assertFalse(mojom.ContainsPointers(pod_union))
+    struct = mojom.Struct('HasPodUnion', module=module)
+    struct.AddField('u', pod_union)
+    self.assertFalse(mojom.ContainsPointers(struct))
+
+    for kind in (mojom.STRING, pod, pod_union):
+      union = mojom.Union('ObjectUnion', module=module)
+      union.AddField('a', mojom.INT32)
+      union.AddField('o', kind)
+      self.assertTrue(mojom.ContainsPointers(union), kind.spec)
+      struct = mojom.Struct('HasObjectUnion', module=module)
+      struct.AddField('u', union)
+      self.assertTrue(mojom.ContainsPointers(struct), kind.spec)
+
+    node = mojom.Struct('Node', module=module)
+    node.AddField('value', mojom.INT32)
+    node.AddField('next', node.MakeNullableKind())
+    self.assertTrue(mojom.ContainsPointers(node))
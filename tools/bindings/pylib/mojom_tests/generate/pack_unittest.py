@@ -0,0 +1,109 @@
+# Copyright 2016 The Chromium Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+import imp
+import os.path
+import sys
+import unittest
+
+def _GetDirAbove(dirname):
+  """Returns the directory "above" this file containing |dirname| (which must
+  also be "above" this file)."""
+  path = os.path.abspath(__file__)
+  while True:
+    path, tail = os.path.split(path)
+    assert tail
+    if tail == dirname:
+      return path
+
+try:
+  imp.find_module("mojom")
+except ImportError:
+  sys.path.append(os.path.join(_GetDirAbove("pylib"), "pylib"))
+from mojom.generate import module as mojom
+from mojom.generate import pack
+
+
+def _MakeStruct(module, name, num_bytes, fields=()):
+  """Returns a struct with |fields| (pairs of name and kind) whose latest
+  version is |num_bytes| long."""
+  struct = mojom.Struct(name, module=module)
+  for field_name, kind in fields:
+    struct.AddField(field_name, kind)
+  struct.versions = [pack.VersionInfo(0, len(struct.fields), num_bytes)]
+  return struct
+
+
+class GetFixedSerializedSizeTest(unittest.TestCase):
+
+  def setUp(self):
+    self.module = mojom.Module('test_module', 'test_namespace')
+    self.pod = _MakeStruct(self.module, 'Pod', 16,
+                           [('a', mojom.INT32), ('b', mojom.DOUBLE)])
+
+  def testPod(self):
+    """Tests that a struct without pointers has its own size."""
+    self.assertEquals(16, pack.GetFixedSerializedSize(self.pod))
+
+  def testNestedStructs(self):
+    """Tests that the sizes of non-nullable nested structs are summed."""
+    pair = _MakeStruct(self.module, 'Pair', 24,
+                       [('first', self.pod), ('second', self.pod)])
+    self.assertEquals(24 + 2 * 16, pack.GetFixedSerializedSize(pair))
+    outer = _MakeStruct(self.module, 'Outer', 24,
+                        [('pair', pair), ('pod', self.pod)])
+    self.assertEquals(24 + (24 + 2 * 16) + 16,
+                      pack.GetFixedSerializedSize(outer))
+
+  def testNullableStruct(self):
+    """Tests that a nullable struct field makes the size vary."""
+    struct = _MakeStruct(self.module, 'HasNullable', 16,
+                         [('pod', self.pod.MakeNullableKind())])
+    self.assertEquals(0, pack.GetFixedSerializedSize(struct))
+    outer = _MakeStruct(self.module, 'Outer', 16, [('inner', struct)])
+    self.assertEquals(0, pack.GetFixedSerializedSize(outer))
+
+  def testUnion(self):
+    """Tests that a union field makes the size vary, even if the union has no
+    pointers."""
+    union = mojom.Union('PodUnion', module=self.module)
+    union.AddField('a', mojom.INT32)
+    union.AddField('b', mojom.DOUBLE)
+    struct = _MakeStruct(self.module, 'HasUnion', 24, [('u', union)])
+    self.assertEquals(0, pack.GetFixedSerializedSize(struct))
+
+  def testStringArrayAndMap(self):
+    """Tests that string, array and map fields make the size vary."""
+    for kind in (mojom.STRING, mojom.Array(mojom.INT32),
+                 mojom.Array(mojom.INT32, 4),
+                 mojom.Map(mojom.STRING, mojom.INT32)):
+      struct = _MakeStruct(self.module, 'HasObject', 16, [('o', kind)])
+      self.assertEquals(0, pack.GetFixedSerializedSize(struct), kind.spec)
+
+  def testSelfReferential(self):
+    """Tests that a struct that refers to itself has no fixed size."""
+    node = mojom.Struct('Node', module=self.module)
+    node.AddField('value', mojom.INT32)
+    node.AddField('next', node.MakeNullableKind())
+    node.versions = [pack.VersionInfo(0, 2, 24)]
+    self.assertEquals(0, pack.GetFixedSerializedSize(node))
+
+
+class GetNumBytesByVersionTest(unittest.TestCase):
+
+  def testContiguousVersions(self):
+    """Tests that each version has its own size."""
+    struct = mojom.Struct('Struct')
+    struct.versions = [pack.VersionInfo(0, 1, 16), pack.VersionInfo(1, 2, 24),
+                       pack.VersionInfo(2, 3, 32)]
+    self.assertEquals([16, 24, 32], pack.GetNumBytesByVersion(struct))
+
+  def testMissingVersions(self):
+    """Tests that a version without fields of its own has the size of the
+    version before it."""
+    struct = mojom.Struct('Struct')
+    struct.versions = [pack.VersionInfo(0, 1, 16), pack.VersionInfo(2, 2, 24),
+                       pack.VersionInfo(5, 4, 40)]
+    self.assertEquals([16, 16, 24, 24, 24, 40],
+                      pack.GetNumBytesByVersion(struct))